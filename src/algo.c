@@ -18,16 +18,20 @@
  */
 
 
+#include <stdlib.h>
+#include <pthread.h>
+
 #include "algo.h"
 #include "utils.h"
 #include "fitness.h"
+#include "timing.h"
 
 
 bool _should_apply_baldwin(bool is_better, algo_data_t *wd)
 {
     if (wd->config->algorithm == baldwin) {
         int diff = (wd->cgp_population->generation
-                    - wd->baldwin_state.last_applied_generation);
+                    - atomic_load(&wd->baldwin_state.last_applied_generation));
 
         if (is_better || (wd->config->bw_interval && diff >= wd->config->bw_interval)) {
             return true;
@@ -39,215 +43,580 @@ bool _should_apply_baldwin(bool is_better, algo_data_t *wd)
 
 
 /**
- * CGP main loop
+ * Appends current generation to binary trace
  * @param  wd (= work_data)
- * @return Program return value
+ * @param  predicted_fitness
+ * @param  real_fitness
+ * @param  real_fitness_known Whether real fitness was calculated now
+ * @param  pred_view Predictor archive view used in this generation
  */
-int cgp_main(algo_data_t *wd)
+static void _cgp_trace_generation(algo_data_t *wd,
+    ga_fitness_t predicted_fitness, ga_fitness_t real_fitness,
+    bool real_fitness_known, arc_view_t pred_view)
+{
+    trace_record_t record = {
+        .generation = wd->cgp_population->generation,
+        .flags = real_fitness_known? TRACE_REAL_MEASURED : 0,
+        .predicted_fitness = predicted_fitness,
+        .real_fitness = real_fitness,
+        .active_predictor_fitness = -1,
+        .pred_length = -1,
+        .pred_used_length = -1,
+        .cgp_evals = fitness_get_cgp_evals(),
+    };
+
+    if (pred_view) {
+        ga_chr_t predictor = arc_view_get(pred_view, 0);
+        record.active_predictor_fitness = predictor->fitness;
+        record.pred_length = pred_get_length();
+        record.pred_used_length = ((pred_genome_t) predictor->genome)->used_pixels;
+    }
+
+    trace_append(wd->trace, &record);
+}
+
+
+/**
+ * Finishes CGP generation - checks stop conditions, updates archive,
+ * schedules baldwin parameters change and fires log events
+ * @param  wd (= work_data)
+ * @param  cgp_parent_fitness Best fitness before this generation
+ * @param  pred_view Predictor archive view used in this generation
+ * @return Received signal code, zero if none
+ */
+static int _cgp_finish_generation(algo_data_t *wd,
+    ga_fitness_t cgp_parent_fitness, arc_view_t pred_view)
 {
     history_entry_t current_history_entry;
     finish_reason_t finish_reason;
+    ga_fitness_t predicted_fitness;
+    ga_fitness_t real_fitness = 0;
+    bool real_fitness_known = true;
 
-    /* A. log start */
-    logger_fire(&wd->loggers, started, history_last(&wd->history));
 
-    /* B. "Infinite" loop */
-    while (!(wd->finished)) {
-        ga_fitness_t cgp_parent_fitness;
-        ga_fitness_t predicted_fitness;
-        ga_fitness_t real_fitness = 0;
+    /* check stop conditions **************************************************/
 
 
-        /* advance to next generation *****************************************/
+    int received_signal = check_signals(wd->cgp_population->generation);
 
+    // last generation?
+    if (wd->cgp_population->generation >= wd->config->max_generations) {
+        finish_reason = generation_limit;
+        wd->finished = true;
+    }
+
+    // target fitness achieved?
+    if (wd->config->target_fitness != 0
+        && wd->cgp_population->best_fitness >= wd->config->target_fitness)
+    {
+        finish_reason = target_fitness;
+        wd->finished = true;
+    }
+
+    // signal received
+    if (received_signal > 0) {
+        // stop other threads
+        finish_reason = received_signal;
+        wd->finished = true;
+    }
+
+
+    /* various checks**********************************************************/
 
-        #pragma omp critical (PRED_ARCHIVE__CGP_POP)
-        {
-            cgp_parent_fitness = wd->cgp_population->best_fitness;
-            // create children and evaluate new generation
-            ga_next_generation(wd->cgp_population);
-        }
 
+    // whether we found better solution
+    bool is_better = ga_is_better(wd->cgp_population->problem_type,
+        wd->cgp_population->best_fitness, cgp_parent_fitness);
 
-        /* check stop conditions **********************************************/
+    // whether we should log now
+    bool log_tick_now = wd->config->log_interval
+        && ((wd->cgp_population->generation % wd->config->log_interval) == 0);
 
+    // whether we update evolution params now
+    bool apply_baldwin_now = _should_apply_baldwin(is_better, wd);
 
-        int received_signal = check_signals(wd->cgp_population->generation);
+    // whether we should append entry to history log
+    bool need_history_entry_append = is_better || apply_baldwin_now;
 
-        // last generation?
-        if (wd->cgp_population->generation >= wd->config->max_generations) {
-            finish_reason = generation_limit;
-            wd->finished = true;
+    // whether we need to calculate current state for any reason
+    bool need_history_entry_calc =
+        need_history_entry_append || log_tick_now || received_signal
+        || wd->finished;
+
+
+    /* update archive, calculate real fitness if necessary ********************/
+
+
+    if (wd->config->algorithm == simple_cgp) {
+        predicted_fitness = -1;
+        real_fitness = wd->cgp_population->best_fitness;
+
+    } else {
+        /* coevolution */
+        predicted_fitness = wd->cgp_population->best_fitness;
+
+        if (is_better) {
+            // store, predictors are reevaluated by their thread
+            ga_chr_t archived = arc_insert(wd->cgp_archive,
+                wd->cgp_population->best_chromosome);
+            real_fitness = archived->fitness;
+
+        } else if (need_history_entry_calc) {
+            // the same way as archived circuits (farm, fitness cache)
+            real_fitness = arc_eval(wd->cgp_archive, wd->cgp_population->best_chromosome);
+
+        } else {
+            real_fitness_known = false;
         }
+    }
+
+
+    /* append generation to trace *********************************************/
+
 
-        // target fitness achieved?
-        if (wd->config->target_fitness != 0
-            && wd->cgp_population->best_fitness >= wd->config->target_fitness)
-        {
-            finish_reason = target_fitness;
-            wd->finished = true;
+    if (wd->trace) {
+        _cgp_trace_generation(wd, predicted_fitness, real_fitness,
+            real_fitness_known, pred_view);
+    }
+
+
+    /* change evolution params in baldwin mode ********************************/
+
+
+    // thread-safe copy
+    int new_predictor_length = 0;
+
+    if (apply_baldwin_now) {
+        // everything is done in predictors thread asynchronously
+        new_predictor_length = bw_get_new_predictor_length(&wd->config->bw_config, &wd->history);
+        if (new_predictor_length != 0) {
+            atomic_store(&wd->baldwin_state.new_predictor_length, new_predictor_length);
         }
+    }
 
-        // signal received
-        if (received_signal > 0) {
-            // stop other threads
-            finish_reason = received_signal;
-            wd->finished = true;
+
+    /* calculate and append current history entry *****************************/
+
+
+    if (need_history_entry_calc) {
+        ga_fitness_t active_predictor_fitness = -1;
+        int pred_length = -1;
+        int pred_used_length = -1;
+
+        if (wd->config->algorithm != simple_cgp) {
+            ga_chr_t predictor = arc_view_get(pred_view, 0);
+            pred_used_length = ((pred_genome_t) predictor->genome)->used_pixels,
+            active_predictor_fitness = predictor->fitness;
+            pred_length = pred_get_length();
         }
 
+        history_calc_entry(
+            &current_history_entry,
+            history_last(&wd->history),
+            wd->cgp_population->generation,
+            real_fitness,
+            predicted_fitness,
+            active_predictor_fitness,
+            fitness_get_cgp_evals(),
+            pred_length,
+            pred_used_length,
+            atomic_load(&wd->scheduler.cgp_workers),
+            atomic_load(&wd->scheduler.pred_workers)
+        );
+    }
+
+    if (need_history_entry_append) {
+        history_append_entry(&wd->history, &current_history_entry);
+    }
+
 
-        /* various checks******************************************************/
+    /* fire log events ********************************************************/
 
 
-        // whether we found better solution
-        bool is_better = ga_is_better(wd->cgp_population->problem_type,
-            wd->cgp_population->best_fitness, cgp_parent_fitness);
+#ifdef TIMING
+    // loggers print timers together with history entry
+    if (need_history_entry_calc) {
+        timing_totals_t timing_totals;
+        timing_get_totals(&timing_totals);
+        logger_fire(&wd->loggers, timing, &timing_totals);
+    }
+#endif
+
+    if (is_better) {
+        logger_fire(&wd->loggers, better_cgp, &current_history_entry);
+    } else if (log_tick_now) {
+        logger_fire(&wd->loggers, log_tick, &current_history_entry);
+    }
 
-        // whether we should log now
-        bool log_tick_now = wd->config->log_interval
-            && ((wd->cgp_population->generation % wd->config->log_interval) == 0);
+    if (received_signal) {
+        logger_fire(&wd->loggers, signal, abs(received_signal), &current_history_entry);
+    }
 
-        // whether we update evolution params now
-        bool apply_baldwin_now = _should_apply_baldwin(is_better, wd);
+    if (new_predictor_length != 0) {
+        logger_fire(&wd->loggers, pred_length_change_scheduled, new_predictor_length, &current_history_entry);
+    }
 
-        // whether we should append entry to history log
-        bool need_history_entry_append = is_better || apply_baldwin_now;
+    if (received_signal) {
+        logger_fire(&wd->loggers, signal, abs(received_signal), &current_history_entry);
+    }
 
-        // whether we need to calculate current state for any reason
-        bool need_history_entry_calc =
-            need_history_entry_append || log_tick_now || received_signal
-            || wd->finished;
+    if (wd->finished) {
+        logger_fire(&wd->loggers, finished, finish_reason, &current_history_entry, wd);
+    }
 
 
-        /* update archive, calculate real fitness if necessary ****************/
+    /* checkpoint *************************************************************/
 
 
-        if (wd->config->algorithm == simple_cgp) {
-            predicted_fitness = -1;
-            real_fitness = wd->cgp_population->best_fitness;
+    // first SIGINT does not stop evolution, but the user probably wants
+    // to have current state saved; final checkpoint is written after
+    // both threads finish
+    if (wd->checkpoint && !wd->finished) {
+        bool checkpoint_tick_now = wd->config->checkpoint_interval
+            && ((wd->cgp_population->generation % wd->config->checkpoint_interval) == 0);
 
-        } else {
-            /* coevolution */
-            predicted_fitness = wd->cgp_population->best_fitness;
-
-            if (is_better) {
-                // store and recalculate predictors fitness
-                ga_chr_t archived;
-                #pragma omp critical (CGP_ARCHIVE__PRED_POP)
-                {
-                    archived = arc_insert(wd->cgp_archive,
-                        wd->cgp_population->best_chromosome);
-                    real_fitness = archived->fitness;
-                    ga_reevaluate_pop(wd->pred_population);
-                    #pragma omp critical (PRED_ARCHIVE__CGP_POP)
-                    {
-                        ga_reevaluate_chr(wd->pred_population,
-                            arc_get(wd->pred_archive, 0));
-                    }
-                }
-
-            } else if (need_history_entry_calc) {
-                real_fitness = fitness_eval_cgp(wd->cgp_population->best_chromosome);
-            }
+        if (checkpoint_tick_now || received_signal < 0) {
+            checkpoint_capture_cgp(wd->checkpoint, wd);
         }
+    }
 
+    return received_signal;
+}
 
-        /* change evolution params in baldwin mode ****************************/
 
+/**
+ * Exchanges best circuit with other islands - publishes current parent and
+ * replaces it with migrant from preceding island, if the migrant is better
+ * or same
+ * @param  wd (= work_data)
+ * @param  pred_view Predictor archive view used in this generation
+ */
+static void _cgp_migrate(algo_data_t *wd, arc_view_t pred_view)
+{
+    ga_pop_t pop = wd->cgp_population;
+    struct cgp_genome payload;
+    ga_fitness_t sender_fitness;
 
-        // thread-safe copy
-        int new_predictor_length = 0;
+    // genome is flat structure, it can be sent as is
+    island_publish(wd->island, island_cgp, pop->best_chromosome->genome,
+        pop->best_fitness);
 
-        if (apply_baldwin_now) {
-            // everything is done in predictors thread asynchronously
-            new_predictor_length = bw_get_new_predictor_length(&wd->config->bw_config, &wd->history);
-            if (new_predictor_length != 0) {
-                #pragma omp critical (BALDWIN)
-                {
-                    wd->baldwin_state.new_predictor_length = new_predictor_length;
-                }
-            }
-        }
+    if (!island_receive(wd->island, island_cgp, &payload, &sender_fitness)) {
+        return;
+    }
 
+    // sender's fitness may be predicted by different predictor
+    ga_chr_t migrant = ga_alloc_chr(cgp_alloc_genome);
+    cgp_copy_genome(migrant->genome, &payload);
+    if (pred_view) {
+        migrant->fitness = fitness_eval_or_predict_cgp_in_view(migrant, pred_view);
+        migrant->has_fitness = true;
+    } else {
+        ga_reevaluate_chr(pop, migrant);
+    }
 
-        /* calculate and append current history entry *************************/
+    // archive is updated in `_cgp_finish_generation`, if it is an improvement
+    if (ga_is_better_or_same(pop->problem_type, migrant->fitness, pop->best_fitness)) {
+        ga_copy_chr(pop->best_chromosome, migrant, cgp_copy_genome);
+        pop->best_fitness = migrant->fitness;
+    }
 
+    ga_destroy_chr(migrant, cgp_free_genome);
+}
 
-        if (need_history_entry_calc) {
-            ga_fitness_t active_predictor_fitness = -1;
-            int pred_length = -1;
-            int pred_used_length = -1;
 
-            if (wd->config->algorithm != simple_cgp) {
-                #pragma omp critical (PRED_ARCHIVE__CGP_POP)
-                {
-                    ga_chr_t predictor = arc_get(wd->pred_archive, 0);
-                    pred_used_length = ((pred_genome_t) predictor->genome)->used_pixels,
-                    active_predictor_fitness = predictor->fitness;
-                }
+/**
+ * Returns whether islands should exchange migrants in current generation
+ * @param  wd (= work_data)
+ */
+static inline bool _should_migrate(algo_data_t *wd)
+{
+    return wd->island != NULL
+        && (wd->cgp_population->generation % wd->config->migration_interval) == 0;
+}
+
+
+/**
+ * Lock-step CGP loop, whole population is evaluated in each generation
+ * @param  wd (= work_data)
+ * @return Program return value
+ */
+static int _cgp_main_generational(algo_data_t *wd)
+{
+    // predictor archive version the population was evaluated with
+    unsigned long pred_archive_version = 0;
+
+    while (!(wd->finished)) {
+        ga_fitness_t cgp_parent_fitness;
+        arc_view_t pred_view = NULL;
 
-                pred_length = pred_get_length();
+
+        /* advance to next generation *****************************************/
+
+
+        // budget may have been changed in previous generation
+        sched_apply_cgp(&wd->scheduler);
+
+        if (wd->config->algorithm != simple_cgp) {
+            // hold current predictor for whole generation
+            pred_view = arc_read_begin(wd->pred_archive);
+
+            // predictor has changed, parents' fitness is outdated
+            if (pred_view->version != pred_archive_version) {
+                ga_reevaluate_pop(wd->cgp_population);
+                pred_archive_version = pred_view->version;
             }
+        }
 
-            history_calc_entry(
-                &current_history_entry,
-                history_last(&wd->history),
-                wd->cgp_population->generation,
-                real_fitness,
-                predicted_fitness,
-                active_predictor_fitness,
-                fitness_get_cgp_evals(),
-                pred_length,
-                pred_used_length
-            );
+        cgp_parent_fitness = wd->cgp_population->best_fitness;
+        // create children and evaluate new generation
+        ga_next_generation(wd->cgp_population);
+
+        // move workers to the side which needs them more
+        sched_rebalance(&wd->scheduler, wd->cgp_population->generation);
+
+        if (_should_migrate(wd)) {
+            _cgp_migrate(wd, pred_view);
         }
 
-        if (need_history_entry_append) {
-            history_append_entry(&wd->history, &current_history_entry);
+        int received_signal = _cgp_finish_generation(wd, cgp_parent_fitness, pred_view);
+
+        if (pred_view) {
+            arc_read_end(wd->pred_archive);
         }
 
 
-        /* fire log events ****************************************************/
+        /* return signal code, if terminated by signal ************************/
 
 
-        if (is_better) {
-            logger_fire(&wd->loggers, better_cgp, &current_history_entry);
-        } else if (log_tick_now) {
-            logger_fire(&wd->loggers, log_tick, &current_history_entry);
+        if (received_signal > 0) {
+            return received_signal;
         }
+    }
 
-        if (received_signal) {
-            logger_fire(&wd->loggers, signal, abs(received_signal), &current_history_entry);
-        }
+    return 0;
+}
 
-        if (new_predictor_length != 0) {
-            logger_fire(&wd->loggers, pred_length_change_scheduled, new_predictor_length, &current_history_entry);
+
+/*
+    State shared by asynchronous CGP workers
+ */
+typedef struct {
+    // guards population and everything done in `_cgp_finish_generation`
+    pthread_mutex_t lock;
+
+    // predictor archive version the parent was evaluated with
+    unsigned long pred_archive_version;
+
+    int retval;
+} _cgp_async_state_t;
+
+
+/**
+ * Asynchronous CGP worker - repeatedly mutates current parent and replaces
+ * it, if the child is better or same
+ * @param  wd (= work_data)
+ * @param  state
+ */
+static void _cgp_async_worker(algo_data_t *wd, _cgp_async_state_t *state)
+{
+    ga_pop_t pop = wd->cgp_population;
+    bool coevolution = wd->config->algorithm != simple_cgp;
+    ga_chr_t child = ga_alloc_chr(cgp_alloc_genome);
+
+    // all workers are busy with their own children, do not split
+    // evaluations into tiles
+    ga_set_workers(1);
+
+    while (!(wd->finished)) {
+        arc_view_t pred_view = NULL;
+        if (coevolution) {
+            pred_view = arc_view_acquire(wd->pred_archive);
         }
 
-        if (received_signal) {
-            logger_fire(&wd->loggers, signal, abs(received_signal), &current_history_entry);
+        TIMING_START(wait_parent);
+        pthread_mutex_lock(&state->lock);
+        TIMING_STOP(timing_wait_async_parent, wait_parent);
+        ga_copy_chr(child, pop->best_chromosome, cgp_copy_genome);
+        pthread_mutex_unlock(&state->lock);
+
+        TIMING_START(offspring);
+        cgp_mutate_chr(child);
+        TIMING_STOP(timing_cgp_offspring, offspring);
+        // the same evaluation as in generational loop, but with own view
+        if (coevolution) {
+            child->fitness = fitness_eval_or_predict_cgp_in_view(child, pred_view);
+            child->has_fitness = true;
+        } else {
+            ga_reevaluate_chr(pop, child);
         }
 
-        if (wd->finished) {
-            #pragma omp critical (CGP_ARCHIVE__PRED_POP)
+        TIMING_START(wait_finish);
+        pthread_mutex_lock(&state->lock);
+        TIMING_STOP(timing_wait_async_finish, wait_finish);
+
+        if (!(wd->finished)) {
+            // child and parent must be evaluated by the same predictor
+            bool comparable = true;
+
+            if (coevolution && pred_view->version > state->pred_archive_version) {
+                // predictor has changed, parent's fitness is outdated -
+                // rescore it with the view the child was scored with
+                ga_chr_t parent = pop->best_chromosome;
+                parent->fitness = fitness_eval_or_predict_cgp_in_view(parent, pred_view);
+                parent->has_fitness = true;
+                pop->best_fitness = parent->fitness;
+                state->pred_archive_version = pred_view->version;
+
+            } else if (coevolution && pred_view->version < state->pred_archive_version) {
+                comparable = false;
+            }
+
+            ga_fitness_t cgp_parent_fitness = pop->best_fitness;
+
+            if (comparable && ga_is_better_or_same(pop->problem_type,
+                child->fitness, cgp_parent_fitness))
             {
-                #pragma omp critical (PRED_ARCHIVE__CGP_POP)
-                {
-                    logger_fire(&wd->loggers, finished, finish_reason, &current_history_entry, wd);
-                }
+                // population chromosomes live in its arena, so child is
+                // copied over parent (packed genome is just few cache lines)
+                ga_copy_chr(pop->best_chromosome, child, cgp_copy_genome);
+                pop->best_fitness = child->fitness;
             }
-        }
 
+            // every evaluation counts as generation
+            pop->generation++;
+            sched_rebalance(&wd->scheduler, pop->generation);
 
-        /* return signal code, if terminated by signal ************************/
+            if (comparable && _should_migrate(wd)) {
+                _cgp_migrate(wd, pred_view);
+            }
 
+            int received_signal = _cgp_finish_generation(wd, cgp_parent_fitness, pred_view);
+            if (received_signal > 0) {
+                state->retval = received_signal;
+            }
+        }
 
-        if (received_signal > 0) {
-            return received_signal;
+        pthread_mutex_unlock(&state->lock);
+
+        if (pred_view) {
+            arc_view_release(pred_view);
         }
     }
 
-    return 0;
+    ga_destroy_chr(child, cgp_free_genome);
+}
+
+
+/**
+ * Asynchronous steady-state CGP loop, there are no generation barriers
+ * @param  wd (= work_data)
+ * @return Program return value
+ */
+static int _cgp_main_async(algo_data_t *wd)
+{
+    _cgp_async_state_t state = {
+        .pred_archive_version = 0,
+        .retval = 0,
+    };
+    pthread_mutex_init(&state.lock, NULL);
+
+    if (wd->config->algorithm != simple_cgp) {
+        // parent was evaluated with current predictor during initialization
+        state.pred_archive_version = arc_current(wd->pred_archive)->version;
+    }
+
+    // budget is fixed for the whole run
+    int workers = atomic_load(&wd->scheduler.cgp_workers);
+    if (workers < 1) {
+        workers = 1;
+    }
+
+    #pragma omp parallel num_threads(workers)
+    {
+        _cgp_async_worker(wd, &state);
+    }
+
+    pthread_mutex_destroy(&state.lock);
+    return state.retval;
+}
+
+
+/**
+ * CGP main loop
+ * @param  wd (= work_data)
+ * @return Program return value
+ */
+int cgp_main(algo_data_t *wd)
+{
+    /* A. log start */
+    logger_fire(&wd->loggers, started, history_last(&wd->history));
+
+    /* B. "Infinite" loop */
+    if (wd->config->async_evolution) {
+        return _cgp_main_async(wd);
+    } else {
+        return _cgp_main_generational(wd);
+    }
+}
+
+
+/**
+ * Reevaluates archived predictor (with optionally recalculated phenotype)
+ * and publishes it as new archive content
+ *
+ * New archive version is published only if the phenotype has changed,
+ * otherwise CGP fitness predicted by it stays valid.
+ *
+ * @param  wd (= work_data)
+ * @param  scratch Chromosome used for preparation
+ * @param  recalculate_phenotype
+ */
+void _pred_republish_archived(algo_data_t *wd, ga_chr_t scratch, bool recalculate_phenotype)
+{
+    ga_chr_t archived = arc_get(wd->pred_archive, 0);
+    ga_copy_chr(scratch, archived, pred_copy_genome);
+    if (recalculate_phenotype) {
+        pred_calculate_phenotype((pred_genome_t) scratch->genome);
+    }
+    ga_reevaluate_chr(wd->pred_population, scratch);
+
+    if (pred_phenotype_equals((pred_genome_t) archived->genome, (pred_genome_t) scratch->genome)) {
+        arc_update_fitness(wd->pred_archive, 0, scratch->fitness);
+    } else {
+        arc_insert(wd->pred_archive, scratch);
+    }
+}
+
+
+/**
+ * Exchanges best predictor with other islands - publishes archived one and
+ * archives migrant from preceding island, if it is better
+ * @param  wd (= work_data)
+ * @param  scratch Chromosome used for migrant evaluation
+ * @param  buffer Serialized predictor buffer
+ */
+void _pred_migrate(algo_data_t *wd, ga_chr_t scratch, void *buffer)
+{
+    ga_chr_t archived = arc_get(wd->pred_archive, 0);
+    ga_fitness_t sender_fitness;
+
+    pred_serialize_genome((pred_genome_t) archived->genome, buffer);
+    island_publish(wd->island, island_pred, buffer, archived->fitness);
+
+    if (!island_receive(wd->island, island_pred, buffer, &sender_fitness)) {
+        return;
+    }
+
+    // sender used its own CGP archive
+    pred_deserialize_genome((pred_genome_t) scratch->genome, buffer);
+    ga_reevaluate_chr(wd->pred_population, scratch);
+
+    if (ga_is_better(wd->pred_population->problem_type, scratch->fitness, archived->fitness)) {
+        logger_fire(&wd->loggers, better_pred, archived->fitness, scratch->fitness);
+        arc_insert(wd->pred_archive, scratch);
+        sched_pred_improved(&wd->scheduler);
+    }
 }
 
 
@@ -257,57 +626,63 @@ int cgp_main(algo_data_t *wd)
  */
 void pred_main(algo_data_t *wd)
 {
+    // CGP archive version the population was evaluated with
+    unsigned long cgp_archive_version = arc_current(wd->cgp_archive)->version;
+
+    // archived predictor is never modified in place
+    ga_chr_t scratch = ga_alloc_chr(pred_alloc_genome);
+
+    // islands exchange predictors when CGP reaches migration interval
+    void *migration_buffer = NULL;
+    int last_migration = 0;
+    if (wd->island) {
+        migration_buffer = malloc(pred_serialized_size());
+    }
+
     while (!(wd->finished)) {
 
-        #pragma omp critical (CGP_ARCHIVE__PRED_POP)
-        {
-            ga_next_generation(wd->pred_population);
+        // budget may have been changed by CGP thread
+        sched_apply_pred(&wd->scheduler);
+
+        // hold current CGP archive for whole generation
+        arc_view_t cgp_view = arc_read_begin(wd->cgp_archive);
+
+        // CGP archive has changed, predictors' fitness is outdated
+        if (cgp_view->version != cgp_archive_version) {
+            ga_reevaluate_pop(wd->pred_population);
+            _pred_republish_archived(wd, scratch, false);
+            cgp_archive_version = cgp_view->version;
         }
 
+        ga_next_generation(wd->pred_population);
+
         // if evolution params should be changed now, do it
-        // no lock necessary
-        if (wd->baldwin_state.new_predictor_length) {
-            #pragma omp critical (BALDWIN)
-            {
-                int generation = wd->cgp_population->generation;
-                int old_length = pred_get_length();
-                int new_length = wd->baldwin_state.new_predictor_length;
-                int old_used_length = ((pred_genome_t) arc_get(wd->pred_archive, 0)->genome)->used_pixels;
-                int new_used_length;
-
-                pred_set_length(new_length);
-
-                // recalculate predictors' phenotypes
-                pred_pop_calculate_phenotype(wd->pred_population);
-                #pragma omp critical (PRED_ARCHIVE__CGP_POP)
-                {
-                    pred_calculate_phenotype(arc_get(wd->pred_archive, 0)->genome);
-                }
-
-                new_used_length = ((pred_genome_t) arc_get(wd->pred_archive, 0)->genome)->used_pixels;
-
-                // reevaluate predictors
-                #pragma omp critical (CGP_ARCHIVE__PRED_POP)
-                {
-                    ga_reevaluate_pop(wd->pred_population);
-                    #pragma omp critical (PRED_ARCHIVE__CGP_POP)
-                    {
-                        ga_reevaluate_chr(wd->pred_population,
-                            arc_get(wd->pred_archive, 0));
-                    }
-                }
-
-                logger_fire(&wd->loggers, pred_length_change_applied,
-                    generation,
-                    old_length,
-                    new_length,
-                    old_used_length,
-                    new_used_length);
-
-                // no lock on CGP population here, it should not matter
-                wd->baldwin_state.last_applied_generation = generation;
-                wd->baldwin_state.new_predictor_length = 0;
-            }
+        int new_length = atomic_exchange(&wd->baldwin_state.new_predictor_length, 0);
+        if (new_length) {
+            int generation = wd->cgp_population->generation;
+            int old_length = pred_get_length();
+            int old_used_length = ((pred_genome_t) arc_get(wd->pred_archive, 0)->genome)->used_pixels;
+            int new_used_length;
+
+            pred_set_length(new_length);
+
+            // recalculate predictors' phenotypes and reevaluate them
+            TIMING_START(start);
+            pred_pop_calculate_phenotype(wd->pred_population);
+            ga_reevaluate_pop(wd->pred_population);
+            _pred_republish_archived(wd, scratch, true);
+            TIMING_STOP(timing_baldwin_phenotype, start);
+
+            new_used_length = ((pred_genome_t) arc_get(wd->pred_archive, 0)->genome)->used_pixels;
+
+            logger_fire(&wd->loggers, pred_length_change_applied,
+                generation,
+                old_length,
+                new_length,
+                old_used_length,
+                new_used_length);
+
+            atomic_store(&wd->baldwin_state.last_applied_generation, generation);
         }
 
         bool is_better = ga_is_better(wd->pred_population->problem_type,
@@ -323,12 +698,27 @@ void pred_main(algo_data_t *wd)
                 wd->pred_population->best_fitness
             );
 
-            // store and invalidate CGP fitness
-            #pragma omp critical (PRED_ARCHIVE__CGP_POP)
-            {
-                arc_insert(wd->pred_archive, wd->pred_population->best_chromosome);
-                ga_reevaluate_pop(wd->cgp_population);
+            // publish, CGP population is reevaluated by its thread
+            arc_insert(wd->pred_archive, wd->pred_population->best_chromosome);
+            sched_pred_improved(&wd->scheduler);
+        }
+
+        if (migration_buffer) {
+            int migration = wd->cgp_population->generation / wd->config->migration_interval;
+            if (migration != last_migration) {
+                _pred_migrate(wd, scratch, migration_buffer);
+                last_migration = migration;
             }
         }
+
+        // complete checkpoint started by CGP thread
+        if (wd->checkpoint) {
+            checkpoint_capture_pred(wd->checkpoint, wd);
+        }
+
+        arc_read_end(wd->cgp_archive);
     }
+
+    free(migration_buffer);
+    ga_destroy_chr(scratch, pred_free_genome);
 }
@@ -25,9 +25,14 @@
 #include "image.h"
 #include "config.h"
 #include "archive.h"
+#include "fitness_cache.h"
 #include "baldwin.h"
 #include "predictors.h"
+#include "scheduler.h"
+#include "island.h"
+#include "checkpoint.h"
 #include "logging/logging.h"
+#include "logging/trace.h"
 
 
 typedef struct algo_data {
@@ -44,12 +49,27 @@ typedef struct algo_data {
     archive_t cgp_archive;
     archive_t pred_archive;
 
+    // memoized CGP fitness values, NULL if disabled
+    fitness_cache_t fitness_cache;
+
     // history
     history_t history;
 
     // baldwin (colearning state)
     bw_state_t baldwin_state;
 
+    // worker budgets of CGP and predictors
+    sched_t scheduler;
+
+    // migration between processes, NULL if running alone
+    island_t island;
+
+    // periodic state snapshots, NULL if disabled
+    checkpoint_t checkpoint;
+
+    // per-generation binary trace, NULL if disabled
+    trace_t trace;
+
     // log files
     FILE *log_file;
     FILE *history_file;
@@ -18,68 +18,122 @@
  */
 
 
+
+#include <time.h>
+#include <sched.h>
 #include <stdlib.h>
 
 #include "archive.h"
+#include "timing.h"
+
+
+/**
+ * Allocate memory for view's items
+ * @return 0 on success
+ */
+int _arc_init_view(arc_view_t view, int capacity, arc_func_vect_t methods)
+{
+    view->capacity = capacity;
+    view->stored = 0;
+    view->pointer = 0;
+    view->version = 0;
+    atomic_init(&view->readers, 0);
+
+    view->original_fitness = (ga_fitness_t*) malloc(sizeof(ga_fitness_t) * capacity);
+    if (view->original_fitness == NULL) {
+        return -1;
+    }
 
+    view->chromosomes = (ga_chr_t*) malloc(sizeof(ga_chr_t) * capacity);
+    if (view->chromosomes == NULL) {
+        free(view->original_fitness);
+        return -1;
+    }
+
+    for (int i = 0; i < capacity; i++) {
+        view->chromosomes[i] = ga_alloc_chr(methods.alloc_genome);
+        if (view->chromosomes[i] == NULL) {
+            for (int x = i - 1; x >= 0; x--) {
+                ga_destroy_chr(view->chromosomes[x], methods.free_genome);
+            }
+            free(view->chromosomes);
+            free(view->original_fitness);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Release view's items from memory
+ */
+void _arc_deinit_view(arc_view_t view, arc_func_vect_t methods)
+{
+    for (int i = 0; i < view->capacity; i++) {
+        ga_destroy_chr(view->chromosomes[i], methods.free_genome);
+    }
+    free(view->chromosomes);
+    free(view->original_fitness);
+}
 
 
 /**
  * Allocate memory for and initialize new archive
  *
  * @param  size Archive size
+ * @param  readers Number of threads which may hold a view at once
  * @param  problem-specific genome function pointers
  * @param  problem type - used to compare new chromosomes with best found
  * @return pointer to created archive
  */
-archive_t arc_create(int capacity, arc_func_vect_t methods, ga_problem_type_t problem_type)
+archive_t arc_create(int capacity, int readers, arc_func_vect_t methods,
+    ga_problem_type_t problem_type)
 {
     archive_t arc = (archive_t) malloc(sizeof(struct archive));
     if (arc == NULL) {
         return NULL;
     }
 
-    ga_chr_t *items = (ga_chr_t*) malloc(sizeof(ga_chr_t) * capacity);
-    if (items == NULL) {
-        free(arc);
-        return NULL;
+    if (readers < 1) {
+        readers = 1;
     }
-
-    ga_fitness_t *original_fitness = (ga_fitness_t*) malloc(sizeof(ga_fitness_t) * capacity);
-    if (original_fitness == NULL) {
-        free(items);
+    arc->views_count = readers + ARC_EXTRA_VIEWS;
+    arc->views = (struct arc_view*) malloc(sizeof(struct arc_view) * arc->views_count);
+    if (arc->views == NULL) {
         free(arc);
         return NULL;
     }
 
     ga_chr_t best_ever = ga_alloc_chr(methods.alloc_genome);
     if (best_ever == NULL) {
-        free(original_fitness);
-        free(items);
+        free(arc->views);
         free(arc);
         return NULL;
     }
     best_ever->has_fitness = false;
 
-    for (int i = 0; i < capacity; i++) {
-        items[i] = ga_alloc_chr(methods.alloc_genome);
-        if (items[i] == NULL) {
-            for (int x = i - 1; x >= 0; i--) {
-                ga_destroy_chr(items[x], methods.free_genome);
+    for (int v = 0; v < arc->views_count; v++) {
+        if (_arc_init_view(&arc->views[v], capacity, methods) != 0) {
+            for (int x = v - 1; x >= 0; x--) {
+                _arc_deinit_view(&arc->views[x], methods);
             }
+            ga_destroy_chr(best_ever, methods.free_genome);
+            free(arc->views);
             free(arc);
             return NULL;
         }
     }
 
-    arc->chromosomes = items;
+    atomic_init(&arc->current, &arc->views[0]);
+    arc->read_view = NULL;
     arc->best_chromosome_ever = best_ever;
-    arc->original_fitness = original_fitness;
     arc->capacity = capacity;
-    arc->stored = 0;
-    arc->pointer = 0;
     arc->methods = methods;
     arc->problem_type = problem_type;
+    arc->wait_time = 0;
+    arc->waits = 0;
     return arc;
 }
 
@@ -91,22 +145,81 @@ void arc_destroy(archive_t arc)
 {
     if (!arc) return;
 
-    for (int i = 0; i < arc->capacity; i++) {
-        ga_destroy_chr(arc->chromosomes[i], arc->methods.free_genome);
+    for (int v = 0; v < arc->views_count; v++) {
+        _arc_deinit_view(&arc->views[v], arc->methods);
     }
-    free(arc->chromosomes);
-    free(arc->original_fitness);
     ga_destroy_chr(arc->best_chromosome_ever, arc->methods.free_genome);
+    free(arc->views);
     free(arc);
 }
 
 
+/**
+ * Finds view which is neither published nor read by anyone
+ *
+ * Every reader holds one view at most, so there is almost always one
+ * available.
+ * If not, waits until reader releases its view (grace period).
+ */
+arc_view_t _arc_get_free_view(archive_t arc, arc_view_t current)
+{
+    struct timespec start, end;
+    bool waited = false;
+
+    while (true) {
+        for (int v = 0; v < arc->views_count; v++) {
+            arc_view_t view = &arc->views[v];
+            if (view != current && atomic_load(&view->readers) == 0) {
+                if (waited) {
+                    clock_gettime(CLOCK_MONOTONIC, &end);
+                    arc->wait_time += (end.tv_sec - start.tv_sec)
+                        + (end.tv_nsec - start.tv_nsec) / 1e9;
+                    arc->waits++;
+                }
+                return view;
+            }
+        }
+
+        if (!waited) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            waited = true;
+        }
+        sched_yield();
+    }
+}
+
+
+/**
+ * Evaluates chromosome using `arc->methods.fitness`, or looks its fitness
+ * up in cache, if it is set
+ * @param  arc
+ * @param  chr
+ * @return fitness value
+ */
+ga_fitness_t arc_eval(archive_t arc, ga_chr_t chr)
+{
+    fitness_cache_t cache = arc->methods.fitness_cache;
+    if (cache == NULL || arc->methods.phenotype_hash == NULL) {
+        return arc->methods.fitness(chr);
+    }
+
+    ga_fitness_t fitness;
+    uint64_t hash = arc->methods.phenotype_hash(chr);
+    if (!fitness_cache_get(cache, hash, FITNESS_CACHE_REAL, &fitness)) {
+        fitness = arc->methods.fitness(chr);
+        fitness_cache_put(cache, hash, FITNESS_CACHE_REAL, fitness);
+    }
+    return fitness;
+}
+
+
 /**
  * Insert chromosome into archive
  *
  * Chromosome is copied into place and pointer to it is returned.
  *
- * Chromosome is reevaluated using `arc->methods.fitness` (if set).
+ * Chromosome is reevaluated using `arc->methods.fitness` (if set),
+ * unless its real fitness is found in `arc->methods.fitness_cache`.
  *
  * @param  arc
  * @param  chr
@@ -114,22 +227,138 @@ void arc_destroy(archive_t arc)
  */
 ga_chr_t arc_insert(archive_t arc, ga_chr_t chr)
 {
-    ga_chr_t dst = arc->chromosomes[arc->pointer];
+    TIMING_START(start);
+    arc_view_t current = arc_current(arc);
+    arc_view_t next = _arc_get_free_view(arc, current);
+
+    // bring view up to date, except the item which will be replaced
+    for (int i = 0; i < current->stored; i++) {
+        if (i != current->pointer) {
+            ga_copy_chr(next->chromosomes[i], current->chromosomes[i], arc->methods.copy_genome);
+            next->original_fitness[i] = current->original_fitness[i];
+        }
+    }
+    next->stored = current->stored;
+    next->pointer = current->pointer;
+
+    ga_chr_t dst = next->chromosomes[next->pointer];
     ga_copy_chr(dst, chr, arc->methods.copy_genome);
-    arc->original_fitness[arc->pointer] = chr->has_fitness? chr->fitness : 0;
+    next->original_fitness[next->pointer] = chr->has_fitness? chr->fitness : 0;
 
     if (arc->methods.fitness != NULL) {
-        dst->fitness = arc->methods.fitness(dst);
+        dst->fitness = arc_eval(arc, dst);
         dst->has_fitness = true;
     }
 
-    if (arc->stored == 0 || ga_is_better(arc->problem_type, dst->fitness, arc->best_chromosome_ever->fitness)) {
+    if (next->stored == 0 || ga_is_better(arc->problem_type, dst->fitness, arc->best_chromosome_ever->fitness)) {
         ga_copy_chr(arc->best_chromosome_ever, dst, arc->methods.copy_genome);
     }
 
-    if (arc->stored < arc->capacity) {
-        arc->stored++;
+    if (next->stored < next->capacity) {
+        next->stored++;
     }
-    arc->pointer = (arc->pointer + 1) % arc->capacity;
+    next->pointer = (next->pointer + 1) % next->capacity;
+    next->version = current->version + 1;
+
+    // publish
+    atomic_store(&arc->current, next);
+
+    TIMING_STOP(timing_archive_insert, start);
     return dst;
 }
+
+
+/**
+ * Replaces fitness of item stored on given index
+ *
+ * New view keeps version of the published one.
+ *
+ * @param  arc
+ * @param  index
+ * @param  fitness
+ */
+void arc_update_fitness(archive_t arc, int index, ga_fitness_t fitness)
+{
+    arc_view_t current = arc_current(arc);
+    arc_view_t next = _arc_get_free_view(arc, current);
+
+    for (int i = 0; i < current->stored; i++) {
+        ga_copy_chr(next->chromosomes[i], current->chromosomes[i], arc->methods.copy_genome);
+        next->original_fitness[i] = current->original_fitness[i];
+    }
+    next->stored = current->stored;
+    next->pointer = current->pointer;
+    next->version = current->version;
+
+    int real = arc_real_index(next, index);
+    ga_chr_t dst = next->chromosomes[real];
+    dst->fitness = fitness;
+    dst->has_fitness = true;
+    next->original_fitness[real] = fitness;
+
+    if (ga_is_better(arc->problem_type, dst->fitness, arc->best_chromosome_ever->fitness)) {
+        ga_copy_chr(arc->best_chromosome_ever, dst, arc->methods.copy_genome);
+    }
+
+    // publish
+    atomic_store(&arc->current, next);
+}
+
+
+/**
+ * Obtains currently published view and keeps it until `arc_view_release`
+ * is called
+ *
+ * @param  arc
+ * @return held view
+ */
+arc_view_t arc_view_acquire(archive_t arc)
+{
+    while (true) {
+        arc_view_t view = atomic_load(&arc->current);
+        atomic_fetch_add(&view->readers, 1);
+
+        // writer may have picked this view before we registered,
+        // it is safe only if it is still published
+        if (atomic_load(&arc->current) == view) {
+            return view;
+        }
+        atomic_fetch_sub(&view->readers, 1);
+    }
+}
+
+
+/**
+ * Releases view obtained by `arc_view_acquire`
+ * @param  view
+ */
+void arc_view_release(arc_view_t view)
+{
+    atomic_fetch_sub(&view->readers, 1);
+}
+
+
+/**
+ * Starts reading archive - obtains currently published view and keeps
+ * it until `arc_read_end` is called
+ *
+ * @param  arc
+ * @return held view
+ */
+arc_view_t arc_read_begin(archive_t arc)
+{
+    arc->read_view = arc_view_acquire(arc);
+    return arc->read_view;
+}
+
+
+/**
+ * Ends reading archive - releases view obtained by `arc_read_begin`
+ * @param  arc
+ */
+void arc_read_end(archive_t arc)
+{
+    arc_view_t view = arc->read_view;
+    arc->read_view = NULL;
+    arc_view_release(view);
+}
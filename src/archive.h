@@ -18,15 +18,19 @@
  */
 
 
-#pragma once
 
+#pragma once
 
-#ifdef _OPENMP
-    #include <omp.h>
-#endif
 
+#include <assert.h>
+#include <stdatomic.h>
 
 #include "ga.h"
+#include "fitness_cache.h"
+
+
+/* archive views besides those held by readers - published one and a spare */
+#define ARC_EXTRA_VIEWS 2
 
 
  /**
@@ -42,10 +46,20 @@
 
      /* fitness function */
      ga_fitness_func_t fitness;
+
+     /* optional fitness memoization, both must be set to use it */
+     uint64_t (*phenotype_hash)(ga_chr_t chromosome);
+     fitness_cache_t fitness_cache;
  } arc_func_vect_t;
 
 
-struct archive
+/**
+ * Archive view - snapshot of archive content
+ *
+ * Published view is never modified. Writer prepares new content in a view
+ * which is neither published nor read and then publishes it at once.
+ */
+struct arc_view
 {
     /* archive capacity */
     int capacity;
@@ -63,6 +77,30 @@ struct archive
        stored */
     int pointer;
 
+    /* content version, increased whenever stored chromosomes change */
+    unsigned long version;
+
+    /* number of readers currently holding this view */
+    atomic_int readers;
+};
+typedef struct arc_view* arc_view_t;
+
+
+struct archive
+{
+    /* archive capacity */
+    int capacity;
+
+    /* content snapshots, one per possible reader and ARC_EXTRA_VIEWS */
+    struct arc_view *views;
+    int views_count;
+
+    /* currently published view */
+    _Atomic(arc_view_t) current;
+
+    /* view held by reading thread (between read begin and end) */
+    arc_view_t read_view;
+
     /* genome-specific functions */
     arc_func_vect_t methods;
 
@@ -71,6 +109,10 @@ struct archive
 
     /* problem type to determine best item */
     ga_problem_type_t problem_type;
+
+    /* how long and how many times writer waited for a free view */
+    double wait_time;
+    long waits;
 };
 typedef struct archive* archive_t;
 
@@ -78,12 +120,17 @@ typedef struct archive* archive_t;
 /**
  * Allocate memory for and initialize new archive
  *
+ * Writer never waits for a free view, unless more than `readers` threads
+ * hold (different) views at the same time.
+ *
  * @param  size Archive size
+ * @param  readers Number of threads which may hold a view at once
  * @param  problem-specific genome function pointers
  * @param  problem type - used to compare new chromosomes with best found
  * @return pointer to created archive
  */
-archive_t arc_create(int capacity, arc_func_vect_t methods, ga_problem_type_t problem_type);
+archive_t arc_create(int capacity, int readers, arc_func_vect_t methods,
+    ga_problem_type_t problem_type);
 
 
 /**
@@ -92,12 +139,29 @@ archive_t arc_create(int capacity, arc_func_vect_t methods, ga_problem_type_t pr
 void arc_destroy(archive_t arc);
 
 
+/**
+ * Evaluates chromosome the same way as archived ones are evaluated
+ *
+ * Uses `arc->methods.fitness` (which must be set), unless the real fitness
+ * is found in `arc->methods.fitness_cache`. Chromosome is not modified.
+ *
+ * @param  arc
+ * @param  chr
+ * @return fitness value
+ */
+ga_fitness_t arc_eval(archive_t arc, ga_chr_t chr);
+
+
 /**
  * Insert chromosome into archive
  *
  * Chromosome is copied into place and pointer to it is returned.
  *
- * Chromosome is reevaluated using `arc->methods.fitness` (if set).
+ * Chromosome is reevaluated using `arc->methods.fitness` (if set),
+ * unless its real fitness is found in `arc->methods.fitness_cache`.
+ *
+ * New content is prepared in a spare view and published afterwards, so
+ * readers are never blocked. Only one thread may write into archive.
  *
  * @param  arc
  * @param  chr
@@ -107,64 +171,119 @@ ga_chr_t arc_insert(archive_t arc, ga_chr_t chr);
 
 
 /**
- * OpenMP: Enters archive write critical section
+ * Replaces fitness of item stored on given index
+ *
+ * Stored chromosomes do not change, so the new view is published with
+ * the same version and readers do not have to reevaluate anything
+ * derived from them. Only one thread may write into archive.
+ *
+ * @param  arc
+ * @param  index
+ * @param  fitness
+ */
+void arc_update_fitness(archive_t arc, int index, ga_fitness_t fitness);
+
+
+/**
+ * Obtains currently published view and keeps it until `arc_view_release`
+ * is called
  *
- * Blocks until write lock is obtained.
+ * Never blocks, any number of threads may hold views this way.
+ *
+ * @param  arc
+ * @return held view
  */
-void arc_omp_write_enter(archive_t arc);
+arc_view_t arc_view_acquire(archive_t arc);
 
 
 /**
- * OpenMP: Leaves archive write critical section
+ * Releases view obtained by `arc_view_acquire`
+ * @param  view
  */
-void arc_omp_write_leave(archive_t arc);
+void arc_view_release(arc_view_t view);
 
 
 /**
- * OpenMP: Enters archive read critical section
+ * Starts reading archive - obtains currently published view and keeps
+ * it until `arc_read_end` is called
  *
- * Blocks until read lock is obtained.
+ * Never blocks. Only one thread may read archive this way.
+ *
+ * @param  arc
+ * @return held view
  */
-void arc_omp_read_enter(archive_t arc);
+arc_view_t arc_read_begin(archive_t arc);
 
 
 /**
- * OpenMP: Leaves archive read critical section
+ * Ends reading archive - releases view obtained by `arc_read_begin`
+ * @param  arc
  */
-void arc_omp_read_leave(archive_t arc);
+void arc_read_end(archive_t arc);
 
 
 /**
- * Returns real index of item in archive's ring buffer
+ * Returns view held by reading thread, must be called between
+ * `arc_read_begin` and `arc_read_end`
  */
-static inline int arc_real_index(archive_t arc, int index)
+static inline arc_view_t arc_read_view(archive_t arc)
 {
-    if (arc->stored < arc->capacity) {
-        int real = index % arc->stored;
-        if (real < 0) real += arc->stored;
+    assert(arc->read_view != NULL);
+    return arc->read_view;
+}
+
+
+/**
+ * Returns currently published view. Intended for archive writer, other
+ * threads should use `arc_read_begin`.
+ */
+static inline arc_view_t arc_current(archive_t arc)
+{
+    return atomic_load(&arc->current);
+}
+
+
+/**
+ * Returns real index of item in view's ring buffer
+ */
+static inline int arc_real_index(arc_view_t view, int index)
+{
+    if (view->stored < view->capacity) {
+        int real = index % view->stored;
+        if (real < 0) real += view->stored;
         return real;
 
     } else {
-        int real = (arc->pointer + index) % arc->capacity;
-        if (real < 0) real += arc->capacity;
+        int real = (view->pointer + index) % view->capacity;
+        if (real < 0) real += view->capacity;
         return real;
     }
 }
 
 
 /**
- * Returns item stored on given index
+ * Returns item stored on given index of given view
+ */
+static inline ga_chr_t arc_view_get(arc_view_t view, int index)
+{
+    return view->chromosomes[arc_real_index(view, index)];
+}
+
+
+/**
+ * Returns item stored on given index of published view (writer only)
  */
 static inline ga_chr_t arc_get(archive_t arc, int index)
 {
-    return arc->chromosomes[arc_real_index(arc, index)];
+    return arc_view_get(arc_current(arc), index);
 }
 
 
 /**
- * Returns original fitness of item stored on given index
+ * Returns original fitness of item stored on given index of published view
  */
 static inline ga_fitness_t arc_get_original_fitness(archive_t arc, int index)
 {
-    return arc->original_fitness[arc_real_index(arc, index)];
+    arc_view_t view = arc_current(arc);
+    return view->original_fitness[arc_real_index(view, index)];
 }
@@ -21,6 +21,8 @@
 #pragma once
 
 
+#include <stdatomic.h>
+
 #include "ga.h"
 #include "logging/history.h"
 
@@ -79,9 +81,10 @@ typedef struct {
 } bw_update_t;
 
 
+/* shared by CGP and predictors threads */
 typedef struct {
-    int new_predictor_length;
-    int last_applied_generation;
+    atomic_int new_predictor_length;
+    atomic_int last_applied_generation;
 } bw_state_t;
 
 
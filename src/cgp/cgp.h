@@ -23,3 +23,4 @@
 #include "cgp_core.h"
 #include "cgp_dump.h"
 #include "cgp_load.h"
+#include "cgp_program.h"
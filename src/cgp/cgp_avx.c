@@ -26,33 +26,6 @@
 #include "../random.h"
 
 
-#define CURRENT(x) \
-  (x == 0? current0 \
-    : x == 1? current1 \
-    : x == 2? current2 \
-    : current3)
-
-#define ASSIGN_CURRENT(x, val) do { \
-  if (x == 0) current0 = (val); \
-  else if (x == 1) current1 = (val); \
-  else if (x == 2) current2 = (val); \
-  else if (x == 3) current3 = (val); \
-  else assert(false); \
-} while(0);
-
-#define LOAD_INPUT(reg, idx) do { \
-    if ((idx) < CGP_INPUTS) reg = inputs[(idx)]; \
-    else if ((idx) == CGP_INPUTS + offset) reg = prev0; \
-    else if ((idx) == CGP_INPUTS + offset + 1) reg = prev1; \
-    else if ((idx) == CGP_INPUTS + offset + 2) reg = prev2; \
-    else if ((idx) == CGP_INPUTS + offset + 3) reg = prev3; \
-    else { \
-        fprintf(stderr, "Invalid index %d, (range %d-%d)\n", \
-            idx, CGP_INPUTS + offset, CGP_INPUTS + offset + 3); \
-        assert(false); \
-    } \
-} while(0);
-
 #define UCFMT1 "%u"
 #define UCFMT4 UCFMT1 ", " UCFMT1 ", " UCFMT1 ", " UCFMT1
 #define UCFMT16 UCFMT4 ", " UCFMT4 ", " UCFMT4 ", " UCFMT4
@@ -70,202 +43,310 @@
 } while(0);
 
 
+#ifdef AVX2
 /**
- * Calculate output of given chromosome and inputs using AVX2 instructions
- * @param chr
+ * Looks up 256-entry table using in-lane byte shuffles. VPSHUFB uses only
+ * low nibble of index, so each of 16 table rows is looked up and selected
+ * by high nibble.
+ * @param lut
+ * @param A Indices
+ * @return looked up values
+ */
+static inline __m256i _cgp_avx_lut(const cgp_value_t lut[256], __m256i A)
+{
+    __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+    __m256i low = _mm256_and_si256(A, nibble_mask);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(A, 4), nibble_mask);
+    __m256i Y = _mm256_setzero_si256();
+
+    for (int row = 0; row < 16; row++) {
+        __m256i table = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i*) &lut[row * 16]));
+        __m256i selected = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(row));
+        __m256i values = _mm256_shuffle_epi8(table, low);
+        Y = _mm256_or_si256(Y, _mm256_and_si256(selected, values));
+    }
+
+    return Y;
+}
+
+
+/* functions, see CGP_FUNCTIONS in cgp_func.h *********************************/
+
+
+static inline __m256i _cgp_avx_c255(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return FF;
+}
+
+
+static inline __m256i _cgp_avx_identity(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return A;
+}
+
+
+static inline __m256i _cgp_avx_inversion(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_sub_epi8(FF, A);
+}
+
+
+static inline __m256i _cgp_avx_b_or(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_or_si256(A, B);
+}
+
+
+static inline __m256i _cgp_avx_b_not1or2(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    // we don't have NOT instruction, we need to XOR with FF
+    return _mm256_or_si256(_mm256_xor_si256(FF, A), B);
+}
+
+
+static inline __m256i _cgp_avx_b_and(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_and_si256(A, B);
+}
+
+
+static inline __m256i _cgp_avx_b_nand(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_xor_si256(FF, _mm256_and_si256(A, B));
+}
+
+
+static inline __m256i _cgp_avx_b_xor(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_xor_si256(A, B);
+}
+
+
+static inline __m256i _cgp_avx_rshift1(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    // no SR instruction for 8bit data, we need to shift
+    // 16 bits and apply mask
+    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
+    // SHR: [ 0 1 2 3 4 5 6 7 | 8 A B C D E F G]
+    // MSK: [ 0 1 2 3 4 5 6 7 | 0 A B C D E F G]
+    return _mm256_and_si256(_mm256_srli_epi16(A, 1), _mm256_set1_epi8(0x7F));
+}
+
+
+static inline __m256i _cgp_avx_rshift2(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    // similar to rshift1
+    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
+    // SHR: [ 0 0 1 2 3 4 5 6 | 7 8 A B C D E F]
+    // MSK: [ 0 0 1 2 3 4 5 6 | 0 0 A B C D E F]
+    return _mm256_and_si256(_mm256_srli_epi16(A, 2), _mm256_set1_epi8(0x3F));
+}
+
+
+static inline __m256i _cgp_avx_swap(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    // SWAP(A, B) (((A & 0x0F) << 4) | ((B & 0x0F)))
+    // Shift A left by 4 bits
+    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
+    // SHL: [ 5 6 7 8 A B C D | E F G H 0 0 0 0]
+    // MSK: [ 5 6 7 8 0 0 0 0 | E F G H 0 0 0 0]
+    __m256i high = _mm256_and_si256(_mm256_slli_epi16(A, 4), _mm256_set1_epi8(0xF0));
+
+    // Mask B
+    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
+    // MSK: [ 0 0 0 0 5 6 7 8 | 0 0 0 0 E F G H]
+    __m256i low = _mm256_and_si256(B, _mm256_set1_epi8(0x0F));
+
+    // Combine
+    return _mm256_or_si256(low, high);
+}
+
+
+static inline __m256i _cgp_avx_add(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_add_epi8(A, B);
+}
+
+
+static inline __m256i _cgp_avx_add_sat(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_adds_epu8(A, B);
+}
+
+
+static inline __m256i _cgp_avx_avg(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    // shift right first, then add, to avoid overflow
+    // (result differs from scalar one for two odd inputs)
+    __m256i mask = _mm256_set1_epi8(0x7F);
+    __m256i halfA = _mm256_and_si256(_mm256_srli_epi16(A, 1), mask);
+    __m256i halfB = _mm256_and_si256(_mm256_srli_epi16(B, 1), mask);
+    return _mm256_add_epi8(halfA, halfB);
+}
+
+
+static inline __m256i _cgp_avx_max(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_max_epu8(A, B);
+}
+
+
+static inline __m256i _cgp_avx_min(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_min_epu8(A, B);
+}
+
+
+static inline __m256i _cgp_avx_absdiff(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    // one of saturated differences is zero
+    return _mm256_or_si256(_mm256_subs_epu8(A, B), _mm256_subs_epu8(B, A));
+}
+
+
+static inline __m256i _cgp_avx_avg_round(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_avg_epu8(A, B);
+}
+
+
+static inline __m256i _cgp_avx_sub_sat(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_subs_epu8(A, B);
+}
+
+
+static inline __m256i _cgp_avx_cmp_select(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    // there is no unsigned byte comparison, A >= B iff max(A, B) == A
+    __m256i mask = _mm256_cmpeq_epi8(_mm256_max_epu8(A, B), A);
+    return _mm256_and_si256(mask, A);
+}
+
+
+static inline __m256i _cgp_avx_min3(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_min_epu8(_mm256_min_epu8(A, B), C);
+}
+
+
+static inline __m256i _cgp_avx_max3(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    return _mm256_max_epu8(_mm256_max_epu8(A, B), C);
+}
+
+
+static inline __m256i _cgp_avx_median3(__m256i A, __m256i B, __m256i C,
+    __m256i FF)
+{
+    // compare-exchange network: max(min(A, B), min(max(A, B), C))
+    __m256i low = _mm256_min_epu8(A, B);
+    __m256i high = _mm256_max_epu8(A, B);
+    return _mm256_max_epu8(low, _mm256_min_epu8(high, C));
+}
+
+#endif
+
+
+/**
+ * Calculate output of given program and inputs using AVX2 instructions
+ * @param program
  * @param inputs
  * @param outputs
  */
-void cgp_get_output_avx(ga_chr_t chromosome,
+void cgp_program_output_avx(const cgp_program_t *program,
     __m256i_aligned inputs[CGP_INPUTS], __m256i_aligned outputs[CGP_OUTPUTS])
 {
 #ifndef AVX2
     assert(false);
 #else
-    assert(CGP_OUTPUTS == 1);
-    assert(CGP_ROWS == 4);
-    assert(CGP_LBACK == 1);
-
-    // previous and currently computed column
-    register __m256i prev0, prev1, prev2, prev3;
-    register __m256i current0, current1, current2, current3;
-
     // 0xFF constant
     static __m256i_aligned FF;
     FF = _mm256_set1_epi8(0xFF);
 
-    cgp_genome_t genome = (cgp_genome_t) chromosome->genome;
+    // primary inputs, instruction results and constants
+    __m256i_aligned values[CGP_PROGRAM_SLOTS];
 
-#ifdef TEST_EVAL_AVX
+    for (int i = 0; i < CGP_INPUTS; i++) {
+        values[i] = inputs[i];
+    }
+    for (int i = 0; i < program->constants_count; i++) {
+        values[CGP_PROGRAM_CONST_SLOT(i)] = _mm256_set1_epi8(program->constants[i]);
+    }
 
+#ifdef TEST_EVAL_AVX
     for (int i = 0; i < CGP_INPUTS; i++) {
         unsigned char *_tmp = (unsigned char*) &inputs[i];
         printf("I: %2d = " UCFMT32 "\n", i, UCVAL32(0));
     }
 #endif
 
-    int offset = -CGP_ROWS;
-
-    for (int x = 0; x < CGP_COLS; x++) {
-        for (int y = 0; y < CGP_ROWS; y++) {
-            int idx = cgp_node_index(x, y);
-            cgp_node_t *n = &(genome->nodes[idx]);
-
-            // skip inactive blocks
-            if (!n->is_active) continue;
-
-            register __m256i A;
-            register __m256i B;
-            register __m256i Y;
-            register __m256i TMP;
-            register __m256i mask;
-
-            LOAD_INPUT(A, n->inputs[0]);
-            LOAD_INPUT(B, n->inputs[1]);
-
-            switch (n->function) {
-                case c255:
-                    Y = FF;
-                    break;
-
-                case identity:
-                    Y = A;
-                    break;
-
-                case inversion:
-                    Y = _mm256_sub_epi8(FF, A);
-                    break;
-
-                case b_or:
-                    Y = _mm256_or_si256(A, B);
-                    break;
-
-                case b_not1or2:
-                    // we don't have NOT instruction, we need to XOR with FF
-                    Y = _mm256_xor_si256(FF, A);
-                    Y = _mm256_or_si256(Y, B);
-                    break;
-
-                case b_and:
-                    Y = _mm256_and_si256(A, B);
-                    break;
-
-                case b_nand:
-                    Y = _mm256_and_si256(A, B);
-                    Y = _mm256_xor_si256(FF, Y);
-                    break;
-
-                case b_xor:
-                    Y = _mm256_xor_si256(A, B);
-                    break;
-
-                case rshift1:
-                    // no SR instruction for 8bit data, we need to shift
-                    // 16 bits and apply mask
-                    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
-                    // SHR: [ 0 1 2 3 4 5 6 7 | 8 A B C D E F G]
-                    // MSK: [ 0 1 2 3 4 5 6 7 | 0 A B C D E F G]
-                    mask = _mm256_set1_epi8(0x7F);
-                    Y = _mm256_srli_epi16(A, 1);
-                    Y = _mm256_and_si256(Y, mask);
-                    break;
-
-                case rshift2:
-                    // similar to rshift1
-                    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
-                    // SHR: [ 0 0 1 2 3 4 5 6 | 7 8 A B C D E F]
-                    // MSK: [ 0 0 1 2 3 4 5 6 | 0 0 A B C D E F]
-                    mask = _mm256_set1_epi8(0x3F);
-                    Y = _mm256_srli_epi16(A, 2);
-                    Y = _mm256_and_si256(Y, mask);
-                    break;
-
-                case swap:
-                    // SWAP(A, B) (((A & 0x0F) << 4) | ((B & 0x0F)))
-                    // Shift A left by 4 bits
-                    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
-                    // SHL: [ 5 6 7 8 A B C D | E F G H 0 0 0 0]
-                    // MSK: [ 5 6 7 8 0 0 0 0 | E F G H 0 0 0 0]
-                    mask = _mm256_set1_epi8(0xF0);
-                    TMP = _mm256_slli_epi16(A, 4);
-                    TMP = _mm256_and_si256(TMP, mask);
-
-                    // Mask B
-                    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
-                    // MSK: [ 0 0 0 0 5 6 7 8 | 0 0 0 0 E F G H]
-                    mask = _mm256_set1_epi8(0x0F);
-                    Y = _mm256_and_si256(B, mask);
-
-                    // Combine
-                    Y = _mm256_or_si256(Y, TMP);
-                    break;
-
-                case add:
-                    Y = _mm256_add_epi8(A, B);
-                    break;
-
-                case add_sat:
-                    Y = _mm256_adds_epu8(A, B);
-                    break;
-
-                case avg:
-                    // shift right first, then add, to avoid overflow
-                    mask = _mm256_set1_epi8(0x7F);
-                    TMP = _mm256_srli_epi16(A, 1);
-                    TMP = _mm256_and_si256(TMP, mask);
-
-                    Y = _mm256_srli_epi16(B, 1);
-                    Y = _mm256_and_si256(Y, mask);
-
-                    Y = _mm256_add_epi8(Y, TMP);
-                    break;
-
-                case max:
-                    Y = _mm256_max_epu8(A, B);
-                    break;
-
-                case min:
-                    Y = _mm256_min_epu8(A, B);
-                    break;
-            }
+    for (int i = 0; i < program->length; i++) {
+        const cgp_instr_t *instr = &program->instrs[i];
+
+        register __m256i A = values[instr->inputs[0]];
+        register __m256i B = values[instr->inputs[1]];
+        register __m256i C = values[instr->inputs[CGP_INPUT_C]];
+        register __m256i Y = _mm256_setzero_si256();
 
+        if (instr->function == CGP_INSTR_LUT) {
+            Y = _cgp_avx_lut(program->luts[instr->lut], A);
+
+        } else switch (instr->function) {
+            #define _CGP_AVX_CASE(name, ...) \
+                case name: Y = _cgp_avx_##name(A, B, C, FF); break;
+            CGP_FUNCTIONS(_CGP_AVX_CASE)
+            #undef _CGP_AVX_CASE
+        }
 
 #ifdef TEST_EVAL_AVX
-            __m256i _tmpval = Y;
-            unsigned char *_tmp = (unsigned char*) &_tmpval;
-            printf("N: %2d = " UCFMT32 "\n", idx + CGP_INPUTS, UCVAL32(0));
-
-            bool mismatch = false;
-            for (int i = 1; i < 32; i++) {
-                if (_tmp[i] != _tmp[0]) {
-                    fprintf(stderr,
-                        "Value mismatch on index %2d (%u instead of %u)\n",
-                        i, _tmp[i], _tmp[0]);
-                    mismatch = true;
-                }
-            }
-            if (mismatch) {
-                abort();
+        __m256i _tmpval = Y;
+        unsigned char *_tmp = (unsigned char*) &_tmpval;
+        printf("N: %2d = " UCFMT32 "\n", CGP_PROGRAM_INSTR_SLOT(i), UCVAL32(0));
+
+        bool mismatch = false;
+        for (int i = 1; i < 32; i++) {
+            if (_tmp[i] != _tmp[0]) {
+                fprintf(stderr,
+                    "Value mismatch on index %2d (%u instead of %u)\n",
+                    i, _tmp[i], _tmp[0]);
+                mismatch = true;
             }
+        }
+        if (mismatch) {
+            abort();
+        }
 #endif
 
-            if (idx + CGP_INPUTS == genome->outputs[0]) {
-                _mm256_store_si256(&outputs[0], Y);
-#ifndef TEST_EVAL_AVX
-                return;
-#endif
-            }
-
-            ASSIGN_CURRENT(y, Y);
-
-        } // end of column
+        values[CGP_PROGRAM_INSTR_SLOT(i)] = Y;
+    }
 
-        offset += CGP_ROWS;
-        prev0 = current0;
-        prev1 = current1;
-        prev2 = current2;
-        prev3 = current3;
-    } // end of row
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        _mm256_store_si256(&outputs[i], values[program->outputs[i]]);
+    }
 
 #ifdef TEST_EVAL_AVX
     for (int i = 0; i < CGP_OUTPUTS; i++) {
@@ -277,3 +358,19 @@ void cgp_get_output_avx(ga_chr_t chromosome,
 
 #endif
 }
+
+
+/**
+ * Calculate output of given chromosome and inputs using AVX2 instructions
+ * @param chr
+ * @param inputs
+ * @param outputs
+ */
+void cgp_get_output_avx(ga_chr_t chromosome,
+    __m256i_aligned inputs[CGP_INPUTS], __m256i_aligned outputs[CGP_OUTPUTS])
+{
+    cgp_program_t program;
+    cgp_program_build(&program, chromosome);
+    cgp_program_collapse_luts(&program, CGP_AVX_LUT_MIN_LENGTH);
+    cgp_program_output_avx(&program, inputs, outputs);
+}
@@ -23,11 +23,29 @@
 #include <immintrin.h>
 
 #include "cgp_core.h"
+#include "cgp_program.h"
 
 
 typedef __m256i __m256i_aligned __attribute__ ((aligned (32)));
 
 
+/*
+ * Minimal subgraph size worth of lookup table. Table lookup costs about
+ * 16 shuffles, compares and masks, while CGP node is 1-4 instructions.
+ */
+#define CGP_AVX_LUT_MIN_LENGTH 24
+
+
+/**
+ * Calculate output of given program and inputs using AVX2 instructions
+ * @param program
+ * @param inputs
+ * @param outputs
+ */
+void cgp_program_output_avx(const cgp_program_t *program,
+    __m256i_aligned inputs[CGP_INPUTS], __m256i_aligned outputs[CGP_OUTPUTS]);
+
+
 /**
  * Calculate output of given chromosome and inputs using AVX instructions
  * @param chr
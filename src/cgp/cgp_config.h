@@ -26,3 +26,9 @@
 #define CGP_INPUTS 9
 #define CGP_OUTPUTS 1
 #define CGP_LBACK 1
+
+// node inputs, 2 or 3 - three inputs enable rank functions (min3, max3,
+// median3), but change the chromosome file format and make genome larger
+#ifndef CGP_FUNC_INPUTS
+    #define CGP_FUNC_INPUTS 2
+#endif
@@ -18,12 +18,15 @@
  */
 
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdatomic.h>
 
 #include "cgp_core.h"
 #include "../random.h"
+#include "../timing.h"
 
 
 typedef struct {
@@ -34,24 +37,18 @@ typedef struct {
 
 static int_array _allowed_gene_vals[CGP_COLS];
 static int _mutation_rate;
+static cgp_mutation_t _mutation_strategy = mutation_point;
+static atomic_long _mutated_chromosomes;
+static atomic_long _neutral_chromosomes;
+static atomic_long _neutral_genes;
+static atomic_long _effective_genes;
 static ga_fitness_func_t _fitness_func;
 
-#ifdef CGP_LIMIT_FUNCS
-    static int _allowed_functions_list[] = {
-        c255,
-        identity,
-        add,
-        add_sat,
-        inversion,
-        max,
-        min
-    };
-
-    static int_array _allowed_functions = {
-        .size = 7,
-        .values = _allowed_functions_list
-    };
-#endif
+static int _allowed_functions_list[CGP_FUNC_COUNT];
+static int_array _allowed_functions = {
+    .size = 0,
+    .values = _allowed_functions_list
+};
 
 
 #ifdef TEST_RANDOMIZE
@@ -69,6 +66,12 @@ void cgp_init(int mutation_rate, ga_fitness_func_t fitness_func)
 {
     _mutation_rate = mutation_rate;
     _fitness_func = fitness_func;
+    cgp_set_functions(CGP_FUNC_SET_DEFAULT);
+
+    atomic_init(&_mutated_chromosomes, 0);
+    atomic_init(&_neutral_chromosomes, 0);
+    atomic_init(&_neutral_genes, 0);
+    atomic_init(&_effective_genes, 0);
 
     // calculate allowed values of node inputs in each column
     for (int x = 0; x < CGP_COLS; x++) {
@@ -136,6 +139,8 @@ ga_pop_t cgp_init_pop(int pop_size)
 
         .fitness = _fitness_func,
         .offspring = cgp_offspring,
+
+        .genome_size = sizeof(struct cgp_genome),
     };
 
     /* initialize GA */
@@ -153,7 +158,11 @@ ga_pop_t cgp_init_pop(int pop_size)
  */
 void* cgp_alloc_genome()
 {
-    return malloc(sizeof(struct cgp_genome));
+    void *genome;
+    if (posix_memalign(&genome, CGP_GENOME_ALIGNMENT, sizeof(struct cgp_genome)) != 0) {
+        return NULL;
+    }
+    return genome;
 }
 
 
@@ -194,7 +203,8 @@ void cgp_free_genome(void *genome)
  * Replace gene on given locus with random alele
  * @param chr
  * @param gene
- * @return whether active node was changed or not (phenotype has changed)
+ * @return whether gene of active node or output was actually changed
+ *         (phenotype has changed)
  */
 bool cgp_randomize_gene(cgp_genome_t genome, int gene)
 {
@@ -203,41 +213,177 @@ bool cgp_randomize_gene(cgp_genome_t genome, int gene)
 
     if (gene < CGP_CHR_OUTPUTS_INDEX) {
         // mutating node input or function
-        int node_index = gene / 3;
-        int gene_index = gene % 3;
+        int node_index = gene / (CGP_FUNC_INPUTS + 1);
+        int gene_index = gene % (CGP_FUNC_INPUTS + 1);
         int col = cgp_node_col(node_index);
+        uint8_t *value;
 
         TEST_RANDOMIZE_PRINTF("gene %u, node %u, gene %u, col %u\n", gene, node_index, gene_index, col);
 
         if (gene_index == CGP_FUNC_INPUTS) {
             // mutating function
-            #ifdef CGP_LIMIT_FUNCS
-                genome->nodes[node_index].function = (cgp_func_t) rand_schoice(_allowed_functions.size, _allowed_functions.values);
-            #else
-                genome->nodes[node_index].function = (cgp_func_t) rand_range(0, CGP_FUNC_COUNT - 1);
-            #endif
-            TEST_RANDOMIZE_PRINTF("func 0 - %u\n", CGP_FUNC_COUNT - 1);
-            return genome->nodes[node_index].is_active;
+            value = &genome->nodes[node_index].function;
+            uint8_t old = *value;
+            *value = (cgp_func_t) rand_schoice(_allowed_functions.size, _allowed_functions.values);
+            TEST_RANDOMIZE_PRINTF("func choice from %u\n", _allowed_functions.size);
+            return *value != old && cgp_node_is_active(genome, node_index);
 
         } else {
             // mutating input
-            genome->nodes[node_index].inputs[gene_index] = rand_schoice(_allowed_gene_vals[col].size, _allowed_gene_vals[col].values);
+            value = &genome->nodes[node_index].inputs[gene_index];
+            uint8_t old = *value;
+            *value = rand_schoice(_allowed_gene_vals[col].size, _allowed_gene_vals[col].values);
             TEST_RANDOMIZE_PRINTF("input choice from %u\n", _allowed_gene_vals[col].size);
-            return genome->nodes[node_index].is_active;
+            return *value != old && cgp_node_is_active(genome, node_index);
         }
 
     } else {
         // mutating primary output connection
         int index = gene - CGP_CHR_OUTPUTS_INDEX;
+        uint8_t old = genome->outputs[index];
         genome->outputs[index] = rand_range(CGP_INPUTS, CGP_INPUTS + CGP_NODES - 1);
         TEST_RANDOMIZE_PRINTF("out %u - %u\n", CGP_INPUTS, CGP_INPUTS + CGP_NODES - 1);
-        return true;
+        return genome->outputs[index] != old;
+    }
+}
+
+
+/**
+ * Set functions which may be used in new and mutated genomes,
+ * default is CGP_FUNC_SET_DEFAULT
+ * @param functions
+ */
+void cgp_set_functions(cgp_func_set_t functions)
+{
+    // functions with more inputs than nodes have are never used
+    functions &= CGP_FUNC_SET_ALL;
+    assert(functions != 0);
+
+    _allowed_functions.size = 0;
+    for (int f = 0; f < CGP_FUNC_COUNT; f++) {
+        if (functions & ((cgp_func_set_t) 1 << f)) {
+            _allowed_functions_list[_allowed_functions.size++] = f;
+        }
+    }
+}
+
+
+/**
+ * Parses comma separated list of function names, "all" or "default"
+ * @param  list
+ * @param  functions Parsed set is stored here
+ * @return 0 on success, -1 on unknown or unusable function or empty set
+ */
+int cgp_parse_functions(const char *list, cgp_func_set_t *functions)
+{
+    cgp_func_set_t set = 0;
+    const char *name = list;
+
+    while (*name) {
+        size_t length = strcspn(name, ",");
+
+        if (length == 3 && strncmp(name, "all", length) == 0) {
+            set |= CGP_FUNC_SET_ALL;
+
+        } else if (length == 7 && strncmp(name, "default", length) == 0) {
+            set |= CGP_FUNC_SET_DEFAULT;
+
+        } else {
+            int f;
+            for (f = 0; f < CGP_FUNC_COUNT; f++) {
+                if (strlen(cgp_func_names[f]) == length
+                    && strncmp(name, cgp_func_names[f], length) == 0) {
+                    break;
+                }
+            }
+            if (f == CGP_FUNC_COUNT || cgp_func_arity[f] > CGP_FUNC_INPUTS) {
+                return -1;
+            }
+            set |= (cgp_func_set_t) 1 << f;
+        }
+
+        name += length;
+        if (*name == ',') name++;
+    }
+
+    if (set == 0) {
+        return -1;
+    }
+
+    *functions = set;
+    return 0;
+}
+
+
+/**
+ * Formats function set as comma separated list of names
+ * @param functions
+ * @param buffer
+ * @param size
+ */
+void cgp_format_functions(cgp_func_set_t functions, char *buffer, size_t size)
+{
+    size_t used = 0;
+    buffer[0] = '\0';
+
+    for (int f = 0; f < CGP_FUNC_COUNT && used < size; f++) {
+        if (functions & ((cgp_func_set_t) 1 << f)) {
+            used += snprintf(buffer + used, size - used, "%s%s",
+                used? "," : "", cgp_func_names[f]);
+        }
+    }
+}
+
+
+/**
+ * Set mutation strategy, default is point mutation
+ * @param strategy
+ */
+void cgp_set_mutation(cgp_mutation_t strategy)
+{
+    _mutation_strategy = strategy;
+}
+
+
+/**
+ * Returns mutation statistics
+ * @param stats
+ */
+void cgp_get_mutation_stats(cgp_mutation_stats_t *stats)
+{
+    stats->chromosomes = atomic_load(&_mutated_chromosomes);
+    stats->neutral_chromosomes = atomic_load(&_neutral_chromosomes);
+    stats->neutral_genes = atomic_load(&_neutral_genes);
+    stats->effective_genes = atomic_load(&_effective_genes);
+}
+
+
+/**
+ * Returns whether genome differs from original in any gene of node active
+ * in original or in primary output
+ */
+static bool _cgp_active_genes_changed(cgp_genome_t original, cgp_genome_t genome)
+{
+    uint64_t active = original->active;
+    while (active) {
+        int i = __builtin_ctzll(active);
+        active &= active - 1;
+        if (memcmp(&original->nodes[i], &genome->nodes[i], sizeof(cgp_node_t)) != 0) {
+            return true;
+        }
     }
+    return memcmp(original->outputs, genome->outputs, sizeof(original->outputs)) != 0;
 }
 
 
 /**
  * Mutate given chromosome
+ *
+ * Active nodes are taken from the parent, the mask is recalculated
+ * only after all genes are changed. In active and single modes gene may
+ * be changed back by later mutation, so the result is compared with
+ * the parent at the end.
+ *
  * @param chr
  */
 void cgp_mutate_chr(ga_chr_t chromosome)
@@ -245,11 +391,50 @@ void cgp_mutate_chr(ga_chr_t chromosome)
     assert(_mutation_rate <= CGP_CHR_LENGTH);
     cgp_genome_t genome = (cgp_genome_t) chromosome->genome;
 
-    int genes_to_change = rand_range(0, _mutation_rate);
-    for (int i = 0; i < genes_to_change; i++) {
-        int gene = rand_range(0, CGP_CHR_LENGTH - 1);
-        cgp_randomize_gene(genome, gene);
+    long neutral = 0;
+    long effective = 0;
+    bool changed;
+
+    if (_mutation_strategy == mutation_point) {
+        int genes_to_change = rand_range(0, _mutation_rate);
+        for (int i = 0; i < genes_to_change; i++) {
+            int gene = rand_range(0, CGP_CHR_LENGTH - 1);
+            if (cgp_randomize_gene(genome, gene)) {
+                effective++;
+            } else {
+                neutral++;
+            }
+        }
+        changed = effective > 0;
+
+    } else {
+        assert(_mutation_rate >= 1);
+
+        struct cgp_genome original;
+        memcpy(&original, genome, sizeof(struct cgp_genome));
+
+        do {
+            int genes_to_change = (_mutation_strategy == mutation_single)?
+                1 : rand_range(1, _mutation_rate);
+
+            for (int i = 0; i < genes_to_change; i++) {
+                int gene = rand_range(0, CGP_CHR_LENGTH - 1);
+                if (cgp_randomize_gene(genome, gene)) {
+                    effective++;
+                } else {
+                    neutral++;
+                }
+            }
+            changed = effective > 0 && _cgp_active_genes_changed(&original, genome);
+        } while (!changed);
+    }
+
+    atomic_fetch_add_explicit(&_mutated_chromosomes, 1, memory_order_relaxed);
+    if (!changed) {
+        atomic_fetch_add_explicit(&_neutral_chromosomes, 1, memory_order_relaxed);
     }
+    atomic_fetch_add_explicit(&_neutral_genes, neutral, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_effective_genes, effective, memory_order_relaxed);
 
     cgp_find_active_blocks(chromosome);
     chromosome->has_fitness = false;
@@ -267,17 +452,10 @@ void cgp_copy_genome(void *_dst, void *_src)
     cgp_genome_t dst = (cgp_genome_t) _dst;
     cgp_genome_t src = (cgp_genome_t) _src;
 
-    memcpy(dst->nodes, src->nodes, sizeof(cgp_node_t) * CGP_NODES);
-    memcpy(dst->outputs, src->outputs, sizeof(int) * CGP_OUTPUTS);
+    memcpy(dst, src, sizeof(struct cgp_genome));
 }
 
 
-#define SWAP(A, B) (((A & 0x0F) << 4) | ((B & 0x0F)))
-#define ADD_SAT(A, B) ((A > 0xFF - B) ? 0xFF : A + B)
-#define MAX(A, B) ((A > B) ? A : B)
-#define MIN(A, B) ((A < B) ? A : B)
-
-
 /* evaluation *****************************************************************/
 
 
@@ -293,37 +471,15 @@ void cgp_get_output(ga_chr_t chromosome, cgp_value_t *inputs, cgp_value_t *outpu
     // copy primary inputs to working array
     memcpy(inner_outputs, inputs, sizeof(cgp_value_t) * CGP_INPUTS);
 
-    for (int i = 0; i < CGP_NODES; i++) {
+    // walk active blocks only, lowest first
+    for (uint64_t active = genome->active; active; active &= active - 1) {
+        int i = __builtin_ctzll(active);
         cgp_node_t *n = &(genome->nodes[i]);
 
-        // skip inactive blocks
-        if (!n->is_active) continue;
-
         cgp_value_t A = inner_outputs[n->inputs[0]];
         cgp_value_t B = inner_outputs[n->inputs[1]];
-        cgp_value_t Y;
-
-        switch (n->function) {
-            case c255:          Y = 255;            break;
-            case identity:      Y = A;              break;
-            case inversion:     Y = 255 - A;        break;
-            case b_or:          Y = A | B;          break;
-            case b_not1or2:     Y = ~A | B;         break;
-            case b_and:         Y = A & B;          break;
-            case b_nand:        Y = ~(A & B);       break;
-            case b_xor:         Y = A ^ B;          break;
-            case rshift1:       Y = A >> 1;         break;
-            case rshift2:       Y = A >> 2;         break;
-            case swap:          Y = SWAP(A, B);     break;
-            case add:           Y = A + B;          break;
-            case add_sat:       Y = ADD_SAT(A, B);  break;
-            case avg:           Y = (A + B) >> 1;   break;
-            case max:           Y = MAX(A, B);      break;
-            case min:           Y = MIN(A, B);      break;
-            default:            abort();
-        }
-
-        inner_outputs[CGP_INPUTS + i] = Y;
+        cgp_value_t C = inner_outputs[n->inputs[CGP_INPUT_C]];
+        inner_outputs[CGP_INPUTS + i] = cgp_eval_func(n->function, A, B, C);
     }
 
     for (int i = 0; i < CGP_OUTPUTS; i++) {
@@ -349,42 +505,135 @@ void cgp_get_output(ga_chr_t chromosome, cgp_value_t *inputs, cgp_value_t *outpu
 void cgp_find_active_blocks(ga_chr_t chromosome)
 {
     cgp_genome_t genome = (cgp_genome_t) chromosome->genome;
-
-    // first mark all nodes as inactive
-    for (int i = CGP_NODES - 1; i >= 0; i--) {
-        genome->nodes[i].is_active = false;
-    }
+    uint64_t active = 0;
 
     // mark inputs of primary outputs as active
     for (int i = 0; i < CGP_OUTPUTS; i++) {
         int index = genome->outputs[i] - CGP_INPUTS;
         // index may be negative (primary input), so do the check...
         if (index >= 0) {
-            genome->nodes[index].is_active = true;
+            active |= 1ULL << index;
         }
     }
 
-    // then walk nodes backwards and mark inputs of active nodes
-    // as active nodes
-    for (int i = CGP_NODES - 1; i >= 0; i--) {
-        if (!genome->nodes[i].is_active) continue;
+    // then visit active nodes from the highest one and mark their inputs
+    // as active nodes, inputs always precede the node
+    uint64_t pending = active;
+    while (pending) {
+        int i = 63 - __builtin_clzll(pending);
+        pending &= ~(1ULL << i);
         cgp_node_t *n = &(genome->nodes[i]);
 
         for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
             int index = n->inputs[k] - CGP_INPUTS;
             // index may be negative (primary input), so do the check...
-            if (index >= 0) {
-                genome->nodes[index].is_active = true;
+            if (index >= 0 && !(active & (1ULL << index))) {
+                active |= 1ULL << index;
+                pending |= 1ULL << index;
             }
         }
     }
+
+    genome->active = active;
 }
 
 
+/**
+ * Adds one value to phenotype hash (FNV-1a over whole words)
+ */
+static inline uint64_t _cgp_hash_add(uint64_t hash, uint64_t value)
+{
+    return (hash ^ value) * 0x100000001B3ULL;
+}
+
+
+/**
+ * Calculates hash of phenotype - only nodes which influence outputs
+ * (and their used inputs) are hashed, renumbered in order of appearance.
+ * Genomes with the same phenotype thus have the same hash, regardless
+ * of their inactive genes.
+ * @param  chromosome
+ * @return hash
+ */
+uint64_t cgp_phenotype_hash(ga_chr_t chromosome)
+{
+    cgp_genome_t genome = (cgp_genome_t) chromosome->genome;
+    bool used[CGP_NODES];
+    int renumbered[CGP_INPUTS + CGP_NODES];
+
+    // same as `cgp_find_active_blocks`, but follows only inputs which
+    // the function really reads
+    memset(used, 0, sizeof(used));
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        int index = genome->outputs[i] - CGP_INPUTS;
+        if (index >= 0) {
+            used[index] = true;
+        }
+    }
+    for (int i = CGP_NODES - 1; i >= 0; i--) {
+        if (!used[i]) continue;
+        cgp_node_t *n = &(genome->nodes[i]);
+
+        for (int k = 0; k < cgp_func_arity[n->function]; k++) {
+            int index = n->inputs[k] - CGP_INPUTS;
+            if (index >= 0) {
+                used[index] = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < CGP_INPUTS; i++) {
+        renumbered[i] = i;
+    }
+
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    int next = CGP_INPUTS;
+
+    for (int i = 0; i < CGP_NODES; i++) {
+        if (!used[i]) continue;
+        cgp_node_t *n = &(genome->nodes[i]);
+        int arity = cgp_func_arity[n->function];
+
+        hash = _cgp_hash_add(hash, n->function);
+        for (int k = 0; k < arity; k++) {
+            hash = _cgp_hash_add(hash, renumbered[n->inputs[k]]);
+        }
+        renumbered[CGP_INPUTS + i] = next++;
+    }
+
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        hash = _cgp_hash_add(hash, renumbered[genome->outputs[i]]);
+    }
+
+    // final avalanche, so that low bits can be used as table index
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
 
 /* population *****************************************************************/
 
 
+static void _cgp_offspring_task(void *data, int index)
+{
+    ga_pop_t pop = (ga_pop_t) data;
+    ga_chr_t parent = pop->best_chromosome;
+    ga_chr_t chr = pop->chromosomes[index];
+
+    if (chr == parent) return;
+    TIMING_START(start);
+    ga_copy_chr(chr, parent, cgp_copy_genome);
+    cgp_mutate_chr(chr);
+    TIMING_STOP(timing_cgp_offspring, start);
+
+    // evaluate right away, so the generation does not wait for all
+    // children to be created first
+    ga_evaluate_chr(pop, chr);
+}
+
+
 /**
  * Create new generation
  * @param pop
@@ -392,13 +641,5 @@ void cgp_find_active_blocks(ga_chr_t chromosome)
  */
 void cgp_offspring(ga_pop_t pop)
 {
-    ga_chr_t parent = pop->best_chromosome;
-
-    #pragma omp parallel for
-    for (int i = 0; i < pop->size; i++) {
-        ga_chr_t chr = pop->chromosomes[i];
-        if (chr == parent) continue;
-        ga_copy_chr(chr, parent, cgp_copy_genome);
-        cgp_mutate_chr(chr);
-    }
+    ga_parallel_for(pop->size, _cgp_offspring_task, pop);
 }
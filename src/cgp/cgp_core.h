@@ -20,67 +20,173 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <stdlib.h>
+
 #include "../ga.h"
 #include "cgp_config.h"
+#include "cgp_func.h"
 
 
-#define CGP_FUNC_INPUTS 2
 #define CGP_NODES (CGP_COLS * CGP_ROWS)
 #define CGP_CHR_OUTPUTS_INDEX ((CGP_FUNC_INPUTS + 1) * CGP_NODES)
 #define CGP_CHR_LENGTH (CGP_CHR_OUTPUTS_INDEX + CGP_OUTPUTS)
 
 static const ga_problem_type_t CGP_PROBLEM_TYPE = maximize;
 
+// index of node input read by three-input functions only, with two inputs
+// it is the second one, so that evaluators need no conditional compilation
+#define CGP_INPUT_C ((CGP_FUNC_INPUTS > 2)? 2 : 1)
+
 typedef unsigned char cgp_value_t;
 
-#define CGP_FUNC_COUNT 16
-typedef enum
+
+#define _CGP_FUNC_EVAL(name, arity, commutative, cost, symbol, expression) \
+    case name: return (cgp_value_t) (expression);
+
+
+/**
+ * Calculates output of single function block
+ * @param  function
+ * @param  A First input
+ * @param  B Second input
+ * @param  C Third input, used by three-input functions only
+ * @return
+ */
+static inline cgp_value_t cgp_eval_func(cgp_func_t function,
+    cgp_value_t A, cgp_value_t B, cgp_value_t C)
 {
-    c255 = 0,   // 255
-    identity,   // a
-    inversion,  // 255 - a
-    b_or,       // a or b
-    b_not1or2,  // (not a) or b
-    b_and,      // a and b
-    b_nand,     // not (a and b)
-    b_xor,      // a xor b
-    rshift1,    // a >> 1
-    rshift2,    // a >> 2
-    swap,       // a <-> b
-    add,        // a + b
-    add_sat,    // a +S b
-    avg,        // (a + b) >> 1
-    max,        // max(a, b)
-    min,        // min(a, b)
-} cgp_func_t;
-
-
-/**
- * One CGP node (function block)
+    switch (function) {
+        CGP_FUNCTIONS(_CGP_FUNC_EVAL)
+        default: abort();
+    }
+}
+
+
+#if CGP_INPUTS + CGP_NODES > 256
+    #error "Packed genome stores connections in bytes, use at most 256 inputs and nodes"
+#endif
+
+#if CGP_NODES > 64
+    #error "Active nodes are stored in 64-bit mask, use at most 64 nodes"
+#endif
+
+
+/* genome alignment, so that small genome spans as few cache lines as possible */
+#define CGP_GENOME_ALIGNMENT 64
+
+
+/**
+ * One CGP node (function block), packed to CGP_FUNC_INPUTS + 1 bytes
  */
 typedef struct {
-    int inputs[CGP_FUNC_INPUTS];
-    cgp_func_t function;
-    bool is_active;
+    uint8_t inputs[CGP_FUNC_INPUTS];
+    uint8_t function;
 } cgp_node_t;
 
 
 /**
  * Chromosome
+ *
+ * Packed layout, default 8x4 genome with two-input nodes takes 112 bytes
+ * (two cache lines).
+ * Loaders and dumps convert from and to the textual format.
  */
 struct cgp_genome {
+    // bit i is set if node i is active
+    uint64_t active;
     cgp_node_t nodes[CGP_COLS * CGP_ROWS];
-    int outputs[CGP_OUTPUTS];
+    uint8_t outputs[CGP_OUTPUTS];
 };
 typedef struct cgp_genome* cgp_genome_t;
 
 
+/**
+ * Returns whether node with given index is active
+ * @param  genome
+ * @param  index
+ * @return
+ */
+static inline bool cgp_node_is_active(cgp_genome_t genome, int index)
+{
+    return (genome->active >> index) & 1;
+}
+
+
+/**
+ * Mutation strategies
+ */
+typedef enum {
+    // random number of genes in [0, rate], phenotype may stay the same
+    mutation_point = 0,
+    // point mutation repeated until some active gene is changed
+    mutation_active,
+    // single genes are changed until some active gene is changed
+    mutation_single,
+} cgp_mutation_t;
+
+
+/**
+ * Mutation statistics, gathered since cgp_init
+ */
+typedef struct {
+    // number of mutated chromosomes
+    long chromosomes;
+    // chromosomes without any active gene changed
+    long neutral_chromosomes;
+    // changed genes which did not affect the phenotype
+    long neutral_genes;
+    // changed genes which affected the phenotype
+    long effective_genes;
+} cgp_mutation_stats_t;
+
+
 /**
  * Initialize CGP internals
  */
 void cgp_init(int mutation_rate, ga_fitness_func_t fitness_func);
 
 
+/**
+ * Set mutation strategy, default is point mutation
+ * @param strategy
+ */
+void cgp_set_mutation(cgp_mutation_t strategy);
+
+
+/**
+ * Returns mutation statistics
+ * @param stats
+ */
+void cgp_get_mutation_stats(cgp_mutation_stats_t *stats);
+
+
+/**
+ * Set functions which may be used in new and mutated genomes,
+ * default is CGP_FUNC_SET_DEFAULT
+ * @param functions
+ */
+void cgp_set_functions(cgp_func_set_t functions);
+
+
+/**
+ * Parses comma separated list of function names, "all" or "default"
+ * @param  list
+ * @param  functions Parsed set is stored here
+ * @return 0 on success, -1 on unknown or unusable function or empty set
+ */
+int cgp_parse_functions(const char *list, cgp_func_set_t *functions);
+
+
+/**
+ * Formats function set as comma separated list of names
+ * @param functions
+ * @param buffer
+ * @param size
+ */
+void cgp_format_functions(cgp_func_set_t functions, char *buffer, size_t size);
+
+
 /**
  * Deinitialize CGP internals
  */
@@ -131,7 +237,8 @@ void cgp_copy_genome(void *_dst, void *_src);
  * Replace gene on given locus with random alele
  * @param chr
  * @param gene
- * @return whether active node was changed or not (phenotype has changed)
+ * @return whether gene of active node or output was actually changed
+ *         (phenotype has changed)
  */
 bool cgp_randomize_gene(cgp_genome_t genome, int gene);
 
@@ -207,3 +314,14 @@ static inline int cgp_node_row(int index)
  * @param active
  */
 void cgp_find_active_blocks(ga_chr_t chromosome);
+
+
+/**
+ * Calculates hash of phenotype - only nodes which influence outputs
+ * (and their used inputs) are hashed, renumbered in order of appearance.
+ * Genomes with the same phenotype thus have the same hash, regardless
+ * of their inactive genes.
+ * @param  chromosome
+ * @return hash
+ */
+uint64_t cgp_phenotype_hash(ga_chr_t chromosome);
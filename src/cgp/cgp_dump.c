@@ -20,36 +20,28 @@
 
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include "cgp_dump.h"
+#include "cgp_program.h"
 
 
 #define FITNESS_PRECISE_FMT "%a"
 
 
 static inline const char* cgp_func_name(cgp_func_t f) {
-    const char *func_names[] = {
-        " FF ",     // 255
-        "  a ",     // a
-        "FF-a",     // 255 - a
-        " or ",     // a or b
-        "~1|2",     // (not a) or b
-        " and",     // a and b
-        "nand",     // not (a and b)
-        " xor",     // a xor b
-        "a>>1",     // a >> 1
-        "a>>2",     // a >> 2
-        "swap",     // a <-> b
-        " +  ",     // a + b
-        " +S ",     // a +S b
-        " avg",     // (a + b) >> 1
-        " max",     // max(a, b)
-        " min",     // min(a, b)
-    };
-    return func_names[f];
+    return cgp_func_symbols[f];
 }
 
 
+// scalar expressions of functions, as written in CGP_FUNCTIONS
+#define _CGP_DUMP_C_EXPRESSION(name, arity, commutative, cost, symbol, expression) \
+    #expression,
+static const char * const _cgp_dump_c_expressions[] = {
+    CGP_FUNCTIONS(_CGP_DUMP_C_EXPRESSION)
+};
+
+
 /**
  * Dumps chromosome to given file pointer
  * @param fp
@@ -65,6 +57,9 @@ void cgp_dump_chr(ga_chr_t chr, FILE *fp, cgp_dump_format fmt)
     } else if (fmt == asciiart_active) {
         cgp_dump_chr_asciiart(chr, fp, true);
 
+    } else if (fmt == c_source) {
+        cgp_dump_chr_c(chr, fp);
+
     } else {
         cgp_dump_chr_compat(chr, fp);
     }
@@ -128,8 +123,11 @@ void cgp_dump_chr_compat(ga_chr_t chr, FILE *fp)
 
     for (int i = 0; i < CGP_NODES; i++) {
         cgp_node_t *n = &(genome->nodes[i]);
-        fprintf(fp, "([%u] %u, %u, %u)",
-            CGP_INPUTS + i, n->inputs[0], n->inputs[1], n->function);
+        fprintf(fp, "([%u]", CGP_INPUTS + i);
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            fprintf(fp, " %u,", n->inputs[k]);
+        }
+        fprintf(fp, " %u)", n->function);
     }
 
     cgp_dump_chr_outputs(chr, fp);
@@ -152,8 +150,11 @@ void cgp_dump_chr_readable(ga_chr_t chr, FILE *fp)
             int i = cgp_node_index(x, y);
             cgp_node_t *n = &(genome->nodes[i]);
 
-            fprintf(fp, "([%2u] %2u, %2u, %2u)  ",
-                CGP_INPUTS + i, n->inputs[0], n->inputs[1], n->function);
+            fprintf(fp, "([%2u]", CGP_INPUTS + i);
+            for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+                fprintf(fp, " %2u,", n->inputs[k]);
+            }
+            fprintf(fp, " %2u)  ", n->function);
         }
         if (CGP_OUTPUTS <= CGP_ROWS && y < CGP_OUTPUTS) {
             fprintf(fp, "  (%2u)", genome->outputs[y]);
@@ -235,9 +236,8 @@ void cgp_dump_chr_asciiart(ga_chr_t chr, FILE *fp, bool only_active_blocks)
         fprintf(fp, " ");
         for (int x = 0; x < CGP_COLS; x++) {
             int i = cgp_node_index(x, y);
-            cgp_node_t *n = &(genome->nodes[i]);
 
-            if (only_active_blocks && !n->is_active) {
+            if (only_active_blocks && !cgp_node_is_active(genome, i)) {
                 fprintf(fp, "                ");
             } else {
                 fprintf(fp, "    .----.      ");
@@ -256,7 +256,7 @@ void cgp_dump_chr_asciiart(ga_chr_t chr, FILE *fp, bool only_active_blocks)
             int i = cgp_node_index(x, y);
             cgp_node_t *n = &(genome->nodes[i]);
 
-            if (only_active_blocks && !n->is_active) {
+            if (only_active_blocks && !cgp_node_is_active(genome, i)) {
                 fprintf(fp, "                ");
             } else {
                 fprintf(fp, "[%2u]>|    |>[%2u]", n->inputs[0], CGP_INPUTS + i);
@@ -275,7 +275,7 @@ void cgp_dump_chr_asciiart(ga_chr_t chr, FILE *fp, bool only_active_blocks)
             int i = cgp_node_index(x, y);
             cgp_node_t *n = &(genome->nodes[i]);
 
-            if (only_active_blocks && !n->is_active) {
+            if (only_active_blocks && !cgp_node_is_active(genome, i)) {
                 fprintf(fp, "                ");
             } else {
                 fprintf(fp, "[%2u]>|%s|     ", n->inputs[1], cgp_func_name(n->function));
@@ -293,10 +293,12 @@ void cgp_dump_chr_asciiart(ga_chr_t chr, FILE *fp, bool only_active_blocks)
         fprintf(fp, " ");
         for (int x = 0; x < CGP_COLS; x++) {
             int i = cgp_node_index(x, y);
-            cgp_node_t *n = &(genome->nodes[i]);
 
-            if (only_active_blocks && !n->is_active) {
+            if (only_active_blocks && !cgp_node_is_active(genome, i)) {
                 fprintf(fp, "                ");
+            } else if (CGP_FUNC_INPUTS > 2) {
+                // third input
+                fprintf(fp, "%3u>'----'      ", genome->nodes[i].inputs[CGP_INPUT_C]);
             } else {
                 fprintf(fp, "    '----'      ");
             }
@@ -319,6 +321,348 @@ void cgp_dump_chr_asciiart(ga_chr_t chr, FILE *fp, bool only_active_blocks)
 }
 
 
+/**
+ * C source rendering helper: formats name of value in given slot
+ * @param program
+ * @param slot
+ * @param vector_prefix Intrinsics prefix for vector code, NULL for scalar
+ * @param buffer
+ * @param size Buffer size
+ */
+static void _cgp_dump_c_operand(const cgp_program_t *program, int slot,
+    const char *vector_prefix, char *buffer, size_t size)
+{
+    if (slot < CGP_INPUTS) {
+        snprintf(buffer, size, "in[%d]", slot);
+
+    } else if (slot < CGP_PROGRAM_CONST_SLOT(0)) {
+        snprintf(buffer, size, "v%d", slot - CGP_INPUTS);
+
+    } else {
+        cgp_value_t value = program->constants[slot - CGP_PROGRAM_CONST_SLOT(0)];
+        if (vector_prefix) {
+            snprintf(buffer, size, "%sset1_epi8((char) 0x%02X)", vector_prefix, value);
+        } else {
+            snprintf(buffer, size, "0x%02X", value);
+        }
+    }
+}
+
+
+/**
+ * C source rendering helper: prints scalar function for every function
+ * used in program, expressions are the same as in `cgp_eval_func`
+ * @param program
+ * @param fp
+ */
+static void _cgp_dump_c_scalar_funcs(const cgp_program_t *program, FILE *fp)
+{
+    cgp_func_set_t used = 0;
+    for (int i = 0; i < program->length; i++) {
+        used |= (cgp_func_set_t) 1 << program->instrs[i].function;
+    }
+
+    for (int f = 0; f < CGP_FUNC_COUNT; f++) {
+        if (!(used & ((cgp_func_set_t) 1 << f))) continue;
+        fprintf(fp,
+            "static inline uint8_t coco_f_%s(uint8_t A, uint8_t B, uint8_t C)\n"
+            "{\n"
+            "    return (uint8_t) (%s);\n"
+            "}\n\n",
+            cgp_func_names[f], _cgp_dump_c_expressions[f]);
+    }
+    fprintf(fp, "\n");
+}
+
+
+/**
+ * C source rendering helper: prints scalar expression of single instruction
+ * @param program
+ * @param instr
+ * @param fp
+ */
+static void _cgp_dump_c_scalar_instr(const cgp_program_t *program,
+    const cgp_instr_t *instr, FILE *fp)
+{
+    char A[32], B[32], C[32];
+    _cgp_dump_c_operand(program, instr->inputs[0], NULL, A, sizeof(A));
+    _cgp_dump_c_operand(program, instr->inputs[1], NULL, B, sizeof(B));
+    _cgp_dump_c_operand(program, instr->inputs[CGP_INPUT_C], NULL, C, sizeof(C));
+    fprintf(fp, "coco_f_%s(%s, %s, %s)", cgp_func_names[instr->function], A, B, C);
+}
+
+
+/**
+ * C source rendering helper: prints vector expression of single instruction.
+ * Unlike `cgp_program_output_sse`, avg is rounded down exactly as scalar one.
+ * @param program
+ * @param instr
+ * @param p Intrinsics prefix, e.g. "_mm256_"
+ * @param si Integer vector suffix, e.g. "si256"
+ * @param fp
+ */
+static void _cgp_dump_c_vector_instr(const cgp_program_t *program,
+    const cgp_instr_t *instr, const char *p, const char *si, FILE *fp)
+{
+    char A[64], B[64], C[64], FF[64];
+    _cgp_dump_c_operand(program, instr->inputs[0], p, A, sizeof(A));
+    _cgp_dump_c_operand(program, instr->inputs[1], p, B, sizeof(B));
+    _cgp_dump_c_operand(program, instr->inputs[CGP_INPUT_C], p, C, sizeof(C));
+    snprintf(FF, sizeof(FF), "%sset1_epi8((char) 0xFF)", p);
+
+    switch (instr->function) {
+        case c255:
+            fprintf(fp, "%s", FF);
+            break;
+
+        case identity:
+            fprintf(fp, "%s", A);
+            break;
+
+        case inversion:
+            fprintf(fp, "%sxor_%s(%s, %s)", p, si, A, FF);
+            break;
+
+        case b_or:
+            fprintf(fp, "%sor_%s(%s, %s)", p, si, A, B);
+            break;
+
+        case b_not1or2:
+            fprintf(fp, "%sor_%s(%sxor_%s(%s, %s), %s)", p, si, p, si, A, FF, B);
+            break;
+
+        case b_and:
+            fprintf(fp, "%sand_%s(%s, %s)", p, si, A, B);
+            break;
+
+        case b_nand:
+            fprintf(fp, "%sxor_%s(%sand_%s(%s, %s), %s)", p, si, p, si, A, B, FF);
+            break;
+
+        case b_xor:
+            fprintf(fp, "%sxor_%s(%s, %s)", p, si, A, B);
+            break;
+
+        case rshift1:
+            fprintf(fp, "%sand_%s(%ssrli_epi16(%s, 1), %sset1_epi8(0x7F))",
+                p, si, p, A, p);
+            break;
+
+        case rshift2:
+            fprintf(fp, "%sand_%s(%ssrli_epi16(%s, 2), %sset1_epi8(0x3F))",
+                p, si, p, A, p);
+            break;
+
+        case swap:
+            fprintf(fp, "%sor_%s(%sand_%s(%sslli_epi16(%s, 4), %sset1_epi8((char) 0xF0)), "
+                "%sand_%s(%s, %sset1_epi8(0x0F)))",
+                p, si, p, si, p, A, p, p, si, B, p);
+            break;
+
+        case add:
+            fprintf(fp, "%sadd_epi8(%s, %s)", p, A, B);
+            break;
+
+        case add_sat:
+            fprintf(fp, "%sadds_epu8(%s, %s)", p, A, B);
+            break;
+
+        case avg:
+            // pavgb rounds up, subtract carry of lowest bits
+            fprintf(fp, "%ssub_epi8(%savg_epu8(%s, %s), %sand_%s(%sxor_%s(%s, %s), %sset1_epi8(1)))",
+                p, p, A, B, p, si, p, si, A, B, p);
+            break;
+
+        case max:
+            fprintf(fp, "%smax_epu8(%s, %s)", p, A, B);
+            break;
+
+        case min:
+            fprintf(fp, "%smin_epu8(%s, %s)", p, A, B);
+            break;
+
+        case absdiff:
+            fprintf(fp, "%sor_%s(%ssubs_epu8(%s, %s), %ssubs_epu8(%s, %s))",
+                p, si, p, A, B, p, B, A);
+            break;
+
+        case avg_round:
+            fprintf(fp, "%savg_epu8(%s, %s)", p, A, B);
+            break;
+
+        case sub_sat:
+            fprintf(fp, "%ssubs_epu8(%s, %s)", p, A, B);
+            break;
+
+        case cmp_select:
+            fprintf(fp, "%sand_%s(%scmpeq_epi8(%smax_epu8(%s, %s), %s), %s)",
+                p, si, p, p, A, B, A, A);
+            break;
+
+        case min3:
+            fprintf(fp, "%smin_epu8(%smin_epu8(%s, %s), %s)", p, p, A, B, C);
+            break;
+
+        case max3:
+            fprintf(fp, "%smax_epu8(%smax_epu8(%s, %s), %s)", p, p, A, B, C);
+            break;
+
+        case median3:
+            fprintf(fp, "%smax_epu8(%smin_epu8(%s, %s), %smin_epu8(%smax_epu8(%s, %s), %s))",
+                p, p, A, B, p, p, A, B, C);
+            break;
+    }
+}
+
+
+/**
+ * C source rendering helper: prints vector kernel
+ * @param program
+ * @param type Vector type, e.g. "__m256i"
+ * @param p Intrinsics prefix, e.g. "_mm256_"
+ * @param si Integer vector suffix, e.g. "si256"
+ * @param fp
+ */
+static void _cgp_dump_c_vector_kernel(const cgp_program_t *program,
+    const char *type, const char *p, const char *si, FILE *fp)
+{
+    int width = (strcmp(si, "si256") == 0)? 32 : 16;
+
+    fprintf(fp, "#define COCO_FILTER_VECTOR %d\n", width);
+    fprintf(fp, "typedef %s coco_vector_t;\n", type);
+    fprintf(fp, "#define coco_vector_load(ptr) %sloadu_%s((const %s*) (ptr))\n", p, si, type);
+    fprintf(fp, "#define coco_vector_store(ptr, v) %sstoreu_%s((%s*) (ptr), (v))\n\n", p, si, type);
+
+    fprintf(fp, "static inline %s coco_filter_vector(const %s in[%d])\n{\n",
+        type, type, CGP_INPUTS);
+    for (int i = 0; i < program->length; i++) {
+        fprintf(fp, "    const %s v%d = ", type, i);
+        _cgp_dump_c_vector_instr(program, &program->instrs[i], p, si, fp);
+        fprintf(fp, ";\n");
+    }
+    char Y[64];
+    _cgp_dump_c_operand(program, program->outputs[0], p, Y, sizeof(Y));
+    fprintf(fp, "    return %s;\n}\n", Y);
+}
+
+
+/**
+ * Dumps chromosome to given file as self-contained C source of image filter.
+ * Only active nodes are emitted, as straight-line code. Generated source
+ * contains scalar code and AVX2 or SSE2 kernel, selected by compiler flags,
+ * and defines function
+ *
+ *     void coco_filter_image(const uint8_t *src, uint8_t *dst,
+ *         int width, int height);
+ *
+ * which filters 8-bit grayscale image. Output is the same as of
+ * `cgp_get_output` applied to each pixel window.
+ *
+ * @param chr
+ * @param fp
+ */
+void cgp_dump_chr_c(ga_chr_t chr, FILE *fp)
+{
+    cgp_program_t program;
+    cgp_program_build(&program, chr);
+
+    fprintf(fp,
+        "/*\n"
+        " * Image filter generated from evolved CGP circuit\n");
+    if (chr->has_fitness) {
+        fprintf(fp, " * Fitness: %lf\n", chr->fitness);
+    }
+    fprintf(fp,
+        " * Instructions: %d\n"
+        " *\n"
+        " * Compile with -O3 -mavx2 or -O3 -msse2 to get vectorized kernel,\n"
+        " * define COCO_FILTER_NO_SIMD to use scalar code only.\n"
+        " */\n"
+        "\n"
+        "#include <stddef.h>\n"
+        "#include <stdint.h>\n"
+        "\n"
+        "\n",
+        program.length);
+
+    // scalar code, used for image borders and without SIMD
+    _cgp_dump_c_scalar_funcs(&program, fp);
+    fprintf(fp, "static inline uint8_t coco_filter_pixel(const uint8_t in[%d])\n{\n",
+        CGP_INPUTS);
+    for (int i = 0; i < program.length; i++) {
+        fprintf(fp, "    const uint8_t v%d = ", i);
+        _cgp_dump_c_scalar_instr(&program, &program.instrs[i], fp);
+        fprintf(fp, ";\n");
+    }
+    char Y[32];
+    _cgp_dump_c_operand(&program, program.outputs[0], NULL, Y, sizeof(Y));
+    fprintf(fp, "    return %s;\n}\n\n\n", Y);
+
+    fprintf(fp, "#if !defined(COCO_FILTER_NO_SIMD) && defined(__AVX2__)\n\n");
+    fprintf(fp, "#include <immintrin.h>\n\n");
+    _cgp_dump_c_vector_kernel(&program, "__m256i", "_mm256_", "si256", fp);
+    fprintf(fp, "\n#elif !defined(COCO_FILTER_NO_SIMD) && defined(__SSE2__)\n\n");
+    fprintf(fp, "#include <emmintrin.h>\n\n");
+    _cgp_dump_c_vector_kernel(&program, "__m128i", "_mm_", "si128", fp);
+    fprintf(fp, "\n#endif\n\n\n");
+
+    fprintf(fp,
+        "/* loads 3x3 neighbourhood of pixel, image borders are replicated */\n"
+        "static inline void coco_filter_window(const uint8_t *rows[3], int x,\n"
+        "    int width, uint8_t in[9])\n"
+        "{\n"
+        "    int left = (x > 0)? x - 1 : 0;\n"
+        "    int right = (x < width - 1)? x + 1 : width - 1;\n"
+        "    for (int r = 0; r < 3; r++) {\n"
+        "        in[3 * r + 0] = rows[r][left];\n"
+        "        in[3 * r + 1] = rows[r][x];\n"
+        "        in[3 * r + 2] = rows[r][right];\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "\n"
+        "/* filters 8-bit grayscale image row by row, src and dst must not overlap */\n"
+        "void coco_filter_image(const uint8_t *src, uint8_t *dst, int width, int height)\n"
+        "{\n"
+        "    uint8_t in[9];\n"
+        "\n"
+        "    for (int y = 0; y < height; y++) {\n"
+        "        const uint8_t *rows[3] = {\n"
+        "            src + (size_t) ((y > 0)? y - 1 : 0) * width,\n"
+        "            src + (size_t) y * width,\n"
+        "            src + (size_t) ((y < height - 1)? y + 1 : height - 1) * width,\n"
+        "        };\n"
+        "        uint8_t *out = dst + (size_t) y * width;\n"
+        "        int x = 0;\n"
+        "\n"
+        "#ifdef COCO_FILTER_VECTOR\n"
+        "        // left border is done by scalar code, vectors need x - 1\n"
+        "        if (width > 0) {\n"
+        "            coco_filter_window(rows, 0, width, in);\n"
+        "            out[0] = coco_filter_pixel(in);\n"
+        "            x = 1;\n"
+        "        }\n"
+        "\n"
+        "        for (; x + COCO_FILTER_VECTOR < width; x += COCO_FILTER_VECTOR) {\n"
+        "            coco_vector_t vin[9];\n"
+        "            for (int r = 0; r < 3; r++) {\n"
+        "                for (int c = 0; c < 3; c++) {\n"
+        "                    vin[3 * r + c] = coco_vector_load(rows[r] + x - 1 + c);\n"
+        "                }\n"
+        "            }\n"
+        "            coco_vector_store(out + x, coco_filter_vector(vin));\n"
+        "        }\n"
+        "#endif\n"
+        "\n"
+        "        for (; x < width; x++) {\n"
+        "            coco_filter_window(rows, x, width, in);\n"
+        "            out[x] = coco_filter_pixel(in);\n"
+        "        }\n"
+        "    }\n"
+        "}\n");
+}
+
+
 /**
  * Dumps whole population to given file pointer with chromosomes in
  * CGP-viewer compatible format
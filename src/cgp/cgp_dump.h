@@ -35,6 +35,7 @@ typedef enum {
     asciiart_active,
     compat,
     readable,
+    c_source,
 } cgp_dump_format;
 
 
@@ -62,6 +63,24 @@ void cgp_dump_chr_compat(ga_chr_t chr, FILE *fp);
 void cgp_dump_chr_readable(ga_chr_t chr, FILE *fp);
 
 
+/**
+ * Dumps chromosome to given file as self-contained C source of image filter.
+ * Only active nodes are emitted, as straight-line code. Generated source
+ * contains scalar code and AVX2 or SSE2 kernel, selected by compiler flags,
+ * and defines function
+ *
+ *     void coco_filter_image(const uint8_t *src, uint8_t *dst,
+ *         int width, int height);
+ *
+ * which filters 8-bit grayscale image. Output is the same as of
+ * `cgp_get_output` applied to each pixel window.
+ *
+ * @param chr
+ * @param fp
+ */
+void cgp_dump_chr_c(ga_chr_t chr, FILE *fp);
+
+
 /**
  * Dumps chromosome to given file as an ASCII-art, which looks like this:
  *
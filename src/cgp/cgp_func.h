@@ -0,0 +1,132 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include "cgp_config.h"
+
+
+/**
+ * CGP function registry
+ *
+ * Every function is one row of the table:
+ *
+ *     X(name, arity, commutative, cost, symbol, expression)
+ *
+ *   name        - value of `cgp_func_t`, also used by --cgp-functions
+ *   arity       - number of inputs the function reads (0 - 3), functions
+ *                 with more inputs than CGP_FUNC_INPUTS are never used
+ *   commutative - whether result does not depend on inputs order
+ *   cost        - estimated number of SIMD instructions
+ *   symbol      - four characters wide label for ASCII art dumps
+ *   expression  - scalar reference implementation, operands are A, B, C
+ *
+ * SSE2 and AVX2 implementations are `_cgp_sse_<name>` in cgp_sse.c and
+ * `_cgp_avx_<name>` in cgp_avx.c, C source dump is in cgp_dump.c.
+ *
+ * Function index is stored in chromosome files, so new functions
+ * must be appended to the end.
+ */
+#define CGP_FUNCTIONS(X) \
+    X(c255,       0, 0, 0, " FF ", 255) \
+    X(identity,   1, 0, 0, "  a ", A) \
+    X(inversion,  1, 0, 1, "FF-a", 255 - A) \
+    X(b_or,       2, 1, 1, " or ", A | B) \
+    X(b_not1or2,  2, 0, 2, "~1|2", ~A | B) \
+    X(b_and,      2, 1, 1, " and", A & B) \
+    X(b_nand,     2, 1, 2, "nand", ~(A & B)) \
+    X(b_xor,      2, 1, 1, " xor", A ^ B) \
+    X(rshift1,    1, 0, 2, "a>>1", A >> 1) \
+    X(rshift2,    1, 0, 2, "a>>2", A >> 2) \
+    X(swap,       2, 0, 4, "swap", ((A & 0x0F) << 4) | (B & 0x0F)) \
+    X(add,        2, 1, 1, " +  ", A + B) \
+    X(add_sat,    2, 1, 1, " +S ", (A > 0xFF - B)? 0xFF : A + B) \
+    X(avg,        2, 1, 5, " avg", (A + B) >> 1) \
+    X(max,        2, 1, 1, " max", (A > B)? A : B) \
+    X(min,        2, 1, 1, " min", (A < B)? A : B) \
+    X(absdiff,    2, 1, 3, "|-| ", (A > B)? A - B : B - A) \
+    X(avg_round,  2, 1, 1, "avgr", (A + B + 1) >> 1) \
+    X(sub_sat,    2, 0, 1, " -S ", (A > B)? A - B : 0) \
+    X(cmp_select, 2, 0, 3, "a>=b", (A >= B)? A : 0) \
+    X(min3,       3, 1, 2, "min3", (A < B)? ((A < C)? A : C) : ((B < C)? B : C)) \
+    X(max3,       3, 1, 2, "max3", (A > B)? ((A > C)? A : C) : ((B > C)? B : C)) \
+    X(median3,    3, 1, 4, " med", (A < B)? ((B < C)? B : ((A < C)? C : A)) \
+                                           : ((A < C)? A : ((B < C)? C : B)))
+
+
+#define _CGP_FUNC_ENUM(name, ...) name,
+#define _CGP_FUNC_ONE(...) + 1
+#define _CGP_FUNC_NAME(name, ...) #name,
+#define _CGP_FUNC_ARITY(name, arity, ...) arity,
+#define _CGP_FUNC_COMMUTATIVE(name, arity, commutative, ...) commutative,
+#define _CGP_FUNC_COST(name, arity, commutative, cost, ...) cost,
+#define _CGP_FUNC_SYMBOL(name, arity, commutative, cost, symbol, ...) symbol,
+#define _CGP_FUNC_USABLE(name, arity, ...) \
+    | (((arity) <= CGP_FUNC_INPUTS)? ((cgp_func_set_t) 1 << (name)) : 0)
+
+
+typedef enum
+{
+    CGP_FUNCTIONS(_CGP_FUNC_ENUM)
+} cgp_func_t;
+
+
+enum {
+    CGP_FUNC_COUNT = 0 CGP_FUNCTIONS(_CGP_FUNC_ONE)
+};
+
+
+// multiple const to avoid "unused variable" warnings
+static const char * const cgp_func_names[] = {
+    CGP_FUNCTIONS(_CGP_FUNC_NAME)
+};
+
+static const char * const cgp_func_symbols[] = {
+    CGP_FUNCTIONS(_CGP_FUNC_SYMBOL)
+};
+
+static const int cgp_func_arity[] = {
+    CGP_FUNCTIONS(_CGP_FUNC_ARITY)
+};
+
+static const int cgp_func_commutative[] = {
+    CGP_FUNCTIONS(_CGP_FUNC_COMMUTATIVE)
+};
+
+static const int cgp_func_cost[] = {
+    CGP_FUNCTIONS(_CGP_FUNC_COST)
+};
+
+
+/**
+ * Set of allowed functions, bit i is set if function i may be used
+ */
+typedef uint64_t cgp_func_set_t;
+
+_Static_assert(CGP_FUNC_COUNT < 64, "Function set is stored in 64-bit mask");
+
+// the original function set (first 16 functions)
+#define CGP_FUNC_SET_DEFAULT ((cgp_func_set_t) 0xFFFF)
+
+// all functions usable with CGP_FUNC_INPUTS node inputs
+#define CGP_FUNC_SET_ALL ((cgp_func_set_t) 0 CGP_FUNCTIONS(_CGP_FUNC_USABLE))
@@ -47,7 +47,8 @@ int cgp_load_chr_compat(ga_chr_t chr, FILE *fp)
     if (rows != CGP_ROWS) return -2;
     if (func_inputs != CGP_FUNC_INPUTS) return -2;
     if (func_outputs != 1) return -2;
-    if (func_count != CGP_FUNC_COUNT) return -2;
+    // functions are only appended, files with fewer functions are fine
+    if (func_count > CGP_FUNC_COUNT) return -2;
 
     // nodes
 
@@ -56,10 +57,25 @@ int cgp_load_chr_compat(ga_chr_t chr, FILE *fp)
         cgp_node_t *n = &genome->nodes[i];
 
         int nodeid;
-        count = fscanf(fp, "([%u] %u, %u, %u)",
-            &nodeid, &n->inputs[0], &n->inputs[1], &n->function);
-        if (count != 4) return -1;
+        unsigned int input, function;
+        count = fscanf(fp, "([%u]", &nodeid);
+        if (count != 1) return -1;
         if (nodeid != CGP_INPUTS + i) return -1;
+
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            count = fscanf(fp, " %u,", &input);
+            if (count != 1) return -1;
+
+            // genome is packed, values must fit
+            if (input >= CGP_INPUTS + i) return -1;
+            n->inputs[k] = input;
+        }
+
+        count = fscanf(fp, " %u)", &function);
+        if (count != 1) return -1;
+        if (function >= func_count) return -1;
+        if (cgp_func_arity[function] > CGP_FUNC_INPUTS) return -1;
+        n->function = function;
     }
 
     // primary outputs
@@ -68,8 +84,11 @@ int cgp_load_chr_compat(ga_chr_t chr, FILE *fp)
     fscanf(fp, "(");
     for (int i = 0; i < CGP_OUTPUTS; i++) {
         if (i > 0) fscanf(fp, ",");
-        count = fscanf(fp, "%u", &genome->outputs[i]);
+        unsigned int output;
+        count = fscanf(fp, "%u", &output);
         if (count != 1) return -1;
+        if (output >= CGP_INPUTS + CGP_NODES) return -1;
+        genome->outputs[i] = output;
     }
     fscanf(fp, ")\n");
 
@@ -0,0 +1,639 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include <string.h>
+#include <assert.h>
+
+#include "cgp_program.h"
+
+
+/*
+    While building, values are referenced by "refs": primary input index,
+    CGP_INPUTS + index of temporary instruction, or negative number for
+    constant value (see _REF_CONST).
+ */
+#define _REF_CONST(value) (-1 - (int) (value))
+#define _REF_IS_CONST(ref) ((ref) < 0)
+#define _REF_VALUE(ref) ((cgp_value_t) (-1 - (ref)))
+
+
+typedef struct {
+    int length;
+    cgp_instr_t instrs[CGP_NODES];
+} _cgp_builder_t;
+
+
+/**
+ * Returns instruction which produces value of given ref, or NULL
+ */
+static inline cgp_instr_t *_cgp_def(_cgp_builder_t *builder, int ref)
+{
+    if (_REF_IS_CONST(ref) || ref < CGP_INPUTS) {
+        return NULL;
+    }
+    return &builder->instrs[ref - CGP_INPUTS];
+}
+
+
+/**
+ * Appends instruction, unless the same one already exists. Inputs not read
+ * by the function are set to the last read one (C is B with two-input nodes).
+ * @return ref to instruction result
+ */
+static int _cgp_emit(_cgp_builder_t *builder, cgp_func_t function,
+    int A, int B, int C)
+{
+    assert(CGP_FUNC_INPUTS > 2 || B == C);
+
+    for (int i = 0; i < builder->length; i++) {
+        cgp_instr_t *instr = &builder->instrs[i];
+        if (instr->function == function
+            && instr->inputs[0] == A && instr->inputs[1] == B
+            && instr->inputs[CGP_INPUT_C] == C) {
+            return CGP_INPUTS + i;
+        }
+    }
+
+    assert(builder->length < CGP_NODES);
+    cgp_instr_t *instr = &builder->instrs[builder->length];
+    instr->function = function;
+    instr->inputs[0] = A;
+    instr->inputs[1] = B;
+    instr->inputs[CGP_INPUT_C] = C;
+    return CGP_INPUTS + builder->length++;
+}
+
+
+/**
+ * Simplifies single-input function
+ */
+static int _cgp_simplify_unary(_cgp_builder_t *builder, cgp_func_t function,
+    int A)
+{
+    if (_REF_IS_CONST(A)) {
+        return _REF_CONST(cgp_eval_func(function, _REF_VALUE(A), 0, 0));
+    }
+
+    cgp_instr_t *def = _cgp_def(builder, A);
+
+    switch (function) {
+        case identity:
+            return A;
+
+        case inversion:
+            // 255 - (255 - x) = x
+            if (def && def->function == inversion) {
+                return def->inputs[0];
+            }
+            break;
+
+        case rshift1:
+            // (x >> 1) >> 1 = x >> 2
+            if (def && def->function == rshift1) {
+                int x = def->inputs[0];
+                return _cgp_emit(builder, rshift2, x, x, x);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return _cgp_emit(builder, function, A, A, A);
+}
+
+
+static int _cgp_simplify_rank(_cgp_builder_t *builder, cgp_func_t function,
+    int A, int B, int C);
+
+
+/**
+ * Simplifies one function block with already simplified inputs
+ * @return ref to its value
+ */
+static int _cgp_simplify(_cgp_builder_t *builder, cgp_func_t function,
+    int A, int B, int C)
+{
+    switch (cgp_func_arity[function]) {
+        case 0:
+            return _REF_CONST(cgp_eval_func(function, 0, 0, 0));
+
+        case 1:
+            return _cgp_simplify_unary(builder, function, A);
+
+        case 3:
+            return _cgp_simplify_rank(builder, function, A, B, C);
+
+        default:
+            break;
+    }
+
+    // SIMD evaluators calculate average as (A >> 1) + (B >> 1), while
+    // scalar one as (A + B) >> 1, results differ for two odd inputs.
+    // Program is shared by both, so averages cannot be folded.
+    if (function == avg) {
+        if (A > B) {
+            int tmp = A; A = B; B = tmp;
+        }
+        return _cgp_emit(builder, function, A, B, B);
+    }
+
+    if (_REF_IS_CONST(A) && _REF_IS_CONST(B)) {
+        return _REF_CONST(cgp_eval_func(function, _REF_VALUE(A), _REF_VALUE(B), 0));
+    }
+
+    // canonical order - constant as second input, otherwise lower ref first
+    if (cgp_func_commutative[function]
+        && (_REF_IS_CONST(A) || (!_REF_IS_CONST(B) && A > B))) {
+        int tmp = A; A = B; B = tmp;
+    }
+
+    bool b_const = _REF_IS_CONST(B);
+    cgp_value_t b_value = b_const? _REF_VALUE(B) : 0;
+
+    switch (function) {
+        case b_or:
+            if (A == B || (b_const && b_value == 0)) return A;
+            if (b_const && b_value == 255) return _REF_CONST(255);
+            break;
+
+        case b_and:
+            if (A == B || (b_const && b_value == 255)) return A;
+            if (b_const && b_value == 0) return _REF_CONST(0);
+            break;
+
+        case b_nand:
+            if (A == B || (b_const && b_value == 255)) {
+                return _cgp_simplify_unary(builder, inversion, A);
+            }
+            if (b_const && b_value == 0) return _REF_CONST(255);
+            break;
+
+        case b_xor:
+            if (A == B) return _REF_CONST(0);
+            if (b_const && b_value == 0) return A;
+            if (b_const && b_value == 255) {
+                return _cgp_simplify_unary(builder, inversion, A);
+            }
+            break;
+
+        case b_not1or2:
+            // ~A | B
+            if (A == B) return _REF_CONST(255);
+            if (_REF_IS_CONST(A) && _REF_VALUE(A) == 255) return B;
+            if (_REF_IS_CONST(A) && _REF_VALUE(A) == 0) return _REF_CONST(255);
+            if (b_const && b_value == 0) {
+                return _cgp_simplify_unary(builder, inversion, A);
+            }
+            if (b_const && b_value == 255) return _REF_CONST(255);
+            break;
+
+        case add:
+            if (b_const && b_value == 0) return A;
+            break;
+
+        case add_sat:
+            if (b_const && b_value == 0) return A;
+            if (b_const && b_value == 255) return _REF_CONST(255);
+            break;
+
+        case max:
+            if (A == B || (b_const && b_value == 0)) return A;
+            if (b_const && b_value == 255) return _REF_CONST(255);
+            break;
+
+        case min:
+            if (A == B || (b_const && b_value == 255)) return A;
+            if (b_const && b_value == 0) return _REF_CONST(0);
+            break;
+
+        case absdiff:
+            if (A == B) return _REF_CONST(0);
+            if (b_const && b_value == 0) return A;
+            if (b_const && b_value == 255) {
+                return _cgp_simplify_unary(builder, inversion, A);
+            }
+            break;
+
+        case avg_round:
+            if (A == B) return A;
+            break;
+
+        case sub_sat:
+            // A -S B
+            if (A == B || (b_const && b_value == 255)) return _REF_CONST(0);
+            if (_REF_IS_CONST(A) && _REF_VALUE(A) == 0) return _REF_CONST(0);
+            if (b_const && b_value == 0) return A;
+            if (_REF_IS_CONST(A) && _REF_VALUE(A) == 255) {
+                return _cgp_simplify_unary(builder, inversion, B);
+            }
+            break;
+
+        case cmp_select:
+            // (A >= B)? A : 0
+            if (A == B || (b_const && b_value == 0)) return A;
+            if (_REF_IS_CONST(A) && _REF_VALUE(A) == 0) return _REF_CONST(0);
+            break;
+
+        default:
+            break;
+    }
+
+    return _cgp_emit(builder, function, A, B, B);
+}
+
+
+/**
+ * Returns whether ref goes first in canonical order of symmetric
+ * function inputs - lower refs first, constants last
+ */
+static inline bool _cgp_ref_before(int a, int b)
+{
+    if (_REF_IS_CONST(a) != _REF_IS_CONST(b)) {
+        return !_REF_IS_CONST(a);
+    }
+    return a < b;
+}
+
+
+/**
+ * Simplifies three-input rank function (min3, max3, median3), its inputs
+ * are symmetric
+ */
+static int _cgp_simplify_rank(_cgp_builder_t *builder, cgp_func_t function,
+    int A, int B, int C)
+{
+    int tmp;
+    if (_cgp_ref_before(B, A)) { tmp = A; A = B; B = tmp; }
+    if (_cgp_ref_before(C, B)) { tmp = B; B = C; C = tmp; }
+    if (_cgp_ref_before(B, A)) { tmp = A; A = B; B = tmp; }
+
+    if (_REF_IS_CONST(A)) {
+        return _REF_CONST(cgp_eval_func(function,
+            _REF_VALUE(A), _REF_VALUE(B), _REF_VALUE(C)));
+    }
+
+    // equal refs are next to each other after sorting
+    if (A == B || B == C) {
+        int twice = B;
+        int other = (A == B)? C : A;
+        switch (function) {
+            case min3:  return _cgp_simplify(builder, min, twice, other, other);
+            case max3:  return _cgp_simplify(builder, max, twice, other, other);
+            default:    return twice;
+        }
+    }
+
+    // constant is the last input, 0 and 255 decide some of the results
+    bool c_const = _REF_IS_CONST(C);
+    cgp_value_t c_value = c_const? _REF_VALUE(C) : 0;
+    if (c_const && (c_value == 0 || c_value == 255)) {
+        switch (function) {
+            case min3:
+                if (c_value == 0) return _REF_CONST(0);
+                return _cgp_simplify(builder, min, A, B, B);
+
+            case max3:
+                if (c_value == 255) return _REF_CONST(255);
+                return _cgp_simplify(builder, max, A, B, B);
+
+            default:
+                return _cgp_simplify(builder, (c_value == 0)? min : max, A, B, B);
+        }
+    }
+
+    return _cgp_emit(builder, function, A, B, C);
+}
+
+
+/**
+ * Converts builder ref to program slot, constants get their slots
+ * on first use
+ */
+static int _cgp_ref_to_slot(cgp_program_t *program, int ref,
+    int instr_slots[CGP_NODES], int const_slots[256])
+{
+    if (_REF_IS_CONST(ref)) {
+        cgp_value_t value = _REF_VALUE(ref);
+        if (const_slots[value] < 0) {
+            assert(program->constants_count < CGP_PROGRAM_CONSTS);
+            program->constants[program->constants_count] = value;
+            const_slots[value] = CGP_PROGRAM_CONST_SLOT(program->constants_count);
+            program->constants_count++;
+        }
+        return const_slots[value];
+    }
+
+    if (ref < CGP_INPUTS) {
+        return ref;
+    }
+
+    return instr_slots[ref - CGP_INPUTS];
+}
+
+
+/**
+ * Translates active nodes of chromosome into simplified program
+ * @param program
+ * @param chromosome
+ */
+void cgp_program_build(cgp_program_t *program, ga_chr_t chromosome)
+{
+    cgp_genome_t genome = (cgp_genome_t) chromosome->genome;
+    _cgp_builder_t builder = { .length = 0 };
+
+    // ref of every node output, genome index -> ref
+    int refs[CGP_INPUTS + CGP_NODES];
+    for (int i = 0; i < CGP_INPUTS; i++) {
+        refs[i] = i;
+    }
+
+    for (int i = 0; i < CGP_NODES; i++) {
+        cgp_node_t *n = &(genome->nodes[i]);
+        if (!cgp_node_is_active(genome, i)) continue;
+
+        refs[CGP_INPUTS + i] = _cgp_simplify(&builder, n->function,
+            refs[n->inputs[0]], refs[n->inputs[1]], refs[n->inputs[CGP_INPUT_C]]);
+    }
+
+    // keep only instructions used by outputs, walk backwards
+    bool used[CGP_NODES];
+    memset(used, 0, sizeof(used));
+
+    int outputs[CGP_OUTPUTS];
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        outputs[i] = refs[genome->outputs[i]];
+        if (_cgp_def(&builder, outputs[i])) {
+            used[outputs[i] - CGP_INPUTS] = true;
+        }
+    }
+
+    for (int i = builder.length - 1; i >= 0; i--) {
+        if (!used[i]) continue;
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            int ref = builder.instrs[i].inputs[k];
+            if (_cgp_def(&builder, ref)) {
+                used[ref - CGP_INPUTS] = true;
+            }
+        }
+    }
+
+    // renumber refs to slots
+    int instr_slots[CGP_NODES];
+    int const_slots[256];
+    for (int i = 0; i < 256; i++) {
+        const_slots[i] = -1;
+    }
+
+    program->length = 0;
+    program->constants_count = 0;
+    program->luts_count = 0;
+
+    for (int i = 0; i < builder.length; i++) {
+        if (!used[i]) continue;
+        cgp_instr_t *src = &builder.instrs[i];
+        cgp_instr_t *dst = &program->instrs[program->length];
+
+        dst->function = src->function;
+        dst->lut = -1;
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            dst->inputs[k] = _cgp_ref_to_slot(program, src->inputs[k],
+                instr_slots, const_slots);
+        }
+        instr_slots[i] = CGP_PROGRAM_INSTR_SLOT(program->length);
+        program->length++;
+    }
+
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        program->outputs[i] = _cgp_ref_to_slot(program, outputs[i],
+            instr_slots, const_slots);
+    }
+}
+
+
+/**
+ * Removes instructions which do not influence outputs and renumbers
+ * instruction slots
+ * @param program
+ */
+static void _cgp_program_compact(cgp_program_t *program)
+{
+    bool used[CGP_NODES];
+    memset(used, 0, sizeof(used));
+
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        int slot = program->outputs[i];
+        if (slot >= CGP_INPUTS && slot < CGP_PROGRAM_CONST_SLOT(0)) {
+            used[slot - CGP_INPUTS] = true;
+        }
+    }
+
+    for (int i = program->length - 1; i >= 0; i--) {
+        if (!used[i]) continue;
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            int slot = program->instrs[i].inputs[k];
+            if (slot >= CGP_INPUTS && slot < CGP_PROGRAM_CONST_SLOT(0)) {
+                used[slot - CGP_INPUTS] = true;
+            }
+        }
+    }
+
+    // old instruction slot -> new one
+    int slots[CGP_PROGRAM_SLOTS];
+    for (int i = 0; i < CGP_PROGRAM_SLOTS; i++) {
+        slots[i] = i;
+    }
+
+    int length = 0;
+    for (int i = 0; i < program->length; i++) {
+        if (!used[i]) continue;
+        cgp_instr_t *instr = &program->instrs[length];
+        *instr = program->instrs[i];
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            instr->inputs[k] = slots[instr->inputs[k]];
+        }
+        slots[CGP_PROGRAM_INSTR_SLOT(i)] = CGP_PROGRAM_INSTR_SLOT(length);
+        length++;
+    }
+    program->length = length;
+
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        program->outputs[i] = slots[program->outputs[i]];
+    }
+}
+
+
+/**
+ * Fills lookup table with values of given instruction for all values of
+ * primary input it depends on
+ * @param program
+ * @param root Instruction index
+ * @param lut
+ */
+static void _cgp_program_fill_lut(const cgp_program_t *program, int root,
+    cgp_value_t lut[256])
+{
+    cgp_value_t values[CGP_PROGRAM_SLOTS];
+    memcpy(&values[CGP_PROGRAM_CONST_SLOT(0)], program->constants,
+        sizeof(cgp_value_t) * program->constants_count);
+
+    for (int x = 0; x < 256; x++) {
+        // other inputs do not influence the result
+        memset(values, x, sizeof(cgp_value_t) * CGP_INPUTS);
+
+        for (int i = 0; i <= root; i++) {
+            const cgp_instr_t *instr = &program->instrs[i];
+            if (instr->function == CGP_INSTR_LUT) {
+                values[CGP_PROGRAM_INSTR_SLOT(i)] =
+                    program->luts[instr->lut][values[instr->inputs[0]]];
+            } else {
+                values[CGP_PROGRAM_INSTR_SLOT(i)] = cgp_eval_func(instr->function,
+                    values[instr->inputs[0]], values[instr->inputs[1]],
+                    values[instr->inputs[CGP_INPUT_C]]);
+            }
+        }
+        lut[x] = values[CGP_PROGRAM_INSTR_SLOT(root)];
+    }
+}
+
+
+/**
+ * Replaces maximal subgraphs which depend on single primary input
+ * (and constants) with lookup tables. Subgraphs containing `avg` are kept,
+ * because SIMD and scalar evaluators calculate it differently.
+ * @param program
+ * @param min_length Only subgraphs with at least this many instructions
+ *                   are replaced
+ */
+void cgp_program_collapse_luts(cgp_program_t *program, int min_length)
+{
+    // primary inputs each instruction depends on (bitmap), whether
+    // it can be tabulated and size of its subgraph
+    unsigned int depends[CGP_PROGRAM_SLOTS];
+    bool single[CGP_PROGRAM_SLOTS];
+    int size[CGP_PROGRAM_SLOTS];
+
+    for (int i = 0; i < CGP_PROGRAM_SLOTS; i++) {
+        depends[i] = (i < CGP_INPUTS)? (1u << i) : 0;
+        single[i] = false;
+        size[i] = 0;
+    }
+
+    for (int i = 0; i < program->length; i++) {
+        const cgp_instr_t *instr = &program->instrs[i];
+        int slot = CGP_PROGRAM_INSTR_SLOT(i);
+
+        depends[slot] = 0;
+        single[slot] = instr->function != avg;
+        size[slot] = 1;
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            int input = instr->inputs[k];
+            depends[slot] |= depends[input];
+            single[slot] = single[slot] && (input < CGP_INPUTS
+                || input >= CGP_PROGRAM_CONST_SLOT(0) || single[input]);
+
+            // shared instructions are counted more times, it is just estimate
+            if (k == 0 || input != instr->inputs[k - 1]) {
+                size[slot] += size[input];
+            }
+        }
+        single[slot] = single[slot] && __builtin_popcount(depends[slot]) == 1;
+    }
+
+    // subgraph root is used by output or by instruction which cannot
+    // be tabulated
+    bool root[CGP_NODES];
+    memset(root, 0, sizeof(root));
+
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        int slot = program->outputs[i];
+        if (slot >= CGP_INPUTS && slot < CGP_PROGRAM_CONST_SLOT(0)) {
+            root[slot - CGP_INPUTS] = true;
+        }
+    }
+    for (int i = 0; i < program->length; i++) {
+        int slot = CGP_PROGRAM_INSTR_SLOT(i);
+        if (single[slot]) continue;
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            int input = program->instrs[i].inputs[k];
+            if (input >= CGP_INPUTS && input < CGP_PROGRAM_CONST_SLOT(0)) {
+                root[input - CGP_INPUTS] = true;
+            }
+        }
+    }
+
+    bool changed = false;
+    for (int i = 0; i < program->length; i++) {
+        int slot = CGP_PROGRAM_INSTR_SLOT(i);
+        if (!root[i] || !single[slot] || size[slot] < min_length) continue;
+        if (program->luts_count >= CGP_PROGRAM_LUTS) break;
+
+        int lut = program->luts_count++;
+        _cgp_program_fill_lut(program, i, program->luts[lut]);
+
+        cgp_instr_t *instr = &program->instrs[i];
+        int input = __builtin_ctz(depends[slot]);
+        instr->function = CGP_INSTR_LUT;
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            instr->inputs[k] = input;
+        }
+        instr->lut = lut;
+        changed = true;
+    }
+
+    // replaced subgraphs are not used anymore
+    if (changed) {
+        _cgp_program_compact(program);
+    }
+}
+
+
+/**
+ * Calculate output of given program and inputs
+ * @param program
+ * @param inputs
+ * @param outputs
+ */
+void cgp_program_output(const cgp_program_t *program, cgp_value_t *inputs,
+    cgp_value_t *outputs)
+{
+    cgp_value_t values[CGP_PROGRAM_SLOTS];
+
+    memcpy(values, inputs, sizeof(cgp_value_t) * CGP_INPUTS);
+    memcpy(&values[CGP_PROGRAM_CONST_SLOT(0)], program->constants,
+        sizeof(cgp_value_t) * program->constants_count);
+
+    for (int i = 0; i < program->length; i++) {
+        const cgp_instr_t *instr = &program->instrs[i];
+        if (instr->function == CGP_INSTR_LUT) {
+            values[CGP_PROGRAM_INSTR_SLOT(i)] =
+                program->luts[instr->lut][values[instr->inputs[0]]];
+        } else {
+            values[CGP_PROGRAM_INSTR_SLOT(i)] = cgp_eval_func(instr->function,
+                values[instr->inputs[0]], values[instr->inputs[1]],
+                values[instr->inputs[CGP_INPUT_C]]);
+        }
+    }
+
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        outputs[i] = values[program->outputs[i]];
+    }
+}
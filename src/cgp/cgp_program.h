@@ -0,0 +1,123 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+#include "cgp_core.h"
+
+
+/*
+    Evaluation program - simplified active part of CGP genome.
+
+    Genome is never modified. Before evaluation, its active nodes are
+    translated into linear list of instructions: constants are folded,
+    identities and algebraic no-ops (x & x, x | 0, min(x, 255),
+    double inversion...) are removed, commutative operations get
+    canonical order of operands, duplicate instructions are merged and
+    instructions which do not influence outputs are dropped.
+
+    Instruction operands and program outputs are slots:
+    primary inputs, instruction results, and folded constants.
+
+    Optionally, maximal subgraphs depending on single primary input
+    are replaced by 256-entry lookup tables (see `cgp_program_collapse_luts`).
+ */
+
+
+/* maximal number of distinct folded constants (every operand may be one) */
+#define CGP_PROGRAM_CONSTS (CGP_FUNC_INPUTS * CGP_NODES + CGP_OUTPUTS)
+
+/* total number of slots */
+#define CGP_PROGRAM_SLOTS (CGP_INPUTS + CGP_NODES + CGP_PROGRAM_CONSTS)
+
+/* slot holding result of instruction with given index */
+#define CGP_PROGRAM_INSTR_SLOT(index) (CGP_INPUTS + (index))
+
+/* slot holding constant with given index */
+#define CGP_PROGRAM_CONST_SLOT(index) (CGP_INPUTS + CGP_NODES + (index))
+
+/* maximal number of lookup tables in one program */
+#define CGP_PROGRAM_LUTS 8
+
+/* instruction "function" for lookup table, Y = lut[A] */
+#define CGP_INSTR_LUT ((cgp_func_t) CGP_FUNC_COUNT)
+
+/* minimal subgraph size worth of lookup table in scalar evaluation */
+#define CGP_LUT_MIN_LENGTH_SCALAR 2
+
+
+/**
+ * One instruction, result is stored in CGP_PROGRAM_INSTR_SLOT(index).
+ * Single-input functions have both inputs set to the same slot.
+ */
+typedef struct {
+    cgp_func_t function;
+    int inputs[CGP_FUNC_INPUTS];
+
+    // lookup table index, if function is CGP_INSTR_LUT
+    int lut;
+} cgp_instr_t;
+
+
+/**
+ * Evaluation program
+ */
+typedef struct {
+    int length;
+    cgp_instr_t instrs[CGP_NODES];
+
+    int constants_count;
+    cgp_value_t constants[CGP_PROGRAM_CONSTS];
+
+    int luts_count;
+    cgp_value_t luts[CGP_PROGRAM_LUTS][256];
+
+    int outputs[CGP_OUTPUTS];
+} cgp_program_t;
+
+
+/**
+ * Translates active nodes of chromosome into simplified program
+ * @param program
+ * @param chromosome
+ */
+void cgp_program_build(cgp_program_t *program, ga_chr_t chromosome);
+
+
+/**
+ * Replaces maximal subgraphs which depend on single primary input
+ * (and constants) with lookup tables. Subgraphs containing `avg` are kept,
+ * because SIMD and scalar evaluators calculate it differently.
+ * @param program
+ * @param min_length Only subgraphs with at least this many instructions
+ *                   are replaced
+ */
+void cgp_program_collapse_luts(cgp_program_t *program, int min_length);
+
+
+/**
+ * Calculate output of given program and inputs
+ * @param program
+ * @param inputs
+ * @param outputs
+ */
+void cgp_program_output(const cgp_program_t *program, cgp_value_t *inputs,
+    cgp_value_t *outputs);
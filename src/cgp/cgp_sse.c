@@ -26,33 +26,6 @@
 #include "../random.h"
 
 
-#define CURRENT(x) \
-  (x == 0? current0 \
-    : x == 1? current1 \
-    : x == 2? current2 \
-    : current3)
-
-#define ASSIGN_CURRENT(x, val) do { \
-  if (x == 0) current0 = (val); \
-  else if (x == 1) current1 = (val); \
-  else if (x == 2) current2 = (val); \
-  else if (x == 3) current3 = (val); \
-  else assert(false); \
-} while(0);
-
-#define LOAD_INPUT(reg, idx) do { \
-    if ((idx) < CGP_INPUTS) reg = inputs[(idx)]; \
-    else if ((idx) == CGP_INPUTS + offset) reg = prev0; \
-    else if ((idx) == CGP_INPUTS + offset + 1) reg = prev1; \
-    else if ((idx) == CGP_INPUTS + offset + 2) reg = prev2; \
-    else if ((idx) == CGP_INPUTS + offset + 3) reg = prev3; \
-    else { \
-        fprintf(stderr, "Invalid index %d, (range %d-%d)\n", \
-            idx, CGP_INPUTS + offset, CGP_INPUTS + offset + 3); \
-        assert(false); \
-    } \
-} while(0);
-
 #define UCFMT1 "%u"
 #define UCFMT4 UCFMT1 ", " UCFMT1 ", " UCFMT1 ", " UCFMT1
 #define UCFMT16 UCFMT4 ", " UCFMT4 ", " UCFMT4 ", " UCFMT4
@@ -68,40 +41,249 @@
 } while(0);
 
 
+#ifdef SSE2
 /**
- * Calculate output of given chromosome and inputs using SSE instructions
- * @param chr
+ * Looks up 256-entry table. SSE2 has no byte shuffle (PSHUFB is SSSE3),
+ * so lookup is done per byte. Fitness evaluation does not create tables
+ * for SSE2 programs, this is here for completeness only.
+ * @param lut
+ * @param A Indices
+ * @return looked up values
+ */
+static inline __m128i _cgp_sse_lut(const cgp_value_t lut[256], __m128i A)
+{
+    __m128i_aligned Y = A;
+    cgp_value_t *bytes = (cgp_value_t*) &Y;
+    for (int i = 0; i < 16; i++) {
+        bytes[i] = lut[bytes[i]];
+    }
+    return Y;
+}
+
+
+/* functions, see CGP_FUNCTIONS in cgp_func.h *********************************/
+
+
+static inline __m128i _cgp_sse_c255(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return FF;
+}
+
+
+static inline __m128i _cgp_sse_identity(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return A;
+}
+
+
+static inline __m128i _cgp_sse_inversion(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_sub_epi8(FF, A);
+}
+
+
+static inline __m128i _cgp_sse_b_or(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_or_si128(A, B);
+}
+
+
+static inline __m128i _cgp_sse_b_not1or2(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    // we don't have NOT instruction, we need to XOR with FF
+    return _mm_or_si128(_mm_xor_si128(FF, A), B);
+}
+
+
+static inline __m128i _cgp_sse_b_and(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_and_si128(A, B);
+}
+
+
+static inline __m128i _cgp_sse_b_nand(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_xor_si128(FF, _mm_and_si128(A, B));
+}
+
+
+static inline __m128i _cgp_sse_b_xor(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_xor_si128(A, B);
+}
+
+
+static inline __m128i _cgp_sse_rshift1(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    // no SR instruction for 8bit data, we need to shift
+    // 16 bits and apply mask
+    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
+    // SHR: [ 0 1 2 3 4 5 6 7 | 8 A B C D E F G]
+    // MSK: [ 0 1 2 3 4 5 6 7 | 0 A B C D E F G]
+    return _mm_and_si128(_mm_srli_epi16(A, 1), _mm_set1_epi8(0x7F));
+}
+
+
+static inline __m128i _cgp_sse_rshift2(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    // similar to rshift1
+    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
+    // SHR: [ 0 0 1 2 3 4 5 6 | 7 8 A B C D E F]
+    // MSK: [ 0 0 1 2 3 4 5 6 | 0 0 A B C D E F]
+    return _mm_and_si128(_mm_srli_epi16(A, 2), _mm_set1_epi8(0x3F));
+}
+
+
+static inline __m128i _cgp_sse_swap(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    // SWAP(A, B) (((A & 0x0F) << 4) | ((B & 0x0F)))
+    // Shift A left by 4 bits
+    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
+    // SHL: [ 5 6 7 8 A B C D | E F G H 0 0 0 0]
+    // MSK: [ 5 6 7 8 0 0 0 0 | E F G H 0 0 0 0]
+    __m128i high = _mm_and_si128(_mm_slli_epi16(A, 4), _mm_set1_epi8(0xF0));
+
+    // Mask B
+    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
+    // MSK: [ 0 0 0 0 5 6 7 8 | 0 0 0 0 E F G H]
+    __m128i low = _mm_and_si128(B, _mm_set1_epi8(0x0F));
+
+    // Combine
+    return _mm_or_si128(low, high);
+}
+
+
+static inline __m128i _cgp_sse_add(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_add_epi8(A, B);
+}
+
+
+static inline __m128i _cgp_sse_add_sat(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_adds_epu8(A, B);
+}
+
+
+static inline __m128i _cgp_sse_avg(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    // shift right first, then add, to avoid overflow
+    // (result differs from scalar one for two odd inputs)
+    __m128i mask = _mm_set1_epi8(0x7F);
+    __m128i halfA = _mm_and_si128(_mm_srli_epi16(A, 1), mask);
+    __m128i halfB = _mm_and_si128(_mm_srli_epi16(B, 1), mask);
+    return _mm_add_epi8(halfA, halfB);
+}
+
+
+static inline __m128i _cgp_sse_max(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_max_epu8(A, B);
+}
+
+
+static inline __m128i _cgp_sse_min(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_min_epu8(A, B);
+}
+
+
+static inline __m128i _cgp_sse_absdiff(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    // one of saturated differences is zero
+    return _mm_or_si128(_mm_subs_epu8(A, B), _mm_subs_epu8(B, A));
+}
+
+
+static inline __m128i _cgp_sse_avg_round(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_avg_epu8(A, B);
+}
+
+
+static inline __m128i _cgp_sse_sub_sat(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_subs_epu8(A, B);
+}
+
+
+static inline __m128i _cgp_sse_cmp_select(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    // there is no unsigned byte comparison, A >= B iff max(A, B) == A
+    __m128i mask = _mm_cmpeq_epi8(_mm_max_epu8(A, B), A);
+    return _mm_and_si128(mask, A);
+}
+
+
+static inline __m128i _cgp_sse_min3(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_min_epu8(_mm_min_epu8(A, B), C);
+}
+
+
+static inline __m128i _cgp_sse_max3(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    return _mm_max_epu8(_mm_max_epu8(A, B), C);
+}
+
+
+static inline __m128i _cgp_sse_median3(__m128i A, __m128i B, __m128i C,
+    __m128i FF)
+{
+    // compare-exchange network: max(min(A, B), min(max(A, B), C))
+    __m128i low = _mm_min_epu8(A, B);
+    __m128i high = _mm_max_epu8(A, B);
+    return _mm_max_epu8(low, _mm_min_epu8(high, C));
+}
+
+#endif
+
+
+/**
+ * Calculate output of given program and inputs using SSE instructions
+ * @param program
  * @param inputs
  * @param outputs
  */
-void cgp_get_output_sse(ga_chr_t chromosome,
+void cgp_program_output_sse(const cgp_program_t *program,
     __m128i_aligned inputs[CGP_INPUTS], __m128i_aligned outputs[CGP_OUTPUTS])
 {
 #ifdef SSE2
-    assert(CGP_OUTPUTS == 1);
-    assert(CGP_ROWS == 4);
-    assert(CGP_LBACK == 1);
-
-    // previous and currently computed column
-    register __m128i prev0, prev1, prev2, prev3;
-    register __m128i current0, current1, current2, current3;
-
     // 0xFF constant
     static __m128i_aligned FF;
     FF = _mm_set1_epi8(0xFF);
 
-    cgp_genome_t genome = (cgp_genome_t) chromosome->genome;
-
-    /* if primary output is connected to primary input, skip evaluation
+    // primary inputs, instruction results and constants
+    __m128i_aligned values[CGP_PROGRAM_SLOTS];
 
-    This cannot happen - CGP does not generate circuits like that
-
-    if (genome->outputs[0] < CGP_INPUTS) {
-        int i = genome->outputs[0];
-        _mm_store_si128(&outputs[0], inputs[i]);
-        return;
+    for (int i = 0; i < CGP_INPUTS; i++) {
+        values[i] = inputs[i];
+    }
+    for (int i = 0; i < program->constants_count; i++) {
+        values[CGP_PROGRAM_CONST_SLOT(i)] = _mm_set1_epi8(program->constants[i]);
     }
-    */
 
 #ifdef TEST_EVAL_SSE2
     for (int i = 0; i < CGP_INPUTS; i++) {
@@ -110,168 +292,49 @@ void cgp_get_output_sse(ga_chr_t chromosome,
     }
 #endif
 
-    int offset = -CGP_ROWS;
-
-    for (int x = 0; x < CGP_COLS; x++) {
-        for (int y = 0; y < CGP_ROWS; y++) {
-            int idx = cgp_node_index(x, y);
-            cgp_node_t *n = &(genome->nodes[idx]);
-
-            // skip inactive blocks
-            if (!n->is_active) continue;
-
-            register __m128i A;
-            register __m128i B;
-            register __m128i Y;
-            register __m128i TMP;
-            register __m128i mask;
-
-            LOAD_INPUT(A, n->inputs[0]);
-            LOAD_INPUT(B, n->inputs[1]);
-
-            switch (n->function) {
-                case c255:
-                    Y = FF;
-                    break;
-
-                case identity:
-                    Y = A;
-                    break;
-
-                case inversion:
-                    Y = _mm_sub_epi8(FF, A);
-                    break;
-
-                case b_or:
-                    Y = _mm_or_si128(A, B);
-                    break;
-
-                case b_not1or2:
-                    // we don't have NOT instruction, we need to XOR with FF
-                    Y = _mm_xor_si128(FF, A);
-                    Y = _mm_or_si128(Y, B);
-                    break;
-
-                case b_and:
-                    Y = _mm_and_si128(A, B);
-                    break;
-
-                case b_nand:
-                    Y = _mm_and_si128(A, B);
-                    Y = _mm_xor_si128(FF, Y);
-                    break;
-
-                case b_xor:
-                    Y = _mm_xor_si128(A, B);
-                    break;
-
-                case rshift1:
-                    // no SR instruction for 8bit data, we need to shift
-                    // 16 bits and apply mask
-                    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
-                    // SHR: [ 0 1 2 3 4 5 6 7 | 8 A B C D E F G]
-                    // MSK: [ 0 1 2 3 4 5 6 7 | 0 A B C D E F G]
-                    mask = _mm_set1_epi8(0x7F);
-                    Y = _mm_srli_epi16(A, 1);
-                    Y = _mm_and_si128(Y, mask);
-                    break;
-
-                case rshift2:
-                    // similar to rshift1
-                    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
-                    // SHR: [ 0 0 1 2 3 4 5 6 | 7 8 A B C D E F]
-                    // MSK: [ 0 0 1 2 3 4 5 6 | 0 0 A B C D E F]
-                    mask = _mm_set1_epi8(0x3F);
-                    Y = _mm_srli_epi16(A, 2);
-                    Y = _mm_and_si128(Y, mask);
-                    break;
-
-                case swap:
-                    // SWAP(A, B) (((A & 0x0F) << 4) | ((B & 0x0F)))
-                    // Shift A left by 4 bits
-                    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
-                    // SHL: [ 5 6 7 8 A B C D | E F G H 0 0 0 0]
-                    // MSK: [ 5 6 7 8 0 0 0 0 | E F G H 0 0 0 0]
-                    mask = _mm_set1_epi8(0xF0);
-                    TMP = _mm_slli_epi16(A, 4);
-                    TMP = _mm_and_si128(TMP, mask);
-
-                    // Mask B
-                    // IN : [ 1 2 3 4 5 6 7 8 | A B C D E F G H]
-                    // MSK: [ 0 0 0 0 5 6 7 8 | 0 0 0 0 E F G H]
-                    mask = _mm_set1_epi8(0x0F);
-                    Y = _mm_and_si128(B, mask);
-
-                    // Combine
-                    Y = _mm_or_si128(Y, TMP);
-                    break;
-
-                case add:
-                    Y = _mm_add_epi8(A, B);
-                    break;
-
-                case add_sat:
-                    Y = _mm_adds_epu8(A, B);
-                    break;
-
-                case avg:
-                    // shift right first, then add, to avoid overflow
-                    mask = _mm_set1_epi8(0x7F);
-                    TMP = _mm_srli_epi16(A, 1);
-                    TMP = _mm_and_si128(TMP, mask);
-
-                    Y = _mm_srli_epi16(B, 1);
-                    Y = _mm_and_si128(Y, mask);
-
-                    Y = _mm_add_epi8(Y, TMP);
-                    break;
-
-                case max:
-                    Y = _mm_max_epu8(A, B);
-                    break;
-
-                case min:
-                    Y = _mm_min_epu8(A, B);
-                    break;
-            }
+    for (int i = 0; i < program->length; i++) {
+        const cgp_instr_t *instr = &program->instrs[i];
+
+        register __m128i A = values[instr->inputs[0]];
+        register __m128i B = values[instr->inputs[1]];
+        register __m128i C = values[instr->inputs[CGP_INPUT_C]];
+        register __m128i Y = _mm_setzero_si128();
 
+        if (instr->function == CGP_INSTR_LUT) {
+            Y = _cgp_sse_lut(program->luts[instr->lut], A);
+
+        } else switch (instr->function) {
+            #define _CGP_SSE_CASE(name, ...) \
+                case name: Y = _cgp_sse_##name(A, B, C, FF); break;
+            CGP_FUNCTIONS(_CGP_SSE_CASE)
+            #undef _CGP_SSE_CASE
+        }
 
 #ifdef TEST_EVAL_SSE2
-            __m128i _tmpval = Y;
-            unsigned char *_tmp = (unsigned char*) &_tmpval;
-            printf("N: %2d = " UCFMT16 "\n", idx + CGP_INPUTS, UCVAL16(0));
-
-            bool mismatch = false;
-            for (int i = 1; i < 16; i++) {
-                if (_tmp[i] != _tmp[0]) {
-                    fprintf(stderr,
-                        "Value mismatch on index %2d (%u instead of %u)\n",
-                        i, _tmp[i], _tmp[0]);
-                    mismatch = true;
-                }
-            }
-            if (mismatch) {
-                abort();
+        __m128i _tmpval = Y;
+        unsigned char *_tmp = (unsigned char*) &_tmpval;
+        printf("N: %2d = " UCFMT16 "\n", CGP_PROGRAM_INSTR_SLOT(i), UCVAL16(0));
+
+        bool mismatch = false;
+        for (int i = 1; i < 16; i++) {
+            if (_tmp[i] != _tmp[0]) {
+                fprintf(stderr,
+                    "Value mismatch on index %2d (%u instead of %u)\n",
+                    i, _tmp[i], _tmp[0]);
+                mismatch = true;
             }
+        }
+        if (mismatch) {
+            abort();
+        }
 #endif
 
-            if (idx + CGP_INPUTS == genome->outputs[0]) {
-                _mm_store_si128(&outputs[0], Y);
-#ifndef TEST_EVAL_SSE2
-                return;
-#endif
-            }
-
-            ASSIGN_CURRENT(y, Y);
-
-        } // end of column
+        values[CGP_PROGRAM_INSTR_SLOT(i)] = Y;
+    }
 
-        offset += CGP_ROWS;
-        prev0 = current0;
-        prev1 = current1;
-        prev2 = current2;
-        prev3 = current3;
-    } // end of row
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        _mm_store_si128(&outputs[i], values[program->outputs[i]]);
+    }
 
 #ifdef TEST_EVAL_SSE2
     for (int i = 0; i < CGP_OUTPUTS; i++) {
@@ -283,3 +346,18 @@ void cgp_get_output_sse(ga_chr_t chromosome,
 
 #endif
 }
+
+
+/**
+ * Calculate output of given chromosome and inputs using SSE instructions
+ * @param chr
+ * @param inputs
+ * @param outputs
+ */
+void cgp_get_output_sse(ga_chr_t chromosome,
+    __m128i_aligned inputs[CGP_INPUTS], __m128i_aligned outputs[CGP_OUTPUTS])
+{
+    cgp_program_t program;
+    cgp_program_build(&program, chromosome);
+    cgp_program_output_sse(&program, inputs, outputs);
+}
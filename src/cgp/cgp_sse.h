@@ -23,11 +23,22 @@
 #include <immintrin.h>
 
 #include "cgp_core.h"
+#include "cgp_program.h"
 
 
 typedef __m128i __m128i_aligned __attribute__ ((aligned (16)));
 
 
+/**
+ * Calculate output of given program and inputs using SSE instructions
+ * @param program
+ * @param inputs
+ * @param outputs
+ */
+void cgp_program_output_sse(const cgp_program_t *program,
+    __m128i_aligned inputs[CGP_INPUTS], __m128i_aligned outputs[CGP_OUTPUTS]);
+
+
 /**
  * Calculate output of given chromosome and inputs using SSE instructions
  * @param chr
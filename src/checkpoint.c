@@ -0,0 +1,764 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "checkpoint.h"
+#include "algo.h"
+#include "utils.h"
+#include "random.h"
+#include "fitness.h"
+
+
+/*
+    File layout (host byte order and type sizes, version must match):
+
+    header
+    CGP part: PRNG state, CGP evaluations, history, baldwin state,
+              scheduler budgets, CGP population, CGP archive
+    predictors part (coevolution only): predictors metadata, predictors
+              population, predictors archive
+
+    Chromosome is stored as serialized genome, fitness and has_fitness flag.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t algorithm;
+    int32_t cgp_population_size;
+    int32_t cgp_archive_size;
+    int32_t pred_population_size;
+    int32_t reserved;
+    uint64_t cgp_genome_size;
+    uint64_t pred_genome_size;
+} _checkpoint_header_t;
+
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} _checkpoint_buffer_t;
+
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    size_t position;
+} _checkpoint_reader_t;
+
+
+/*
+    How genomes of one kind are stored
+ */
+typedef struct {
+    size_t size;
+    void (*save)(void *genome, void *buffer);
+    void (*load)(void *genome, const void *buffer);
+} _checkpoint_codec_t;
+
+
+typedef enum {
+    ckpt_idle,
+    ckpt_capturing,
+    ckpt_waiting_pred,
+    ckpt_writing,
+} _checkpoint_state_t;
+
+
+struct checkpoint {
+    char path[MAX_FILENAME_LENGTH + 1];
+
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    _checkpoint_state_t state;
+    bool shutdown;
+
+    // set by CGP thread when predictors thread should complete the snapshot
+    atomic_bool pred_requested;
+
+    // snapshot being captured or written
+    _checkpoint_buffer_t buffer;
+};
+
+
+/* buffers ********************************************************************/
+
+
+/**
+ * Reserves space at the end of buffer
+ * @return pointer to reserved space, NULL on allocation failure
+ */
+static void* _checkpoint_reserve(_checkpoint_buffer_t *buf, size_t length)
+{
+    if (buf->failed) return NULL;
+
+    if (buf->size + length > buf->capacity) {
+        size_t capacity = buf->capacity? buf->capacity : 4096;
+        while (capacity < buf->size + length) capacity *= 2;
+
+        unsigned char *data = realloc(buf->data, capacity);
+        if (data == NULL) {
+            buf->failed = true;
+            return NULL;
+        }
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+
+    void *ptr = buf->data + buf->size;
+    buf->size += length;
+    return ptr;
+}
+
+
+static void _checkpoint_put(_checkpoint_buffer_t *buf, const void *src, size_t length)
+{
+    void *dst = _checkpoint_reserve(buf, length);
+    if (dst) memcpy(dst, src, length);
+}
+
+
+/**
+ * Returns pointer to next `length` bytes of checkpoint
+ * @return NULL if there is not enough data
+ */
+static const void* _checkpoint_take(_checkpoint_reader_t *reader, size_t length)
+{
+    if (reader->size - reader->position < length) return NULL;
+    const void *ptr = reader->data + reader->position;
+    reader->position += length;
+    return ptr;
+}
+
+
+static bool _checkpoint_get(_checkpoint_reader_t *reader, void *dst, size_t length)
+{
+    const void *src = _checkpoint_take(reader, length);
+    if (src == NULL) return false;
+    memcpy(dst, src, length);
+    return true;
+}
+
+
+/* genomes ********************************************************************/
+
+
+static void _checkpoint_save_cgp(void *genome, void *buffer)
+{
+    // genome is flat structure
+    memcpy(buffer, genome, sizeof(struct cgp_genome));
+}
+
+
+static void _checkpoint_load_cgp(void *genome, const void *buffer)
+{
+    memcpy(genome, buffer, sizeof(struct cgp_genome));
+}
+
+
+static void _checkpoint_save_pred(void *genome, void *buffer)
+{
+    pred_serialize_genome((pred_genome_t) genome, buffer);
+}
+
+
+static void _checkpoint_load_pred(void *genome, const void *buffer)
+{
+    pred_deserialize_genome((pred_genome_t) genome, buffer);
+}
+
+
+static _checkpoint_codec_t _checkpoint_cgp_codec()
+{
+    return (_checkpoint_codec_t) {
+        .size = sizeof(struct cgp_genome),
+        .save = _checkpoint_save_cgp,
+        .load = _checkpoint_load_cgp,
+    };
+}
+
+
+static _checkpoint_codec_t _checkpoint_pred_codec()
+{
+    return (_checkpoint_codec_t) {
+        .size = pred_serialized_size(),
+        .save = _checkpoint_save_pred,
+        .load = _checkpoint_load_pred,
+    };
+}
+
+
+/* chromosomes, populations and archives **************************************/
+
+
+static void _checkpoint_put_chr(_checkpoint_buffer_t *buf, ga_chr_t chr,
+    _checkpoint_codec_t *codec)
+{
+    void *dst = _checkpoint_reserve(buf, codec->size);
+    if (dst) codec->save(chr->genome, dst);
+    _checkpoint_put(buf, &chr->fitness, sizeof(chr->fitness));
+    _checkpoint_put(buf, &chr->has_fitness, sizeof(chr->has_fitness));
+}
+
+
+static bool _checkpoint_get_chr(_checkpoint_reader_t *reader, ga_chr_t chr,
+    _checkpoint_codec_t *codec)
+{
+    const void *src = _checkpoint_take(reader, codec->size);
+    if (src == NULL) return false;
+    codec->load(chr->genome, src);
+    return _checkpoint_get(reader, &chr->fitness, sizeof(chr->fitness))
+        && _checkpoint_get(reader, &chr->has_fitness, sizeof(chr->has_fitness));
+}
+
+
+static void _checkpoint_put_pop(_checkpoint_buffer_t *buf, ga_pop_t pop,
+    _checkpoint_codec_t *codec)
+{
+    _checkpoint_put(buf, &pop->size, sizeof(pop->size));
+    _checkpoint_put(buf, &pop->generation, sizeof(pop->generation));
+    _checkpoint_put(buf, &pop->best_chr_index, sizeof(pop->best_chr_index));
+    _checkpoint_put(buf, &pop->best_fitness, sizeof(pop->best_fitness));
+
+    for (int i = 0; i < pop->size; i++) {
+        _checkpoint_put_chr(buf, pop->chromosomes[i], codec);
+    }
+}
+
+
+static bool _checkpoint_get_pop(_checkpoint_reader_t *reader, ga_pop_t pop,
+    _checkpoint_codec_t *codec)
+{
+    int size;
+    if (!_checkpoint_get(reader, &size, sizeof(size)) || size != pop->size) {
+        return false;
+    }
+
+    if (!_checkpoint_get(reader, &pop->generation, sizeof(pop->generation))
+        || !_checkpoint_get(reader, &pop->best_chr_index, sizeof(pop->best_chr_index))
+        || !_checkpoint_get(reader, &pop->best_fitness, sizeof(pop->best_fitness)))
+    {
+        return false;
+    }
+
+    if (pop->best_chr_index < 0 || pop->best_chr_index >= pop->size) {
+        return false;
+    }
+
+    for (int i = 0; i < pop->size; i++) {
+        if (!_checkpoint_get_chr(reader, pop->chromosomes[i], codec)) {
+            return false;
+        }
+    }
+
+    pop->best_chromosome = pop->chromosomes[pop->best_chr_index];
+    return true;
+}
+
+
+/**
+ * Stores published content of archive. Must be called by archive writer.
+ */
+static void _checkpoint_put_arc(_checkpoint_buffer_t *buf, archive_t arc,
+    _checkpoint_codec_t *codec)
+{
+    arc_view_t view = arc_current(arc);
+
+    _checkpoint_put(buf, &view->capacity, sizeof(view->capacity));
+    _checkpoint_put(buf, &view->stored, sizeof(view->stored));
+    _checkpoint_put(buf, &view->pointer, sizeof(view->pointer));
+    _checkpoint_put(buf, &view->version, sizeof(view->version));
+
+    for (int i = 0; i < view->stored; i++) {
+        _checkpoint_put_chr(buf, view->chromosomes[i], codec);
+        _checkpoint_put(buf, &view->original_fitness[i], sizeof(view->original_fitness[i]));
+    }
+
+    _checkpoint_put_chr(buf, arc->best_chromosome_ever, codec);
+}
+
+
+/**
+ * Restores archive content directly into published view. Nobody may
+ * read the archive at this time.
+ */
+static bool _checkpoint_get_arc(_checkpoint_reader_t *reader, archive_t arc,
+    _checkpoint_codec_t *codec)
+{
+    arc_view_t view = arc_current(arc);
+    int capacity;
+
+    if (!_checkpoint_get(reader, &capacity, sizeof(capacity))
+        || capacity != view->capacity
+        || !_checkpoint_get(reader, &view->stored, sizeof(view->stored))
+        || !_checkpoint_get(reader, &view->pointer, sizeof(view->pointer))
+        || !_checkpoint_get(reader, &view->version, sizeof(view->version)))
+    {
+        return false;
+    }
+
+    if (view->stored < 0 || view->stored > capacity
+        || view->pointer < 0 || view->pointer >= capacity)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < view->stored; i++) {
+        if (!_checkpoint_get_chr(reader, view->chromosomes[i], codec)
+            || !_checkpoint_get(reader, &view->original_fitness[i], sizeof(view->original_fitness[i])))
+        {
+            return false;
+        }
+    }
+
+    return _checkpoint_get_chr(reader, arc->best_chromosome_ever, codec);
+}
+
+
+/* state parts ****************************************************************/
+
+
+static _checkpoint_header_t _checkpoint_header(algo_data_t *wd)
+{
+    bool coevolution = wd->config->algorithm != simple_cgp;
+    _checkpoint_header_t header = {
+        .version = CHECKPOINT_VERSION,
+        .algorithm = wd->config->algorithm,
+        .cgp_population_size = wd->cgp_population->size,
+        .cgp_archive_size = coevolution? wd->cgp_archive->capacity : 0,
+        .pred_population_size = coevolution? wd->pred_population->size : 0,
+        .cgp_genome_size = sizeof(struct cgp_genome),
+        .pred_genome_size = coevolution? pred_serialized_size() : 0,
+    };
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    return header;
+}
+
+
+/**
+ * Stores header and state owned by CGP thread
+ */
+static void _checkpoint_put_cgp_part(_checkpoint_buffer_t *buf, algo_data_t *wd)
+{
+    _checkpoint_codec_t codec = _checkpoint_cgp_codec();
+    _checkpoint_header_t header = _checkpoint_header(wd);
+    _checkpoint_put(buf, &header, sizeof(header));
+
+    void *rand_state = _checkpoint_reserve(buf, RAND_STATE_SIZE);
+    if (rand_state) rand_save_state(rand_state);
+
+    long cgp_evals = fitness_get_cgp_evals();
+    _checkpoint_put(buf, &cgp_evals, sizeof(cgp_evals));
+
+    _checkpoint_put(buf, &wd->history, sizeof(wd->history));
+
+    int baldwin[2] = {
+        atomic_load(&wd->baldwin_state.new_predictor_length),
+        atomic_load(&wd->baldwin_state.last_applied_generation),
+    };
+    _checkpoint_put(buf, baldwin, sizeof(baldwin));
+
+    int workers[3] = {
+        wd->scheduler.workers,
+        atomic_load(&wd->scheduler.cgp_workers),
+        atomic_load(&wd->scheduler.pred_workers),
+    };
+    _checkpoint_put(buf, workers, sizeof(workers));
+
+    _checkpoint_put_pop(buf, wd->cgp_population, &codec);
+    if (wd->config->algorithm != simple_cgp) {
+        _checkpoint_put_arc(buf, wd->cgp_archive, &codec);
+    }
+}
+
+
+/**
+ * Stores state owned by predictors thread
+ */
+static void _checkpoint_put_pred_part(_checkpoint_buffer_t *buf, algo_data_t *wd)
+{
+    _checkpoint_codec_t codec = _checkpoint_pred_codec();
+
+    _checkpoint_put(buf, pred_get_metadata(), sizeof(pred_metadata_t));
+    _checkpoint_put_pop(buf, wd->pred_population, &codec);
+    _checkpoint_put_arc(buf, wd->pred_archive, &codec);
+}
+
+
+static bool _checkpoint_get_cgp_part(_checkpoint_reader_t *reader, algo_data_t *wd)
+{
+    _checkpoint_codec_t codec = _checkpoint_cgp_codec();
+
+    const void *rand_state = _checkpoint_take(reader, RAND_STATE_SIZE);
+    if (rand_state == NULL) return false;
+    rand_load_state(rand_state);
+
+    long cgp_evals;
+    if (!_checkpoint_get(reader, &cgp_evals, sizeof(cgp_evals))) return false;
+    fitness_set_cgp_evals(cgp_evals);
+
+    if (!_checkpoint_get(reader, &wd->history, sizeof(wd->history))) return false;
+
+    int baldwin[2];
+    if (!_checkpoint_get(reader, baldwin, sizeof(baldwin))) return false;
+    atomic_store(&wd->baldwin_state.new_predictor_length, baldwin[0]);
+    atomic_store(&wd->baldwin_state.last_applied_generation, baldwin[1]);
+
+    // budgets are kept only if total number of workers is the same
+    int workers[3];
+    if (!_checkpoint_get(reader, workers, sizeof(workers))) return false;
+    if (workers[0] == wd->scheduler.workers) {
+        atomic_store(&wd->scheduler.cgp_workers, workers[1]);
+        atomic_store(&wd->scheduler.pred_workers, workers[2]);
+    }
+
+    if (!_checkpoint_get_pop(reader, wd->cgp_population, &codec)) return false;
+    wd->scheduler.last_generation = wd->cgp_population->generation;
+
+    if (wd->config->algorithm != simple_cgp) {
+        return _checkpoint_get_arc(reader, wd->cgp_archive, &codec);
+    }
+    return true;
+}
+
+
+static bool _checkpoint_get_pred_part(_checkpoint_reader_t *reader, algo_data_t *wd)
+{
+    _checkpoint_codec_t codec = _checkpoint_pred_codec();
+    pred_metadata_t *metadata = pred_get_metadata();
+    pred_metadata_t saved;
+
+    if (!_checkpoint_get(reader, &saved, sizeof(saved))) return false;
+    if (saved.genome_type != metadata->genome_type
+        || saved.max_gene_value != metadata->max_gene_value
+        || saved.image_size != metadata->image_size
+        || saved.genotype_length != metadata->genotype_length)
+    {
+        return false;
+    }
+
+    // phenotypes are calculated when genomes are loaded, using this length
+    pred_set_length(saved.genotype_used_length);
+
+    return _checkpoint_get_pop(reader, wd->pred_population, &codec)
+        && _checkpoint_get_arc(reader, wd->pred_archive, &codec);
+}
+
+
+/* writing ********************************************************************/
+
+
+/**
+ * Writes buffer into temporary file and renames it, so there is always
+ * a complete checkpoint on disk
+ * @return 0 on success
+ */
+static int _checkpoint_write(const char *path, _checkpoint_buffer_t *buf)
+{
+    if (buf->failed) {
+        fprintf(stderr, "Failed to allocate checkpoint buffer.\n");
+        return -1;
+    }
+
+    char tmp_path[MAX_FILENAME_LENGTH + 5];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open checkpoint %s: %s\n", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    bool ok = fwrite(buf->data, 1, buf->size, fp) == buf->size;
+    ok = (fflush(fp) == 0) && ok;
+    ok = (fsync(fileno(fp)) == 0) && ok;
+    ok = (fclose(fp) == 0) && ok;
+
+    if (!ok || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to write checkpoint %s: %s\n", path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void* _checkpoint_writer(void *arg)
+{
+    checkpoint_t ckpt = (checkpoint_t) arg;
+
+    pthread_mutex_lock(&ckpt->lock);
+    while (true) {
+        while (ckpt->state != ckpt_writing && !ckpt->shutdown) {
+            pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+        }
+        if (ckpt->state != ckpt_writing) break;
+
+        pthread_mutex_unlock(&ckpt->lock);
+        _checkpoint_write(ckpt->path, &ckpt->buffer);
+        pthread_mutex_lock(&ckpt->lock);
+
+        ckpt->state = ckpt_idle;
+        pthread_cond_broadcast(&ckpt->cond);
+    }
+    pthread_mutex_unlock(&ckpt->lock);
+
+    return NULL;
+}
+
+
+/**
+ * Starts checkpoint writer thread
+ * @param  path Checkpoint file name
+ * @return NULL on error
+ */
+checkpoint_t checkpoint_create(const char *path)
+{
+    checkpoint_t ckpt = (checkpoint_t) malloc(sizeof(struct checkpoint));
+    if (ckpt == NULL) {
+        return NULL;
+    }
+
+    strncpy(ckpt->path, path, MAX_FILENAME_LENGTH);
+    ckpt->path[MAX_FILENAME_LENGTH] = '\0';
+    ckpt->state = ckpt_idle;
+    ckpt->shutdown = false;
+    atomic_init(&ckpt->pred_requested, false);
+    ckpt->buffer = (_checkpoint_buffer_t) { .data = NULL };
+
+    pthread_mutex_init(&ckpt->lock, NULL);
+    pthread_cond_init(&ckpt->cond, NULL);
+
+    if (pthread_create(&ckpt->writer, NULL, _checkpoint_writer, ckpt) != 0) {
+        pthread_cond_destroy(&ckpt->cond);
+        pthread_mutex_destroy(&ckpt->lock);
+        free(ckpt);
+        return NULL;
+    }
+
+    return ckpt;
+}
+
+
+/**
+ * Waits for pending write and stops writer thread
+ * @param ckpt
+ */
+void checkpoint_destroy(checkpoint_t ckpt)
+{
+    pthread_mutex_lock(&ckpt->lock);
+    ckpt->shutdown = true;
+    pthread_cond_broadcast(&ckpt->cond);
+    pthread_mutex_unlock(&ckpt->lock);
+
+    pthread_join(ckpt->writer, NULL);
+
+    pthread_cond_destroy(&ckpt->cond);
+    pthread_mutex_destroy(&ckpt->lock);
+    free(ckpt->buffer.data);
+    free(ckpt);
+}
+
+
+/**
+ * Captures CGP state and asks predictors thread to complete the snapshot.
+ * Does nothing if previous checkpoint is still in progress.
+ *
+ * Must be called by CGP thread (or with CGP population locked).
+ *
+ * @param  ckpt
+ * @param  wd
+ * @return Whether new checkpoint was started
+ */
+bool checkpoint_capture_cgp(checkpoint_t ckpt, algo_data_t *wd)
+{
+    pthread_mutex_lock(&ckpt->lock);
+    if (ckpt->state != ckpt_idle) {
+        pthread_mutex_unlock(&ckpt->lock);
+        return false;
+    }
+    ckpt->state = ckpt_capturing;
+    pthread_mutex_unlock(&ckpt->lock);
+
+    ckpt->buffer.size = 0;
+    ckpt->buffer.failed = false;
+    _checkpoint_put_cgp_part(&ckpt->buffer, wd);
+
+    pthread_mutex_lock(&ckpt->lock);
+    if (wd->config->algorithm != simple_cgp) {
+        ckpt->state = ckpt_waiting_pred;
+        atomic_store(&ckpt->pred_requested, true);
+    } else {
+        ckpt->state = ckpt_writing;
+        pthread_cond_broadcast(&ckpt->cond);
+    }
+    pthread_mutex_unlock(&ckpt->lock);
+
+    return true;
+}
+
+
+/**
+ * Captures predictors state if it was requested by CGP thread and hands
+ * checkpoint over to writer thread
+ *
+ * Must be called by predictors thread.
+ *
+ * @param ckpt
+ * @param wd
+ */
+void checkpoint_capture_pred(checkpoint_t ckpt, algo_data_t *wd)
+{
+    if (!atomic_exchange(&ckpt->pred_requested, false)) {
+        return;
+    }
+
+    _checkpoint_put_pred_part(&ckpt->buffer, wd);
+
+    pthread_mutex_lock(&ckpt->lock);
+    ckpt->state = ckpt_writing;
+    pthread_cond_broadcast(&ckpt->cond);
+    pthread_mutex_unlock(&ckpt->lock);
+}
+
+
+/**
+ * Captures and writes complete state synchronously. Evolution must
+ * not be running.
+ *
+ * @param  ckpt
+ * @param  wd
+ * @return 0 on success
+ */
+int checkpoint_save(checkpoint_t ckpt, algo_data_t *wd)
+{
+    // unfinished snapshot is dropped, but write in progress must end
+    pthread_mutex_lock(&ckpt->lock);
+    while (ckpt->state == ckpt_writing) {
+        pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+    }
+    ckpt->state = ckpt_capturing;
+    atomic_store(&ckpt->pred_requested, false);
+    pthread_mutex_unlock(&ckpt->lock);
+
+    ckpt->buffer.size = 0;
+    ckpt->buffer.failed = false;
+    _checkpoint_put_cgp_part(&ckpt->buffer, wd);
+    if (wd->config->algorithm != simple_cgp) {
+        _checkpoint_put_pred_part(&ckpt->buffer, wd);
+    }
+
+    int retval = _checkpoint_write(ckpt->path, &ckpt->buffer);
+
+    pthread_mutex_lock(&ckpt->lock);
+    ckpt->state = ckpt_idle;
+    pthread_mutex_unlock(&ckpt->lock);
+
+    return retval;
+}
+
+
+/* loading ********************************************************************/
+
+
+/**
+ * Restores complete state from checkpoint file. Populations and archives
+ * must be already created with the same settings as in saved run.
+ *
+ * @param  path
+ * @param  wd
+ * @return 0 on success
+ */
+int checkpoint_load(const char *path, algo_data_t *wd)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open checkpoint %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    unsigned char *data = NULL;
+    size_t size = 0;
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        long length = ftell(fp);
+        if (length > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+            data = malloc(length);
+            if (data && fread(data, 1, length, fp) == (size_t) length) {
+                size = length;
+            }
+        }
+    }
+    fclose(fp);
+
+    if (size == 0) {
+        fprintf(stderr, "Failed to read checkpoint %s.\n", path);
+        free(data);
+        return -1;
+    }
+
+    _checkpoint_reader_t reader = {
+        .data = data,
+        .size = size,
+        .position = 0,
+    };
+
+    _checkpoint_header_t expected = _checkpoint_header(wd);
+    _checkpoint_header_t header;
+    int retval = 0;
+
+    if (!_checkpoint_get(&reader, &header, sizeof(header))
+        || memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0)
+    {
+        fprintf(stderr, "File %s is not a checkpoint.\n", path);
+        retval = -1;
+
+    } else if (header.version != expected.version) {
+        fprintf(stderr, "Checkpoint version %u is not supported (expected %u).\n",
+            header.version, expected.version);
+        retval = -1;
+
+    } else if (memcmp(&header, &expected, sizeof(header)) != 0) {
+        fprintf(stderr, "Checkpoint was created with different algorithm, "
+            "population or archive settings.\n");
+        retval = -1;
+
+    } else if (!_checkpoint_get_cgp_part(&reader, wd)
+        || (wd->config->algorithm != simple_cgp && !_checkpoint_get_pred_part(&reader, wd))
+        || reader.position != reader.size)
+    {
+        fprintf(stderr, "Checkpoint %s is corrupted or does not match current settings.\n", path);
+        retval = -1;
+    }
+
+    free(data);
+    return retval;
+}
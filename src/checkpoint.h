@@ -0,0 +1,110 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+
+#include <stdbool.h>
+
+
+/*
+    Checkpoint is a single binary file with complete evolution state.
+
+    CGP and predictors run in different threads, so each side captures
+    its own state at the end of its generation - CGP thread first, then
+    predictors thread completes the snapshot and it is written to disk
+    by background thread. Predictors part may therefore be a few
+    generations newer, which does not matter for resuming.
+ */
+
+
+#define CHECKPOINT_MAGIC "COCOCKPT"
+#define CHECKPOINT_VERSION 1
+
+
+// algo.h includes this header
+struct algo_data;
+
+
+struct checkpoint;
+typedef struct checkpoint* checkpoint_t;
+
+
+/**
+ * Starts checkpoint writer thread
+ * @param  path Checkpoint file name
+ * @return NULL on error
+ */
+checkpoint_t checkpoint_create(const char *path);
+
+
+/**
+ * Waits for pending write and stops writer thread
+ * @param ckpt
+ */
+void checkpoint_destroy(checkpoint_t ckpt);
+
+
+/**
+ * Captures CGP state and asks predictors thread to complete the snapshot.
+ * Does nothing if previous checkpoint is still in progress.
+ *
+ * Must be called by CGP thread (or with CGP population locked).
+ *
+ * @param  ckpt
+ * @param  wd
+ * @return Whether new checkpoint was started
+ */
+bool checkpoint_capture_cgp(checkpoint_t ckpt, struct algo_data *wd);
+
+
+/**
+ * Captures predictors state if it was requested by CGP thread and hands
+ * checkpoint over to writer thread
+ *
+ * Must be called by predictors thread.
+ *
+ * @param ckpt
+ * @param wd
+ */
+void checkpoint_capture_pred(checkpoint_t ckpt, struct algo_data *wd);
+
+
+/**
+ * Captures and writes complete state synchronously. Evolution must
+ * not be running.
+ *
+ * @param  ckpt
+ * @param  wd
+ * @return 0 on success
+ */
+int checkpoint_save(checkpoint_t ckpt, struct algo_data *wd);
+
+
+/**
+ * Restores complete state from checkpoint file. Populations and archives
+ * must be already created with the same settings as in saved run.
+ *
+ * @param  path
+ * @param  wd
+ * @return 0 on success
+ */
+int checkpoint_load(const char *path, struct algo_data *wd);
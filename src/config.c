@@ -41,6 +41,7 @@
 #define OPT_TARGET_FITNESS 'f'
 
 #define OPT_ALGORITHM 'a'
+#define OPT_ASYNC 1018
 #define OPT_RANDOM_SEED 'r'
 
 #define OPT_ORIGINAL 'i'
@@ -48,15 +49,40 @@
 
 #define OPT_LOG_DIR 'l'
 #define OPT_LOG_INTERVAL 'k'
+#define OPT_LOG_SYNC 1030
+#define OPT_TRACE 1031
+#define OPT_TRACE_COMPRESS 1032
 
 #define OPT_CGP_MUTATE 'm'
 #define OPT_CGP_POPSIZE 'p'
 #define OPT_CGP_ARCSIZE 's'
+#define OPT_FITNESS_CACHE 1033
+#define OPT_CGP_MUTATION 1034
+#define OPT_CGP_FUNCTIONS 1035
 
 #define OPT_PRED_SIZE 'S'
 #define OPT_PRED_MUTATE 'M'
 #define OPT_PRED_POPSIZE 'P'
 #define OPT_PRED_TYPE 'T'
+#define OPT_PRED_PHENOTYPE 1015
+
+#define OPT_WORKERS 1016
+#define OPT_SCHED_INTERVAL 1017
+
+#define OPT_ISLANDS 1019
+#define OPT_ISLAND_ID 1020
+#define OPT_ISLAND_NAME 1021
+#define OPT_MIGRATION_INTERVAL 1022
+
+#define OPT_WORKER 1023
+#define OPT_FARM 1024
+
+#define OPT_CHECKPOINT 1025
+#define OPT_CHECKPOINT_INTERVAL 1026
+#define OPT_RESUME 1027
+
+#define OPT_SWEEP 1028
+#define OPT_SWEEP_JOBS 1029
 
 #define OPT_HELP 'h'
 
@@ -94,6 +120,7 @@ static struct option long_options[] =
 
     /* Algorithm mode */
     {"algorithm", required_argument, 0, OPT_ALGORITHM},
+    {"async", no_argument, 0, OPT_ASYNC},
 
     /* PRNG seed */
     {"random-seed", required_argument, 0, OPT_RANDOM_SEED},
@@ -105,17 +132,47 @@ static struct option long_options[] =
     /* Logging */
     {"log-dir", required_argument, 0, OPT_LOG_DIR},
     {"log-interval", required_argument, 0, OPT_LOG_INTERVAL},
+    {"log-sync", no_argument, 0, OPT_LOG_SYNC},
+    {"trace", required_argument, 0, OPT_TRACE},
+    {"trace-compress", no_argument, 0, OPT_TRACE_COMPRESS},
 
     /* CGP */
     {"cgp-mutate", required_argument, 0, OPT_CGP_MUTATE},
+    {"cgp-mutation", required_argument, 0, OPT_CGP_MUTATION},
+    {"cgp-functions", required_argument, 0, OPT_CGP_FUNCTIONS},
     {"cgp-population-size", required_argument, 0, OPT_CGP_POPSIZE},
     {"cgp-archive-size", required_argument, 0, OPT_CGP_ARCSIZE},
+    {"fitness-cache", required_argument, 0, OPT_FITNESS_CACHE},
 
     /* Predictors */
     {"pred-size", required_argument, 0, OPT_PRED_SIZE},
     {"pred-mutate", required_argument, 0, OPT_PRED_MUTATE},
     {"pred-population-size", required_argument, 0, OPT_PRED_POPSIZE},
     {"pred-type", required_argument, 0, OPT_PRED_TYPE},
+    {"pred-phenotype", required_argument, 0, OPT_PRED_PHENOTYPE},
+
+    /* Scheduling */
+    {"workers", required_argument, 0, OPT_WORKERS},
+    {"sched-interval", required_argument, 0, OPT_SCHED_INTERVAL},
+
+    /* Islands */
+    {"islands", required_argument, 0, OPT_ISLANDS},
+    {"island-id", required_argument, 0, OPT_ISLAND_ID},
+    {"island-name", required_argument, 0, OPT_ISLAND_NAME},
+    {"migration-interval", required_argument, 0, OPT_MIGRATION_INTERVAL},
+
+    /* Evaluation farm */
+    {"worker", required_argument, 0, OPT_WORKER},
+    {"farm", required_argument, 0, OPT_FARM},
+
+    /* Checkpoints */
+    {"checkpoint", required_argument, 0, OPT_CHECKPOINT},
+    {"checkpoint-interval", required_argument, 0, OPT_CHECKPOINT_INTERVAL},
+    {"resume", required_argument, 0, OPT_RESUME},
+
+    /* Sweeps */
+    {"sweep", required_argument, 0, OPT_SWEEP},
+    {"sweep-jobs", required_argument, 0, OPT_SWEEP_JOBS},
 
     /* Baldwin */
     {"bw-algorithm", required_argument, 0, OPT_BW_ALGORITHM},
@@ -243,7 +300,7 @@ config_retval_t config_load_args(int argc, char **argv, config_t *cfg)
                     cfg->algorithm = predictors;
                 } else if (strcmp(optarg, "baldwin") == 0) {
                     cfg->algorithm = baldwin;
-                    if (pred_type_specified && cfg->pred_genome_type != repeated) {
+                    if (pred_type_specified && cfg->pred_genome_type == permuted) {
                         fprintf(stderr, "Cannot combine baldwin and permuted genotype.\n");
                         return cfg_err;
                     }
@@ -257,6 +314,10 @@ config_retval_t config_load_args(int argc, char **argv, config_t *cfg)
                 algorithm_specified = true;
                 break;
 
+            case OPT_ASYNC:
+                cfg->async_evolution = true;
+                break;
+
             case OPT_RANDOM_SEED:
                 PARSE_UNSIGNED_INT(cfg->random_seed);
                 break;
@@ -275,6 +336,19 @@ config_retval_t config_load_args(int argc, char **argv, config_t *cfg)
                 PARSE_INT(cfg->log_interval);
                 break;
 
+            case OPT_LOG_SYNC:
+                cfg->log_sync = true;
+                break;
+
+            case OPT_TRACE:
+                CHECK_FILENAME_LENGTH;
+                strncpy(cfg->trace_file, optarg, MAX_FILENAME_LENGTH);
+                break;
+
+            case OPT_TRACE_COMPRESS:
+                cfg->trace_compress = true;
+                break;
+
             case OPT_LOG_DIR:
                 CHECK_FILENAME_LENGTH;
                 strncpy(cfg->log_dir, optarg, MAX_FILENAME_LENGTH);
@@ -284,6 +358,29 @@ config_retval_t config_load_args(int argc, char **argv, config_t *cfg)
                 PARSE_INT(cfg->cgp_mutate_genes);
                 break;
 
+            case OPT_CGP_MUTATION:
+                if (strcmp(optarg, "point") == 0) {
+                    cfg->cgp_mutation = mutation_point;
+
+                } else if (strcmp(optarg, "active") == 0) {
+                    cfg->cgp_mutation = mutation_active;
+
+                } else if (strcmp(optarg, "single") == 0) {
+                    cfg->cgp_mutation = mutation_single;
+
+                } else {
+                    fprintf(stderr, "Invalid CGP mutation strategy (options: point, active, single)\n");
+                    return cfg_err;
+                }
+                break;
+
+            case OPT_CGP_FUNCTIONS:
+                if (cgp_parse_functions(optarg, &cfg->cgp_functions) != 0) {
+                    fprintf(stderr, "Invalid CGP function list: %s\n", optarg);
+                    return cfg_err;
+                }
+                break;
+
             case OPT_CGP_POPSIZE:
                 PARSE_INT(cfg->cgp_population_size);
                 break;
@@ -292,6 +389,10 @@ config_retval_t config_load_args(int argc, char **argv, config_t *cfg)
                 PARSE_INT(cfg->cgp_archive_size);
                 break;
 
+            case OPT_FITNESS_CACHE:
+                PARSE_INT(cfg->fitness_cache_size);
+                break;
+
             case OPT_PRED_SIZE:
                 PARSE_PERCENT(cfg->pred_size);
                 break;
@@ -343,13 +444,90 @@ config_retval_t config_load_args(int argc, char **argv, config_t *cfg)
                 } else if (strcmp(optarg, "repeated-circular") == 0) {
                     cfg->pred_genome_type = circular;
 
+                } else if (strcmp(optarg, "tiled") == 0) {
+                    cfg->pred_genome_type = tiled;
+
+                } else if (strcmp(optarg, "tiled-circular") == 0) {
+                    cfg->pred_genome_type = tiled_circular;
+
                 } else {
-                    fprintf(stderr, "Invalid predictor type (options: permuted, repeated, repeated-circular)\n");
+                    fprintf(stderr, "Invalid predictor type (options: permuted, repeated, repeated-circular, tiled, tiled-circular)\n");
                     return cfg_err;
                 }
                 pred_type_specified = true;
                 break;
 
+            case OPT_PRED_PHENOTYPE:
+                if (strcmp(optarg, "gathered") == 0) {
+                    cfg->pred_phenotype = gathered;
+
+                } else if (strcmp(optarg, "bitmap") == 0) {
+                    cfg->pred_phenotype = bitmap;
+
+                } else {
+                    fprintf(stderr, "Invalid predictor phenotype (options: gathered, bitmap)\n");
+                    return cfg_err;
+                }
+                break;
+
+            case OPT_WORKERS:
+                PARSE_INT(cfg->workers);
+                break;
+
+            case OPT_SCHED_INTERVAL:
+                PARSE_INT(cfg->sched_interval);
+                break;
+
+            case OPT_ISLANDS:
+                PARSE_INT(cfg->islands);
+                break;
+
+            case OPT_ISLAND_ID:
+                PARSE_INT(cfg->island_id);
+                break;
+
+            case OPT_ISLAND_NAME:
+                CHECK_FILENAME_LENGTH;
+                strncpy(cfg->island_name, optarg, MAX_FILENAME_LENGTH);
+                break;
+
+            case OPT_MIGRATION_INTERVAL:
+                PARSE_INT(cfg->migration_interval);
+                break;
+
+            case OPT_WORKER:
+                CHECK_FILENAME_LENGTH;
+                strncpy(cfg->worker_socket, optarg, MAX_FILENAME_LENGTH);
+                break;
+
+            case OPT_FARM:
+                CHECK_FILENAME_LENGTH;
+                strncpy(cfg->farm_sockets, optarg, MAX_FILENAME_LENGTH);
+                break;
+
+            case OPT_CHECKPOINT:
+                CHECK_FILENAME_LENGTH;
+                strncpy(cfg->checkpoint_file, optarg, MAX_FILENAME_LENGTH);
+                break;
+
+            case OPT_CHECKPOINT_INTERVAL:
+                PARSE_INT(cfg->checkpoint_interval);
+                break;
+
+            case OPT_RESUME:
+                CHECK_FILENAME_LENGTH;
+                strncpy(cfg->resume_file, optarg, MAX_FILENAME_LENGTH);
+                break;
+
+            case OPT_SWEEP:
+                CHECK_FILENAME_LENGTH;
+                strncpy(cfg->sweep_file, optarg, MAX_FILENAME_LENGTH);
+                break;
+
+            case OPT_SWEEP_JOBS:
+                PARSE_INT(cfg->sweep_jobs);
+                break;
+
             case OPT_BW_INTERVAL:
                 PARSE_INT(cfg->bw_interval);
                 break;
@@ -426,6 +604,42 @@ config_retval_t config_load_args(int argc, char **argv, config_t *cfg)
         advanced_checks_status = false;
     }
 
+    if (cfg->islands > 1 && (cfg->island_id < 0 || cfg->island_id >= cfg->islands)) {
+        fprintf(stderr, "Island id must be between 0 and number of islands - 1\n");
+        advanced_checks_status = false;
+    }
+
+    if (cfg->islands > 1 && cfg->migration_interval <= 0) {
+        fprintf(stderr, "Migration interval must be positive\n");
+        advanced_checks_status = false;
+    }
+
+    if (strlen(cfg->worker_socket) && strlen(cfg->farm_sockets)) {
+        fprintf(stderr, "Worker cannot use evaluation farm\n");
+        advanced_checks_status = false;
+    }
+
+    if (cfg->checkpoint_interval < 0) {
+        fprintf(stderr, "Checkpoint interval cannot be negative\n");
+        advanced_checks_status = false;
+    }
+
+    if (cfg->fitness_cache_size < 0) {
+        fprintf(stderr, "Fitness cache size cannot be negative\n");
+        advanced_checks_status = false;
+    }
+
+    if (cfg->sweep_jobs < 0) {
+        fprintf(stderr, "Number of sweep jobs cannot be negative\n");
+        advanced_checks_status = false;
+    }
+
+    if (cfg->cgp_mutation != mutation_point && cfg->cgp_mutate_genes < 1) {
+        fprintf(stderr, "CGP mutation strategy %s requires at least one mutated gene\n",
+            config_cgp_mutation_names[cfg->cgp_mutation]);
+        advanced_checks_status = false;
+    }
+
     if (cfg->pred_min_size > cfg->pred_initial_size) {
         fprintf(stderr, "Predictors' minimal size cannot be larger than their initial size\n");
         advanced_checks_status = false;
@@ -455,21 +669,49 @@ void config_save_file(FILE *file, config_t *cfg)
     fprintf(file, "original: %s\n", cfg->input_image);
     fprintf(file, "noisy: %s\n", cfg->noisy_image);
     fprintf(file, "algorithm: %s\n", config_algorithm_names[cfg->algorithm]);
+    fprintf(file, "async: %s\n", cfg->async_evolution? "yes" : "no");
     fprintf(file, "random-seed: %u\n", cfg->random_seed);
     fprintf(file, "max-generations: %d\n", cfg->max_generations);
     fprintf(file, "target_fitness: " FITNESS_FMT "\n", cfg->target_fitness);
     fprintf(file, "\n");
     fprintf(file, "log-dir: %s\n", cfg->log_dir);
     fprintf(file, "log-interval: %d\n", cfg->log_interval);
+    fprintf(file, "log-sync: %s\n", cfg->log_sync? "yes" : "no");
+    fprintf(file, "trace: %s\n", cfg->trace_file);
+    fprintf(file, "trace-compress: %s\n", cfg->trace_compress? "yes" : "no");
     fprintf(file, "\n");
     fprintf(file, "cgp-mutate: %d\n", cfg->cgp_mutate_genes);
+    fprintf(file, "cgp-mutation: %s\n", config_cgp_mutation_names[cfg->cgp_mutation]);
+    char functions[CGP_FUNC_COUNT * 16];
+    cgp_format_functions(cfg->cgp_functions, functions, sizeof(functions));
+    fprintf(file, "cgp-functions: %s\n", functions);
+    fprintf(file, "# CGP_FUNC_INPUTS: %d\n", CGP_FUNC_INPUTS);
     fprintf(file, "cgp-population-size: %d\n", cfg->cgp_population_size);
     fprintf(file, "cgp-archive-size: %d\n", cfg->cgp_archive_size);
+    fprintf(file, "fitness-cache: %d\n", cfg->fitness_cache_size);
     fprintf(file, "\n");
     fprintf(file, "pred-size: %.5g\n", cfg->pred_size);
     fprintf(file, "pred-mutate: %.5g\n", cfg->pred_mutation_rate);
     fprintf(file, "pred-population-size: %d\n", cfg->pred_population_size);
-    fprintf(file, "pred-type: %s\n", cfg->pred_genome_type == permuted? "permuted" : "repeated");
+    fprintf(file, "pred-type: %s\n", config_pred_type_names[cfg->pred_genome_type]);
+    fprintf(file, "pred-phenotype: %s\n", cfg->pred_phenotype == bitmap? "bitmap" : "gathered");
+    fprintf(file, "\n");
+    fprintf(file, "workers: %d\n", cfg->workers);
+    fprintf(file, "sched-interval: %d\n", cfg->sched_interval);
+    fprintf(file, "\n");
+    fprintf(file, "islands: %d\n", cfg->islands);
+    fprintf(file, "island-id: %d\n", cfg->island_id);
+    fprintf(file, "island-name: %s\n", cfg->island_name);
+    fprintf(file, "migration-interval: %d\n", cfg->migration_interval);
+    fprintf(file, "\n");
+    fprintf(file, "farm: %s\n", cfg->farm_sockets);
+    fprintf(file, "\n");
+    fprintf(file, "checkpoint: %s\n", cfg->checkpoint_file);
+    fprintf(file, "checkpoint-interval: %d\n", cfg->checkpoint_interval);
+    fprintf(file, "resume: %s\n", cfg->resume_file);
+    fprintf(file, "\n");
+    fprintf(file, "sweep: %s\n", cfg->sweep_file);
+    fprintf(file, "sweep-jobs: %d\n", cfg->sweep_jobs);
     fprintf(file, "\n");
     fprintf(file, "bw-algorithm: %s\n", bw_algorithm_names[cfg->bw_config.algorithm]);
     fprintf(file, "bw-by-max-length: %s\n", cfg->bw_config.use_absolute_increments? "yes" : "no");
@@ -498,11 +740,6 @@ void config_save_file(FILE *file, config_t *cfg)
     fprintf(file, "# CGP_INPUTS: %d\n", CGP_INPUTS);
     fprintf(file, "# CGP_OUTPUTS: %d\n", CGP_OUTPUTS);
     fprintf(file, "# CGP_LBACK: %d\n", CGP_LBACK);
-    #ifdef CGP_LIMIT_FUNCS
-        fprintf(file, "# CGP_LIMIT_FUNCS: yes\n");
-    #else
-        fprintf(file, "# CGP_LIMIT_FUNCS: no\n");
-    #endif
     fprintf(file, "#\n");
     fprintf(file, "# System\n");
     #ifdef _OPENMP
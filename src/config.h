@@ -27,6 +27,7 @@
 #include "utils.h"
 #include "baldwin.h"
 #include "predictors.h"
+#include "cgp/cgp.h"
 
 
 typedef enum
@@ -53,19 +54,41 @@ static const char * const config_algorithm_names[] = {
 };
 
 
+// same order as pred_genome_type_t
+static const char * const config_pred_type_names[] = {
+    "permuted",
+    "repeated",
+    "repeated-circular",
+    "tiled",
+    "tiled-circular"
+};
+
+
+// same order as cgp_mutation_t
+static const char * const config_cgp_mutation_names[] = {
+    "point",
+    "active",
+    "single"
+};
+
+
 typedef struct
 {
     int max_generations;
     double target_fitness;
     algorithm_t algorithm;
+    bool async_evolution;
     unsigned int random_seed;
 
     char input_image[MAX_FILENAME_LENGTH + 1];
     char noisy_image[MAX_FILENAME_LENGTH + 1];
 
     int cgp_mutate_genes;
+    cgp_mutation_t cgp_mutation;
+    cgp_func_set_t cgp_functions;
     int cgp_population_size;
     int cgp_archive_size;
+    int fitness_cache_size;
 
     float pred_size;
     float pred_initial_size;
@@ -75,6 +98,7 @@ typedef struct
     float pred_offspring_combine;
     int pred_population_size;
     pred_genome_type_t pred_genome_type;
+    pred_phenotype_t pred_phenotype;
 
     int bw_interval;
     bw_config_t bw_config;
@@ -85,6 +109,27 @@ typedef struct
 
     int log_interval;
     char log_dir[MAX_FILENAME_LENGTH + 1];
+    bool log_sync;
+    char trace_file[MAX_FILENAME_LENGTH + 1];
+    bool trace_compress;
+
+    int workers;
+    int sched_interval;
+
+    int islands;
+    int island_id;
+    int migration_interval;
+    char island_name[MAX_FILENAME_LENGTH + 1];
+
+    char worker_socket[MAX_FILENAME_LENGTH + 1];
+    char farm_sockets[MAX_FILENAME_LENGTH + 1];
+
+    char checkpoint_file[MAX_FILENAME_LENGTH + 1];
+    int checkpoint_interval;
+    char resume_file[MAX_FILENAME_LENGTH + 1];
+
+    char sweep_file[MAX_FILENAME_LENGTH + 1];
+    int sweep_jobs;
 
 } config_t;
 
@@ -131,6 +176,13 @@ static inline void print_help() {
         "          - coev: CGP coevoluting with fitness predictors of fixed size.\n"
         "          - baldwin: CGP coevoluting with fitness predictors of flexible size.\n"
         "\n"
+        "    --async\n"
+        "          Asynchronous steady-state CGP evolution. Workers independently\n"
+        "          mutate current parent, evaluate the child and replace parent\n"
+        "          if the child is better or same, without waiting for each other.\n"
+        "          Every evaluation counts as one generation, which applies to\n"
+        "          --max-generations, --log-interval, --bw-interval and logs.\n"
+        "\n"
         "    --random-seed NUM, -r ALG\n"
         "          PRNG seed value, default is obtained using gettimeofday() call.\n"
         "\n"
@@ -153,15 +205,55 @@ static inline void print_help() {
         "          Logging interval (in generations), default is 0.\n"
         "          If zero, only fitness changes are logged.\n"
         "\n"
+        "    --log-sync\n"
+        "          Write logs directly from evolution threads. By default\n"
+        "          log events are queued and written by separate thread.\n"
+        "\n"
+        "    --trace FILE\n"
+        "          Write binary trace with one record per CGP generation\n"
+        "          (fitness, predictor length, evaluations). Convert it to CSV\n"
+        "          using ./coco_trace. When resuming, records are appended\n"
+        "          after the checkpointed generation, later ones are dropped.\n"
+        "\n"
+        "    --trace-compress\n"
+        "          Store trace records as deltas to previous ones (varints).\n"
+        "\n"
         "    --cgp-mutate NUM, -m NUM\n"
         "          Number of (max) mutated genes in CGP, default is 5.\n"
         "\n"
+        "    --cgp-mutation TYPE\n"
+        "          CGP mutation strategy, default is point:\n"
+        "            point  - random number of genes (up to --cgp-mutate)\n"
+        "                     is changed, phenotype may stay the same\n"
+        "            active - point mutation is repeated until at least\n"
+        "                     one active gene is changed\n"
+        "            single - genes are changed one by one until an active\n"
+        "                     gene is changed\n"
+        "\n"
+        "    --cgp-functions LIST\n"
+        "          Comma separated list of functions used in CGP nodes,\n"
+        "          \"all\" or \"default\". Default set is c255, identity,\n"
+        "          inversion, b_or, b_not1or2, b_and, b_nand, b_xor, rshift1,\n"
+        "          rshift2, swap, add, add_sat, avg, max and min. Additional\n"
+        "          functions are absdiff (|a - b|), avg_round (rounding\n"
+        "          average), sub_sat (saturating a - b) and cmp_select\n"
+        "          (a >= b ? a : 0). Three-input rank functions min3, max3\n"
+        "          and median3 are available only when compiled with\n"
+        "          -DCGP_FUNC_INPUTS=3 (nodes with three inputs), otherwise\n"
+        "          they are rejected.\n"
+        "\n"
         "    --cgp-population-size NUM, -p NUM\n"
         "          CGP population size, default is 8.\n"
         "\n"
         "    --cgp-archive-size NUM, -s NUM\n"
         "          CGP archive size, default is 10.\n"
         "\n"
+        "    --fitness-cache NUM\n"
+        "          Number of entries in CGP fitness cache, default is 65536.\n"
+        "          Fitness of circuits with already seen active phenotype is\n"
+        "          taken from cache instead of being evaluated again.\n"
+        "          If zero, cache is disabled.\n"
+        "\n"
         "    --pred-size NUM, -S NUM\n"
         "          Predictor size (in percent), default is 0.25.\n"
         "\n"
@@ -172,7 +264,8 @@ static inline void print_help() {
         "          Predictors population size, default is 10.\n"
         "\n"
         "    --pred-type TYPE, -T TYPE\n"
-        "          Predictor genome type, one of {permuted|repeated}\n"
+        "          Predictor genome type, one of {permuted|repeated|repeated-circular|\n"
+        "          tiled|tiled-circular}\n"
         "          Default is \"permuted\" for coevolution and \"repeated\" for baldwin.\n"
         "          - permuted: No value can be repeated in genotype, phenotype equals\n"
         "                      genotype. Cannot be used with \"baldwin\".\n"
@@ -182,6 +275,30 @@ static inline void print_help() {
         "          - repeated-circular: Same as repeated, but phenotype construction\n"
         "                      starts from any locus (offset). It is determined as the\n"
         "                      locus with best fitness from 5 tries.\n"
+        "          - tiled: Same as repeated, but every gene selects a run of 32\n"
+        "                      neighbouring pixels (a tile) instead of single pixel.\n"
+        "                      Predictor sizes are rounded to whole tiles.\n"
+        "          - tiled-circular: Same as tiled, with circular phenotype\n"
+        "                      construction as in repeated-circular.\n"
+        "\n"
+        "    --pred-phenotype TYPE\n"
+        "          Predictor phenotype representation for SIMD evaluation,\n"
+        "          one of {gathered|bitmap}, default is \"gathered\".\n"
+        "          - gathered: Selected pixels are copied into predictor's own\n"
+        "                      arrays whenever its phenotype changes.\n"
+        "          - bitmap: Selected pixels are stored as a bitmap over blocks\n"
+        "                      of 32 pixels, circuits are evaluated directly on\n"
+        "                      the image and empty blocks are skipped.\n"
+        "\n"
+        "    --workers NUM\n"
+        "          Total number of worker threads shared by CGP and predictors\n"
+        "          evolution, default is number of CPUs.\n"
+        "\n"
+        "    --sched-interval NUM\n"
+        "          Interval (in CGP generations) of workers rebalancing between\n"
+        "          CGP and predictors evolution, default is 100. Each time one\n"
+        "          worker can be moved, depending on how often predictors improve\n"
+        "          per CGP generation. If zero, initial split is kept.\n"
         "\n"
         "    --baldwin-interval NUM, -b NUM\n"
         "          Minimal interval of evolution parameters update in \"baldwin\" mode\n"
@@ -245,6 +362,78 @@ static inline void print_help() {
         "        velocity < 0                   --->  len += decr_increment\n"
         "        velocity < slow_thr            --->  len += slow_increment\n"
         "        velocity > slow_thr            --->  len += fast_increment\n"
+        "\n"
+        "Islands:\n"
+        "    Several processes started with the same --islands and --island-name\n"
+        "    form a ring. Every --migration-interval CGP generations, each island\n"
+        "    publishes its best circuit and predictor through shared memory and\n"
+        "    takes those of preceding island, if they are better than its own.\n"
+        "\n"
+        "    --islands NUM\n"
+        "          Number of islands in group, default is 1 (no migration).\n"
+        "\n"
+        "    --island-id NUM\n"
+        "          Index of this island, from 0 to islands - 1, default is 0.\n"
+        "\n"
+        "    --island-name NAME\n"
+        "          Island group name, default is \"coco\". Use different names for\n"
+        "          unrelated groups running on the same machine.\n"
+        "\n"
+        "    --migration-interval NUM\n"
+        "          Migration interval in CGP generations, default is 100.\n"
+        "\n"
+        "Evaluation farm:\n"
+        "    CGP circuits can be evaluated by worker processes listening on UNIX\n"
+        "    sockets. Workers must be started with the same images. Number of\n"
+        "    evaluations in progress is limited by --workers, so it is useful\n"
+        "    to set it higher than number of local CPUs.\n"
+        "\n"
+        "    --worker SOCKET\n"
+        "          Run as evaluation worker listening on given socket path,\n"
+        "          instead of running evolution.\n"
+        "\n"
+        "    --farm SOCKET[,SOCKET...]\n"
+        "          Evaluate CGP circuits on workers listening on given sockets.\n"
+        "          Only real fitness evaluations are sent to workers, predicted\n"
+        "          fitness is always computed locally. If all workers fail,\n"
+        "          evaluation falls back to local one.\n"
+        "\n"
+        "Checkpoints:\n"
+        "    Checkpoint holds complete evolution state - both populations and\n"
+        "    archives, history, baldwin state and PRNG state. It is written in\n"
+        "    background every --checkpoint-interval generations, when SIGINT is\n"
+        "    received for the first time and when evolution ends (including\n"
+        "    SIGTERM and SIGXCPU).\n"
+        "\n"
+        "    --checkpoint FILE\n"
+        "          Checkpoint file name, checkpoints are disabled by default.\n"
+        "\n"
+        "    --checkpoint-interval NUM\n"
+        "          Checkpoint interval in CGP generations, default is 10000.\n"
+        "          If zero, checkpoint is written only on signal and at the end.\n"
+        "\n"
+        "    --resume FILE\n"
+        "          Continue evolution from given checkpoint. Options affecting\n"
+        "          populations and archives must be the same as in original run.\n"
+        "\n"
+        "Sweeps:\n"
+        "    Runs many jobs (e.g. different seeds and configurations) on the same\n"
+        "    images. Images are loaded and preprocessed only once, jobs are forked\n"
+        "    from the main process and share that data. CPUs are split evenly\n"
+        "    between simultaneously running jobs.\n"
+        "\n"
+        "    --sweep FILE\n"
+        "          Jobs file, one job per line. Each line contains options which\n"
+        "          are applied on top of the command line ones, empty lines and\n"
+        "          lines starting with # are ignored. Unless job sets its own\n"
+        "          --log-dir, it logs into job-NNN subdirectory of --log-dir\n"
+        "          (or \"sweep\" directory). For example:\n"
+        "              -r 1 -a cgp\n"
+        "              -r 1 -a baldwin --log-dir results/baldwin-1\n"
+        "\n"
+        "    --sweep-jobs NUM\n"
+        "          Number of simultaneously running jobs, default is number\n"
+        "          of CPUs.\n"
     , stdout);  // this comma is ugly, I know
 }
 
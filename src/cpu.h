@@ -31,6 +31,7 @@
 
 
 #define SIMD_PADDING_BYTES 32
+#define SIMD_ALIGNMENT_BYTES 64
 
 
 /**
@@ -0,0 +1,494 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "farm.h"
+#include "fitness.h"
+#include "cgp/cgp.h"
+
+
+#define FARM_STATUS_OK 0
+#define FARM_STATUS_ERROR 1
+
+
+/*
+    Wire format (host byte order, both sides run on the same machine
+    or at least the same architecture): request header followed by
+    `length` bytes of chromosome, response is fixed-size.
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t length;
+} farm_request_header_t;
+
+
+typedef struct {
+    uint32_t id;
+    uint32_t status;
+    fitness_sqdiff_t sqdiffsum;
+} farm_response_t;
+
+
+/*
+    Request in progress. Lives on caller's stack, completed (and removed
+    from pending table) by connection's receiver thread.
+ */
+typedef struct {
+    int connection;
+    bool done;
+    bool failed;
+    bool rejected;
+    fitness_sqdiff_t sqdiffsum;
+} _farm_request_t;
+
+
+typedef struct {
+    char path[sizeof(((struct sockaddr_un*) 0)->sun_path)];
+    int fd;
+    bool alive;
+    int outstanding;
+    pthread_mutex_t send_lock;
+    pthread_t receiver;
+} _farm_connection_t;
+
+
+static _farm_connection_t _connections[FARM_MAX_CONNECTIONS];
+static int _connections_count;
+
+// guards everything except sending, which is guarded per connection
+static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _cond = PTHREAD_COND_INITIALIZER;
+static _farm_request_t *_pending[FARM_MAX_PENDING];
+
+
+/**
+ * Reads exactly `size` bytes
+ * @return false on error or closed connection
+ */
+static bool _farm_read(int fd, void *buffer, size_t size)
+{
+    unsigned char *ptr = buffer;
+    while (size > 0) {
+        ssize_t received = recv(fd, ptr, size, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        ptr += received;
+        size -= received;
+    }
+    return true;
+}
+
+
+/**
+ * Writes exactly `size` bytes
+ * @return false on error
+ */
+static bool _farm_write(int fd, const void *buffer, size_t size)
+{
+    const unsigned char *ptr = buffer;
+    while (size > 0) {
+        ssize_t sent = send(fd, ptr, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        ptr += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+
+/**
+ * Fills socket address
+ * @return false if path is too long
+ */
+static bool _farm_address(struct sockaddr_un *addr, const char *path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        return false;
+    }
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+
+/******************************************************************************/
+
+
+/**
+ * Marks connection as dead and fails all its requests, so that callers
+ * can retry elsewhere. Caller must hold `_lock`.
+ * @param connection
+ */
+static void _farm_connection_failed(int connection)
+{
+    _farm_connection_t *conn = &_connections[connection];
+    if (!conn->alive) return;
+
+    conn->alive = false;
+    shutdown(conn->fd, SHUT_RDWR);
+
+    for (int i = 0; i < FARM_MAX_PENDING; i++) {
+        if (_pending[i] && _pending[i]->connection == connection) {
+            _pending[i]->failed = true;
+            _pending[i] = NULL;
+        }
+    }
+    conn->outstanding = 0;
+    pthread_cond_broadcast(&_cond);
+}
+
+
+/**
+ * Receives responses from single worker and completes requests
+ * @param arg Connection index
+ */
+static void* _farm_receiver(void *arg)
+{
+    int connection = (intptr_t) arg;
+    _farm_connection_t *conn = &_connections[connection];
+    farm_response_t response;
+
+    while (_farm_read(conn->fd, &response, sizeof(response))) {
+        pthread_mutex_lock(&_lock);
+        if (response.id < FARM_MAX_PENDING
+            && _pending[response.id]
+            && _pending[response.id]->connection == connection)
+        {
+            _farm_request_t *request = _pending[response.id];
+            request->sqdiffsum = response.sqdiffsum;
+            request->done = (response.status == FARM_STATUS_OK);
+            request->rejected = !request->done;
+            _pending[response.id] = NULL;
+            conn->outstanding--;
+            pthread_cond_broadcast(&_cond);
+        }
+        pthread_mutex_unlock(&_lock);
+    }
+
+    pthread_mutex_lock(&_lock);
+    if (conn->alive) {
+        fprintf(stderr, "Farm worker %s disconnected.\n", conn->path);
+    }
+    _farm_connection_failed(connection);
+    pthread_mutex_unlock(&_lock);
+    return NULL;
+}
+
+
+/**
+ * Connects to workers
+ * @param  sockets Comma separated list of socket paths
+ * @return 0 on success, -1 if any of workers cannot be reached
+ */
+int farm_connect(const char *sockets)
+{
+    char *list = strdup(sockets);
+    if (!list) return -1;
+
+    int retval = 0;
+    char *saveptr;
+    for (char *path = strtok_r(list, ",", &saveptr); path;
+        path = strtok_r(NULL, ",", &saveptr))
+    {
+        if (_connections_count == FARM_MAX_CONNECTIONS) {
+            fprintf(stderr, "Too many farm workers, maximum is %d.\n", FARM_MAX_CONNECTIONS);
+            retval = -1;
+            break;
+        }
+
+        struct sockaddr_un addr;
+        if (!_farm_address(&addr, path)) {
+            fprintf(stderr, "Farm socket path too long: %s\n", path);
+            retval = -1;
+            break;
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+            fprintf(stderr, "Failed to connect to farm worker %s: %s\n", path, strerror(errno));
+            if (fd >= 0) close(fd);
+            retval = -1;
+            break;
+        }
+
+        int connection = _connections_count;
+        _farm_connection_t *conn = &_connections[connection];
+        strcpy(conn->path, addr.sun_path);
+        conn->fd = fd;
+        conn->alive = true;
+        conn->outstanding = 0;
+        pthread_mutex_init(&conn->send_lock, NULL);
+
+        if (pthread_create(&conn->receiver, NULL, _farm_receiver, (void*) (intptr_t) connection) != 0) {
+            pthread_mutex_destroy(&conn->send_lock);
+            close(fd);
+            retval = -1;
+            break;
+        }
+        _connections_count++;
+    }
+
+    free(list);
+    if (retval != 0) {
+        farm_disconnect();
+    }
+    return retval;
+}
+
+
+/**
+ * Disconnects from all workers
+ */
+void farm_disconnect()
+{
+    for (int i = 0; i < _connections_count; i++) {
+        pthread_mutex_lock(&_lock);
+        _farm_connection_failed(i);
+        pthread_mutex_unlock(&_lock);
+
+        pthread_join(_connections[i].receiver, NULL);
+        close(_connections[i].fd);
+        pthread_mutex_destroy(&_connections[i].send_lock);
+    }
+    _connections_count = 0;
+}
+
+
+/**
+ * Returns alive connection with least requests in progress or -1.
+ * Caller must hold `_lock`.
+ */
+static int _farm_pick_connection()
+{
+    int best = -1;
+    for (int i = 0; i < _connections_count; i++) {
+        if (!_connections[i].alive) continue;
+        if (best < 0 || _connections[i].outstanding < _connections[best].outstanding) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+
+/**
+ * Sends request to worker, tries other workers if it fails
+ * @return true if request was completed by some worker
+ */
+static bool _farm_submit(_farm_request_t *request, const char *payload, size_t length)
+{
+    pthread_mutex_lock(&_lock);
+
+    while (true) {
+        int connection = _farm_pick_connection();
+        if (connection < 0) break;
+
+        int id = -1;
+        for (int i = 0; i < FARM_MAX_PENDING; i++) {
+            if (!_pending[i]) {
+                id = i;
+                break;
+            }
+        }
+        if (id < 0) {
+            pthread_cond_wait(&_cond, &_lock);
+            continue;
+        }
+
+        _farm_connection_t *conn = &_connections[connection];
+        *request = (_farm_request_t) { .connection = connection };
+        _pending[id] = request;
+        conn->outstanding++;
+        pthread_mutex_unlock(&_lock);
+
+        farm_request_header_t header = {
+            .id = id,
+            .length = length,
+        };
+        pthread_mutex_lock(&conn->send_lock);
+        bool sent = _farm_write(conn->fd, &header, sizeof(header))
+            && _farm_write(conn->fd, payload, length);
+        pthread_mutex_unlock(&conn->send_lock);
+
+        pthread_mutex_lock(&_lock);
+        if (!sent) {
+            if (conn->alive) {
+                fprintf(stderr, "Farm worker %s failed: %s\n", conn->path, strerror(errno));
+            }
+            _farm_connection_failed(connection);
+        }
+        while (!request->done && !request->failed && !request->rejected) {
+            pthread_cond_wait(&_cond, &_lock);
+        }
+        if (request->done || request->rejected) break;
+    }
+
+    pthread_mutex_unlock(&_lock);
+    return request->done;
+}
+
+
+/**
+ * Evaluates CGP circuit fitness on one of workers. Blocks until result
+ * is received. If no worker is available, evaluates locally.
+ *
+ * Can be called from multiple threads at once.
+ *
+ * @param  chr
+ * @return fitness value
+ */
+ga_fitness_t farm_eval_cgp(ga_chr_t chr)
+{
+    char *payload = NULL;
+    size_t length = 0;
+    FILE *fp = open_memstream(&payload, &length);
+    if (fp == NULL) {
+        return fitness_eval_cgp(chr);
+    }
+    cgp_dump_chr_compat(chr, fp);
+    fclose(fp);
+
+    _farm_request_t request = { .done = false };
+    bool done = _farm_submit(&request, payload, length);
+    free(payload);
+
+    if (done) {
+        return fitness_cgp_from_sqdiffsum(request.sqdiffsum);
+    } else {
+        return fitness_eval_cgp(chr);
+    }
+}
+
+
+/******************************************************************************/
+
+
+/**
+ * Serves single master until it disconnects
+ * @param fd
+ * @param chr Chromosome buffer
+ */
+static void _farm_serve(int fd, ga_chr_t chr)
+{
+    farm_request_header_t header;
+    char *payload = NULL;
+
+    while (_farm_read(fd, &header, sizeof(header))) {
+        if (header.length > FARM_MAX_PAYLOAD) {
+            fprintf(stderr, "Farm request too large (%u bytes).\n", header.length);
+            break;
+        }
+
+        char *resized = realloc(payload, header.length + 1);
+        if (!resized) break;
+        payload = resized;
+        if (!_farm_read(fd, payload, header.length)) break;
+
+        farm_response_t response = {
+            .id = header.id,
+            .status = FARM_STATUS_ERROR,
+            .sqdiffsum = 0,
+        };
+
+        FILE *fp = fmemopen(payload, header.length, "r");
+        if (fp) {
+            if (cgp_load_chr_compat(chr, fp) == 0) {
+                response.sqdiffsum = fitness_get_cgp_sqdiffsum(chr);
+                response.status = FARM_STATUS_OK;
+            }
+            fclose(fp);
+        }
+
+        if (!_farm_write(fd, &response, sizeof(response))) break;
+    }
+
+    free(payload);
+}
+
+
+/**
+ * Runs evaluation worker - listens on given socket and serves
+ * connected masters one after another. Fitness module must be
+ * initialized.
+ *
+ * @param  socket_path
+ * @return non-zero on error, never returns otherwise
+ */
+int farm_worker_run(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    if (!_farm_address(&addr, socket_path)) {
+        fprintf(stderr, "Worker socket path too long: %s\n", socket_path);
+        return 1;
+    }
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        fprintf(stderr, "Failed to create worker socket: %s\n", strerror(errno));
+        return 1;
+    }
+
+    unlink(socket_path);
+    if (bind(server, (struct sockaddr*) &addr, sizeof(addr)) != 0
+        || listen(server, 1) != 0)
+    {
+        fprintf(stderr, "Failed to listen on %s: %s\n", socket_path, strerror(errno));
+        close(server);
+        return 1;
+    }
+
+    ga_chr_t chr = ga_alloc_chr(cgp_alloc_genome);
+    if (chr == NULL) {
+        close(server);
+        return 1;
+    }
+
+    printf("Worker listening on %s\n", socket_path);
+    fflush(stdout);
+
+    while (true) {
+        int client = accept(server, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Failed to accept connection: %s\n", strerror(errno));
+            break;
+        }
+        _farm_serve(client, chr);
+        close(client);
+    }
+
+    ga_destroy_chr(chr, cgp_free_genome);
+    close(server);
+    unlink(socket_path);
+    return 1;
+}
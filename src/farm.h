@@ -0,0 +1,81 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+
+#include "ga.h"
+
+
+/*
+    Evaluation farm - CGP circuits are sent in CGP-viewer compatible
+    format to worker processes over UNIX stream sockets, workers reply
+    with sum of squared differences. Every connection can have many
+    requests in progress, new requests go to the connection with least
+    of them, so slow workers get less work.
+ */
+
+
+// maximal number of workers master can connect to
+#define FARM_MAX_CONNECTIONS 64
+
+// maximal number of requests in progress (over all connections)
+#define FARM_MAX_PENDING 256
+
+// maximal accepted request payload size
+#define FARM_MAX_PAYLOAD (64 * 1024)
+
+
+/**
+ * Connects to workers
+ * @param  sockets Comma separated list of socket paths
+ * @return 0 on success, -1 if any of workers cannot be reached
+ */
+int farm_connect(const char *sockets);
+
+
+/**
+ * Disconnects from all workers
+ */
+void farm_disconnect();
+
+
+/**
+ * Evaluates CGP circuit fitness on one of workers. Blocks until result
+ * is received. If no worker is available, evaluates locally.
+ *
+ * Can be called from multiple threads at once.
+ *
+ * @param  chr
+ * @return fitness value
+ */
+ga_fitness_t farm_eval_cgp(ga_chr_t chr);
+
+
+/**
+ * Runs evaluation worker - listens on given socket and serves
+ * connected masters one after another. Fitness module must be
+ * initialized.
+ *
+ * @param  socket_path
+ * @return non-zero on error, never returns otherwise
+ */
+int farm_worker_run(const char *socket_path);
@@ -26,6 +26,8 @@
 #include "cpu.h"
 #include "random.h"
 #include "fitness.h"
+#include "cgp/cgp_avx.h"
+#include "timing.h"
 
 static img_image_t _original_image;
 static img_window_array_t _noisy_image_windows;
@@ -33,6 +35,7 @@ static img_pixel_t *_noisy_image_simd[WINDOW_SIZE];
 static archive_t _cgp_archive;
 static archive_t _pred_archive;
 static double _psnr_coeficient;
+static fitness_cache_t _cache;
 
 static long _cgp_evals;
 
@@ -59,29 +62,70 @@ void fitness_test_init(img_image_t original_image,
 
 
 /**
- * Initializes fitness module - prepares test image
- * @param original
- * @param noisy
- * @param cgp_archive
- * @param pred_archive
+ * Prepares training data - splits noisy image into windows
+ * @param  data
+ * @param  original
+ * @param  noisy
+ * @return 0 on success
  */
-void fitness_init(img_image_t original, img_image_t noisy,
-    archive_t cgp_archive, archive_t pred_archive)
+int fitness_prepare_data(fitness_data_t *data, img_image_t original,
+    img_image_t noisy)
 {
     assert(original->width == noisy->width);
     assert(original->height == noisy->height);
     assert(original->comp == noisy->comp);
 
-    _original_image = original;
-    _noisy_image_windows = img_split_windows(noisy);
+    memset(data, 0, sizeof(fitness_data_t));
+    data->original = original;
+
+    data->noisy_windows = img_split_windows(noisy);
+    if (data->noisy_windows == NULL) {
+        return -1;
+    }
+
+    if (can_use_simd()) {
+        if (img_split_windows_simd(noisy, data->noisy_simd) != 0) {
+            fitness_destroy_data(data);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Releases training data
+ * @param data
+ */
+void fitness_destroy_data(fitness_data_t *data)
+{
+    img_windows_destroy(data->noisy_windows);
+
+    for (int i = 0; i < WINDOW_SIZE; i++) {
+        free(data->noisy_simd[i]);
+    }
+}
+
+
+/**
+ * Initializes fitness module
+ * @param data Prepared training data, must live until `fitness_deinit`
+ * @param cgp_archive
+ * @param pred_archive
+ */
+void fitness_init(fitness_data_t *data, archive_t cgp_archive,
+    archive_t pred_archive)
+{
+    _original_image = data->original;
+    _noisy_image_windows = data->noisy_windows;
+    for (int i = 0; i < WINDOW_SIZE; i++) {
+        _noisy_image_simd[i] = data->noisy_simd[i];
+    }
     _cgp_archive = cgp_archive;
     _pred_archive = pred_archive;
     _psnr_coeficient = fitness_psnr_coeficient(_noisy_image_windows->size);
     _cgp_evals = 0;
-
-    if (can_use_simd()) {
-        img_split_windows_simd(noisy, _noisy_image_simd);
-    }
 }
 
 
@@ -90,11 +134,21 @@ void fitness_init(img_image_t original, img_image_t noisy,
  */
 void fitness_deinit()
 {
-    img_windows_destroy(_noisy_image_windows);
+    _original_image = NULL;
+    _noisy_image_windows = NULL;
+    _cgp_archive = NULL;
+    _pred_archive = NULL;
+    _cache = NULL;
+}
 
-    for (int i = 0; i < WINDOW_SIZE; i++) {
-        free(_noisy_image_simd[i]);
-    }
+
+/**
+ * Sets cache of CGP fitness values, NULL disables caching
+ * @param cache
+ */
+void fitness_set_cache(fitness_cache_t cache)
+{
+    _cache = cache;
 }
 
 
@@ -107,6 +161,15 @@ long fitness_get_cgp_evals()
 }
 
 
+/**
+ * Sets number of performed CGP evaluations, e.g. when resuming evolution
+ */
+void fitness_set_cgp_evals(long evals)
+{
+    _cgp_evals = evals;
+}
+
+
 /**
  * Filters image using given filter. Caller is responsible for freeing
  * the filtered image
@@ -119,12 +182,16 @@ img_image_t fitness_filter_image(ga_chr_t chr)
     img_image_t filtered = img_create(_original_image->width, _original_image->height,
         _original_image->comp);
 
+    cgp_program_t program;
+    cgp_program_build(&program, chr);
+    cgp_program_collapse_luts(&program, CGP_LUT_MIN_LENGTH_SCALAR);
+
     for (int i = 0; i < _noisy_image_windows->size; i++) {
         img_window_t *w = &_noisy_image_windows->windows[i];
 
         cgp_value_t *inputs = w->pixels;
         cgp_value_t output_pixel;
-        cgp_get_output(chr, inputs, &output_pixel);
+        cgp_program_output(&program, inputs, &output_pixel);
 
         img_set_pixel(filtered, w->pos_x, w->pos_y, output_pixel);
     }
@@ -136,25 +203,29 @@ img_image_t fitness_filter_image(ga_chr_t chr)
 /**
  * Calculates difference between original and filtered pixel
  *
- * @param  chr
+ * @param  program Evaluation program of CGP circuit
  * @param  w
  * @return
  */
-int _fitness_get_diff(ga_chr_t chr, img_window_t *w)
+int _fitness_get_diff(const cgp_program_t *program, img_window_t *w)
 {
     cgp_value_t *inputs = w->pixels;
     cgp_value_t output_pixel;
-    cgp_get_output(chr, inputs, &output_pixel);
+    cgp_program_output(program, inputs, &output_pixel);
     return output_pixel - img_get_pixel(_original_image, w->pos_x, w->pos_y);
 }
 
 
 double _fitness_get_sqdiffsum_scalar(ga_chr_t chr)
 {
+    cgp_program_t program;
+    cgp_program_build(&program, chr);
+    cgp_program_collapse_luts(&program, CGP_LUT_MIN_LENGTH_SCALAR);
+
     double sum = 0;
     for (int i = 0; i < _noisy_image_windows->size; i++) {
         img_window_t *w = &_noisy_image_windows->windows[i];
-        double diff = _fitness_get_diff(chr, w);
+        double diff = _fitness_get_diff(&program, w);
         sum += diff * diff;
     }
     #pragma omp atomic
@@ -163,69 +234,273 @@ double _fitness_get_sqdiffsum_scalar(ga_chr_t chr)
 }
 
 
-double _fitness_get_sqdiffsum_simd(ga_chr_t chr, img_pixel_t *original, img_pixel_t *noisy[WINDOW_SIZE], int data_length)
+/*
+    Single fitness evaluation split into tiles, shared by tile tasks
+ */
+typedef struct {
+    const cgp_program_t *program;
+    img_pixel_t *original;
+    img_pixel_t **noisy;
+    int data_length;
+
+    fitness_simd_func_t func;
+    int block_size;
+
+    // minimal subgraph size replaced by lookup table, 0 to disable
+    int lut_min_length;
+
+    // used by masked evaluation only
+    fitness_simd_masked_func_t masked_func;
+    pred_genome_t predictor;
+
+    // one partial sum per tile
+    fitness_sqdiff_t *partial_sums;
+} _fitness_tiles_t;
+
+
+/**
+ * Selects SIMD evaluators available on this CPU
+ * @param tiles
+ */
+static void _fitness_select_simd(_fitness_tiles_t *tiles)
 {
-    fitness_simd_func_t func = NULL;
-    int block_size = 0;
-    double sum = 0;
+    tiles->func = NULL;
+    tiles->masked_func = NULL;
+    tiles->lut_min_length = 0;
 
     #ifdef AVX2
         if(can_use_intel_core_4th_gen_features()) {
-            func = _fitness_get_sqdiffsum_avx;
-            block_size = FITNESS_AVX2_STEP;
+            tiles->func = _fitness_get_sqdiffsum_avx;
+            tiles->masked_func = _fitness_get_sqdiffsum_avx_masked;
+            tiles->block_size = FITNESS_AVX2_STEP;
+            tiles->lut_min_length = CGP_AVX_LUT_MIN_LENGTH;
         }
     #endif
 
     #ifdef SSE2
-        if(can_use_sse2()) {
-            func = _fitness_get_sqdiffsum_sse;
-            block_size = FITNESS_SSE2_STEP;
+        if(tiles->func == NULL && can_use_sse2()) {
+            tiles->func = _fitness_get_sqdiffsum_sse;
+            tiles->masked_func = _fitness_get_sqdiffsum_sse_masked;
+            tiles->block_size = FITNESS_SSE2_STEP;
+            // SSE2 has no byte shuffle, tables would be slower
         }
     #endif
 
-    assert(func != NULL);
+    assert(tiles->func != NULL);
+}
 
-    int offset = 0;
-    int unaligned_bytes = data_length % block_size;
-    data_length -= unaligned_bytes;
 
-    for (; offset < data_length; offset += block_size) {
-        sum += func(original, noisy, chr, offset, block_size);
-        #pragma omp atomic
-            _cgp_evals += block_size;
+/**
+ * Sums squared differences of pixels in single tile
+ * @param data _fitness_tiles_t
+ * @param tile Tile index
+ */
+static void _fitness_sqdiffsum_tile(void *data, int tile)
+{
+    _fitness_tiles_t *tiles = (_fitness_tiles_t*) data;
+    int offset = tile * FITNESS_TILE_SIZE;
+    int end = offset + FITNESS_TILE_SIZE;
+    if (end > tiles->data_length) {
+        end = tiles->data_length;
+    }
+
+    fitness_sqdiff_t sum = 0;
+    for (; offset < end; offset += tiles->block_size) {
+        // last block may not fill the whole register
+        int block_size = end - offset;
+        if (block_size > tiles->block_size) {
+            block_size = tiles->block_size;
+        }
+        sum += tiles->func(tiles->original, tiles->noisy, tiles->program,
+            offset, block_size);
+    }
+
+    tiles->partial_sums[tile] = sum;
+}
+
+
+/**
+ * Sums squared differences of all tiles and combines partial sums in tile
+ * order, so the result does not depend on number of threads
+ *
+ * @param  tiles
+ * @param  tile_count
+ * @param  tile_func
+ * @return
+ */
+static fitness_sqdiff_t _fitness_sqdiffsum_tiles(_fitness_tiles_t *tiles,
+    int tile_count, ga_task_func_t tile_func)
+{
+    if (tile_count == 0) {
+        return 0;
+    }
+
+    fitness_sqdiff_t partial_sums[tile_count];
+    tiles->partial_sums = partial_sums;
+
+    ga_parallel_for(tile_count, tile_func, tiles);
+
+    fitness_sqdiff_t sum = 0;
+    for (int i = 0; i < tile_count; i++) {
+        sum += partial_sums[i];
     }
+    return sum;
+}
 
-    // fix image data not fitting into register
-    // offset is set correctly here - it points to first pixel after
-    // aligned data (we subtracted no. unaligned bytes before)
-    if (unaligned_bytes > 0) {
-        sum += func(original, noisy, chr, offset, unaligned_bytes);
-        #pragma omp atomic
-            _cgp_evals += unaligned_bytes;
+
+double _fitness_get_sqdiffsum_simd(ga_chr_t chr, img_pixel_t *original, img_pixel_t *noisy[WINDOW_SIZE], int data_length)
+{
+    cgp_program_t program;
+    cgp_program_build(&program, chr);
+
+    _fitness_tiles_t tiles = {
+        .program = &program,
+        .original = original,
+        .noisy = noisy,
+        .data_length = data_length,
+    };
+    _fitness_select_simd(&tiles);
+    if (tiles.lut_min_length) {
+        cgp_program_collapse_luts(&program, tiles.lut_min_length);
     }
 
+    int tile_count = (data_length + FITNESS_TILE_SIZE - 1) / FITNESS_TILE_SIZE;
+    fitness_sqdiff_t sum = _fitness_sqdiffsum_tiles(&tiles, tile_count,
+        _fitness_sqdiffsum_tile);
+
+    #pragma omp atomic
+        _cgp_evals += data_length;
+
     return sum;
 }
 
 
 /**
- * Evaluates CGP circuit fitness
+ * Sums squared differences of pixels in single tile of predictor's
+ * active blocks
+ * @param data _fitness_tiles_t
+ * @param tile Tile index
+ */
+static void _fitness_sqdiffsum_masked_tile(void *data, int tile)
+{
+    const int tile_blocks = FITNESS_TILE_SIZE / PRED_BLOCK_SIZE;
+
+    _fitness_tiles_t *tiles = (_fitness_tiles_t*) data;
+    pred_genome_t predictor = tiles->predictor;
+    int block_size = tiles->block_size;
+
+    const pred_block_mask_t lanes = (block_size >= PRED_BLOCK_SIZE)?
+        ~(pred_block_mask_t) 0 : ((pred_block_mask_t) 1 << block_size) - 1;
+
+    int first = tile * tile_blocks;
+    int end = first + tile_blocks;
+    if (end > predictor->active_blocks_count) {
+        end = predictor->active_blocks_count;
+    }
+
+    fitness_sqdiff_t sum = 0;
+    for (int b = first; b < end; b++) {
+        unsigned int block = predictor->active_blocks[b];
+        pred_block_mask_t mask = predictor->block_masks[block];
+        int offset = block * PRED_BLOCK_SIZE;
+
+        // one predictor block may span more simd registers, skip empty ones
+        for (int sub = 0; sub < PRED_BLOCK_SIZE; sub += block_size) {
+            pred_block_mask_t sub_mask = (mask >> sub) & lanes;
+            if (sub_mask) {
+                sum += tiles->masked_func(tiles->original, tiles->noisy,
+                    tiles->program, offset + sub, sub_mask);
+            }
+        }
+    }
+
+    tiles->partial_sums[tile] = sum;
+}
+
+
+/**
+ * Calculates squared differences sum of pixels selected by predictor's
+ * block bitmap, directly on the shared image planes
  *
  * @param  chr
- * @return fitness value
+ * @param  predictor
+ * @return
  */
-ga_fitness_t fitness_eval_cgp(ga_chr_t chr)
+double _fitness_get_sqdiffsum_simd_masked(ga_chr_t chr, pred_genome_t predictor)
 {
-    double sum = 0;
+    const int tile_blocks = FITNESS_TILE_SIZE / PRED_BLOCK_SIZE;
+
+    cgp_program_t program;
+    cgp_program_build(&program, chr);
+
+    _fitness_tiles_t tiles = {
+        .program = &program,
+        .original = _original_image->data,
+        .noisy = _noisy_image_simd,
+        .predictor = predictor,
+    };
+    _fitness_select_simd(&tiles);
+    if (tiles.lut_min_length) {
+        cgp_program_collapse_luts(&program, tiles.lut_min_length);
+    }
+
+    int tile_count = (predictor->active_blocks_count + tile_blocks - 1) / tile_blocks;
+    fitness_sqdiff_t sum = _fitness_sqdiffsum_tiles(&tiles, tile_count,
+        _fitness_sqdiffsum_masked_tile);
+
+    #pragma omp atomic
+        _cgp_evals += predictor->used_pixels;
 
+    return sum;
+}
+
+
+/**
+ * Calculates sum of squared differences between original image
+ * and noisy image filtered by CGP circuit
+ *
+ * @param  chr
+ * @return sum of squared differences
+ */
+fitness_sqdiff_t fitness_get_cgp_sqdiffsum(ga_chr_t chr)
+{
     if(can_use_simd()) {
-        sum = _fitness_get_sqdiffsum_simd(chr, _original_image->data,
+        return _fitness_get_sqdiffsum_simd(chr, _original_image->data,
             _noisy_image_simd, _noisy_image_windows->size);
 
     } else {
-        sum = _fitness_get_sqdiffsum_scalar(chr);
+        return _fitness_get_sqdiffsum_scalar(chr);
     }
+}
 
+
+/**
+ * Converts sum of squared differences calculated elsewhere (e.g. by
+ * farm worker) to CGP fitness and counts it as one evaluation
+ *
+ * @param  sum
+ * @return fitness value
+ */
+ga_fitness_t fitness_cgp_from_sqdiffsum(fitness_sqdiff_t sum)
+{
+    #pragma omp atomic
+        _cgp_evals += _noisy_image_windows->size;
+
+    return _psnr_coeficient / sum;
+}
+
+
+/**
+ * Evaluates CGP circuit fitness
+ *
+ * @param  chr
+ * @return fitness value
+ */
+ga_fitness_t fitness_eval_cgp(ga_chr_t chr)
+{
+    TIMING_START(start);
+    double sum = fitness_get_cgp_sqdiffsum(chr);
+    TIMING_STOP(timing_cgp_eval, start);
     return _psnr_coeficient / sum;
 }
 
@@ -238,16 +513,61 @@ ga_fitness_t fitness_eval_cgp(ga_chr_t chr)
  */
 ga_fitness_t fitness_eval_or_predict_cgp(ga_chr_t chr)
 {
-    if (_pred_archive && _pred_archive->stored > 0) {
-        return fitness_predict_cgp(chr, arc_get(_pred_archive, 0));
+    arc_view_t view = NULL;
+    if (_pred_archive) {
+        view = arc_read_view(_pred_archive);
+    }
+    return fitness_eval_or_predict_cgp_in_view(chr, view);
+}
+
+
+/**
+ * Evaluates CGP circuit fitness using given predictors archive view
+ *
+ * @param  chr
+ * @param  view Predictors archive view, NULL to evaluate real fitness
+ * @return fitness value
+ */
+ga_fitness_t fitness_eval_or_predict_cgp_in_view(ga_chr_t chr, arc_view_t view)
+{
+    ga_chr_t predictor = NULL;
+    uint64_t context = FITNESS_CACHE_REAL;
+
+    if (view && view->stored > 0) {
+        // published predictor is never modified, new one gets
+        // new (non-zero) archive version
+        predictor = arc_view_get(view, 0);
+        context = view->version;
+    }
+
+    ga_fitness_t fitness;
+    uint64_t hash = 0;
+    if (_cache) {
+        hash = cgp_phenotype_hash(chr);
+        if (fitness_cache_get(_cache, hash, context, &fitness)) {
+            return fitness;
+        }
+    }
+
+    if (predictor) {
+        fitness = fitness_predict_cgp(chr, predictor);
     } else {
-        return fitness_eval_cgp(chr);
+        fitness = fitness_eval_cgp(chr);
     }
+
+    if (_cache) {
+        fitness_cache_put(_cache, hash, context, fitness);
+    }
+    return fitness;
 }
 
 
 double _fitness_predict_cgp_scalar(ga_chr_t cgp_chr, pred_genome_t predictor)
 {
+    cgp_program_t program;
+    cgp_program_build(&program, cgp_chr);
+    cgp_program_collapse_luts(&program, CGP_LUT_MIN_LENGTH_SCALAR);
+
     double sum = 0;
 
     for (int i = 0; i < predictor->used_pixels; i++) {
@@ -256,7 +576,7 @@ double _fitness_predict_cgp_scalar(ga_chr_t cgp_chr, pred_genome_t predictor)
         assert(index < _noisy_image_windows->size);
         img_window_t *w = &_noisy_image_windows->windows[index];
 
-        int diff = _fitness_get_diff(cgp_chr, w);
+        int diff = _fitness_get_diff(&program, w);
         sum += diff * diff;
     }
 
@@ -279,7 +599,10 @@ ga_fitness_t fitness_predict_cgp_by_genome(ga_chr_t cgp_chr, pred_genome_t predi
     double coef = fitness_psnr_coeficient(predictor->used_pixels);
     double sum = 0;
 
-    if (can_use_simd()) {
+    if (can_use_simd() && predictor->block_masks != NULL) {
+        sum = _fitness_get_sqdiffsum_simd_masked(cgp_chr, predictor);
+
+    } else if (can_use_simd()) {
         sum = _fitness_get_sqdiffsum_simd(cgp_chr, predictor->original_simd,
             predictor->pixels_simd, predictor->used_pixels);
 
@@ -299,8 +622,11 @@ ga_fitness_t fitness_predict_cgp_by_genome(ga_chr_t cgp_chr, pred_genome_t predi
  */
 ga_fitness_t fitness_predict_cgp(ga_chr_t cgp_chr, ga_chr_t pred_chr)
 {
+    TIMING_START(start);
     pred_genome_t predictor = (pred_genome_t) pred_chr->genome;
-    return fitness_predict_cgp_by_genome(cgp_chr, predictor);
+    ga_fitness_t fitness = fitness_predict_cgp_by_genome(cgp_chr, predictor);
+    TIMING_STOP(timing_cgp_eval, start);
+    return fitness;
 }
 
 
@@ -312,13 +638,16 @@ ga_fitness_t fitness_predict_cgp(ga_chr_t cgp_chr, ga_chr_t pred_chr)
  */
 ga_fitness_t fitness_eval_predictor_genome(pred_genome_t predictor)
 {
+    TIMING_START(start);
+    arc_view_t view = arc_read_view(_cgp_archive);
     double sum = 0;
-    for (int i = 0; i < _cgp_archive->stored; i++) {
-        ga_chr_t cgp_chr = arc_get(_cgp_archive, i);
+    for (int i = 0; i < view->stored; i++) {
+        ga_chr_t cgp_chr = arc_view_get(view, i);
         double predicted = fitness_predict_cgp_by_genome(cgp_chr, predictor);
         sum += fabs(cgp_chr->fitness - predicted);
     }
-    return sum / _cgp_archive->stored;
+    TIMING_STOP(timing_pred_eval, start);
+    return sum / view->stored;
 }
 
 
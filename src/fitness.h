@@ -21,15 +21,32 @@
 #pragma once
 
 
+#include <stdint.h>
+
 #include "image.h"
 #include "cgp/cgp.h"
 #include "archive.h"
+#include "fitness_cache.h"
 #include "predictors.h"
 
 
 static const int FITNESS_SSE2_STEP = 16;
 static const int FITNESS_AVX2_STEP = 32;
 
+/*
+    Single fitness evaluation is split into tiles of this many pixels,
+    which are processed in parallel. Must be multiple of all SIMD steps
+    and of PRED_BLOCK_SIZE.
+ */
+#define FITNESS_TILE_SIZE 4096
+
+
+/*
+    Sum of squared differences. Integer, so partial sums of tiles can be
+    combined with the same result regardless of number of threads.
+ */
+typedef uint64_t fitness_sqdiff_t;
+
 static const int PRED_CIRCULAR_TRIES = 3;
 
 
@@ -41,15 +58,43 @@ void fitness_test_init(img_image_t original_image,
     img_pixel_t *noisy_image_simd[WINDOW_SIZE]);
 
 
+/*
+    Preprocessed training data - noisy image split into windows. It is
+    prepared once and can be shared by several runs (see sweep.h).
+ */
+typedef struct {
+    img_image_t original;
+    img_window_array_t noisy_windows;
+    img_pixel_t *noisy_simd[WINDOW_SIZE];
+} fitness_data_t;
+
+
 /**
- * Initializes fitness module - prepares test image
- * @param original
- * @param noisy
+ * Prepares training data - splits noisy image into windows
+ * @param  data
+ * @param  original
+ * @param  noisy
+ * @return 0 on success
+ */
+int fitness_prepare_data(fitness_data_t *data, img_image_t original,
+    img_image_t noisy);
+
+
+/**
+ * Releases training data
+ * @param data
+ */
+void fitness_destroy_data(fitness_data_t *data);
+
+
+/**
+ * Initializes fitness module
+ * @param data Prepared training data, must live until `fitness_deinit`
  * @param cgp_archive
  * @param pred_archive
  */
-void fitness_init(img_image_t original, img_image_t noisy,
-    archive_t cgp_archive, archive_t pred_archive);
+void fitness_init(fitness_data_t *data, archive_t cgp_archive,
+    archive_t pred_archive);
 
 
 /**
@@ -58,12 +103,25 @@ void fitness_init(img_image_t original, img_image_t noisy,
 void fitness_deinit();
 
 
+/**
+ * Sets cache of CGP fitness values, NULL disables caching
+ * @param cache
+ */
+void fitness_set_cache(fitness_cache_t cache);
+
+
 /**
  * Returns number of performed CGP evaluations
  */
 long fitness_get_cgp_evals();
 
 
+/**
+ * Sets number of performed CGP evaluations, e.g. when resuming evolution
+ */
+void fitness_set_cgp_evals(long evals);
+
+
 /**
  * Filters image using given filter. Caller is responsible for freeing
  * the filtered image
@@ -76,6 +134,26 @@ long fitness_get_cgp_evals();
 img_image_t fitness_filter_image(ga_chr_t chr);
 
 
+/**
+ * Calculates sum of squared differences between original image
+ * and noisy image filtered by CGP circuit
+ *
+ * @param  chr
+ * @return sum of squared differences
+ */
+fitness_sqdiff_t fitness_get_cgp_sqdiffsum(ga_chr_t chr);
+
+
+/**
+ * Converts sum of squared differences calculated elsewhere (e.g. by
+ * farm worker) to CGP fitness and counts it as one evaluation
+ *
+ * @param  sum
+ * @return fitness value
+ */
+ga_fitness_t fitness_cgp_from_sqdiffsum(fitness_sqdiff_t sum);
+
+
 /**
  * Evaluates CGP circuit fitness
  *
@@ -89,6 +167,7 @@ ga_fitness_t fitness_eval_cgp(ga_chr_t chr);
  * If predictors archive is empty, returns `fitness_eval_cgp` result.
  * If there is at least one predictor in archive
  * returns `fitness_predict_cgp` result using first predictor in archive.
+ * Results are memoized by phenotype hash, if cache is set.
  *
  * @param  chr
  * @return fitness value
@@ -96,6 +175,18 @@ ga_fitness_t fitness_eval_cgp(ga_chr_t chr);
 ga_fitness_t fitness_eval_or_predict_cgp(ga_chr_t chr);
 
 
+/**
+ * Same as `fitness_eval_or_predict_cgp`, but uses given predictors archive
+ * view instead of the one held by archive reader, so it may be called by
+ * any thread holding a view
+ *
+ * @param  chr
+ * @param  view Predictors archive view, NULL to evaluate real fitness
+ * @return fitness value
+ */
+ga_fitness_t fitness_eval_or_predict_cgp_in_view(ga_chr_t chr, arc_view_t view);
+
+
 /**
  * Predictes CGP circuit fitness
  *
@@ -155,10 +246,10 @@ static inline double fitness_to_psnr(ga_fitness_t f) {
 /**
  * SIMD fitness evaluator prototype
  */
-typedef double (*fitness_simd_func_t)(
+typedef fitness_sqdiff_t (*fitness_simd_func_t)(
     img_pixel_t *original,
     img_pixel_t *noisy[WINDOW_SIZE],
-    ga_chr_t chr,
+    const cgp_program_t *program,
     int offset,
     int block_size);
 
@@ -171,15 +262,15 @@ typedef double (*fitness_simd_func_t)(
  *
  * @param  original_image
  * @param  noisy_image_simd
- * @param  chr
+ * @param  program Evaluation program of CGP circuit
  * @param  offset Where to start in arrays
  * @param  block_size How many pixels to process
  * @return
  */
-double _fitness_get_sqdiffsum_sse(
+fitness_sqdiff_t _fitness_get_sqdiffsum_sse(
     img_pixel_t *original,
     img_pixel_t *noisy[WINDOW_SIZE],
-    ga_chr_t chr,
+    const cgp_program_t *program,
     int offset,
     int block_size);
 
@@ -190,15 +281,72 @@ double _fitness_get_sqdiffsum_sse(
  *
  * One call equals 32 CGP evaluations.
  *
- * @param  chr
- * @param  w
+ * @param  original_image
+ * @param  noisy_image_simd
+ * @param  program Evaluation program of CGP circuit
+ * @param  offset Where to start in arrays
+ * @param  block_size How many pixels to process
  * @return
  */
-double _fitness_get_sqdiffsum_avx(
-    img_image_t _original_image,
-    img_pixel_t *_noisy_image_simd[WINDOW_SIZE],
-    ga_chr_t chr,
-    int offset);
+fitness_sqdiff_t _fitness_get_sqdiffsum_avx(
+    img_pixel_t *original,
+    img_pixel_t *noisy[WINDOW_SIZE],
+    const cgp_program_t *program,
+    int offset,
+    int block_size);
+
+
+/**
+ * SIMD fitness evaluator prototype, only lanes selected by mask are summed
+ */
+typedef fitness_sqdiff_t (*fitness_simd_masked_func_t)(
+    img_pixel_t *original,
+    img_pixel_t *noisy[WINDOW_SIZE],
+    const cgp_program_t *program,
+    int offset,
+    pred_block_mask_t mask);
+
+
+/**
+ * Calculates difference between original and filtered pixel using SSE2
+ * instructions, only pixels selected by mask are used.
+ *
+ * One call equals 16 CGP evaluations.
+ *
+ * @param  original_image
+ * @param  noisy_image_simd
+ * @param  program Evaluation program of CGP circuit
+ * @param  offset Where to start in arrays
+ * @param  mask Lane mask, bit i selects pixel offset + i
+ * @return
+ */
+fitness_sqdiff_t _fitness_get_sqdiffsum_sse_masked(
+    img_pixel_t *original,
+    img_pixel_t *noisy[WINDOW_SIZE],
+    const cgp_program_t *program,
+    int offset,
+    pred_block_mask_t mask);
+
+
+/**
+ * Calculates difference between original and filtered pixel using AVX2
+ * instructions, only pixels selected by mask are used.
+ *
+ * One call equals 32 CGP evaluations.
+ *
+ * @param  original_image
+ * @param  noisy_image_simd
+ * @param  program Evaluation program of CGP circuit
+ * @param  offset Where to start in arrays
+ * @param  mask Lane mask, bit i selects pixel offset + i
+ * @return
+ */
+fitness_sqdiff_t _fitness_get_sqdiffsum_avx_masked(
+    img_pixel_t *original,
+    img_pixel_t *noisy[WINDOW_SIZE],
+    const cgp_program_t *program,
+    int offset,
+    pred_block_mask_t mask);
 
 
 /**
@@ -28,30 +28,75 @@
  *
  * One call equals 32 CGP evaluations.
  *
- * @param  chr
- * @param  w
+ * @param  original_image
+ * @param  noisy_image_simd
+ * @param  program Evaluation program of CGP circuit
+ * @param  offset Where to start in arrays
+ * @param  block_size How many pixels to process
  * @return
  */
-double _fitness_get_sqdiffsum_avx(
-    img_image_t _original_image,
-    img_pixel_t *_noisy_image_simd[WINDOW_SIZE],
-    ga_chr_t chr,
-    int offset)
+fitness_sqdiff_t _fitness_get_sqdiffsum_avx(
+    img_pixel_t *original,
+    img_pixel_t *noisy[WINDOW_SIZE],
+    const cgp_program_t *program,
+    int offset,
+    int block_size)
 {
     __m256i_aligned avx_inputs[CGP_INPUTS];
     __m256i_aligned avx_outputs[CGP_OUTPUTS];
     unsigned char *outputs_ptr = (unsigned char*) &avx_outputs;
 
     for (int i = 0; i < CGP_INPUTS; i++) {
-        avx_inputs[i] = _mm256_load_si256((__m256i*)(&_noisy_image_simd[i][offset]));
+        avx_inputs[i] = _mm256_load_si256((__m256i*)(&noisy[i][offset]));
     }
 
-    cgp_get_output_avx(chr, avx_inputs, avx_outputs);
+    cgp_program_output_avx(program, avx_inputs, avx_outputs);
 
-    // store
-    double sum = 0;
-    for (int i = 0; i < 32; i++) {
-        int diff = outputs_ptr[i] - _original_image->data[offset + i];
+    fitness_sqdiff_t sum = 0;
+    for (int i = 0; i < block_size; i++) {
+        int diff = outputs_ptr[i] - original[offset + i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+
+/**
+ * Calculates difference between original and filtered pixel using AVX2
+ * instructions, only pixels selected by mask are used.
+ *
+ * One call equals 32 CGP evaluations.
+ *
+ * @param  original_image
+ * @param  noisy_image_simd
+ * @param  program Evaluation program of CGP circuit
+ * @param  offset Where to start in arrays
+ * @param  mask Lane mask, bit i selects pixel offset + i
+ * @return
+ */
+fitness_sqdiff_t _fitness_get_sqdiffsum_avx_masked(
+    img_pixel_t *original,
+    img_pixel_t *noisy[WINDOW_SIZE],
+    const cgp_program_t *program,
+    int offset,
+    pred_block_mask_t mask)
+{
+    __m256i_aligned avx_inputs[CGP_INPUTS];
+    __m256i_aligned avx_outputs[CGP_OUTPUTS];
+    unsigned char *outputs_ptr = (unsigned char*) &avx_outputs;
+
+    for (int i = 0; i < CGP_INPUTS; i++) {
+        avx_inputs[i] = _mm256_load_si256((__m256i*)(&noisy[i][offset]));
+    }
+
+    cgp_program_output_avx(program, avx_inputs, avx_outputs);
+
+    // visit set bits only
+    fitness_sqdiff_t sum = 0;
+    while (mask) {
+        int i = __builtin_ctz(mask);
+        mask &= mask - 1;
+        int diff = outputs_ptr[i] - original[offset + i];
         sum += diff * diff;
     }
     return sum;
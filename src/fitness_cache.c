@@ -0,0 +1,156 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include <stdlib.h>
+
+#include "fitness_cache.h"
+
+
+/**
+ * Create new cache
+ * @param  size Number of entries, rounded up to power of two
+ * @return pointer to cache or NULL on error
+ */
+fitness_cache_t fitness_cache_create(unsigned int size)
+{
+    fitness_cache_t cache = (fitness_cache_t) malloc(sizeof(struct fitness_cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    unsigned int rounded = 1;
+    while (rounded < size) {
+        rounded <<= 1;
+    }
+
+    cache->entries = (fitness_cache_entry_t*) malloc(sizeof(fitness_cache_entry_t) * rounded);
+    if (cache->entries == NULL) {
+        free(cache);
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < rounded; i++) {
+        atomic_init(&cache->entries[i].sequence, 0);
+        atomic_init(&cache->entries[i].hash, 0);
+        atomic_init(&cache->entries[i].context, 0);
+        atomic_init(&cache->entries[i].fitness, 0);
+    }
+
+    cache->size = rounded;
+    atomic_init(&cache->lookups, 0);
+    atomic_init(&cache->hits, 0);
+    return cache;
+}
+
+
+/**
+ * Release cache from memory
+ * @param cache
+ */
+void fitness_cache_destroy(fitness_cache_t cache)
+{
+    if (!cache) return;
+    free(cache->entries);
+    free(cache);
+}
+
+
+/**
+ * Returns slot for given key
+ */
+static inline fitness_cache_entry_t *_fitness_cache_slot(fitness_cache_t cache,
+    uint64_t hash, uint64_t context)
+{
+    uint64_t key = hash ^ (context * 0x9E3779B97F4A7C15ULL);
+    return &cache->entries[(key ^ (key >> 32)) & (cache->size - 1)];
+}
+
+
+/**
+ * Looks up fitness of given phenotype
+ * @param  cache
+ * @param  hash Phenotype hash
+ * @param  context Fitness context, e.g. FITNESS_CACHE_REAL or predictor id
+ * @param  fitness Found value is stored here
+ * @return whether value was found
+ */
+bool fitness_cache_get(fitness_cache_t cache, uint64_t hash, uint64_t context,
+    ga_fitness_t *fitness)
+{
+    fitness_cache_entry_t *entry = _fitness_cache_slot(cache, hash, context);
+    atomic_fetch_add_explicit(&cache->lookups, 1, memory_order_relaxed);
+
+    uint_fast64_t sequence = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+    if (sequence == 0 || (sequence & 1)) {
+        return false;
+    }
+
+    uint64_t stored_hash = atomic_load_explicit(&entry->hash, memory_order_relaxed);
+    uint64_t stored_context = atomic_load_explicit(&entry->context, memory_order_relaxed);
+    ga_fitness_t stored_fitness = atomic_load_explicit(&entry->fitness, memory_order_relaxed);
+
+    // entry must not be rewritten while we were reading it
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&entry->sequence, memory_order_relaxed) != sequence) {
+        return false;
+    }
+
+    if (stored_hash != hash || stored_context != context) {
+        return false;
+    }
+
+    atomic_fetch_add_explicit(&cache->hits, 1, memory_order_relaxed);
+    *fitness = stored_fitness;
+    return true;
+}
+
+
+/**
+ * Stores fitness of given phenotype
+ * @param  cache
+ * @param  hash Phenotype hash
+ * @param  context Fitness context, e.g. FITNESS_CACHE_REAL or predictor id
+ * @param  fitness
+ */
+void fitness_cache_put(fitness_cache_t cache, uint64_t hash, uint64_t context,
+    ga_fitness_t fitness)
+{
+    fitness_cache_entry_t *entry = _fitness_cache_slot(cache, hash, context);
+
+    uint_fast64_t sequence = atomic_load_explicit(&entry->sequence, memory_order_relaxed);
+    if (sequence & 1) {
+        // someone else is writing, his value is as good as ours
+        return;
+    }
+    if (!atomic_compare_exchange_strong_explicit(&entry->sequence, &sequence,
+            sequence + 1, memory_order_acquire, memory_order_relaxed)) {
+        return;
+    }
+
+    // readers must see odd sequence before any of new values
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&entry->hash, hash, memory_order_relaxed);
+    atomic_store_explicit(&entry->context, context, memory_order_relaxed);
+    atomic_store_explicit(&entry->fitness, fitness, memory_order_relaxed);
+
+    atomic_store_explicit(&entry->sequence, sequence + 2, memory_order_release);
+}
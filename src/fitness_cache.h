@@ -0,0 +1,122 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "ga.h"
+
+
+/*
+    Fitness memoization. Many offspring share identical active phenotype
+    (mutations often hit inactive nodes only), so their fitness is looked
+    up by phenotype hash instead of being evaluated again.
+
+    Cache is a fixed-size direct-mapped table. Colliding entries simply
+    replace each other. Each slot is guarded by sequence number, so
+    readers never block and never see half-written entries; concurrent
+    writers of the same slot give up instead of waiting.
+ */
+
+
+/* context of real fitness (evaluated on whole training image) */
+#define FITNESS_CACHE_REAL 0
+
+
+/**
+ * One cached value
+ */
+typedef struct {
+    // odd while being written, zero if never written
+    atomic_uint_fast64_t sequence;
+
+    _Atomic uint64_t hash;
+    _Atomic uint64_t context;
+    _Atomic ga_fitness_t fitness;
+} fitness_cache_entry_t;
+
+
+struct fitness_cache {
+    // number of entries, power of two
+    unsigned int size;
+    fitness_cache_entry_t *entries;
+
+    // statistics
+    atomic_long lookups;
+    atomic_long hits;
+};
+typedef struct fitness_cache* fitness_cache_t;
+
+
+/**
+ * Create new cache
+ * @param  size Number of entries, rounded up to power of two
+ * @return pointer to cache or NULL on error
+ */
+fitness_cache_t fitness_cache_create(unsigned int size);
+
+
+/**
+ * Release cache from memory
+ * @param cache
+ */
+void fitness_cache_destroy(fitness_cache_t cache);
+
+
+/**
+ * Looks up fitness of given phenotype
+ * @param  cache
+ * @param  hash Phenotype hash
+ * @param  context Fitness context, e.g. FITNESS_CACHE_REAL or predictor id
+ * @param  fitness Found value is stored here
+ * @return whether value was found
+ */
+bool fitness_cache_get(fitness_cache_t cache, uint64_t hash, uint64_t context,
+    ga_fitness_t *fitness);
+
+
+/**
+ * Stores fitness of given phenotype
+ * @param  cache
+ * @param  hash Phenotype hash
+ * @param  context Fitness context, e.g. FITNESS_CACHE_REAL or predictor id
+ * @param  fitness
+ */
+void fitness_cache_put(fitness_cache_t cache, uint64_t hash, uint64_t context,
+    ga_fitness_t fitness);
+
+
+/**
+ * Returns ratio of successful lookups
+ * @param  cache
+ * @return hit rate from 0 to 1
+ */
+static inline double fitness_cache_hit_rate(fitness_cache_t cache)
+{
+    long lookups = atomic_load(&cache->lookups);
+    if (lookups == 0) {
+        return 0;
+    }
+    return atomic_load(&cache->hits) / (double) lookups;
+}
@@ -30,15 +30,15 @@
  *
  * @param  original_image
  * @param  noisy_image_simd
- * @param  chr
+ * @param  program Evaluation program of CGP circuit
  * @param  offset Where to start in arrays
  * @param  block_size How many pixels to process
  * @return
  */
-double _fitness_get_sqdiffsum_sse(
+fitness_sqdiff_t _fitness_get_sqdiffsum_sse(
     img_pixel_t *original,
     img_pixel_t *noisy[WINDOW_SIZE],
-    ga_chr_t chr,
+    const cgp_program_t *program,
     int offset,
     int block_size)
 {
@@ -50,9 +50,9 @@ double _fitness_get_sqdiffsum_sse(
         sse_inputs[i] = _mm_load_si128((__m128i*)(&noisy[i][offset]));
     }
 
-    cgp_get_output_sse(chr, sse_inputs, sse_outputs);
+    cgp_program_output_sse(program, sse_inputs, sse_outputs);
 
-    double sum = 0;
+    fitness_sqdiff_t sum = 0;
     for (int i = 0; i < block_size; i++) {
         int diff = outputs_ptr[i] - original[offset + i];
         sum += diff * diff;
@@ -60,3 +60,44 @@ double _fitness_get_sqdiffsum_sse(
     return sum;
 }
 
+
+/**
+ * Calculates difference between original and filtered pixel using SSE2
+ * instructions, only pixels selected by mask are used.
+ *
+ * One call equals 16 CGP evaluations.
+ *
+ * @param  original_image
+ * @param  noisy_image_simd
+ * @param  program Evaluation program of CGP circuit
+ * @param  offset Where to start in arrays
+ * @param  mask Lane mask, bit i selects pixel offset + i
+ * @return
+ */
+fitness_sqdiff_t _fitness_get_sqdiffsum_sse_masked(
+    img_pixel_t *original,
+    img_pixel_t *noisy[WINDOW_SIZE],
+    const cgp_program_t *program,
+    int offset,
+    pred_block_mask_t mask)
+{
+    __m128i_aligned sse_inputs[CGP_INPUTS];
+    __m128i_aligned sse_outputs[CGP_OUTPUTS];
+    unsigned char *outputs_ptr = (unsigned char*) &sse_outputs;
+
+    for (int i = 0; i < CGP_INPUTS; i++) {
+        sse_inputs[i] = _mm_load_si128((__m128i*)(&noisy[i][offset]));
+    }
+
+    cgp_program_output_sse(program, sse_inputs, sse_outputs);
+
+    // visit set bits only
+    fitness_sqdiff_t sum = 0;
+    while (mask) {
+        int i = __builtin_ctz(mask);
+        mask &= mask - 1;
+        int diff = outputs_ptr[i] - original[offset + i];
+        sum += diff * diff;
+    }
+    return sum;
+}
@@ -23,7 +23,9 @@
 #include <assert.h>
 
 #ifdef GA_USE_PTHREAD
-    #include <pthread.h>
+    #include "pool.h"
+#elif defined(_OPENMP)
+    #include <omp.h>
 #endif
 
 #include "ga.h"
@@ -33,8 +35,55 @@
 /* population *****************************************************************/
 
 
-ga_chr_t *_ga_allocate_chromosomes(int size, ga_alloc_genome_func_t alloc_func,
-    ga_free_genome_func_t free_func)
+/* alignment of arena parts, so that genomes start on cache line */
+#define GA_ARENA_ALIGNMENT 64
+
+
+static inline size_t _ga_arena_align(size_t size)
+{
+    return (size + GA_ARENA_ALIGNMENT - 1) & ~((size_t) GA_ARENA_ALIGNMENT - 1);
+}
+
+
+/**
+ * Allocates chromosomes and children of population in single arena:
+ * pointer arrays, chromosome headers and then genomes back to back
+ * @param  pop
+ * @return 0 on success, -1 on failure
+ */
+static int _ga_allocate_arena(ga_pop_t pop)
+{
+    int count = 2 * pop->size;
+    size_t pointers_size = _ga_arena_align(sizeof(ga_chr_t) * count);
+    size_t headers_size = _ga_arena_align(sizeof(struct ga_chr) * count);
+    size_t genome_stride = _ga_arena_align(pop->methods.genome_size);
+
+    void *arena;
+    if (posix_memalign(&arena, GA_ARENA_ALIGNMENT,
+            pointers_size + headers_size + genome_stride * count) != 0) {
+        return -1;
+    }
+
+    unsigned char *ptr = (unsigned char*) arena;
+    ga_chr_t *pointers = (ga_chr_t*) ptr;
+    struct ga_chr *headers = (struct ga_chr*) (ptr + pointers_size);
+    unsigned char *genomes = ptr + pointers_size + headers_size;
+
+    for (int i = 0; i < count; i++) {
+        headers[i].has_fitness = false;
+        headers[i].fitness = 0;
+        headers[i].genome = genomes + genome_stride * i;
+        pointers[i] = &headers[i];
+    }
+
+    pop->arena = arena;
+    pop->chromosomes = pointers;
+    pop->children = pointers + pop->size;
+    return 0;
+}
+
+
+ga_chr_t *_ga_allocate_chromosomes(int size, ga_func_vect_t *methods)
 {
     ga_chr_t *new_array = (ga_chr_t*) malloc(sizeof(ga_chr_t) * size);
     if (new_array == NULL) {
@@ -43,11 +92,17 @@ ga_chr_t *_ga_allocate_chromosomes(int size, ga_alloc_genome_func_t alloc_func,
 
     /* initialize chromosomes */
     for (int i = 0; i < size; i++) {
-        ga_chr_t new_chr = ga_alloc_chr(alloc_func);
+        ga_chr_t new_chr;
+        if (methods->alloc_genome_from != NULL) {
+            new_chr = ga_alloc_chr_from(methods->alloc_genome_from,
+                methods->genome_allocator);
+        } else {
+            new_chr = ga_alloc_chr(methods->alloc_genome);
+        }
 
         if (new_chr == NULL) {
             for (int x = i - 1; x >= 0; x--) {
-                ga_destroy_chr(new_array[x], free_func);
+                ga_destroy_chr(new_array[x], methods->free_genome);
             }
             free(new_array);
             return NULL;
@@ -80,8 +135,9 @@ void _ga_free_chromosomes(ga_chr_t * arr, int size, ga_free_genome_func_t free_f
 ga_pop_t ga_create_pop(int size, ga_problem_type_t type, ga_func_vect_t methods)
 {
     /* only alloc/free/init are required for initialization */
-    assert(methods.alloc_genome != NULL);
-    assert(methods.free_genome != NULL);
+    assert(methods.genome_size > 0 || methods.alloc_genome != NULL
+        || methods.alloc_genome_from != NULL);
+    assert(methods.genome_size > 0 || methods.free_genome != NULL);
     assert(methods.init_genome != NULL);
 
     ga_pop_t new_pop = (ga_pop_t) malloc(sizeof(struct ga_pop));
@@ -95,24 +151,31 @@ ga_pop_t ga_create_pop(int size, ga_problem_type_t type, ga_func_vect_t methods)
     new_pop->problem_type = type;
     new_pop->methods = methods;
     new_pop->best_chr_index = -1;
+    new_pop->arena = NULL;
 
-    /* allocate chromosome array */
-    new_pop->chromosomes = _ga_allocate_chromosomes(size, methods.alloc_genome,
-        methods.free_genome);
+    /* fixed-size genomes live in single arena */
+    if (methods.genome_size > 0) {
+        if (_ga_allocate_arena(new_pop) != 0) {
+            free(new_pop);
+            return NULL;
+        }
+    } else {
+        /* allocate chromosome array */
+        new_pop->chromosomes = _ga_allocate_chromosomes(size, &methods);
 
-    if (new_pop->chromosomes == NULL) {
-        free(new_pop);
-        return NULL;
-    }
+        if (new_pop->chromosomes == NULL) {
+            free(new_pop);
+            return NULL;
+        }
 
-    /* allocate children array */
-    new_pop->children = _ga_allocate_chromosomes(size, methods.alloc_genome,
-        methods.free_genome);
+        /* allocate children array */
+        new_pop->children = _ga_allocate_chromosomes(size, &methods);
 
-    if (new_pop->children == NULL) {
-        _ga_free_chromosomes(new_pop->chromosomes, size, methods.free_genome);
-        free(new_pop);
-        return NULL;
+        if (new_pop->children == NULL) {
+            _ga_free_chromosomes(new_pop->chromosomes, size, methods.free_genome);
+            free(new_pop);
+            return NULL;
+        }
     }
 
     /* initialize chromosomes */
@@ -134,7 +197,10 @@ ga_pop_t ga_create_pop(int size, ga_problem_type_t type, ga_func_vect_t methods)
  */
 void ga_destroy_pop(ga_pop_t pop)
 {
-    if (pop != NULL) {
+    if (pop != NULL && pop->arena != NULL) {
+        free(pop->arena);
+
+    } else if (pop != NULL) {
         for (int i = 0; i < pop->size; i++) {
             pop->methods.free_genome(pop->chromosomes[i]->genome);
             pop->methods.free_genome(pop->children[i]->genome);
@@ -148,6 +214,19 @@ void ga_destroy_pop(ga_pop_t pop)
 }
 
 
+/**
+ * Makes children the current population and old chromosomes the space
+ * for next children. Only pointer arrays are exchanged.
+ * @param pop
+ */
+void ga_swap_generations(ga_pop_t pop)
+{
+    ga_chr_t *tmp = pop->chromosomes;
+    pop->chromosomes = pop->children;
+    pop->children = tmp;
+}
+
+
 /* chromosome *****************************************************************/
 
 
@@ -175,6 +254,31 @@ ga_chr_t ga_alloc_chr(ga_alloc_genome_func_t alloc_func)
 }
 
 
+/**
+ * Allocates memory for chromosome, genome is taken from given allocator
+ *
+ * @param  problem-specific genome allocation function
+ * @param  allocator
+ * @return pointer to allocated chromosome
+ */
+ga_chr_t ga_alloc_chr_from(ga_alloc_genome_from_func_t alloc_func, void *allocator)
+{
+    ga_chr_t new_chr = (ga_chr_t) malloc(sizeof(struct ga_chr));
+    if (new_chr == NULL) {
+        return NULL;
+    }
+    void *new_genome = alloc_func(allocator);
+    if (new_genome == NULL) {
+        free(new_chr);
+        return NULL;
+    }
+
+    new_chr->has_fitness = false;
+    new_chr->genome = new_genome;
+    return new_chr;
+}
+
+
 /**
  * De-allocates memory for chromosome
  *
@@ -271,23 +375,42 @@ ga_fitness_t ga_reevaluate_chr(ga_pop_t pop, ga_chr_t chr)
  */
 void ga_invalidate_fitness(ga_pop_t pop)
 {
-    #pragma omp parallel for
+    // too little work to be worth parallelization
     for (int i = 0; i < pop->size; i++) {
         pop->chromosomes[i]->has_fitness = false;
     }
 }
 
 
+static void _ga_evaluate_task(void *data, int index)
+{
+    ga_pop_t pop = (ga_pop_t) data;
+    ga_evaluate_chr(pop, pop->chromosomes[index]);
+}
+
+
+static void _ga_reevaluate_task(void *data, int index)
+{
+    ga_pop_t pop = (ga_pop_t) data;
+    ga_reevaluate_chr(pop, pop->chromosomes[index]);
+}
+
+
 /**
  * Calculate fitness of whole population, using `ga_evaluate_chr`
  * @param chr
  */
 void ga_evaluate_pop(ga_pop_t pop)
 {
-    // evaluate population
-    #pragma omp parallel for
+    // offspring function may have evaluated children itself already
+    bool evaluated = true;
     for (int i = 0; i < pop->size; i++) {
-        ga_evaluate_chr(pop, pop->chromosomes[i]);
+        evaluated &= pop->chromosomes[i]->has_fitness;
+    }
+
+    // evaluate population
+    if (!evaluated) {
+        ga_parallel_for(pop->size, _ga_evaluate_task, pop);
     }
 
     /* find new best chromosome */
@@ -302,10 +425,7 @@ void ga_evaluate_pop(ga_pop_t pop)
 void ga_reevaluate_pop(ga_pop_t pop)
 {
     // reevaluate population
-    #pragma omp parallel for
-    for (int i = 0; i < pop->size; i++) {
-        ga_reevaluate_chr(pop, pop->chromosomes[i]);
-    }
+    ga_parallel_for(pop->size, _ga_reevaluate_task, pop);
 
     /* find new best chromosome */
     _ga_find_new_best(pop);
@@ -325,3 +445,67 @@ void ga_next_generation(ga_pop_t pop)
     ga_evaluate_pop(pop);
     pop->generation++;
 }
+
+
+/* parallel execution *********************************************************/
+
+
+/**
+ * Starts persistent workers used by `ga_parallel_for`
+ * @param  workers Total number of workers including calling threads
+ * @return 0 on success, other value on error
+ */
+int ga_init_workers(int workers)
+{
+    #ifdef GA_USE_PTHREAD
+        // calling thread is one of the workers
+        return pool_init(workers - 1);
+    #else
+        return 0;
+    #endif
+}
+
+
+/**
+ * Stops persistent workers
+ */
+void ga_deinit_workers()
+{
+    #ifdef GA_USE_PTHREAD
+        pool_deinit();
+    #endif
+}
+
+
+/**
+ * Sets number of workers used by `ga_parallel_for` in calling thread
+ * @param workers Number of workers including calling thread
+ */
+void ga_set_workers(int workers)
+{
+    #ifdef GA_USE_PTHREAD
+        pool_set_width(workers > 0? workers - 1 : 0);
+    #elif defined(_OPENMP)
+        omp_set_num_threads(workers > 0? workers : 1);
+    #endif
+}
+
+
+/**
+ * Runs `func(data, i)` for each i in [0, count) in parallel and returns
+ * when all tasks are finished
+ * @param count
+ * @param func
+ * @param data
+ */
+void ga_parallel_for(int count, ga_task_func_t func, void *data)
+{
+    #ifdef GA_USE_PTHREAD
+        pool_parallel_for(count, func, data);
+    #else
+        #pragma omp parallel for
+        for (int i = 0; i < count; i++) {
+            func(data, i);
+        }
+    #endif
+}
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <math.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <float.h>
 #include <stdbool.h>
@@ -62,6 +63,16 @@ typedef struct ga_pop* ga_pop_t;
 typedef void* (*ga_alloc_genome_func_t)();
 
 
+/**
+ * Genome allocation function using given allocator, e.g. memory block
+ * shared by the whole population
+ *
+ * @param  allocator
+ * @return pointer to allocated genome
+ */
+typedef void* (*ga_alloc_genome_from_func_t)(void *allocator);
+
+
 /**
  * Genome deallocation function.
  *
@@ -164,6 +175,11 @@ typedef struct {
     ga_alloc_genome_func_t alloc_genome;
     ga_free_genome_func_t free_genome;
 
+    /* optional allocation of population genomes from given allocator,
+       used instead of alloc_genome if set */
+    ga_alloc_genome_from_func_t alloc_genome_from;
+    void *genome_allocator;
+
     /* random genome initialization */
     ga_init_genome_func_t init_genome;
 
@@ -177,6 +193,11 @@ typedef struct {
     ga_alloc_metadata_func_t alloc_metadata;
     ga_free_metadata_func_t free_metadata;
 
+    /* fixed genome size in bytes - if set, population genomes are stored
+       back to back in single aligned arena and alloc_genome/free_genome
+       are not used for them (genome must not own any other memory) */
+    size_t genome_size;
+
 } ga_func_vect_t;
 
 
@@ -205,6 +226,9 @@ struct ga_pop {
 
     /* problem-specific metadata, e.g. pre-calculated values */
     void *metadata;
+
+    /* single allocation with all chromosomes, if genome_size is set */
+    void *arena;
 };
 
 
@@ -229,6 +253,14 @@ ga_pop_t ga_create_pop(int size, ga_problem_type_t type, ga_func_vect_t methods)
 void ga_destroy_pop(ga_pop_t pop);
 
 
+/**
+ * Makes children the current population and old chromosomes the space
+ * for next children. Only pointer arrays are exchanged.
+ * @param pop
+ */
+void ga_swap_generations(ga_pop_t pop);
+
+
 /* chromosome *****************************************************************/
 
 
@@ -241,6 +273,16 @@ void ga_destroy_pop(ga_pop_t pop);
 ga_chr_t ga_alloc_chr(ga_alloc_genome_func_t alloc_func);
 
 
+/**
+ * Allocates memory for chromosome, genome is taken from given allocator
+ *
+ * @param  problem-specific genome allocation function
+ * @param  allocator
+ * @return pointer to allocated chromosome
+ */
+ga_chr_t ga_alloc_chr_from(ga_alloc_genome_from_func_t alloc_func, void *allocator);
+
+
 /**
  * De-allocates memory for chromosome
  *
@@ -354,3 +396,46 @@ static inline double ga_worst_fitness(ga_problem_type_t type) {
  * @param pop
  */
 void ga_next_generation(ga_pop_t pop);
+
+
+/* parallel execution *********************************************************/
+
+
+/**
+ * Parallel task function
+ * @param data Shared task data
+ * @param index Task index
+ */
+typedef void (*ga_task_func_t)(void *data, int index);
+
+
+/**
+ * Starts persistent workers used by `ga_parallel_for`. Without
+ * GA_USE_PTHREAD, OpenMP is used and this does nothing.
+ * @param  workers Total number of workers including calling threads
+ * @return 0 on success, other value on error
+ */
+int ga_init_workers(int workers);
+
+
+/**
+ * Stops persistent workers
+ */
+void ga_deinit_workers();
+
+
+/**
+ * Sets number of workers used by `ga_parallel_for` in calling thread
+ * @param workers Number of workers including calling thread
+ */
+void ga_set_workers(int workers);
+
+
+/**
+ * Runs `func(data, i)` for each i in [0, count) in parallel and returns
+ * when all tasks are finished
+ * @param count
+ * @param func
+ * @param data
+ */
+void ga_parallel_for(int count, ga_task_func_t func, void *data);
@@ -197,9 +197,10 @@ int img_split_windows_simd(img_image_t img, img_pixel_t *out[WINDOW_SIZE])
     int size = img->width * img->height;
     int padding = SIMD_PADDING_BYTES - (size % SIMD_PADDING_BYTES);
 
+    // aligned to allow aligned simd loads (malloc guarantees 16 bytes only)
     for (int i = 0; i < WINDOW_SIZE; i++) {
-        out[i] = (img_pixel_t*) malloc(sizeof(img_pixel_t) * (size + padding));
-        if (out[i] == NULL) {
+        if (posix_memalign((void**) &out[i], SIMD_ALIGNMENT_BYTES,
+                sizeof(img_pixel_t) * (size + padding)) != 0) {
             // TODO: dealloc
             return -1;
         }
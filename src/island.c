@@ -0,0 +1,387 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <stdatomic.h>
+
+#include "island.h"
+
+
+#define ISLAND_MAGIC 0xC0C015A1u
+
+/* header is being changed by one of the processes */
+#define ISLAND_LOCKED 1u
+
+/* last island detached, segment name is (being) removed */
+#define ISLAND_UNLINKED 2u
+
+#define ISLAND_ALIGNMENT 64
+
+
+/*
+    Segment starts with header, followed by `count * ISLAND_CHANNELS`
+    slots. Slot is guarded by sequence lock - odd sequence means that
+    its owner is writing.
+
+    Header is changed only while `magic` is ISLAND_LOCKED. Processes
+    attached to the segment are counted, so that the name is removed by
+    the last one. Segment left by crashed run (no attached process is
+    alive) is reset on attach and gets new run id.
+ */
+typedef struct {
+    atomic_uint magic;
+    int count;
+    size_t payload_sizes[ISLAND_CHANNELS];
+
+    /* run which uses the segment and how many times it was reset */
+    uint64_t run_id;
+    unsigned int generation;
+
+    /* attached processes, pid of each island (0 if not attached) */
+    int attached;
+    pid_t pids[];
+} island_header_t;
+
+
+typedef struct {
+    atomic_uint sequence;
+    unsigned int published;
+    ga_fitness_t fitness;
+    unsigned char payload[];
+} island_slot_t;
+
+
+struct island {
+    int count;
+    int id;
+    char shm_name[256];
+    uint64_t run_id;
+
+    unsigned char *segment;
+    size_t segment_size;
+    size_t slot_offsets[ISLAND_CHANNELS];
+    size_t slot_strides[ISLAND_CHANNELS];
+    size_t payload_sizes[ISLAND_CHANNELS];
+
+    // last received `published` counter per channel
+    unsigned int received[ISLAND_CHANNELS];
+};
+
+
+static size_t _island_align(size_t size)
+{
+    return (size + ISLAND_ALIGNMENT - 1) & ~(size_t) (ISLAND_ALIGNMENT - 1);
+}
+
+
+static island_slot_t *_island_slot(island_t island, island_channel_t channel, int id)
+{
+    return (island_slot_t*) (island->segment + island->slot_offsets[channel]
+        + id * island->slot_strides[channel]);
+}
+
+
+/**
+ * Opens (or creates) shared memory segment and maps it
+ * @return 0 on success, other value on error
+ */
+static int _island_map(island_t island)
+{
+    // segment is zero-filled when created
+    int fd = shm_open(island->shm_name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        perror("shm_open");
+        return -1;
+    }
+
+    // never shrink segment used by islands with other settings
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("fstat");
+        close(fd);
+        return -1;
+    }
+
+    if ((size_t) st.st_size < island->segment_size
+        && ftruncate(fd, island->segment_size) != 0)
+    {
+        perror("ftruncate");
+        close(fd);
+        return -1;
+    }
+
+    island->segment = (unsigned char*) mmap(NULL, island->segment_size,
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (island->segment == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * Waits until header is not locked and locks it
+ * @return Header state before locking
+ */
+static unsigned int _island_lock(island_header_t *header)
+{
+    while (true) {
+        unsigned int magic = atomic_load(&header->magic);
+        if (magic != ISLAND_LOCKED
+            && atomic_compare_exchange_weak(&header->magic, &magic, ISLAND_LOCKED))
+        {
+            return magic;
+        }
+        sched_yield();
+    }
+}
+
+
+static bool _island_pid_alive(pid_t pid)
+{
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+
+/**
+ * Returns whether any process attached to locked segment is still running
+ */
+static bool _island_alive(island_header_t *header)
+{
+    if (header->attached <= 0) {
+        return false;
+    }
+    for (int i = 0; i < header->count; i++) {
+        if (header->pids[i] != 0 && _island_pid_alive(header->pids[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Attaches to shared memory segment of island group, creates it if
+ * necessary
+ *
+ * Segment with no running island is reset, so that migrants of crashed
+ * run are not received.
+ *
+ * @param  name Group name, used to derive shared memory object name
+ * @param  count Number of islands in group
+ * @param  id This island index in [0, count)
+ * @param  payload_sizes Maximal payload size of each channel
+ * @return NULL on error
+ */
+island_t island_create(const char *name, int count, int id,
+    size_t payload_sizes[ISLAND_CHANNELS])
+{
+    if (count < 1 || id < 0 || id >= count) {
+        fprintf(stderr, "Invalid island id %d of %d islands.\n", id, count);
+        return NULL;
+    }
+
+    island_t island = (island_t) malloc(sizeof(struct island));
+    if (island == NULL) {
+        return NULL;
+    }
+
+    island->count = count;
+    island->id = id;
+    snprintf(island->shm_name, sizeof(island->shm_name), "/coco-islands-%s", name);
+
+    size_t offset = _island_align(sizeof(island_header_t) + count * sizeof(pid_t));
+    for (int ch = 0; ch < ISLAND_CHANNELS; ch++) {
+        island->payload_sizes[ch] = payload_sizes[ch];
+        island->slot_strides[ch] = _island_align(sizeof(island_slot_t) + payload_sizes[ch]);
+        island->slot_offsets[ch] = offset;
+        island->received[ch] = 0;
+        offset += count * island->slot_strides[ch];
+    }
+    island->segment_size = offset;
+
+    island_header_t *header;
+    while (true) {
+        if (_island_map(island) != 0) {
+            free(island);
+            return NULL;
+        }
+
+        header = (island_header_t*) island->segment;
+        unsigned int magic = _island_lock(header);
+        if (magic != ISLAND_UNLINKED) {
+            break;
+        }
+
+        // last island has just left, segment name refers to a new one now
+        atomic_store(&header->magic, ISLAND_UNLINKED);
+        munmap(island->segment, island->segment_size);
+    }
+
+    if (!_island_alive(header)) {
+        // fresh segment or one left by crashed run
+        memset(island->segment + sizeof(island_header_t), 0,
+            island->segment_size - sizeof(island_header_t));
+        header->count = count;
+        memcpy(header->payload_sizes, payload_sizes, sizeof(header->payload_sizes));
+        header->run_id = ((uint64_t) time(NULL) << 32) ^ (uint64_t) getpid();
+        header->generation++;
+        header->attached = 0;
+
+    } else if (header->count != count
+        || memcmp(header->payload_sizes, payload_sizes, sizeof(header->payload_sizes)) != 0)
+    {
+        fprintf(stderr, "Island group '%s' was created with different settings.\n", name);
+        atomic_store(&header->magic, ISLAND_MAGIC);
+        munmap(island->segment, island->segment_size);
+        free(island);
+        return NULL;
+
+    } else if (header->pids[id] != 0 && _island_pid_alive(header->pids[id])) {
+        fprintf(stderr, "Island %d of group '%s' is already running.\n", id, name);
+        atomic_store(&header->magic, ISLAND_MAGIC);
+        munmap(island->segment, island->segment_size);
+        free(island);
+        return NULL;
+
+    } else if (header->pids[id] != 0) {
+        // this island crashed and is restarted, others are still running
+        header->attached--;
+    }
+
+    header->pids[id] = getpid();
+    header->attached++;
+    island->run_id = header->run_id;
+    atomic_store(&header->magic, ISLAND_MAGIC);
+
+    return island;
+}
+
+
+/**
+ * Detaches from shared memory segment, the last island removes it
+ * @param island
+ */
+void island_destroy(island_t island)
+{
+    island_header_t *header = (island_header_t*) island->segment;
+    _island_lock(header);
+
+    bool last = false;
+    if (header->run_id == island->run_id && header->pids[island->id] == getpid()) {
+        header->pids[island->id] = 0;
+        header->attached--;
+        last = header->attached <= 0;
+    }
+
+    if (last) {
+        // islands which opened the name meanwhile have to open it again
+        atomic_store(&header->magic, ISLAND_UNLINKED);
+        shm_unlink(island->shm_name);
+    } else {
+        atomic_store(&header->magic, ISLAND_MAGIC);
+    }
+
+    munmap(island->segment, island->segment_size);
+    free(island);
+}
+
+
+/**
+ * Publishes migrant for other islands, never blocks
+ * @param island
+ * @param channel
+ * @param payload Serialized individual
+ * @param fitness Its fitness
+ */
+void island_publish(island_t island, island_channel_t channel,
+    const void *payload, ga_fitness_t fitness)
+{
+    island_slot_t *slot = _island_slot(island, channel, island->id);
+
+    // only this island writes into the slot
+    unsigned int sequence = atomic_load(&slot->sequence);
+    atomic_store(&slot->sequence, sequence + 1);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(slot->payload, payload, island->payload_sizes[channel]);
+    slot->fitness = fitness;
+    slot->published++;
+
+    atomic_store(&slot->sequence, sequence + 2);
+}
+
+
+/**
+ * Receives migrant from preceding island
+ * @param  island
+ * @param  channel
+ * @param  payload Buffer for serialized individual
+ * @param  fitness Its fitness as evaluated by the sender
+ * @return Whether there is new migrant since last call
+ */
+bool island_receive(island_t island, island_channel_t channel,
+    void *payload, ga_fitness_t *fitness)
+{
+    if (island->count < 2) {
+        return false;
+    }
+
+    int source = (island->id + island->count - 1) % island->count;
+    island_slot_t *slot = _island_slot(island, channel, source);
+
+    while (true) {
+        unsigned int before = atomic_load(&slot->sequence);
+        if (before & 1) {
+            sched_yield();
+            continue;
+        }
+
+        unsigned int published = slot->published;
+        if (published == island->received[channel]) {
+            return false;
+        }
+
+        memcpy(payload, slot->payload, island->payload_sizes[channel]);
+        *fitness = slot->fitness;
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load(&slot->sequence) == before) {
+            island->received[channel] = published;
+            return true;
+        }
+    }
+}
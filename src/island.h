@@ -0,0 +1,94 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ga.h"
+
+
+/*
+    Islands are independent processes which periodically exchange their
+    best individuals through POSIX shared memory. Each island publishes
+    into its own slot and receives from its predecessor in a ring.
+ */
+
+
+#define ISLAND_CHANNELS 2
+
+typedef enum {
+    island_cgp = 0,
+    island_pred = 1,
+} island_channel_t;
+
+
+struct island;
+typedef struct island* island_t;
+
+
+/**
+ * Attaches to shared memory segment of island group, creates it if
+ * necessary
+ *
+ * All islands of the group must use the same count and payload sizes.
+ * Segment with no running island (left by crashed run) is reset.
+ *
+ * @param  name Group name, used to derive shared memory object name
+ * @param  count Number of islands in group
+ * @param  id This island index in [0, count)
+ * @param  payload_sizes Maximal payload size of each channel
+ * @return NULL on error
+ */
+island_t island_create(const char *name, int count, int id,
+    size_t payload_sizes[ISLAND_CHANNELS]);
+
+
+/**
+ * Detaches from shared memory segment, the last island removes it
+ * @param island
+ */
+void island_destroy(island_t island);
+
+
+/**
+ * Publishes migrant for other islands, never blocks
+ * @param island
+ * @param channel
+ * @param payload Serialized individual
+ * @param fitness Its fitness
+ */
+void island_publish(island_t island, island_channel_t channel,
+    const void *payload, ga_fitness_t fitness);
+
+
+/**
+ * Receives migrant from preceding island
+ * @param  island
+ * @param  channel
+ * @param  payload Buffer for serialized individual
+ * @param  fitness Its fitness as evaluated by the sender
+ * @return Whether there is new migrant since last call
+ */
+bool island_receive(island_t island, island_channel_t channel,
+    void *payload, ga_fitness_t *fitness);
@@ -48,6 +48,8 @@ void logger_init_base(logger_t logger, config_t *config)
     logger->handler_pred_length_change_scheduled = NULL;
     logger->handler_pred_length_change_applied = NULL;
     logger->handler_signal = NULL;
+    logger->handler_timing = NULL;
+    logger->handler_flush = NULL;
 }
 
 
@@ -28,6 +28,7 @@
 
 #include "../ga.h"
 #include "../config.h"
+#include "../timing.h"
 
 
 typedef enum {
@@ -54,6 +55,8 @@ typedef void (*handler_pred_length_change_scheduled_t)(logger_t logger, int new_
 typedef void (*handler_pred_length_change_applied_t)(logger_t logger, int cgp_generation,
     unsigned int old_length, unsigned int new_length,
     unsigned int old_used_length, unsigned int new_used_length);
+typedef void (*handler_timing_t)(logger_t logger, timing_totals_t *totals);
+typedef void (*handler_flush_t)(logger_t logger);
 
 /* "destructor" */
 typedef void (*logger_destructor_t)(logger_t logger);
@@ -77,6 +80,10 @@ struct logger_base {
     handler_pred_length_change_scheduled_t handler_pred_length_change_scheduled;
     handler_pred_length_change_applied_t handler_pred_length_change_applied;
     handler_signal_t handler_signal;
+    handler_timing_t handler_timing;
+
+    /* writes buffered output, called after each batch of events */
+    handler_flush_t handler_flush;
 
     /* "destructor" */
     logger_destructor_t destructor;
@@ -29,6 +29,9 @@ struct logger_csv {
     struct logger_base base;  // must be first!
     FILE *log_file;
     history_entry_t last_entry;
+#ifdef TIMING
+    timing_totals_t last_timing;
+#endif
 };
 typedef struct logger_csv *logger_csv_t;
 
@@ -41,6 +44,10 @@ static void handle_log_tick(logger_t logger, history_entry_t *state);
 static void handle_signal(logger_t logger, int signal, history_entry_t *state);
 static void handle_better_pred(logger_t logger, ga_fitness_t old_fitness, ga_fitness_t new_fitness);
 static void handle_pred_length_change_applied(logger_t logger, int cgp_generation, unsigned int old_length, unsigned int new_length, unsigned int old_used_length, unsigned int new_used_length);
+static void handle_flush(logger_t logger);
+#ifdef TIMING
+static void handle_timing(logger_t logger, timing_totals_t *totals);
+#endif
 
 /* "destructor" */
 static void logger_csv_destruct(logger_t logger);
@@ -58,6 +65,9 @@ logger_t logger_csv_create(config_t *config, FILE *target)
     if (logger == NULL) return NULL;
 
     logger->log_file = target;
+#ifdef TIMING
+    memset(&logger->last_timing, 0, sizeof(timing_totals_t));
+#endif
 
     // this is the same as &logger->base
     logger_t base = (logger_t) logger;
@@ -71,6 +81,10 @@ logger_t logger_csv_create(config_t *config, FILE *target)
     base->handler_better_pred = handle_better_pred;
     base->handler_pred_length_change_applied = handle_pred_length_change_applied;
     base->handler_signal = handle_signal;
+    base->handler_flush = handle_flush;
+#ifdef TIMING
+    base->handler_timing = handle_timing;
+#endif
     base->destructor = logger_csv_destruct;
 
     return base;
@@ -133,12 +147,14 @@ static inline void _print_line(logger_t logger, history_entry_t *entry) {
         "%d,"        // entry->pred_length,
         "%d,"       // entry->pred_used_length,
         "%ld,"      // entry->cgp_evals,
+        "%d,"       // entry->cgp_workers,
+        "%d,"       // entry->pred_workers,
         "%.10g,"    // entry->velocity,
         "%d,"        // entry->delta_generation,
         "%.10g,"     // entry->delta_real_fitness,
         "%.10g,"    // entry->delta_velocity,
         "%.10g,"     // logger_get_wallclock(logger).tv_sec / 60.0,
-        "%.10g\n",  // logger_get_usertime(logger).tv_sec / 60.0
+        "%.10g",    // logger_get_usertime(logger).tv_sec / 60.0
 
         entry->generation,
         entry->predicted_fitness,
@@ -149,6 +165,8 @@ static inline void _print_line(logger_t logger, history_entry_t *entry) {
         entry->pred_length,
         entry->pred_used_length,
         entry->cgp_evals,
+        entry->cgp_workers,
+        entry->pred_workers,
         entry->velocity,
         entry->delta_generation,
         entry->delta_real_fitness,
@@ -156,7 +174,15 @@ static inline void _print_line(logger_t logger, history_entry_t *entry) {
         logger_get_wallclock(logger).tv_sec / 60.0,
         logger_get_usertime(logger).tv_sec / 60.0
     );
-    fflush(fp);
+
+#ifdef TIMING
+    timing_totals_t *timing = &((logger_csv_t) logger)->last_timing;
+    for (int i = 0; i < TIMING_PHASES; i++) {
+        fprintf(fp, ",%.10g", timing->seconds[i]);
+    }
+#endif
+
+    fprintf(fp, "\n");
 }
 
 
@@ -174,13 +200,23 @@ static void handle_started(logger_t logger, history_entry_t *state)
         "pred_length,"               // entry->pred_length,
         "pred_used_length,"         // entry->pred_used_length,
         "cgp_evals,"                // entry->cgp_evals,
+        "cgp_workers,"              // entry->cgp_workers,
+        "pred_workers,"             // entry->pred_workers,
         "velocity,"                 // entry->velocity,
         "delta_generation,"          // entry->delta_generation,
         "delta_fitness,"             // entry->delta_real_fitness,
         "delta_velocity,"           // entry->delta_velocity,
         "wallclock,"                 // logger_get_wallclock(logger).tv_sec / 60.0,
-        "usertime\n"                // logger_get_usertime(logger).tv_sec / 60.0
+        "usertime"                  // logger_get_usertime(logger).tv_sec / 60.0
     );
+
+#ifdef TIMING
+    for (int i = 0; i < TIMING_PHASES; i++) {
+        fprintf(_get_fp(logger), ",time_%s", timing_phase_names[i]);
+    }
+#endif
+
+    fprintf(_get_fp(logger), "\n");
 }
 
 
@@ -224,3 +260,17 @@ static void handle_pred_length_change_applied(logger_t logger, int cgp_generatio
     last->pred_used_length = new_used_length;
     _print_line(logger, last);
 }
+
+
+static void handle_flush(logger_t logger)
+{
+    fflush(_get_fp(logger));
+}
+
+
+#ifdef TIMING
+static void handle_timing(logger_t logger, timing_totals_t *totals)
+{
+    memcpy(&((logger_csv_t) logger)->last_timing, totals, sizeof(timing_totals_t));
+}
+#endif
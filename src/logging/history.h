@@ -55,6 +55,10 @@ typedef struct {
 
     int pred_length;
     int pred_used_length;
+
+    // worker budgets
+    int cgp_workers;
+    int pred_workers;
 } history_entry_t;
 
 
@@ -91,7 +95,9 @@ void history_calc_entry(
     ga_fitness_t active_predictor_fitness,
     long cgp_evals,
     int pred_length,
-    int pred_used_length
+    int pred_used_length,
+    int cgp_workers,
+    int pred_workers
 );
 
 
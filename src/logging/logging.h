@@ -24,6 +24,7 @@
 
 #include "history.h"
 #include "base.h"
+#include "queue.h"
 
 /* various logger implementations */
 #include "csv.h"
@@ -35,20 +36,63 @@
 #define LOGGERS_MAX 10
 
 
-typedef struct {
+typedef struct logger_list {
     int count;
     logger_t loggers[LOGGERS_MAX];
+
+    /* if set, events are handled by logging thread */
+    logger_queue_t queue;
 } logger_list_t;
 
 
 static inline void logger_init_list(logger_list_t *list)
 {
     list->count = 0;
+    list->queue = NULL;
+}
+
+
+/**
+ * Starts handling events in separate logging thread
+ * @return 0 on success
+ */
+static inline int logger_start_thread(logger_list_t *list)
+{
+    assert(list->queue == NULL);
+    list->queue = logger_queue_create(list);
+    return list->queue? 0 : -1;
+}
+
+
+/**
+ * Waits until all events are handled and stops logging thread, events
+ * are handled synchronously again
+ */
+static inline void logger_stop_thread(logger_list_t *list)
+{
+    if (list->queue) {
+        logger_queue_destroy(list->queue);
+        list->queue = NULL;
+    }
+}
+
+
+/**
+ * Writes buffered output of all loggers
+ */
+static inline void logger_flush_list(logger_list_t *list)
+{
+    for (int i = 0; i < list->count; i++) {
+        if (list->loggers[i]->handler_flush) {
+            list->loggers[i]->handler_flush(list->loggers[i]);
+        }
+    }
 }
 
 
 static inline void logger_destroy_list(logger_list_t *list)
 {
+    logger_stop_thread(list);
     for (int i = 0; i < list->count; i++) {
         logger_destroy(list->loggers[i]);
     }
@@ -65,10 +109,22 @@ static inline void logger_add(logger_list_t *list, logger_t logger)
 }
 
 
-#define logger_fire(listptr, event, ...) do { \
+/* calls handlers of all loggers in current thread */
+#define _logger_fire_sync(listptr, event, ...) do { \
     for (int i = 0; i < (listptr)->count; i++) { \
         if ((listptr)->loggers[i]->handler_ ## event) { \
             (listptr)->loggers[i]->handler_ ## event ((listptr)->loggers[i], ##__VA_ARGS__); \
         } \
     } \
+} while(0)
+
+
+/* posts event to logging thread, or handles it right away if not running */
+#define logger_fire(listptr, event, ...) do { \
+    if ((listptr)->queue) { \
+        logger_post_ ## event ((listptr)->queue, ##__VA_ARGS__); \
+    } else { \
+        _logger_fire_sync(listptr, event, ##__VA_ARGS__); \
+        logger_flush_list(listptr); \
+    } \
 } while(0);
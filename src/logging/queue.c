@@ -0,0 +1,393 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include <errno.h>
+#include <stdint.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+#include "queue.h"
+#include "logging.h"
+
+
+#define LOGGER_QUEUE_MASK (LOGGER_QUEUE_SIZE - 1)
+
+
+/*
+    Ring buffer cell, sequence tells whether the cell is free for position
+    `pos` (sequence == pos) or holds event of position `pos`
+    (sequence == pos + 1)
+ */
+typedef struct {
+    atomic_size_t sequence;
+    logger_event_t event;
+} _logger_cell_t;
+
+
+struct logger_queue {
+    _logger_cell_t cells[LOGGER_QUEUE_SIZE];
+
+    /* next position to write, shared by producers */
+    atomic_size_t enqueue_pos __attribute__ ((aligned (64)));
+
+    /* next position to read, used only by logging thread */
+    size_t dequeue_pos __attribute__ ((aligned (64)));
+
+    /* number of posted events, logging thread sleeps on it */
+    sem_t items;
+
+    pthread_t thread;
+    struct logger_list *list;
+};
+
+
+/**
+ * Takes next event from the queue, it must be already posted
+ * @param queue
+ * @param event
+ */
+static void _logger_queue_take(logger_queue_t queue, logger_event_t *event)
+{
+    _logger_cell_t *cell = &queue->cells[queue->dequeue_pos & LOGGER_QUEUE_MASK];
+
+    // semaphore is incremented after the event is published, so this
+    // loop only guards against reordering
+    while (atomic_load_explicit(&cell->sequence, memory_order_acquire) != queue->dequeue_pos + 1) {
+        sched_yield();
+    }
+
+    memcpy(event, &cell->event, sizeof(logger_event_t));
+    atomic_store_explicit(&cell->sequence, queue->dequeue_pos + LOGGER_QUEUE_SIZE,
+        memory_order_release);
+    queue->dequeue_pos++;
+}
+
+
+/**
+ * Calls handlers of all loggers
+ * @param list
+ * @param event
+ */
+static void _logger_dispatch(struct logger_list *list, logger_event_t *event)
+{
+    switch (event->type) {
+        case logger_event_started:
+            _logger_fire_sync(list, started, &event->state);
+            break;
+
+        case logger_event_finished:
+            _logger_fire_sync(list, finished, event->finished.reason,
+                &event->state, event->finished.work_data);
+            break;
+
+        case logger_event_better_cgp:
+            _logger_fire_sync(list, better_cgp, &event->state);
+            break;
+
+        case logger_event_baldwin_triggered:
+            _logger_fire_sync(list, baldwin_triggered, &event->state);
+            break;
+
+        case logger_event_log_tick:
+            _logger_fire_sync(list, log_tick, &event->state);
+            break;
+
+        case logger_event_signal:
+            _logger_fire_sync(list, signal, event->signal, &event->state);
+            break;
+
+        case logger_event_better_pred:
+            _logger_fire_sync(list, better_pred, event->better_pred.old_fitness,
+                event->better_pred.new_fitness);
+            break;
+
+        case logger_event_pred_length_change_scheduled:
+            _logger_fire_sync(list, pred_length_change_scheduled,
+                event->new_predictor_length, &event->state);
+            break;
+
+        case logger_event_pred_length_change_applied:
+            _logger_fire_sync(list, pred_length_change_applied,
+                event->length_change.cgp_generation,
+                event->length_change.old_length,
+                event->length_change.new_length,
+                event->length_change.old_used_length,
+                event->length_change.new_used_length);
+            break;
+
+        case logger_event_timing:
+            _logger_fire_sync(list, timing, &event->timing);
+            break;
+
+        case logger_event_stop:
+            break;
+    }
+}
+
+
+/**
+ * Waits for one event
+ * @param queue
+ */
+static void _logger_queue_wait(logger_queue_t queue)
+{
+    while (sem_wait(&queue->items) != 0 && errno == EINTR);
+}
+
+
+/**
+ * Logging thread - handles all available events and flushes loggers once
+ * per batch
+ * @param  data Queue
+ * @return
+ */
+static void *_logger_thread(void *data)
+{
+    logger_queue_t queue = (logger_queue_t) data;
+    logger_event_t event;
+    bool stop = false;
+
+    while (!stop) {
+        _logger_queue_wait(queue);
+
+        do {
+            _logger_queue_take(queue, &event);
+            _logger_dispatch(queue->list, &event);
+            if (event.type == logger_event_stop) {
+                stop = true;
+                break;
+            }
+        } while (sem_trywait(&queue->items) == 0);
+
+        logger_flush_list(queue->list);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Starts logging thread, which handles events posted to returned queue
+ * by calling handlers of all loggers in the list
+ * @param  list
+ * @return queue or NULL on failure
+ */
+logger_queue_t logger_queue_create(struct logger_list *list)
+{
+    logger_queue_t queue = (logger_queue_t) malloc(sizeof(struct logger_queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < LOGGER_QUEUE_SIZE; i++) {
+        atomic_init(&queue->cells[i].sequence, i);
+    }
+    atomic_init(&queue->enqueue_pos, 0);
+    queue->dequeue_pos = 0;
+    queue->list = list;
+
+    if (sem_init(&queue->items, 0, 0) != 0) {
+        free(queue);
+        return NULL;
+    }
+
+    if (pthread_create(&queue->thread, NULL, _logger_thread, queue) != 0) {
+        sem_destroy(&queue->items);
+        free(queue);
+        return NULL;
+    }
+
+    return queue;
+}
+
+
+/**
+ * Handles all posted events and stops logging thread
+ * @param queue
+ */
+void logger_queue_destroy(logger_queue_t queue)
+{
+    logger_event_t event = { .type = logger_event_stop };
+    logger_queue_post(queue, &event);
+    pthread_join(queue->thread, NULL);
+
+    sem_destroy(&queue->items);
+    free(queue);
+}
+
+
+/**
+ * Appends event to the queue, waits if the queue is full
+ *
+ * Safe to be called from multiple threads at once.
+ *
+ * @param queue
+ * @param event
+ */
+void logger_queue_post(logger_queue_t queue, logger_event_t *event)
+{
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    _logger_cell_t *cell;
+
+    while (true) {
+        cell = &queue->cells[pos & LOGGER_QUEUE_MASK];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+
+        if (diff == 0) {
+            // cell is free, try to claim it
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos,
+                &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+
+        } else if (diff < 0) {
+            // queue is full, let the logging thread catch up
+            sched_yield();
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+
+        } else {
+            // other producer claimed the cell
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(&cell->event, event, sizeof(logger_event_t));
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    sem_post(&queue->items);
+}
+
+
+/* event constructors *********************************************************/
+
+
+static inline void _post_with_state(logger_queue_t queue,
+    logger_event_type_t type, history_entry_t *state)
+{
+    logger_event_t event = { .type = type };
+    if (state) {
+        event.state = *state;
+    }
+    logger_queue_post(queue, &event);
+}
+
+
+void logger_post_started(logger_queue_t queue, history_entry_t *state)
+{
+    _post_with_state(queue, logger_event_started, state);
+}
+
+
+void logger_post_finished(logger_queue_t queue, finish_reason_t reason,
+    history_entry_t *state, struct algo_data *work_data)
+{
+    logger_event_t event = {
+        .type = logger_event_finished,
+        .state = *state,
+        .finished = { .reason = reason, .work_data = work_data },
+    };
+    logger_queue_post(queue, &event);
+}
+
+
+void logger_post_better_cgp(logger_queue_t queue, history_entry_t *state)
+{
+    _post_with_state(queue, logger_event_better_cgp, state);
+}
+
+
+void logger_post_baldwin_triggered(logger_queue_t queue, history_entry_t *state)
+{
+    _post_with_state(queue, logger_event_baldwin_triggered, state);
+}
+
+
+void logger_post_log_tick(logger_queue_t queue, history_entry_t *state)
+{
+    _post_with_state(queue, logger_event_log_tick, state);
+}
+
+
+void logger_post_signal(logger_queue_t queue, int signal, history_entry_t *state)
+{
+    logger_event_t event = {
+        .type = logger_event_signal,
+        .state = *state,
+        .signal = signal,
+    };
+    logger_queue_post(queue, &event);
+}
+
+
+void logger_post_better_pred(logger_queue_t queue, ga_fitness_t old_fitness,
+    ga_fitness_t new_fitness)
+{
+    logger_event_t event = {
+        .type = logger_event_better_pred,
+        .better_pred = { .old_fitness = old_fitness, .new_fitness = new_fitness },
+    };
+    logger_queue_post(queue, &event);
+}
+
+
+void logger_post_pred_length_change_scheduled(logger_queue_t queue,
+    int new_predictor_length, history_entry_t *state)
+{
+    logger_event_t event = {
+        .type = logger_event_pred_length_change_scheduled,
+        .state = *state,
+        .new_predictor_length = new_predictor_length,
+    };
+    logger_queue_post(queue, &event);
+}
+
+
+void logger_post_pred_length_change_applied(logger_queue_t queue,
+    int cgp_generation, unsigned int old_length, unsigned int new_length,
+    unsigned int old_used_length, unsigned int new_used_length)
+{
+    logger_event_t event = {
+        .type = logger_event_pred_length_change_applied,
+        .length_change = {
+            .cgp_generation = cgp_generation,
+            .old_length = old_length,
+            .new_length = new_length,
+            .old_used_length = old_used_length,
+            .new_used_length = new_used_length,
+        },
+    };
+    logger_queue_post(queue, &event);
+}
+
+
+void logger_post_timing(logger_queue_t queue, timing_totals_t *totals)
+{
+    logger_event_t event = {
+        .type = logger_event_timing,
+        .timing = *totals,
+    };
+    logger_queue_post(queue, &event);
+}
@@ -0,0 +1,135 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "base.h"
+#include "history.h"
+
+
+/* number of events the queue can hold, must be power of two */
+#define LOGGER_QUEUE_SIZE 1024
+
+
+/* declared in logging.h */
+struct logger_list;
+
+
+typedef enum {
+    logger_event_started,
+    logger_event_finished,
+    logger_event_better_cgp,
+    logger_event_baldwin_triggered,
+    logger_event_log_tick,
+    logger_event_signal,
+    logger_event_better_pred,
+    logger_event_pred_length_change_scheduled,
+    logger_event_pred_length_change_applied,
+    logger_event_timing,
+
+    /* stops the logging thread */
+    logger_event_stop,
+} logger_event_type_t;
+
+
+/*
+    Copy of event arguments, pointed-to history entries and timers are
+    copied too, so they can be handled after the evolution moved on
+ */
+typedef struct {
+    logger_event_type_t type;
+    history_entry_t state;
+
+    union {
+        struct {
+            finish_reason_t reason;
+            struct algo_data *work_data;
+        } finished;
+
+        int signal;
+
+        struct {
+            ga_fitness_t old_fitness;
+            ga_fitness_t new_fitness;
+        } better_pred;
+
+        int new_predictor_length;
+
+        struct {
+            int cgp_generation;
+            unsigned int old_length;
+            unsigned int new_length;
+            unsigned int old_used_length;
+            unsigned int new_used_length;
+        } length_change;
+
+        timing_totals_t timing;
+    };
+} logger_event_t;
+
+
+struct logger_queue;
+typedef struct logger_queue *logger_queue_t;
+
+
+/**
+ * Starts logging thread, which handles events posted to returned queue
+ * by calling handlers of all loggers in the list
+ * @param  list
+ * @return queue or NULL on failure
+ */
+logger_queue_t logger_queue_create(struct logger_list *list);
+
+
+/**
+ * Handles all posted events and stops logging thread
+ * @param queue
+ */
+void logger_queue_destroy(logger_queue_t queue);
+
+
+/**
+ * Appends event to the queue, waits if the queue is full
+ *
+ * Safe to be called from multiple threads at once.
+ *
+ * @param queue
+ * @param event
+ */
+void logger_queue_post(logger_queue_t queue, logger_event_t *event);
+
+
+/* event constructors, arguments are the same as handlers' ones */
+
+void logger_post_started(logger_queue_t queue, history_entry_t *state);
+void logger_post_finished(logger_queue_t queue, finish_reason_t reason, history_entry_t *state, struct algo_data *work_data);
+void logger_post_better_cgp(logger_queue_t queue, history_entry_t *state);
+void logger_post_baldwin_triggered(logger_queue_t queue, history_entry_t *state);
+void logger_post_log_tick(logger_queue_t queue, history_entry_t *state);
+void logger_post_signal(logger_queue_t queue, int signal, history_entry_t *state);
+void logger_post_better_pred(logger_queue_t queue, ga_fitness_t old_fitness, ga_fitness_t new_fitness);
+void logger_post_pred_length_change_scheduled(logger_queue_t queue, int new_predictor_length, history_entry_t *state);
+void logger_post_pred_length_change_applied(logger_queue_t queue, int cgp_generation,
+    unsigned int old_length, unsigned int new_length,
+    unsigned int old_used_length, unsigned int new_used_length);
+void logger_post_timing(logger_queue_t queue, timing_totals_t *totals);
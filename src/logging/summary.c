@@ -63,6 +63,11 @@ static void handle_finished(logger_t logger, finish_reason_t reason, history_ent
 /* "destructor" */
 static void logger_summary_destruct(logger_t logger);
 
+/* helpers */
+static void print_archive_waits(FILE *fp, struct algo_data *work_data);
+static void print_fitness_cache(FILE *fp, struct algo_data *work_data);
+static void print_mutation_stats(FILE *fp, logger_t logger);
+
 
 /**
  * Create summarizing logger
@@ -124,6 +129,60 @@ static void handle_started(logger_t logger, history_entry_t *state)
 }
 
 
+/**
+ * Prints how long archive writers waited for readers
+ */
+static void print_archive_waits(FILE *fp, struct algo_data *work_data)
+{
+    if (work_data->cgp_archive == NULL || work_data->pred_archive == NULL) {
+        return;
+    }
+
+    fprintf(fp, "CGP archive publication wait: %.6f s (%ld times)\n",
+        work_data->cgp_archive->wait_time, work_data->cgp_archive->waits);
+    fprintf(fp, "Predictors archive publication wait: %.6f s (%ld times)\n\n",
+        work_data->pred_archive->wait_time, work_data->pred_archive->waits);
+}
+
+
+/**
+ * Prints how many CGP evaluations were avoided by fitness cache
+ */
+static void print_fitness_cache(FILE *fp, struct algo_data *work_data)
+{
+    fitness_cache_t cache = work_data->fitness_cache;
+    if (cache == NULL) {
+        return;
+    }
+
+    fprintf(fp, "Fitness cache hits: %ld of %ld lookups (%.2f %%)\n\n",
+        atomic_load(&cache->hits), atomic_load(&cache->lookups),
+        fitness_cache_hit_rate(cache) * 100);
+}
+
+
+/**
+ * Prints how many CGP mutations did not change the phenotype
+ */
+static void print_mutation_stats(FILE *fp, logger_t logger)
+{
+    cgp_mutation_stats_t stats;
+    cgp_get_mutation_stats(&stats);
+    if (stats.chromosomes == 0) {
+        return;
+    }
+
+    fprintf(fp, "CGP mutation: %s\n",
+        config_cgp_mutation_names[logger->config->cgp_mutation]);
+    fprintf(fp, "Neutral mutations: %ld of %ld chromosomes (%.2f %%)\n",
+        stats.neutral_chromosomes, stats.chromosomes,
+        (double) stats.neutral_chromosomes / stats.chromosomes * 100);
+    fprintf(fp, "Neutral / effective genes: %ld / %ld (ratio %.3f)\n\n",
+        stats.neutral_genes, stats.effective_genes,
+        stats.effective_genes? (double) stats.neutral_genes / stats.effective_genes : 0.0);
+}
+
+
 static void handle_finished(logger_t logger, finish_reason_t reason, history_entry_t *state,
     struct algo_data *work_data)
 {
@@ -164,6 +223,13 @@ static void handle_finished(logger_t logger, finish_reason_t reason, history_ent
             fclose(fp);
         }
 
+        SPRINTF_FILENAME("best_circuit.c");
+        fp = fopen(_buffer, "wt");
+        if (fp) {
+            cgp_dump_chr(circuit, fp, c_source);
+            fclose(fp);
+        }
+
         SPRINTF_FILENAME("summary.log");
         fp = fopen(_buffer, "wt");
         if (fp) {
@@ -172,6 +238,9 @@ static void handle_finished(logger_t logger, finish_reason_t reason, history_ent
             fprintf(fp, "Best fitness: " FITNESS_FMT "\n", circuit->fitness);
             fprintf(fp, "PSNR: %.2f\n", fitness_to_psnr(circuit->fitness));
             fprintf(fp, "CGP evaluations: %ld\n\n", state->cgp_evals);
+            print_fitness_cache(fp, work_data);
+            print_mutation_stats(fp, logger);
+            print_archive_waits(fp, work_data);
             fprintf(fp, "Time in user mode: %s\n", _usertime_str);
             fprintf(fp, "Wall clock: %s\n", _wallclock_str);
             fclose(fp);
@@ -195,6 +264,9 @@ static void handle_finished(logger_t logger, finish_reason_t reason, history_ent
         printf("Best fitness: " FITNESS_FMT "\n", circuit->fitness);
         printf("PSNR: %.2f\n", fitness_to_psnr(circuit->fitness));
         printf("CGP evaluations: %ld\n\n", state->cgp_evals);
+        print_fitness_cache(stdout, work_data);
+        print_mutation_stats(stdout, logger);
+        print_archive_waits(stdout, work_data);
         printf("Time in user mode: %s\n", _usertime_str);
         printf("Wall clock: %s\n", _wallclock_str);
     }
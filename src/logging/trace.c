@@ -0,0 +1,445 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+
+/* writer maps file in chunks of this size */
+#define TRACE_CHUNK_SIZE (4 << 20)
+
+/* maximal size of compressed record - flags and 7 varints */
+#define TRACE_MAX_RECORD_SIZE (1 + 7 * 10)
+
+
+struct trace {
+    int fd;
+    bool writable;
+    bool compressed;
+
+    /* mapped part of the file */
+    unsigned char *map;
+    size_t map_offset;
+    size_t map_size;
+
+    /* file offset of next record */
+    size_t pos;
+
+    /* reader only: file size */
+    size_t end;
+
+    /* previous record, compressed records are relative to it */
+    trace_record_t last;
+};
+
+
+/* varint coding ***************************************************************/
+
+
+static inline size_t _put_uvarint(unsigned char *buffer, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80) {
+        buffer[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buffer[n++] = value;
+    return n;
+}
+
+
+/**
+ * Decodes varint
+ * @return Number of bytes used, 0 if data ended prematurely
+ */
+static inline size_t _get_uvarint(const unsigned char *buffer, size_t available, uint64_t *value)
+{
+    *value = 0;
+    for (size_t n = 0; n < available && n < 10; n++) {
+        *value |= (uint64_t) (buffer[n] & 0x7F) << (7 * n);
+        if ((buffer[n] & 0x80) == 0) {
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+
+static inline uint64_t _zigzag(int64_t value)
+{
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+
+static inline int64_t _unzigzag(uint64_t value)
+{
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+
+static inline uint64_t _double_bits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+static inline double _bits_double(uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+/**
+ * Encodes record relative to previous one
+ * @return Number of bytes used
+ */
+static size_t _encode_record(unsigned char *buffer, trace_record_t *record, trace_record_t *last)
+{
+    size_t n = 0;
+    buffer[n++] = record->flags;
+    n += _put_uvarint(buffer + n, _zigzag((int64_t) record->generation - last->generation));
+    n += _put_uvarint(buffer + n, _double_bits(record->predicted_fitness) ^ _double_bits(last->predicted_fitness));
+    n += _put_uvarint(buffer + n, _double_bits(record->real_fitness) ^ _double_bits(last->real_fitness));
+    n += _put_uvarint(buffer + n, _double_bits(record->active_predictor_fitness) ^ _double_bits(last->active_predictor_fitness));
+    n += _put_uvarint(buffer + n, _zigzag((int64_t) record->pred_length - last->pred_length));
+    n += _put_uvarint(buffer + n, _zigzag((int64_t) record->pred_used_length - last->pred_used_length));
+    n += _put_uvarint(buffer + n, _zigzag(record->cgp_evals - last->cgp_evals));
+    return n;
+}
+
+
+/**
+ * Decodes record relative to previous one
+ * @return Number of bytes used, 0 if data ended prematurely
+ */
+static size_t _decode_record(const unsigned char *buffer, size_t available, trace_record_t *record, trace_record_t *last)
+{
+    uint64_t fields[7];
+    size_t n = 1;
+
+    if (available < 1) {
+        return 0;
+    }
+
+    for (int i = 0; i < 7; i++) {
+        size_t used = _get_uvarint(buffer + n, available - n, &fields[i]);
+        if (used == 0) {
+            return 0;
+        }
+        n += used;
+    }
+
+    record->flags = buffer[0];
+    record->generation = last->generation + _unzigzag(fields[0]);
+    record->predicted_fitness = _bits_double(_double_bits(last->predicted_fitness) ^ fields[1]);
+    record->real_fitness = _bits_double(_double_bits(last->real_fitness) ^ fields[2]);
+    record->active_predictor_fitness = _bits_double(_double_bits(last->active_predictor_fitness) ^ fields[3]);
+    record->pred_length = last->pred_length + _unzigzag(fields[4]);
+    record->pred_used_length = last->pred_used_length + _unzigzag(fields[5]);
+    record->cgp_evals = last->cgp_evals + _unzigzag(fields[6]);
+    return n;
+}
+
+
+/* writing *********************************************************************/
+
+
+/**
+ * Makes sure next `size` bytes starting at current position are mapped,
+ * extends the file if needed
+ * @return 0 on success
+ */
+static int _trace_map(trace_t trace, size_t size)
+{
+    if (trace->map && trace->pos + size <= trace->map_offset + trace->map_size) {
+        return 0;
+    }
+
+    if (trace->map) {
+        munmap(trace->map, trace->map_size);
+        trace->map = NULL;
+    }
+
+    // mapping must start at page boundary
+    size_t page = sysconf(_SC_PAGESIZE);
+    trace->map_offset = trace->pos - trace->pos % page;
+    trace->map_size = TRACE_CHUNK_SIZE;
+
+    if (ftruncate(trace->fd, trace->map_offset + trace->map_size) != 0) {
+        perror("trace");
+        return -1;
+    }
+
+    void *map = mmap(NULL, trace->map_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED, trace->fd, trace->map_offset);
+    if (map == MAP_FAILED) {
+        perror("trace");
+        return -1;
+    }
+
+    trace->map = (unsigned char *) map;
+    return 0;
+}
+
+
+/**
+ * Finds end of valid records of existing trace, records of generations
+ * after `last_generation` are considered invalid
+ * @return 0 if the trace can be appended to
+ */
+static int _trace_find_end(const char *filename, bool compressed,
+    int32_t last_generation, size_t *pos, trace_record_t *last)
+{
+    trace_t reader = trace_open(filename);
+    if (reader == NULL) {
+        return -1;
+    }
+
+    int retval = -1;
+    if (reader->compressed == compressed) {
+        trace_record_t record;
+        *pos = reader->pos;
+        *last = reader->last;
+        while ((retval = trace_read(reader, &record)) > 0) {
+            if (last_generation >= 0 && record.generation > last_generation) {
+                retval = 0;
+                break;
+            }
+            *pos = reader->pos;
+            *last = reader->last;
+        }
+    }
+
+    trace_close(reader);
+    return retval;
+}
+
+
+/**
+ * Opens trace file for writing
+ *
+ * If `append` is set and the file is valid trace of the same kind, new
+ * records are appended after existing ones. Records of generations after
+ * `last_generation` (e.g. written after checkpoint the run is resumed
+ * from) are removed first. Otherwise the file is truncated.
+ *
+ * @param  filename
+ * @param  compressed Whether to use delta/varint compression
+ * @param  append
+ * @param  last_generation Last kept generation, negative to keep all
+ * @return trace or NULL on failure
+ */
+trace_t trace_create(const char *filename, bool compressed, bool append,
+    int32_t last_generation)
+{
+    trace_t trace = (trace_t) calloc(1, sizeof(struct trace));
+    if (trace == NULL) {
+        return NULL;
+    }
+
+    trace->writable = true;
+    trace->compressed = compressed;
+
+    if (append && _trace_find_end(filename, compressed, last_generation,
+            &trace->pos, &trace->last) == 0)
+    {
+        trace->fd = open(filename, O_RDWR);
+
+        // nothing may follow appended records if we crash
+        if (trace->fd >= 0 && ftruncate(trace->fd, trace->pos) != 0) {
+            perror(filename);
+            close(trace->fd);
+            trace->fd = -1;
+        }
+
+    } else {
+        append = false;
+        trace->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+
+    if (trace->fd < 0) {
+        perror(filename);
+        free(trace);
+        return NULL;
+    }
+
+    if (!append) {
+        trace_header_t header = {
+            .version = TRACE_VERSION,
+            .compressed = compressed,
+            .record_size = sizeof(trace_record_t),
+        };
+        memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+
+        if (_trace_map(trace, sizeof(header)) != 0) {
+            trace_close(trace);
+            return NULL;
+        }
+        memcpy(trace->map + trace->pos - trace->map_offset, &header, sizeof(header));
+        trace->pos += sizeof(header);
+    }
+
+    return trace;
+}
+
+
+/**
+ * Appends record to trace
+ * @param  trace
+ * @param  record
+ * @return 0 on success
+ */
+int trace_append(trace_t trace, trace_record_t *record)
+{
+    trace_record_t current = *record;
+    current.flags |= TRACE_VALID;
+    if (!(current.flags & TRACE_REAL_MEASURED)) {
+        current.real_fitness = trace->last.real_fitness;
+    }
+
+    size_t size = trace->compressed? TRACE_MAX_RECORD_SIZE : sizeof(trace_record_t);
+    if (_trace_map(trace, size) != 0) {
+        return -1;
+    }
+
+    unsigned char *target = trace->map + trace->pos - trace->map_offset;
+    if (trace->compressed) {
+        size = _encode_record(target, &current, &trace->last);
+    } else {
+        memcpy(target, &current, sizeof(trace_record_t));
+    }
+
+    trace->pos += size;
+    trace->last = current;
+    return 0;
+}
+
+
+/**
+ * Truncates trace file to written size and closes it
+ * @param trace
+ */
+void trace_close(trace_t trace)
+{
+    if (trace->map) {
+        munmap(trace->map, trace->map_size);
+    }
+
+    if (trace->writable && ftruncate(trace->fd, trace->pos) != 0) {
+        perror("trace");
+    }
+
+    close(trace->fd);
+    free(trace);
+}
+
+
+/* reading *********************************************************************/
+
+
+/**
+ * Opens trace file for reading
+ * @param  filename
+ * @return trace or NULL on failure
+ */
+trace_t trace_open(const char *filename)
+{
+    trace_t trace = (trace_t) calloc(1, sizeof(struct trace));
+    if (trace == NULL) {
+        return NULL;
+    }
+
+    trace->fd = open(filename, O_RDONLY);
+    if (trace->fd < 0) {
+        free(trace);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(trace->fd, &st) != 0 || (size_t) st.st_size < sizeof(trace_header_t)) {
+        trace_close(trace);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, trace->fd, 0);
+    if (map == MAP_FAILED) {
+        trace_close(trace);
+        return NULL;
+    }
+    trace->map = (unsigned char *) map;
+    trace->map_size = st.st_size;
+    trace->end = st.st_size;
+
+    trace_header_t header;
+    memcpy(&header, trace->map, sizeof(header));
+    if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TRACE_VERSION
+        || header.record_size != sizeof(trace_record_t))
+    {
+        trace_close(trace);
+        return NULL;
+    }
+
+    trace->compressed = header.compressed;
+    trace->pos = sizeof(header);
+    return trace;
+}
+
+
+/**
+ * Reads next record
+ * @param  trace
+ * @param  record
+ * @return 1 if record was read, 0 at the end of trace
+ */
+int trace_read(trace_t trace, trace_record_t *record)
+{
+    size_t available = trace->end - trace->pos;
+    const unsigned char *source = trace->map + trace->pos;
+
+    size_t size = 0;
+    if (trace->compressed) {
+        size = _decode_record(source, available, record, &trace->last);
+    } else if (available >= sizeof(trace_record_t)) {
+        size = sizeof(trace_record_t);
+        memcpy(record, source, size);
+    }
+
+    // incomplete record, or zero flags - unused space after crashed writer
+    if (size == 0 || !(record->flags & TRACE_VALID)) {
+        return 0;
+    }
+
+    trace->pos += size;
+    trace->last = *record;
+    return 1;
+}
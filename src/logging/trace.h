@@ -0,0 +1,123 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+    Binary per-generation trace
+
+    File starts with `trace_header_t`, followed by records. Records are
+    either stored as they are (`trace_record_t`), or compressed - each
+    field is stored as varint of difference to previous record (fitness
+    values as XOR of their bit patterns). Every record starts with non-zero
+    flags, so zero-filled tail left by crashed writer marks end of data.
+ */
+
+
+#define TRACE_MAGIC "COCOTRAC"
+#define TRACE_VERSION 1
+
+/* record is valid, always set */
+#define TRACE_VALID 0x01
+
+/* real fitness was calculated in this generation, otherwise it is copied
+   from previous record */
+#define TRACE_REAL_MEASURED 0x02
+
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t compressed;
+    uint32_t record_size;
+    uint32_t reserved;
+} trace_header_t;
+
+
+typedef struct {
+    int32_t generation;
+    uint32_t flags;
+    double predicted_fitness;
+    double real_fitness;
+    double active_predictor_fitness;
+    int32_t pred_length;
+    int32_t pred_used_length;
+    int64_t cgp_evals;
+} trace_record_t;
+
+
+struct trace;
+typedef struct trace *trace_t;
+
+
+/**
+ * Opens trace file for writing
+ *
+ * If `append` is set and the file is valid trace of the same kind, new
+ * records are appended after existing ones. Records of generations after
+ * `last_generation` (e.g. written after checkpoint the run is resumed
+ * from) are removed first. Otherwise the file is truncated.
+ *
+ * @param  filename
+ * @param  compressed Whether to use delta/varint compression
+ * @param  append
+ * @param  last_generation Last kept generation, negative to keep all
+ * @return trace or NULL on failure
+ */
+trace_t trace_create(const char *filename, bool compressed, bool append,
+    int32_t last_generation);
+
+
+/**
+ * Appends record to trace
+ * @param  trace
+ * @param  record
+ * @return 0 on success
+ */
+int trace_append(trace_t trace, trace_record_t *record);
+
+
+/**
+ * Truncates trace file to written size and closes it
+ * @param trace
+ */
+void trace_close(trace_t trace);
+
+
+/**
+ * Opens trace file for reading
+ * @param  filename
+ * @return trace or NULL on failure
+ */
+trace_t trace_open(const char *filename);
+
+
+/**
+ * Reads next record
+ * @param  trace
+ * @param  record
+ * @return 1 if record was read, 0 at the end of trace
+ */
+int trace_read(trace_t trace, trace_record_t *record);
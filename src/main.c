@@ -37,6 +37,9 @@
 #include "config.h"
 #include "cgp/cgp.h"
 #include "fitness.h"
+#include "farm.h"
+#include "checkpoint.h"
+#include "sweep.h"
 #include "archive.h"
 #include "predictors.h"
 
@@ -48,10 +51,14 @@ static config_t config = {
     .max_generations = 50000,
     .target_fitness = 0,
     .algorithm = predictors,
+    .async_evolution = false,
 
     .cgp_mutate_genes = 5,
+    .cgp_mutation = mutation_point,
+    .cgp_functions = CGP_FUNC_SET_DEFAULT,
     .cgp_population_size = 8,
     .cgp_archive_size = 10,
+    .fitness_cache_size = 65536,
 
     .pred_size = 0.25,
     .pred_initial_size = 0,
@@ -60,6 +67,7 @@ static config_t config = {
     .pred_offspring_elite = 0.25,
     .pred_offspring_combine = 0.5,
     .pred_genome_type = permuted,
+    .pred_phenotype = gathered,
 
     .bw_interval = 0,
     .bw_config = {
@@ -84,12 +92,25 @@ static config_t config = {
 
     .log_interval = 0,
     .log_dir = "",
+
+    .workers = 0,
+    .sched_interval = 100,
+
+    .islands = 1,
+    .island_id = 0,
+    .migration_interval = 100,
+    .island_name = "coco",
+
+    .checkpoint_interval = 10000,
 };
 
 
 // predictor evolution settings and current state
 static pred_metadata_t pred_metadata;
 
+// preprocessed images
+static fitness_data_t fitness_data;
+
 // algorithm working data
 // everything else is statically initialized to NULL
 static algo_data_t work_data = {
@@ -156,6 +177,26 @@ int main(int argc, char *argv[])
         config_ok = false;
     }
 
+    // training data are shared by all sweep jobs, so prepare them first
+    if (config_ok && fitness_prepare_data(&fitness_data,
+            work_data.img_original, work_data.img_noisy) != 0)
+    {
+        fprintf(stderr, "Failed to prepare training data.\n");
+        config_ok = false;
+    }
+
+    // sweep - only child processes continue, each with its own job
+    if (config_ok && strlen(config.sweep_file)) {
+        int job = sweep_run(config.sweep_file, config.sweep_jobs, &config, argv[0]);
+        if (job < 0) {
+            fitness_destroy_data(&fitness_data);
+            img_destroy(work_data.img_original);
+            img_destroy(work_data.img_noisy);
+            logger_destroy_list(&work_data.loggers);
+            return job == SWEEP_DONE? 0 : 1;
+        }
+    }
+
     if (strlen(config.log_dir)) {
         int create_dir_retval = create_dir(config.log_dir);
         if (create_dir_retval != 0) {
@@ -200,29 +241,92 @@ int main(int argc, char *argv[])
         omp_set_nested(true);
     #endif
 
+    // split workers between cgp and predictors
+    sched_init(&work_data.scheduler, config.workers, config.sched_interval,
+        config.algorithm != simple_cgp);
+    config.workers = work_data.scheduler.workers;
+
+    if (ga_init_workers(config.workers) != 0) {
+        fprintf(stderr, "Failed to start worker threads.\n");
+        return 1;
+    }
+
     // random number generator
     rand_init_seed(config.random_seed);
 
+    // evaluation worker mode - no evolution, just serve master
+    if (strlen(config.worker_socket)) {
+        cgp_init(config.cgp_mutate_genes, fitness_eval_cgp);
+        fitness_init(&fitness_data, NULL, NULL);
+
+        retval = farm_worker_run(config.worker_socket);
+
+        cgp_deinit();
+        fitness_deinit();
+        fitness_destroy_data(&fitness_data);
+        ga_deinit_workers();
+        img_destroy(work_data.img_original);
+        img_destroy(work_data.img_noisy);
+        logger_destroy_list(&work_data.loggers);
+        return retval;
+    }
+
+    // real CGP fitness is evaluated either locally or by the farm
+    ga_fitness_func_t cgp_fitness = fitness_eval_cgp;
+    if (strlen(config.farm_sockets)) {
+        if (farm_connect(config.farm_sockets) != 0) {
+            fprintf(stderr, "Failed to connect to evaluation farm.\n");
+            return 1;
+        }
+        cgp_fitness = farm_eval_cgp;
+    }
+
+    // circuits with the same active phenotype have the same fitness
+    if (config.fitness_cache_size > 0) {
+        work_data.fitness_cache = fitness_cache_create(config.fitness_cache_size);
+        if (work_data.fitness_cache == NULL) {
+            fprintf(stderr, "Failed to initialize fitness cache.\n");
+            return 1;
+        }
+    }
+
     // cgp evolution
-    cgp_init(config.cgp_mutate_genes, fitness_eval_or_predict_cgp);
+    // (without predictors archive, real fitness is evaluated locally
+    // and memoized, farm evaluates it remotely)
+    bool use_farm_fitness = config.algorithm == simple_cgp && strlen(config.farm_sockets);
+    cgp_init(config.cgp_mutate_genes, use_farm_fitness?
+        cgp_fitness : fitness_eval_or_predict_cgp);
+    cgp_set_mutation(config.cgp_mutation);
+    cgp_set_functions(config.cgp_functions);
 
     // predictors population and both archives
     if (config.algorithm != simple_cgp) {
 
         // calculate absolute predictors sizes
+        // (in genes - for tiled genotype one gene covers whole tile)
         int img_size = work_data.img_original->width * work_data.img_original->height;
-        int pred_min_size = config.pred_min_size * img_size;
-        int pred_max_size = config.pred_size * img_size;
+        bool is_tiled = (config.pred_genome_type == tiled || config.pred_genome_type == tiled_circular);
+        int gene_pixels = is_tiled? PRED_TILE_SIZE : 1;
+        int gene_count = (img_size + gene_pixels - 1) / gene_pixels;
+        int pred_min_size = config.pred_min_size * gene_count;
+        int pred_max_size = config.pred_size * gene_count;
         int pred_initial_size;
 
         // allow to set different initial size only for baldwin or circular genotype
-        bool is_circular = (config.pred_genome_type == circular);
+        bool is_circular = (config.pred_genome_type == circular || config.pred_genome_type == tiled_circular);
         if (config.pred_initial_size && (config.algorithm == baldwin || is_circular)) {
-            pred_initial_size = config.pred_initial_size * img_size;
+            pred_initial_size = config.pred_initial_size * gene_count;
         } else {
             pred_initial_size = pred_max_size;
         }
 
+        if (pred_max_size < 1) {
+            pred_max_size = 1;
+        }
+        if (pred_initial_size < 1) {
+            pred_initial_size = 1;
+        }
+
         if (config.algorithm == baldwin) {
 
             // baldwin thresholds
@@ -238,11 +342,11 @@ int main(int argc, char *argv[])
                 config.bw_config.increase_fast_increment = pred_max_size * config.bw_increase_fast_increment_percent;
 
                 printf("Absolute increments are:\n"
-                    "Base: %d pixels\n"
-                    "Zero: %d pixels\n"
-                    "Decrease: %d pixels\n"
-                    "Slow increase: %d pixels\n"
-                    "Fast increase: %d pixels\n",
+                    "Base: %d genes\n"
+                    "Zero: %d genes\n"
+                    "Decrease: %d genes\n"
+                    "Slow increase: %d genes\n"
+                    "Fast increase: %d genes\n",
                     config.bw_config.absolute_increment_base,
                     config.bw_config.zero_increment,
                     config.bw_config.decrease_increment,
@@ -253,7 +357,9 @@ int main(int argc, char *argv[])
         }
 
         pred_metadata.genome_type = config.pred_genome_type;
-        pred_metadata.max_gene_value = img_size - 1;
+        pred_metadata.phenotype = config.pred_phenotype;
+        pred_metadata.max_gene_value = gene_count - 1;
+        pred_metadata.image_size = img_size;
         pred_metadata.genotype_length = pred_max_size;
         pred_metadata.genotype_used_length = pred_initial_size;
         pred_metadata.mutation_rate = config.pred_mutation_rate;
@@ -268,9 +374,12 @@ int main(int argc, char *argv[])
             .alloc_genome = cgp_alloc_genome,
             .free_genome = cgp_free_genome,
             .copy_genome = cgp_copy_genome,
-            .fitness = fitness_eval_cgp,
+            .fitness = cgp_fitness,
+            .phenotype_hash = cgp_phenotype_hash,
+            .fitness_cache = work_data.fitness_cache,
         };
-        work_data.cgp_archive = arc_create(config.cgp_archive_size, arc_cgp_methods, CGP_PROBLEM_TYPE);
+        work_data.cgp_archive = arc_create(config.cgp_archive_size, 1,
+            arc_cgp_methods, CGP_PROBLEM_TYPE);
         if (work_data.cgp_archive == NULL) {
             fprintf(stderr, "Failed to initialize CGP archive.\n");
             return 1;
@@ -283,16 +392,33 @@ int main(int argc, char *argv[])
             .copy_genome = pred_copy_genome,
             .fitness = NULL,
         };
-        work_data.pred_archive = arc_create(1, arc_pred_methods, PRED_PROBLEM_TYPE);
+        // each asynchronous CGP worker holds its own view
+        int pred_readers = config.async_evolution? config.workers : 1;
+        work_data.pred_archive = arc_create(1, pred_readers,
+            arc_pred_methods, PRED_PROBLEM_TYPE);
         if (work_data.pred_archive == NULL) {
             fprintf(stderr, "Failed to initialize predictors archive.\n");
             return 1;
         }
     }
 
+    // island group
+    if (config.islands > 1) {
+        size_t payload_sizes[ISLAND_CHANNELS] = {
+            [island_cgp] = sizeof(struct cgp_genome),
+            [island_pred] = config.algorithm != simple_cgp? pred_serialized_size() : 0,
+        };
+        work_data.island = island_create(config.island_name, config.islands,
+            config.island_id, payload_sizes);
+        if (work_data.island == NULL) {
+            fprintf(stderr, "Failed to join island group.\n");
+            return 1;
+        }
+    }
+
     // fitness function
-    fitness_init(work_data.img_original, work_data.img_noisy,
-        work_data.cgp_archive, work_data.pred_archive);
+    fitness_init(&fitness_data, work_data.cgp_archive, work_data.pred_archive);
+    fitness_set_cache(work_data.fitness_cache);
 
     /*
         Populations initialization
@@ -337,14 +463,56 @@ int main(int argc, char *argv[])
     printf("Configuration:\n");
     config_save_file(stdout, &config);
 
-    ga_evaluate_pop(work_data.cgp_population);
+    if (strlen(config.resume_file)) {
+        // everything including PRNG state is restored
+        if (checkpoint_load(config.resume_file, &work_data) != 0) {
+            fprintf(stderr, "Failed to resume evolution.\n");
+            return 1;
+        }
+        printf("Resuming from generation %d.\n", work_data.cgp_population->generation);
+
+    } else if (config.algorithm == simple_cgp) {
+        ga_evaluate_pop(work_data.cgp_population);
 
-    if (config.algorithm != simple_cgp) {
+    } else {
+        // predictors archive is still empty, real fitness is used
+        arc_read_begin(work_data.pred_archive);
+        ga_evaluate_pop(work_data.cgp_population);
+        arc_read_end(work_data.pred_archive);
         arc_insert(work_data.cgp_archive, work_data.cgp_population->best_chromosome);
+
+        arc_read_begin(work_data.cgp_archive);
         ga_evaluate_pop(work_data.pred_population);
+        arc_read_end(work_data.cgp_archive);
         arc_insert(work_data.pred_archive, work_data.pred_population->best_chromosome);
     }
 
+    if (strlen(config.checkpoint_file)) {
+        work_data.checkpoint = checkpoint_create(config.checkpoint_file);
+        if (work_data.checkpoint == NULL) {
+            fprintf(stderr, "Failed to start checkpoint writer.\n");
+            return 1;
+        }
+    }
+
+    if (strlen(config.trace_file)) {
+        // records written after the checkpoint are dropped
+        work_data.trace = trace_create(config.trace_file, config.trace_compress,
+            strlen(config.resume_file) > 0, work_data.cgp_population->generation);
+        if (work_data.trace == NULL) {
+            fprintf(stderr, "Failed to create trace file.\n");
+            return 1;
+        }
+    }
+
+    // from now on, logs are written by separate thread
+    if (!config.log_sync) {
+        if (logger_start_thread(&work_data.loggers) != 0) {
+            fprintf(stderr, "Failed to start logging thread.\n");
+            return 1;
+        }
+    }
+
     /*
         Evolution itself
      */
@@ -380,6 +548,22 @@ int main(int argc, char *argv[])
     }
 
 
+    // summary logger needs populations and fitness module
+    logger_stop_thread(&work_data.loggers);
+
+    if (work_data.trace) {
+        trace_close(work_data.trace);
+    }
+
+    // final state, also when terminated by signal
+    if (work_data.checkpoint) {
+        if (checkpoint_save(work_data.checkpoint, &work_data) != 0) {
+            fprintf(stderr, "Failed to save checkpoint.\n");
+        }
+        checkpoint_destroy(work_data.checkpoint);
+    }
+
+
     /*
         Clean-up
      */
@@ -394,6 +578,17 @@ int main(int argc, char *argv[])
     }
     cgp_deinit();
     fitness_deinit();
+    fitness_destroy_data(&fitness_data);
+    fitness_cache_destroy(work_data.fitness_cache);
+    ga_deinit_workers();
+
+    if (strlen(config.farm_sockets)) {
+        farm_disconnect();
+    }
+
+    if (work_data.island) {
+        island_destroy(work_data.island);
+    }
 
     img_destroy(work_data.img_original);
     img_destroy(work_data.img_noisy);
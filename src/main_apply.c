@@ -47,6 +47,9 @@ const char* help =
     "To apply filter:\n"
     "    ./coco_apply --chromosome filter.chr --input noisy.png --output clean.png\n"
     "\n"
+    "To generate C source of filter:\n"
+    "    ./coco_apply --chromosome filter.chr --emit-c filter.c\n"
+    "\n"
     "Various input formats are supported. Output image will always be in PNG file format.\n"
     "\n"
     "Command line options:\n"
@@ -59,7 +62,12 @@ const char* help =
     "    --input FILE, -i FILE\n"
     "          Input image filename\n"
     "    --output FILE, -o FILE\n"
-    "          Output image filename\n";
+    "          Output image filename\n"
+    "\n"
+    "Optional:\n"
+    "    --emit-c FILE, -e FILE\n"
+    "          Write self-contained C source of the filter to FILE. If no\n"
+    "          input image is given, only the source is written.\n";
 
 
 /******************************************************************************/
@@ -73,16 +81,18 @@ int main(int argc, char *argv[])
         {"chromosome", required_argument, 0, 'c'},
         {"input", required_argument, 0, 'i'},
         {"output", required_argument, 0, 'o'},
+        {"emit-c", required_argument, 0, 'e'},
 
         {0, 0, 0, 0}
     };
 
-    static const char *short_options = "hc:i:o:";
+    static const char *short_options = "hc:i:o:e:";
 
     img_image_t input_image = NULL;
     img_window_array_t input_image_windows = NULL;
     img_image_t output_image = NULL;
     FILE *output_image_file = NULL;
+    FILE *source_file = NULL;
     ga_chr_t chromosome = ga_alloc_chr(cgp_alloc_genome);
     bool chromosome_loaded = false;
     if (!chromosome) {
@@ -114,6 +124,14 @@ int main(int argc, char *argv[])
                 output_image_file = fopen(optarg, "wb");
                 break;
 
+            case 'e':
+                source_file = fopen(optarg, "wt");
+                if (!source_file) {
+                    fprintf(stderr, "Failed to open C source file for writing.\n");
+                    return 1;
+                }
+                break;
+
             case 'c':
                 chromosome_file = fopen(optarg, "r");
                 if (!chromosome_file) {
@@ -132,6 +150,23 @@ int main(int argc, char *argv[])
         }
     }
 
+    /*
+        Generate C source
+     */
+    if (source_file) {
+        if (!chromosome_loaded) {
+            fprintf(stderr, "Failed to load chromosome or no file given.\n");
+            return 1;
+        }
+
+        cgp_dump_chr(chromosome, source_file, c_source);
+        fclose(source_file);
+
+        if (!input_image && !output_image_file) {
+            return 0;
+        }
+    }
+
     /*
         Check args
      */
@@ -166,12 +201,16 @@ int main(int argc, char *argv[])
         Filter image
     */
 
+    cgp_program_t program;
+    cgp_program_build(&program, chromosome);
+    cgp_program_collapse_luts(&program, CGP_LUT_MIN_LENGTH_SCALAR);
+
     for (int i = 0; i < input_image_windows->size; i++) {
         img_window_t *w = &input_image_windows->windows[i];
 
         cgp_value_t *inputs = w->pixels;
         cgp_value_t output_pixel;
-        cgp_get_output(chromosome, inputs, &output_pixel);
+        cgp_program_output(&program, inputs, &output_pixel);
 
         img_set_pixel(output_image, w->pos_x, w->pos_y, output_pixel);
     }
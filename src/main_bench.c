@@ -0,0 +1,918 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "cpu.h"
+#include "ga.h"
+#include "random.h"
+#include "image.h"
+#include "fitness.h"
+#include "archive.h"
+#include "predictors.h"
+#include "cgp/cgp.h"
+#include "cgp/cgp_sse.h"
+#include "cgp/cgp_avx.h"
+
+
+/* internal evaluators of fitness.c, not part of its public interface */
+double _fitness_get_sqdiffsum_scalar(ga_chr_t chr);
+double _fitness_get_sqdiffsum_simd(ga_chr_t chr, img_pixel_t *original,
+    img_pixel_t *noisy[WINDOW_SIZE], int data_length);
+
+
+const char* help =
+    "Colearning in Coevolutionary Algorithms\n"
+    "Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>\n"
+    "\n"
+    "Master Thesis\n"
+    "2014/2015\n"
+    "\n"
+    "Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>\n"
+    "\n"
+    "Faculty of Information Technologies\n"
+    "Brno University of Technology\n"
+    "http://www.fit.vutbr.cz/\n"
+    "     _       _\n"
+    "  __(.)=   =(.)__\n"
+    "  \\___)     (___/\n"
+    "\n"
+    "\n"
+    "To run all benchmarks:\n"
+    "    ./coco_bench --format json --output bench.json\n"
+    "\n"
+    "Each result row contains group, benchmark name, variant (evaluator\n"
+    "or algorithm), problem size, measured value and its unit.\n"
+    "\n"
+    "Command line options:\n"
+    "    --help, -h\n"
+    "          Show this help and exit\n"
+    "\n"
+    "Output:\n"
+    "    --format FORMAT, -f FORMAT\n"
+    "          Output format, one of \"csv\" (default) or \"json\"\n"
+    "    --output FILE, -o FILE\n"
+    "          Output filename, default is standard output\n"
+    "\n"
+    "Benchmarks:\n"
+    "    --group GROUP, -g GROUP\n"
+    "          Run only given group, one of \"micro\" (single CGP functions),\n"
+    "          \"kernel\" (fitness kernels), \"predictor\" (predictor operators),\n"
+    "          \"e2e\" (whole evolution) or \"all\" (default)\n"
+    "    --min-time SECONDS, -t SECONDS\n"
+    "          Minimal duration of single measurement, default is 0.5\n"
+    "    --workers NUM, -w NUM\n"
+    "          Number of threads used by fitness kernels, default is 1\n"
+    "    --seed NUM, -s NUM\n"
+    "          PRNG seed value, default is 1\n"
+    "\n"
+    "End-to-end benchmarks:\n"
+    "    --coco FILE, -c FILE\n"
+    "          Path to coco executable, default is ./coco\n"
+    "    --input FILE, -i FILE\n"
+    "          Original image, default is ../images/lena_gray_256.png\n"
+    "    --noisy FILE, -n FILE\n"
+    "          Noisy image, default is ../images/lena_gray_256_saltpepper.png\n"
+    "    --generations NUM, -G NUM\n"
+    "          Number of CGP generations of each run, default is 500\n";
+
+
+/* image sizes used by kernel and predictor benchmarks */
+static const int BENCH_IMAGE_SIZES[] = { 64, 256, 512 };
+#define BENCH_IMAGE_SIZES_COUNT (sizeof(BENCH_IMAGE_SIZES) / sizeof(int))
+
+/* predictor sizes used by predictor benchmarks, relative to image size */
+static const double BENCH_PRED_SIZES[] = { 0.05, 0.25, 1.0 };
+#define BENCH_PRED_SIZES_COUNT (sizeof(BENCH_PRED_SIZES) / sizeof(double))
+
+/* image size used by predictor benchmarks */
+static const int BENCH_PRED_IMAGE_SIZE = 256;
+
+/* algorithms compared by end-to-end benchmarks */
+static const char *BENCH_ALGORITHMS[] = { "cgp", "coev", "baldwin" };
+#define BENCH_ALGORITHMS_COUNT (sizeof(BENCH_ALGORITHMS) / sizeof(char*))
+
+
+typedef enum {
+    bench_csv,
+    bench_json,
+} bench_format_t;
+
+
+typedef struct {
+    bench_format_t format;
+    FILE *output;
+    double min_time;
+    int workers;
+    unsigned int seed;
+
+    bool run_micro;
+    bool run_kernel;
+    bool run_predictor;
+    bool run_e2e;
+
+    char *coco;
+    char *input_image;
+    char *noisy_image;
+    int generations;
+
+    /* number of already reported rows */
+    int rows;
+} bench_config_t;
+
+
+/* single measured operation */
+typedef void (*bench_func_t)(void *data);
+
+
+/******************************************************************************/
+
+
+/**
+ * Returns monotonic time in seconds
+ */
+static double _bench_now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+/**
+ * Repeatedly calls given function until minimal time elapses
+ *
+ * The number of calls is doubled in each round, so the clock is not
+ * read too often for very short operations.
+ *
+ * @param  cfg
+ * @param  func
+ * @param  data
+ * @return Calls per second
+ */
+static double _bench_measure(bench_config_t *cfg, bench_func_t func, void *data)
+{
+    // warm up caches and branch predictors
+    func(data);
+
+    long calls = 0;
+    long batch = 1;
+    double start = _bench_now();
+    double elapsed;
+
+    do {
+        for (long i = 0; i < batch; i++) {
+            func(data);
+        }
+        calls += batch;
+        batch *= 2;
+        elapsed = _bench_now() - start;
+    } while (elapsed < cfg->min_time);
+
+    return calls / elapsed;
+}
+
+
+/**
+ * Writes output header
+ * @param cfg
+ */
+static void _bench_begin(bench_config_t *cfg)
+{
+    if (cfg->format == bench_csv) {
+        fprintf(cfg->output, "group,name,variant,size,value,unit\n");
+    } else {
+        fprintf(cfg->output, "{\n  \"results\": [");
+    }
+    fflush(cfg->output);
+}
+
+
+/**
+ * Writes single result row
+ * @param cfg
+ * @param group
+ * @param name
+ * @param variant
+ * @param size
+ * @param value
+ * @param unit
+ */
+static void _bench_report(bench_config_t *cfg, const char *group,
+    const char *name, const char *variant, long size, double value,
+    const char *unit)
+{
+    if (cfg->format == bench_csv) {
+        fprintf(cfg->output, "%s,%s,%s,%ld,%.4f,%s\n",
+            group, name, variant, size, value, unit);
+    } else {
+        fprintf(cfg->output, "%s\n    {\"group\": \"%s\", \"name\": \"%s\", "
+            "\"variant\": \"%s\", \"size\": %ld, \"value\": %.4f, "
+            "\"unit\": \"%s\"}",
+            cfg->rows? "," : "", group, name, variant, size, value, unit);
+    }
+    fflush(cfg->output);
+    cfg->rows++;
+}
+
+
+/**
+ * Writes output footer
+ * @param cfg
+ */
+static void _bench_end(bench_config_t *cfg)
+{
+    if (cfg->format == bench_json) {
+        fprintf(cfg->output, "\n  ]\n}\n");
+    }
+}
+
+
+/**
+ * Creates random grayscale image and its noisy copy corrupted by
+ * salt-and-pepper noise
+ * @return 0 on success
+ */
+static int _bench_create_images(int size, img_image_t *original,
+    img_image_t *noisy)
+{
+    *original = img_create(size, size, 1);
+    *noisy = img_create(size, size, 1);
+    if (*original == NULL || *noisy == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < size * size; i++) {
+        img_pixel_t value = rand_range(0, 255);
+        (*original)->data[i] = value;
+
+        int noise = rand_range(0, 9);
+        (*noisy)->data[i] = noise == 0? 0 : noise == 1? 255 : value;
+    }
+    return 0;
+}
+
+
+/* CGP function microbenchmarks ***********************************************/
+
+
+/**
+ * Builds chromosome of which all nodes are active and compute given
+ * function - each node is connected to two nodes in previous column
+ * @param chr
+ * @param function
+ */
+static void _bench_build_chain(ga_chr_t chr, cgp_func_t function)
+{
+    cgp_genome_t genome = (cgp_genome_t) chr->genome;
+
+    for (int x = 0; x < CGP_COLS; x++) {
+        for (int y = 0; y < CGP_ROWS; y++) {
+            cgp_node_t *n = &genome->nodes[cgp_node_index(x, y)];
+            n->function = function;
+            for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+                if (x == 0) {
+                    n->inputs[k] = (y + k * CGP_ROWS) % CGP_INPUTS;
+                } else {
+                    n->inputs[k] = CGP_INPUTS + cgp_node_index(x - 1, (y + k) % CGP_ROWS);
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        genome->outputs[i] = CGP_INPUTS + CGP_NODES - 1 - i;
+    }
+
+    cgp_find_active_blocks(chr);
+}
+
+
+/**
+ * Translates active nodes 1:1 into evaluation program, without any
+ * simplification, so every node of the chain is really evaluated
+ * @param program
+ * @param chr
+ */
+static void _bench_chain_program(cgp_program_t *program, ga_chr_t chr)
+{
+    cgp_genome_t genome = (cgp_genome_t) chr->genome;
+    int slots[CGP_INPUTS + CGP_NODES];
+    for (int i = 0; i < CGP_INPUTS; i++) {
+        slots[i] = i;
+    }
+
+    program->length = 0;
+    program->constants_count = 0;
+    program->luts_count = 0;
+    for (int i = 0; i < CGP_NODES; i++) {
+        cgp_node_t *n = &(genome->nodes[i]);
+        if (!cgp_node_is_active(genome, i)) continue;
+
+        cgp_instr_t *instr = &program->instrs[program->length];
+        instr->function = n->function;
+        instr->lut = -1;
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            instr->inputs[k] = slots[n->inputs[k]];
+        }
+        slots[CGP_INPUTS + i] = CGP_PROGRAM_INSTR_SLOT(program->length++);
+    }
+
+    for (int i = 0; i < CGP_OUTPUTS; i++) {
+        program->outputs[i] = slots[genome->outputs[i]];
+    }
+}
+
+
+typedef struct {
+    ga_chr_t chr;
+    cgp_program_t program;
+    cgp_value_t inputs[CGP_INPUTS];
+    cgp_value_t outputs[CGP_OUTPUTS];
+#ifdef SSE2
+    __m128i_aligned inputs_sse[CGP_INPUTS];
+    __m128i_aligned outputs_sse[CGP_OUTPUTS];
+#endif
+#ifdef AVX2
+    __m256i_aligned inputs_avx[CGP_INPUTS];
+    __m256i_aligned outputs_avx[CGP_OUTPUTS];
+#endif
+} _bench_micro_t;
+
+
+static void _bench_micro_scalar(void *data)
+{
+    _bench_micro_t *m = (_bench_micro_t*) data;
+    cgp_program_output(&m->program, m->inputs, m->outputs);
+    // feed output back, so the call cannot be optimized out
+    m->inputs[0] = m->outputs[0];
+}
+
+
+#ifdef SSE2
+static void _bench_micro_sse(void *data)
+{
+    _bench_micro_t *m = (_bench_micro_t*) data;
+    cgp_program_output_sse(&m->program, m->inputs_sse, m->outputs_sse);
+    memcpy(&m->inputs_sse[0], &m->outputs_sse[0], sizeof(m->inputs_sse[0]));
+}
+#endif
+
+
+#ifdef AVX2
+static void _bench_micro_avx(void *data)
+{
+    _bench_micro_t *m = (_bench_micro_t*) data;
+    cgp_program_output_avx(&m->program, m->inputs_avx, m->outputs_avx);
+    memcpy(&m->inputs_avx[0], &m->outputs_avx[0], sizeof(m->inputs_avx[0]));
+}
+#endif
+
+
+/**
+ * Measures throughput of each CGP function in each available evaluator,
+ * in millions of node evaluations (times SIMD lanes) per second
+ * @param cfg
+ * @return 0 on success
+ */
+static int _bench_micro(bench_config_t *cfg)
+{
+    static _bench_micro_t m;
+    m.chr = ga_alloc_chr(cgp_alloc_genome);
+    if (m.chr == NULL) {
+        fprintf(stderr, "Failed to allocate CGP chromosome.\n");
+        return -1;
+    }
+
+    for (int i = 0; i < CGP_INPUTS; i++) {
+        m.inputs[i] = rand_range(0, 255);
+        #ifdef SSE2
+            memset(&m.inputs_sse[i], m.inputs[i], sizeof(m.inputs_sse[i]));
+        #endif
+        #ifdef AVX2
+            memset(&m.inputs_avx[i], m.inputs[i], sizeof(m.inputs_avx[i]));
+        #endif
+    }
+
+    for (int f = 0; f < CGP_FUNC_COUNT; f++) {
+        if (cgp_func_arity[f] > CGP_FUNC_INPUTS) continue;
+        _bench_build_chain(m.chr, (cgp_func_t) f);
+        _bench_chain_program(&m.program, m.chr);
+
+        // estimated cost from function registry, to compare with measurements
+        _bench_report(cfg, "micro", cgp_func_names[f], "cost", CGP_NODES,
+            cgp_func_cost[f], "instructions");
+
+        double calls = _bench_measure(cfg, _bench_micro_scalar, &m);
+        _bench_report(cfg, "micro", cgp_func_names[f], "scalar", CGP_NODES,
+            calls * CGP_NODES / 1e6, "Mnode-evals/s");
+
+        #ifdef SSE2
+            if (can_use_sse2()) {
+                calls = _bench_measure(cfg, _bench_micro_sse, &m);
+                _bench_report(cfg, "micro", cgp_func_names[f], "sse2", CGP_NODES,
+                    calls * CGP_NODES * FITNESS_SSE2_STEP / 1e6, "Mnode-evals/s");
+            }
+        #endif
+
+        #ifdef AVX2
+            if (can_use_intel_core_4th_gen_features()) {
+                calls = _bench_measure(cfg, _bench_micro_avx, &m);
+                _bench_report(cfg, "micro", cgp_func_names[f], "avx2", CGP_NODES,
+                    calls * CGP_NODES * FITNESS_AVX2_STEP / 1e6, "Mnode-evals/s");
+            }
+        #endif
+    }
+
+    ga_destroy_chr(m.chr, cgp_free_genome);
+    return 0;
+}
+
+
+/* fitness kernel benchmarks **************************************************/
+
+
+typedef struct {
+    ga_chr_t chr;
+    cgp_program_t program;
+    fitness_data_t *data;
+    int pixels;
+    fitness_simd_func_t func;
+    int block_size;
+    fitness_sqdiff_t sum;
+} _bench_kernel_t;
+
+
+static void _bench_kernel_scalar(void *data)
+{
+    _bench_kernel_t *k = (_bench_kernel_t*) data;
+    k->sum += _fitness_get_sqdiffsum_scalar(k->chr);
+}
+
+
+static void _bench_kernel_simd(void *data)
+{
+    _bench_kernel_t *k = (_bench_kernel_t*) data;
+    for (int offset = 0; offset < k->pixels; offset += k->block_size) {
+        int block_size = k->pixels - offset;
+        if (block_size > k->block_size) {
+            block_size = k->block_size;
+        }
+        k->sum += k->func(k->data->original->data, k->data->noisy_simd,
+            &k->program, offset, block_size);
+    }
+}
+
+
+static void _bench_kernel_tiled(void *data)
+{
+    _bench_kernel_t *k = (_bench_kernel_t*) data;
+    k->sum += _fitness_get_sqdiffsum_simd(k->chr, k->data->original->data,
+        k->data->noisy_simd, k->pixels);
+}
+
+
+/**
+ * Measures throughput of fitness kernels across image sizes, in millions
+ * of filtered pixels per second
+ * @param cfg
+ * @return 0 on success
+ */
+static int _bench_kernel(bench_config_t *cfg)
+{
+    ga_pop_t pop = cgp_init_pop(1);
+    if (pop == NULL) {
+        fprintf(stderr, "Failed to initialize CGP population.\n");
+        return -1;
+    }
+
+    _bench_kernel_t k = { .chr = pop->chromosomes[0] };
+    cgp_find_active_blocks(k.chr);
+    cgp_program_build(&k.program, k.chr);
+
+    for (unsigned i = 0; i < BENCH_IMAGE_SIZES_COUNT; i++) {
+        int size = BENCH_IMAGE_SIZES[i];
+        img_image_t original, noisy;
+        fitness_data_t data;
+
+        if (_bench_create_images(size, &original, &noisy) != 0
+            || fitness_prepare_data(&data, original, noisy) != 0) {
+            fprintf(stderr, "Failed to create %dx%d images.\n", size, size);
+            return -1;
+        }
+        fitness_init(&data, NULL, NULL);
+
+        k.data = &data;
+        k.pixels = size * size;
+
+        double calls = _bench_measure(cfg, _bench_kernel_scalar, &k);
+        _bench_report(cfg, "kernel", "sqdiffsum", "scalar", k.pixels,
+            calls * k.pixels / 1e6, "Mpixel-evals/s");
+
+        #ifdef SSE2
+            if (can_use_sse2()) {
+                k.func = _fitness_get_sqdiffsum_sse;
+                k.block_size = FITNESS_SSE2_STEP;
+                calls = _bench_measure(cfg, _bench_kernel_simd, &k);
+                _bench_report(cfg, "kernel", "sqdiffsum", "sse2", k.pixels,
+                    calls * k.pixels / 1e6, "Mpixel-evals/s");
+            }
+        #endif
+
+        #ifdef AVX2
+            if (can_use_intel_core_4th_gen_features()) {
+                k.func = _fitness_get_sqdiffsum_avx;
+                k.block_size = FITNESS_AVX2_STEP;
+                calls = _bench_measure(cfg, _bench_kernel_simd, &k);
+                _bench_report(cfg, "kernel", "sqdiffsum", "avx2", k.pixels,
+                    calls * k.pixels / 1e6, "Mpixel-evals/s");
+            }
+        #endif
+
+        if (can_use_simd()) {
+            calls = _bench_measure(cfg, _bench_kernel_tiled, &k);
+            _bench_report(cfg, "kernel", "sqdiffsum", "tiled", k.pixels,
+                calls * k.pixels / 1e6, "Mpixel-evals/s");
+        }
+
+        fitness_deinit();
+        fitness_destroy_data(&data);
+        img_destroy(original);
+        img_destroy(noisy);
+    }
+
+    ga_destroy_pop(pop);
+    return 0;
+}
+
+
+/* predictor benchmarks *******************************************************/
+
+
+typedef struct {
+    ga_pop_t pop;
+    int index;
+} _bench_pred_t;
+
+
+static void _bench_pred_mutate(void *data)
+{
+    _bench_pred_t *p = (_bench_pred_t*) data;
+    p->index = (p->index + 1) % p->pop->size;
+    pred_mutate((pred_genome_t) p->pop->chromosomes[p->index]->genome);
+}
+
+
+static void _bench_pred_offspring(void *data)
+{
+    _bench_pred_t *p = (_bench_pred_t*) data;
+    pred_offspring(p->pop);
+}
+
+
+static void _bench_pred_eval(void *data)
+{
+    _bench_pred_t *p = (_bench_pred_t*) data;
+    p->index = (p->index + 1) % p->pop->size;
+    fitness_eval_predictor(p->pop->chromosomes[p->index]);
+}
+
+
+/**
+ * Measures predictor mutation, offspring creation (crossover and
+ * mutation of whole population) and evaluation across predictor sizes
+ * @param cfg
+ * @return 0 on success
+ */
+static int _bench_predictor(bench_config_t *cfg)
+{
+    int size = BENCH_PRED_IMAGE_SIZE;
+    int pixels = size * size;
+    img_image_t original, noisy;
+    fitness_data_t data;
+
+    if (_bench_create_images(size, &original, &noisy) != 0
+        || fitness_prepare_data(&data, original, noisy) != 0) {
+        fprintf(stderr, "Failed to create %dx%d images.\n", size, size);
+        return -1;
+    }
+
+    // predictors are evaluated against archive of random circuits
+    arc_func_vect_t arc_cgp_methods = {
+        .alloc_genome = cgp_alloc_genome,
+        .free_genome = cgp_free_genome,
+        .copy_genome = cgp_copy_genome,
+        .fitness = fitness_eval_cgp,
+    };
+    archive_t cgp_archive = arc_create(10, 1, arc_cgp_methods, CGP_PROBLEM_TYPE);
+    ga_pop_t cgp_pop = cgp_init_pop(10);
+    if (cgp_archive == NULL || cgp_pop == NULL) {
+        fprintf(stderr, "Failed to initialize CGP archive.\n");
+        return -1;
+    }
+
+    fitness_init(&data, cgp_archive, NULL);
+    for (int i = 0; i < cgp_pop->size; i++) {
+        cgp_find_active_blocks(cgp_pop->chromosomes[i]);
+        arc_insert(cgp_archive, cgp_pop->chromosomes[i]);
+    }
+    arc_read_begin(cgp_archive);
+
+    for (unsigned i = 0; i < BENCH_PRED_SIZES_COUNT; i++) {
+        int genes = BENCH_PRED_SIZES[i] * pixels;
+        pred_metadata_t metadata = {
+            .genome_type = repeated,
+            .phenotype = gathered,
+            .max_gene_value = pixels - 1,
+            .image_size = pixels,
+            .genotype_length = genes,
+            .genotype_used_length = genes,
+            .mutation_rate = 0.05,
+            .offspring_elite = 0.25,
+            .offspring_combine = 0.5,
+        };
+        pred_init(&metadata);
+
+        _bench_pred_t p = { .pop = pred_init_pop(10) };
+        if (p.pop == NULL) {
+            fprintf(stderr, "Failed to initialize predictors population.\n");
+            return -1;
+        }
+        ga_evaluate_pop(p.pop);
+
+        double calls = _bench_measure(cfg, _bench_pred_mutate, &p);
+        _bench_report(cfg, "predictor", "mutate", "repeated", genes,
+            calls, "ops/s");
+
+        calls = _bench_measure(cfg, _bench_pred_offspring, &p);
+        _bench_report(cfg, "predictor", "offspring", "repeated", genes,
+            calls, "ops/s");
+
+        calls = _bench_measure(cfg, _bench_pred_eval, &p);
+        _bench_report(cfg, "predictor", "evaluate", "repeated", genes,
+            calls, "ops/s");
+
+        ga_destroy_pop(p.pop);
+    }
+
+    arc_read_end(cgp_archive);
+    fitness_deinit();
+    ga_destroy_pop(cgp_pop);
+    arc_destroy(cgp_archive);
+    fitness_destroy_data(&data);
+    img_destroy(original);
+    img_destroy(noisy);
+    return 0;
+}
+
+
+/* end-to-end benchmarks ******************************************************/
+
+
+/**
+ * Runs whole evolution with each algorithm in a child process and
+ * measures generations per second, including program start-up
+ * @param cfg
+ * @return 0 on success
+ */
+static int _bench_e2e(bench_config_t *cfg)
+{
+    char generations[16];
+    char seed[16];
+    snprintf(generations, sizeof(generations), "%d", cfg->generations);
+    snprintf(seed, sizeof(seed), "%u", cfg->seed);
+
+    for (unsigned i = 0; i < BENCH_ALGORITHMS_COUNT; i++) {
+        double start = _bench_now();
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return -1;
+        }
+
+        if (pid == 0) {
+            if (freopen("/dev/null", "w", stdout) == NULL) {
+                _exit(127);
+            }
+            execl(cfg->coco, cfg->coco,
+                "-i", cfg->input_image, "-n", cfg->noisy_image,
+                "-a", BENCH_ALGORITHMS[i], "-g", generations,
+                "-r", seed, (char*) NULL);
+            perror(cfg->coco);
+            _exit(127);
+        }
+
+        int status;
+        if (waitpid(pid, &status, 0) < 0) {
+            perror("waitpid");
+            return -1;
+        }
+        double elapsed = _bench_now() - start;
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "Evolution using %s algorithm failed.\n",
+                BENCH_ALGORITHMS[i]);
+            return -1;
+        }
+
+        _bench_report(cfg, "e2e", "evolution", BENCH_ALGORITHMS[i],
+            cfg->generations, cfg->generations / elapsed, "generations/s");
+    }
+
+    return 0;
+}
+
+
+/******************************************************************************/
+
+
+int main(int argc, char *argv[])
+{
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+
+        {"format", required_argument, 0, 'f'},
+        {"output", required_argument, 0, 'o'},
+
+        {"group", required_argument, 0, 'g'},
+        {"min-time", required_argument, 0, 't'},
+        {"workers", required_argument, 0, 'w'},
+        {"seed", required_argument, 0, 's'},
+
+        {"coco", required_argument, 0, 'c'},
+        {"input", required_argument, 0, 'i'},
+        {"noisy", required_argument, 0, 'n'},
+        {"generations", required_argument, 0, 'G'},
+
+        {0, 0, 0, 0}
+    };
+
+    static const char *short_options = "hf:o:g:t:w:s:c:i:n:G:";
+
+    bench_config_t cfg = {
+        .format = bench_csv,
+        .output = stdout,
+        .min_time = 0.5,
+        .workers = 1,
+        .seed = 1,
+        .coco = "./coco",
+        .input_image = "../images/lena_gray_256.png",
+        .noisy_image = "../images/lena_gray_256_saltpepper.png",
+        .generations = 500,
+    };
+    char *group = "all";
+
+    /*
+        Parse command line
+     */
+
+    while (1) {
+        int option_index;
+        int c = getopt_long(argc, argv, short_options, long_options, &option_index);
+        if (c == - 1) break;
+
+        switch (c) {
+            case 'h':
+                puts(help);
+                return 1;
+
+            case 'f':
+                if (strcmp(optarg, "csv") == 0) {
+                    cfg.format = bench_csv;
+                } else if (strcmp(optarg, "json") == 0) {
+                    cfg.format = bench_json;
+                } else {
+                    fprintf(stderr, "Invalid output format.\n");
+                    return 1;
+                }
+                break;
+
+            case 'o':
+                cfg.output = fopen(optarg, "w");
+                if (!cfg.output) {
+                    fprintf(stderr, "Failed to open output file.\n");
+                    return 1;
+                }
+                break;
+
+            case 'g':
+                group = optarg;
+                break;
+
+            case 't':
+                cfg.min_time = atof(optarg);
+                break;
+
+            case 'w':
+                cfg.workers = atoi(optarg);
+                break;
+
+            case 's':
+                cfg.seed = atoi(optarg);
+                break;
+
+            case 'c':
+                cfg.coco = optarg;
+                break;
+
+            case 'i':
+                cfg.input_image = optarg;
+                break;
+
+            case 'n':
+                cfg.noisy_image = optarg;
+                break;
+
+            case 'G':
+                cfg.generations = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Invalid arguments.\n");
+                return 1;
+        }
+    }
+
+    /*
+        Check args
+     */
+
+    bool all = strcmp(group, "all") == 0;
+    cfg.run_micro = all || strcmp(group, "micro") == 0;
+    cfg.run_kernel = all || strcmp(group, "kernel") == 0;
+    cfg.run_predictor = all || strcmp(group, "predictor") == 0;
+    cfg.run_e2e = all || strcmp(group, "e2e") == 0;
+
+    if (!cfg.run_micro && !cfg.run_kernel && !cfg.run_predictor && !cfg.run_e2e) {
+        fprintf(stderr, "Invalid benchmark group.\n");
+        return 1;
+    }
+
+    if (cfg.workers < 1 || cfg.generations < 1 || cfg.min_time <= 0) {
+        fprintf(stderr, "Invalid arguments.\n");
+        return 1;
+    }
+
+    /*
+        Run benchmarks
+     */
+
+    if (ga_init_workers(cfg.workers) != 0) {
+        fprintf(stderr, "Failed to start worker threads.\n");
+        return 1;
+    }
+    rand_init_seed(cfg.seed);
+    cgp_init(5, fitness_eval_cgp);
+
+    int retval = 0;
+    _bench_begin(&cfg);
+
+    if (retval == 0 && cfg.run_micro) {
+        retval = _bench_micro(&cfg);
+    }
+    if (retval == 0 && cfg.run_kernel) {
+        retval = _bench_kernel(&cfg);
+    }
+    if (retval == 0 && cfg.run_predictor) {
+        retval = _bench_predictor(&cfg);
+    }
+    if (retval == 0 && cfg.run_e2e) {
+        retval = _bench_e2e(&cfg);
+    }
+
+    _bench_end(&cfg);
+
+    cgp_deinit();
+    ga_deinit_workers();
+    if (cfg.output != stdout) {
+        fclose(cfg.output);
+    }
+
+    return retval == 0? 0 : 1;
+}
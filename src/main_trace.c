@@ -0,0 +1,177 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+
+#include "logging/trace.h"
+
+
+const char* help =
+    "Colearning in Coevolutionary Algorithms\n"
+    "Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>\n"
+    "\n"
+    "Master Thesis\n"
+    "2014/2015\n"
+    "\n"
+    "Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>\n"
+    "\n"
+    "Faculty of Information Technologies\n"
+    "Brno University of Technology\n"
+    "http://www.fit.vutbr.cz/\n"
+    "     _       _\n"
+    "  __(.)=   =(.)__\n"
+    "  \\___)     (___/\n"
+    "\n"
+    "\n"
+    "To convert binary trace (see --trace option of coco) to CSV:\n"
+    "    ./coco_trace --input trace.bin --output cocolog/cgp_history.csv\n"
+    "\n"
+    "First columns are the same as in cgp_history.csv, so the output can be\n"
+    "plotted using cocolog.gp.\n"
+    "\n"
+    "Command line options:\n"
+    "    --help, -h\n"
+    "          Show this help and exit\n"
+    "\n"
+    "Required:\n"
+    "    --input FILE, -i FILE\n"
+    "          Trace filename\n"
+    "\n"
+    "Optional:\n"
+    "    --output FILE, -o FILE\n"
+    "          Output CSV filename, default is standard output\n";
+
+
+/******************************************************************************/
+
+
+int main(int argc, char *argv[])
+{
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+
+        {"input", required_argument, 0, 'i'},
+        {"output", required_argument, 0, 'o'},
+
+        {0, 0, 0, 0}
+    };
+
+    static const char *short_options = "hi:o:";
+
+    trace_t trace = NULL;
+    FILE *output_file = stdout;
+
+    /*
+        Parse command line
+     */
+
+    while (1) {
+        int option_index;
+        int c = getopt_long(argc, argv, short_options, long_options, &option_index);
+        if (c == - 1) break;
+
+        switch (c) {
+            case 'h':
+                puts(help);
+                return 1;
+
+            case 'i':
+                trace = trace_open(optarg);
+                if (!trace) {
+                    fprintf(stderr, "Failed to open trace file.\n");
+                    return 1;
+                }
+                break;
+
+            case 'o':
+                output_file = fopen(optarg, "w");
+                if (!output_file) {
+                    fprintf(stderr, "Failed to open output file.\n");
+                    return 1;
+                }
+                break;
+
+            default:
+                fprintf(stderr, "Invalid arguments.\n");
+                return 1;
+        }
+    }
+
+    /*
+        Check args
+     */
+
+    if (!trace) {
+        fprintf(stderr, "No trace file given.\n");
+        return 1;
+    }
+
+    /*
+        Convert
+     */
+
+    fprintf(output_file,
+        "generation,"
+        "predicted_fitness,"
+        "real_fitness,"
+        "inaccuracy (pred/real),"
+        "best_fitness_ever,"
+        "active_predictor_fitness,"
+        "pred_length,"
+        "pred_used_length,"
+        "cgp_evals,"
+        "real_measured\n");
+
+    trace_record_t record;
+    double best_real_fitness = 0;
+    long records = 0;
+
+    while (trace_read(trace, &record) > 0) {
+        // both fitness values are PSNR-based, so they are positive
+        if (record.real_fitness > best_real_fitness) {
+            best_real_fitness = record.real_fitness;
+        }
+
+        fprintf(output_file,
+            "%d,%.10g,%.10g,%.10g,%.10g,%.10g,%d,%d,%lld,%d\n",
+            record.generation,
+            record.predicted_fitness,
+            record.real_fitness,
+            record.predicted_fitness / record.real_fitness,
+            best_real_fitness,
+            record.active_predictor_fitness,
+            record.pred_length,
+            record.pred_used_length,
+            (long long) record.cgp_evals,
+            (record.flags & TRACE_REAL_MEASURED) != 0);
+        records++;
+    }
+
+    trace_close(trace);
+    if (output_file != stdout) {
+        fclose(output_file);
+    }
+
+    fprintf(stderr, "%ld records converted.\n", records);
+    return 0;
+}
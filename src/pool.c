@@ -0,0 +1,362 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+// pthread_setaffinity_np, sched_getaffinity
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdatomic.h>
+
+#include "pool.h"
+
+
+/*
+    Tasks of single `pool_parallel_for` call. Lives on submitter's stack,
+    submitter does not return until `remaining` reaches zero. Nested
+    batches submitted from its tasks inherit submitter's width.
+ */
+typedef struct {
+    pool_task_func_t func;
+    void *data;
+    int width;
+    atomic_int remaining;
+} pool_batch_t;
+
+
+typedef struct {
+    pool_batch_t *batch;
+    int index;
+} pool_task_t;
+
+
+/*
+    Double-ended task queue. Owner takes newest tasks from the tail,
+    thieves take oldest tasks from the head.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pool_task_t tasks[POOL_QUEUE_SIZE];
+    int head;
+    int count;
+} pool_queue_t;
+
+
+typedef struct {
+    int id;
+    pthread_t thread;
+    pool_queue_t queue;
+} pool_worker_t;
+
+
+static pool_worker_t *_workers;
+static int _workers_count;
+
+// number of queued (not yet taken) tasks in all queues
+static atomic_int _pending;
+static atomic_bool _shutdown;
+
+// idle workers sleep here
+static pthread_mutex_t _idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _idle_cond = PTHREAD_COND_INITIALIZER;
+
+// first queue used by next submission, spreads batches across workers
+// (unsigned, so that the counter wraps around instead of overflowing)
+static atomic_uint _next_queue;
+
+// workers used by calling thread, negative for all of them
+static _Thread_local int _width = -1;
+
+
+static bool _pool_push(pool_queue_t *queue, pool_task_t task)
+{
+    bool pushed = false;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count < POOL_QUEUE_SIZE) {
+        int tail = (queue->head + queue->count) % POOL_QUEUE_SIZE;
+        queue->tasks[tail] = task;
+        queue->count++;
+        pushed = true;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return pushed;
+}
+
+
+static bool _pool_pop_tail(pool_queue_t *queue, pool_task_t *task)
+{
+    bool popped = false;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count > 0) {
+        queue->count--;
+        *task = queue->tasks[(queue->head + queue->count) % POOL_QUEUE_SIZE];
+        popped = true;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return popped;
+}
+
+
+static bool _pool_pop_head(pool_queue_t *queue, pool_task_t *task)
+{
+    bool popped = false;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count > 0) {
+        *task = queue->tasks[queue->head];
+        queue->head = (queue->head + 1) % POOL_QUEUE_SIZE;
+        queue->count--;
+        popped = true;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return popped;
+}
+
+
+/**
+ * Takes task from worker's own queue or steals one from other workers
+ * @param self Worker index, -1 for submitting thread
+ * @param task
+ * @return Whether any task was taken
+ */
+static bool _pool_take(int self, pool_task_t *task)
+{
+    if (atomic_load(&_pending) == 0) {
+        return false;
+    }
+
+    if (self >= 0 && _pool_pop_tail(&_workers[self].queue, task)) {
+        atomic_fetch_sub(&_pending, 1);
+        return true;
+    }
+
+    int start = self >= 0? self + 1 : 0;
+    for (int i = 0; i < _workers_count; i++) {
+        int victim = (start + i) % _workers_count;
+        if (victim != self && _pool_pop_head(&_workers[victim].queue, task)) {
+            atomic_fetch_sub(&_pending, 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+static void _pool_run(pool_task_t *task)
+{
+    pool_batch_t *batch = task->batch;
+
+    int width = _width;
+    _width = batch->width;
+    batch->func(batch->data, task->index);
+    _width = width;
+
+    // batch must not be touched after this
+    atomic_fetch_sub(&batch->remaining, 1);
+}
+
+
+static void *_pool_worker_main(void *arg)
+{
+    pool_worker_t *self = (pool_worker_t*) arg;
+    pool_task_t task;
+
+    #ifdef __linux__
+        // pick CPU from those this process may use (sweep jobs are
+        // restricted to their own CPUs)
+        cpu_set_t allowed, cpus;
+        CPU_ZERO(&cpus);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            int index = self->id % CPU_COUNT(&allowed);
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed) && index-- == 0) {
+                    CPU_SET(cpu, &cpus);
+                    break;
+                }
+            }
+        } else {
+            CPU_SET(self->id % sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+        }
+        // pinning is only a hint
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    #endif
+
+    while (true) {
+        if (_pool_take(self->id, &task)) {
+            _pool_run(&task);
+            continue;
+        }
+
+        pthread_mutex_lock(&_idle_lock);
+        while (atomic_load(&_pending) == 0 && !atomic_load(&_shutdown)) {
+            pthread_cond_wait(&_idle_cond, &_idle_lock);
+        }
+        pthread_mutex_unlock(&_idle_lock);
+
+        if (atomic_load(&_shutdown)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Starts persistent worker threads, each pinned to its own CPU
+ * @param workers Number of worker threads
+ * @return 0 on success, other value on error
+ */
+int pool_init(int workers)
+{
+    if (workers <= 0) {
+        return 0;
+    }
+
+    _workers = (pool_worker_t*) malloc(sizeof(pool_worker_t) * workers);
+    if (_workers == NULL) {
+        return -1;
+    }
+
+    atomic_init(&_pending, 0);
+    atomic_init(&_shutdown, false);
+    atomic_init(&_next_queue, 0);
+
+    for (int i = 0; i < workers; i++) {
+        _workers[i].id = i;
+        _workers[i].queue.head = 0;
+        _workers[i].queue.count = 0;
+        pthread_mutex_init(&_workers[i].queue.lock, NULL);
+    }
+
+    // workers may steal from all queues once they run
+    _workers_count = workers;
+
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&_workers[i].thread, NULL, _pool_worker_main, &_workers[i]) != 0) {
+            _workers_count = i;
+            pool_deinit();
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Stops and joins worker threads
+ */
+void pool_deinit()
+{
+    if (_workers == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&_idle_lock);
+    atomic_store(&_shutdown, true);
+    pthread_cond_broadcast(&_idle_cond);
+    pthread_mutex_unlock(&_idle_lock);
+
+    for (int i = 0; i < _workers_count; i++) {
+        pthread_join(_workers[i].thread, NULL);
+        pthread_mutex_destroy(&_workers[i].queue.lock);
+    }
+
+    free(_workers);
+    _workers = NULL;
+    _workers_count = 0;
+}
+
+
+/**
+ * Sets number of workers which receive tasks submitted by calling thread
+ * @param width Number of workers, zero for none (serial execution),
+ *              negative for all of them
+ */
+void pool_set_width(int width)
+{
+    _width = width;
+}
+
+
+/**
+ * Runs `func(data, i)` for each i in [0, count) and returns when all
+ * of them are finished. Calling thread takes part in the execution.
+ *
+ * @param count
+ * @param func
+ * @param data
+ */
+void pool_parallel_for(int count, pool_task_func_t func, void *data)
+{
+    if (_workers_count == 0 || _width == 0 || count == 1) {
+        for (int i = 0; i < count; i++) {
+            func(data, i);
+        }
+        return;
+    }
+
+    pool_batch_t batch = {
+        .func = func,
+        .data = data,
+        .width = _width,
+    };
+    atomic_init(&batch.remaining, count);
+
+    // deal tasks to workers in round-robin manner
+    int width = _width;
+    if (width < 0 || width > _workers_count) {
+        width = _workers_count;
+    }
+    int first = atomic_fetch_add(&_next_queue, (unsigned) width)
+        % (unsigned) _workers_count;
+
+    for (int i = 0; i < count; i++) {
+        pool_task_t task = { .batch = &batch, .index = i };
+        pool_queue_t *queue = &_workers[(first + i % width) % _workers_count].queue;
+
+        // increment before push, so the task cannot be taken before
+        // it is counted in
+        atomic_fetch_add(&_pending, 1);
+        if (!_pool_push(queue, task)) {
+            atomic_fetch_sub(&_pending, 1);
+            _pool_run(&task);
+        }
+    }
+
+    pthread_mutex_lock(&_idle_lock);
+    pthread_cond_broadcast(&_idle_cond);
+    pthread_mutex_unlock(&_idle_lock);
+
+    // help with the work until whole batch is done, no barrier needed
+    pool_task_t task;
+    while (atomic_load(&batch.remaining) > 0) {
+        if (_pool_take(-1, &task)) {
+            _pool_run(&task);
+        } else {
+            sched_yield();
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+
+/*
+    Maximum number of queued tasks per worker. If worker's queue is full,
+    the submitting thread runs the task itself.
+ */
+#define POOL_QUEUE_SIZE 256
+
+
+/**
+ * Task function, called once for each index of the batch
+ * @param data Batch data
+ * @param index Task index
+ */
+typedef void (*pool_task_func_t)(void *data, int index);
+
+
+/**
+ * Starts persistent worker threads, each pinned to its own CPU
+ * @param workers Number of worker threads
+ * @return 0 on success, other value on error
+ */
+int pool_init(int workers);
+
+
+/**
+ * Stops and joins worker threads
+ */
+void pool_deinit();
+
+
+/**
+ * Sets number of workers which receive tasks submitted by calling thread
+ *
+ * Idle workers still steal tasks from busy ones, so the width is
+ * a preference rather than a hard limit. Batches submitted from within
+ * a task use the width of the thread which submitted that task.
+ *
+ * @param width Number of workers, zero for none (serial execution),
+ *              negative for all of them
+ */
+void pool_set_width(int width);
+
+
+/**
+ * Runs `func(data, i)` for each i in [0, count) and returns when all
+ * of them are finished. Calling thread takes part in the execution.
+ *
+ * Without running pool, tasks are executed serially.
+ *
+ * @param count
+ * @param func
+ * @param data
+ */
+void pool_parallel_for(int count, pool_task_func_t func, void *data);
@@ -28,6 +28,7 @@
 #include "random.h"
 #include "fitness.h"
 #include "predictors.h"
+#include "timing.h"
 
 
 static pred_metadata_t *_metadata;
@@ -60,104 +61,279 @@ void pred_init(pred_metadata_t *metadata)
 }
 
 
+/* arena **********************************************************************/
+
+
+/* number of simd planes - original image and all noisy image windows */
+#define PRED_ARENA_SIMD_PLANES (WINDOW_SIZE + 1)
+
+
+/* whether selected pixels are gathered into per-predictor simd arrays */
+static inline bool _pred_uses_gathered_simd()
+{
+    return _metadata->phenotype == gathered && can_use_simd();
+}
+
+
+/* number of blocks covering whole image */
+static inline unsigned int _pred_block_count()
+{
+    return (_metadata->image_size - 1) / PRED_BLOCK_SIZE + 1;
+}
+
+
+/* whether genes select tiles instead of pixels */
+static inline bool _pred_is_tiled()
+{
+    return _metadata->genome_type == tiled || _metadata->genome_type == tiled_circular;
+}
+
+
+/* maximal number of pixels in phenotype */
+static inline unsigned int _pred_max_pixels()
+{
+    if (_pred_is_tiled()) {
+        return _metadata->genotype_length * PRED_TILE_SIZE;
+    }
+    return _metadata->genotype_length;
+}
+
+
+static inline size_t _pred_arena_align(size_t size)
+{
+    return (size + SIMD_ALIGNMENT_BYTES - 1) & ~((size_t) SIMD_ALIGNMENT_BYTES - 1);
+}
+
+
 /**
- * Create a new predictors population with given size
- * @param  size
- * @param  problem-specific methods
- * @return
+ * Allocates one aligned slab for given number of genomes
+ *
+ * Everything (arena header, genome headers and all arrays) lives in the
+ * slab. Memory is zeroed, since we want initialized simd padding bits.
+ *
+ * @param  capacity
+ * @return pointer to new arena or NULL on failure
  */
-ga_pop_t pred_init_pop(int pop_size)
+pred_arena_t _pred_arena_create(int capacity)
 {
-    ga_fitness_func_t fitfunc = fitness_eval_predictor;
-    if (_metadata->genome_type == circular) {
-        fitfunc = fitness_eval_circular_predictor;
+    size_t genes_stride = _pred_arena_align(sizeof(pred_gene_t) * _metadata->genotype_length);
+    size_t used_values_stride = _pred_arena_align(sizeof(bool) * (_metadata->max_gene_value + 1));
+    size_t pixels_stride = 0;
+    size_t simd_stride = 0;
+    size_t block_masks_stride = 0;
+    size_t active_blocks_stride = 0;
+
+    if (_metadata->genome_type != permuted) {
+        pixels_stride = _pred_arena_align(sizeof(unsigned int) * _pred_max_pixels());
     }
 
-    /* prepare methods vector */
-    ga_func_vect_t methods = {
-        .alloc_genome = pred_alloc_genome,
-        .free_genome = pred_free_genome,
-        .init_genome = pred_randomize_genome,
+    if (_pred_uses_gathered_simd()) {
+        // keep at least SIMD_PADDING_BYTES of zeroed padding behind data
+        simd_stride = _pred_arena_align(sizeof(img_pixel_t) *
+            (_pred_max_pixels() + SIMD_PADDING_BYTES));
+    }
 
-        .fitness = fitfunc,
-        .offspring = pred_offspring,
-    };
+    if (_metadata->phenotype == bitmap) {
+        block_masks_stride = _pred_arena_align(sizeof(pred_block_mask_t) * _pred_block_count());
+        active_blocks_stride = _pred_arena_align(sizeof(unsigned int) * _pred_block_count());
+    }
 
-    /* initialize GA */
-    ga_pop_t pop = ga_create_pop(pop_size, PRED_PROBLEM_TYPE, methods);
-    return pop;
+    size_t header_size = _pred_arena_align(sizeof(struct pred_arena));
+    size_t genomes_size = _pred_arena_align(sizeof(struct pred_genome) * capacity);
+    size_t total = header_size
+        + genomes_size
+        + genes_stride * capacity
+        + used_values_stride * capacity
+        + pixels_stride * capacity
+        + simd_stride * capacity * PRED_ARENA_SIMD_PLANES
+        + block_masks_stride * capacity
+        + active_blocks_stride * capacity;
+
+    void *slab;
+    if (posix_memalign(&slab, SIMD_ALIGNMENT_BYTES, total) != 0) {
+        return NULL;
+    }
+    memset(slab, 0, total);
+
+    pred_arena_t arena = (pred_arena_t) slab;
+    unsigned char *ptr = (unsigned char*) slab + header_size;
+
+    arena->capacity = capacity;
+    arena->allocated = 0;
+    arena->references = 0;
+    arena->genes_stride = genes_stride;
+    arena->used_values_stride = used_values_stride;
+    arena->pixels_stride = pixels_stride;
+    arena->simd_stride = simd_stride;
+    arena->block_masks_stride = block_masks_stride;
+    arena->active_blocks_stride = active_blocks_stride;
+
+    arena->genomes = (struct pred_genome*) ptr;
+    ptr += genomes_size;
+
+    arena->genes = ptr;
+    ptr += genes_stride * capacity;
+
+    arena->used_values = ptr;
+    ptr += used_values_stride * capacity;
+
+    arena->pixels = ptr;
+    ptr += pixels_stride * capacity;
+
+    arena->simd = ptr;
+    ptr += simd_stride * capacity * PRED_ARENA_SIMD_PLANES;
+
+    arena->block_masks = ptr;
+    ptr += block_masks_stride * capacity;
+
+    arena->active_blocks = ptr;
+
+    return arena;
 }
 
 
 /**
- * Allocates memory for new predictor genome
- * @return pointer to newly allocated genome
+ * Hands out next free genome from the arena
+ * @param  arena
+ * @return genome or NULL if the arena is full
  */
-void* pred_alloc_genome()
+pred_genome_t _pred_arena_take(pred_arena_t arena)
 {
-    pred_genome_t genome = (pred_genome_t) malloc(sizeof(struct pred_genome));
-    if (genome == NULL) {
+    if (arena->allocated >= arena->capacity) {
         return NULL;
     }
 
-    genome->_genes = (pred_gene_t*) malloc(sizeof(pred_gene_t) * _metadata->genotype_length);
-    if (genome->_genes == NULL) {
-        free(genome);
-        return NULL;
-    }
+    int index = arena->allocated;
+    pred_genome_t genome = &arena->genomes[index];
+
+    genome->_genes = (pred_gene_t*) (arena->genes + index * arena->genes_stride);
 
     /*
         For permuted genotype: holds which values has been used.
         For repeated genotype: used for calculating genotype (also holds
             which values has been used in phenotype)
      */
-    genome->_used_values = (bool*) malloc(sizeof(bool) * (_metadata->max_gene_value + 1));
-    if (genome->_used_values == NULL) {
-        free(genome->_genes);
-        free(genome);
-        return NULL;
-    }
+    genome->_used_values = (bool*) (arena->used_values + index * arena->used_values_stride);
 
     if (_metadata->genome_type == permuted) {
-
         // one-to-one mapping
         // field genome->used_pixels must be updated manually after every change!
         genome->pixels = genome->_genes;
 
     } else {
         // phenotype is different
-        genome->pixels = (unsigned int*) malloc(sizeof(unsigned int) * _metadata->genotype_length);
-        if (genome->pixels == NULL) {
-            free(genome->_genes);
-            free(genome);
-            return NULL;
-        }
+        genome->pixels = (unsigned int*) (arena->pixels + index * arena->pixels_stride);
     }
 
-    // allocate space for simd-friendly data using calloc, since we
-    // want initialized padding bits
-    if (can_use_simd()) {
-        int size = _metadata->genotype_length;
-        int padding = SIMD_PADDING_BYTES - (size % SIMD_PADDING_BYTES);
-        genome->original_simd = (img_pixel_t *) calloc(size + padding, sizeof(img_pixel_t));
-        if (genome->original_simd == NULL) {
-            // TODO: implement proper deallocation on failure
-            // Whatever, if it fails, everything fails, OS cleans it, so...
-            return NULL;
-        }
+    if (_pred_uses_gathered_simd()) {
+        // plane-major layout: all genomes' data of one plane are adjacent
+        genome->original_simd = (img_pixel_t*) (arena->simd
+            + (size_t) index * arena->simd_stride);
 
         for (int i = 0; i < WINDOW_SIZE; i++) {
-            genome->pixels_simd[i] = (img_pixel_t *) calloc(size + padding, sizeof(img_pixel_t));
-            if (genome->pixels_simd[i] == NULL) {
-                return NULL;
-            }
+            genome->pixels_simd[i] = (img_pixel_t*) (arena->simd
+                + ((size_t) (i + 1) * arena->capacity + index) * arena->simd_stride);
         }
     }
 
+    if (_metadata->phenotype == bitmap) {
+        genome->block_masks = (pred_block_mask_t*) (arena->block_masks
+            + index * arena->block_masks_stride);
+        genome->active_blocks = (unsigned int*) (arena->active_blocks
+            + index * arena->active_blocks_stride);
+        genome->active_blocks_count = 0;
+    }
+
+    genome->_arena = arena;
+    arena->allocated++;
+    arena->references++;
     return genome;
 }
 
 
+/**
+ * Returns genome to its arena, frees the slab when last genome is returned
+ * @param  arena
+ */
+void _pred_arena_release(pred_arena_t arena)
+{
+    arena->references--;
+    if (arena->references == 0) {
+        free(arena);
+    }
+}
+
+
+/**
+ * Allocates population genome from given arena
+ * @param  arena
+ * @return genome or NULL if the arena is full
+ */
+static void* _pred_alloc_genome_from(void *arena)
+{
+    return _pred_arena_take((pred_arena_t) arena);
+}
+
+
+/* population *****************************************************************/
+
+
+/**
+ * Create a new predictors population with given size
+ * @param  size
+ * @param  problem-specific methods
+ * @return
+ */
+ga_pop_t pred_init_pop(int pop_size)
+{
+    ga_fitness_func_t fitfunc = fitness_eval_predictor;
+    if (_metadata->genome_type == circular || _metadata->genome_type == tiled_circular) {
+        fitfunc = fitness_eval_circular_predictor;
+    }
+
+    /* chromosomes and children share one arena, referenced by each genome
+       and by this function until the population is created */
+    pred_arena_t arena = _pred_arena_create(2 * pop_size);
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    /* prepare methods vector */
+    ga_func_vect_t methods = {
+        .alloc_genome = pred_alloc_genome,
+        .free_genome = pred_free_genome,
+        .alloc_genome_from = _pred_alloc_genome_from,
+        .genome_allocator = arena,
+        .init_genome = pred_randomize_genome,
+
+        .fitness = fitfunc,
+        .offspring = pred_offspring,
+    };
+
+    /* initialize GA */
+    arena->references++;
+    ga_pop_t pop = ga_create_pop(pop_size, PRED_PROBLEM_TYPE, methods);
+    _pred_arena_release(arena);
+
+    return pop;
+}
+
+
+/**
+ * Allocates memory for new predictor genome
+ * @return pointer to newly allocated genome
+ */
+void* pred_alloc_genome()
+{
+    // standalone genome (e.g. in archive) gets its own small arena
+    pred_arena_t arena = _pred_arena_create(1);
+    if (arena == NULL) {
+        return NULL;
+    }
+    return _pred_arena_take(arena);
+}
+
+
 /**
  * Deinitialize predictor genome
  * @param  genome
@@ -166,16 +342,7 @@ void* pred_alloc_genome()
 void pred_free_genome(void *_genome)
 {
     pred_genome_t genome = (pred_genome_t) _genome;
-    free(genome->_used_values);
-    free(genome->_genes);
-    if (_metadata->genome_type != permuted) free(genome->pixels);
-    if (can_use_simd()) {
-        free(genome->original_simd);
-        for (int i = 0; i < WINDOW_SIZE; i++) {
-            free(genome->pixels_simd[i]);
-        }
-    }
-    free(genome);
+    _pred_arena_release(genome->_arena);
 }
 
 
@@ -209,10 +376,75 @@ void _pred_calculate_repeated_phenotype(pred_genome_t genome)
         }
     }
     genome->used_pixels = pheno_index;
+}
 
-    if (can_use_simd()) {
-        fitness_prepare_predictor_for_simd(genome);
+
+/**
+ * Recalculates phenotype for tiled genotype - every distinct tile is
+ * expanded to its pixels, so phenotype consists of contiguous runs
+ */
+void _pred_calculate_tiled_phenotype(pred_genome_t genome)
+{
+    // clear used tiles helper
+    memset(genome->_used_values, 0, sizeof(bool) * (_metadata->max_gene_value + 1));
+
+    int pheno_index = 0;
+    for (int geno_index = 0; geno_index < _metadata->genotype_used_length; geno_index++) {
+        int locus = _pred_get_circular_index(genome, geno_index);
+        pred_gene_t tile = genome->_genes[locus];
+        if (genome->_used_values[tile]) {
+            continue;
+        }
+        genome->_used_values[tile] = true;
+
+        // last tile may be cut by image end
+        unsigned int first = tile * PRED_TILE_SIZE;
+        unsigned int last = first + PRED_TILE_SIZE;
+        if (last > _metadata->image_size) {
+            last = _metadata->image_size;
+        }
+
+        for (unsigned int pixel = first; pixel < last; pixel++) {
+            genome->pixels[pheno_index] = pixel;
+            pheno_index++;
+        }
     }
+    genome->used_pixels = pheno_index;
+}
+
+
+int _pred_compare_blocks(const void *a, const void *b)
+{
+    unsigned int x = *(const unsigned int*) a;
+    unsigned int y = *(const unsigned int*) b;
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * Recalculates block bitmap from phenotype pixels
+ */
+void _pred_calculate_bitmap(pred_genome_t genome)
+{
+    // clear only blocks used by previous phenotype
+    for (int i = 0; i < genome->active_blocks_count; i++) {
+        genome->block_masks[genome->active_blocks[i]] = 0;
+    }
+
+    int count = 0;
+    for (int i = 0; i < genome->used_pixels; i++) {
+        unsigned int index = genome->pixels[i];
+        unsigned int block = index / PRED_BLOCK_SIZE;
+        if (genome->block_masks[block] == 0) {
+            genome->active_blocks[count] = block;
+            count++;
+        }
+        genome->block_masks[block] |= (pred_block_mask_t) 1 << (index % PRED_BLOCK_SIZE);
+    }
+    genome->active_blocks_count = count;
+
+    // evaluate blocks in memory order
+    qsort(genome->active_blocks, count, sizeof(unsigned int), _pred_compare_blocks);
 }
 
 
@@ -224,16 +456,42 @@ void pred_calculate_phenotype(pred_genome_t genome)
     if (_metadata->genome_type == permuted) {
         genome->used_pixels = _metadata->genotype_used_length;
 
+    } else if (_pred_is_tiled()) {
+        _pred_calculate_tiled_phenotype(genome);
+
     } else {
         _pred_calculate_repeated_phenotype(genome);
     }
 
-    if (can_use_simd()) {
+    if (_metadata->phenotype == bitmap) {
+        _pred_calculate_bitmap(genome);
+
+    } else if (can_use_simd()) {
         fitness_prepare_predictor_for_simd(genome);
     }
 }
 
 
+/**
+ * Returns whether both genomes select the same pixels
+ * @param  a
+ * @param  b
+ * @return
+ */
+bool pred_phenotype_equals(pred_genome_t a, pred_genome_t b)
+{
+    if (a->used_pixels != b->used_pixels) {
+        return false;
+    }
+
+    // permuted genotype is used as phenotype directly
+    if (_metadata->genome_type == permuted) {
+        return memcmp(a->_genes, b->_genes, sizeof(pred_gene_t) * a->used_pixels) == 0;
+    }
+    return memcmp(a->pixels, b->pixels, sizeof(unsigned int) * a->used_pixels) == 0;
+}
+
+
 /**
  * Recalculates phenotype for repeated genotype in whole population
  */
@@ -291,22 +549,77 @@ void pred_copy_genome(void *_dst, void *_src)
     memcpy(dst->_genes, src->_genes, sizeof(pred_gene_t) * _metadata->genotype_length);
     memcpy(dst->_used_values, src->_used_values, sizeof(bool) * _metadata->max_gene_value);
 
-    if (_metadata->genome_type == repeated || _metadata->genome_type == circular) {
-        memcpy(dst->pixels, src->pixels, sizeof(pred_gene_t) * _metadata->genotype_length);
+    if (_metadata->genome_type != permuted) {
+        memcpy(dst->pixels, src->pixels, sizeof(unsigned int) * src->used_pixels);
     }
 
-    if (can_use_simd()) {
+    if (_pred_uses_gathered_simd()) {
         memcpy(dst->original_simd, src->original_simd, sizeof(img_pixel_t) * src->used_pixels);
         for (int w = 0; w < WINDOW_SIZE; w++) {
             memcpy(dst->pixels_simd[w], src->pixels_simd[w], sizeof(img_pixel_t) * src->used_pixels);
         }
     }
 
+    if (_metadata->phenotype == bitmap) {
+        memcpy(dst->block_masks, src->block_masks, sizeof(pred_block_mask_t) * _pred_block_count());
+        memcpy(dst->active_blocks, src->active_blocks, sizeof(unsigned int) * src->active_blocks_count);
+        dst->active_blocks_count = src->active_blocks_count;
+    }
+
     dst->used_pixels = src->used_pixels;
     dst->_circular_offset = src->_circular_offset;
 }
 
 
+/**
+ * Returns size of serialized genome in bytes
+ * @return
+ */
+size_t pred_serialized_size()
+{
+    // circular offset followed by genes
+    return sizeof(unsigned int) + sizeof(pred_gene_t) * _metadata->genotype_length;
+}
+
+
+/**
+ * Stores genotype into flat buffer, e.g. to send it to other process
+ * @param genome
+ * @param buffer At least `pred_serialized_size()` bytes
+ */
+void pred_serialize_genome(pred_genome_t genome, void *buffer)
+{
+    unsigned char *ptr = (unsigned char*) buffer;
+    memcpy(ptr, &genome->_circular_offset, sizeof(unsigned int));
+    memcpy(ptr + sizeof(unsigned int), genome->_genes,
+        sizeof(pred_gene_t) * _metadata->genotype_length);
+}
+
+
+/**
+ * Loads genotype stored by `pred_serialize_genome` and calculates
+ * phenotype
+ * @param genome
+ * @param buffer
+ */
+void pred_deserialize_genome(pred_genome_t genome, const void *buffer)
+{
+    const unsigned char *ptr = (const unsigned char*) buffer;
+    memcpy(&genome->_circular_offset, ptr, sizeof(unsigned int));
+    memcpy(genome->_genes, ptr + sizeof(unsigned int),
+        sizeof(pred_gene_t) * _metadata->genotype_length);
+
+    if (_metadata->genome_type == permuted) {
+        memset(genome->_used_values, 0, sizeof(bool) * (_metadata->max_gene_value + 1));
+        for (int i = 0; i < _metadata->genotype_length; i++) {
+            genome->_used_values[genome->_genes[i]] = true;
+        }
+    }
+
+    pred_calculate_phenotype(genome);
+}
+
+
 
 /**
  * Genome mutation function
@@ -325,14 +638,28 @@ void pred_mutate(pred_genome_t genome)
         // choose mutated gene
         int gene = rand_range(0, _metadata->genotype_length - 1);
         pred_gene_t old_value = genome->_genes[gene];
+        pred_gene_t value;
+
+        if (_pred_is_tiled() && rand_range(0, 1) == 0) {
+            // shift to neighbouring tile, keeps locality
+            bool go_up = (old_value == 0) || rand_range(0, 1);
+            if (go_up && old_value < _metadata->max_gene_value) {
+                value = old_value + 1;
+            } else if (old_value > 0) {
+                value = old_value - 1;
+            } else {
+                value = old_value;
+            }
 
-        // generate new value
-        pred_gene_t value = rand_urange(0, _metadata->max_gene_value);
-        if (_metadata->genome_type == permuted) {
-            // either unused or same value is valid, so make corrections
-            while(genome->_used_values[value] && old_value != value) {
-                value = (value + 1) % (_metadata->max_gene_value + 1);
-            };
+        } else {
+            // generate new value
+            value = rand_urange(0, _metadata->max_gene_value);
+            if (_metadata->genome_type == permuted) {
+                // either unused or same value is valid, so make corrections
+                while(genome->_used_values[value] && old_value != value) {
+                    value = (value + 1) % (_metadata->max_gene_value + 1);
+                };
+            }
         }
 
         // rewrite gene
@@ -486,6 +813,47 @@ void _create_combined(ga_pop_t pop, pred_genome_t children)
 }
 
 
+struct _offspring_task {
+    ga_pop_t pop;
+    enum _offspring_op *child_type;
+};
+
+
+static void _offspring_task(void *data, int i)
+{
+    struct _offspring_task *task = (struct _offspring_task*) data;
+    ga_pop_t pop = task->pop;
+
+    VERBOSELOG("Processing child %d.", i);
+
+    // elites are moved after all children are created
+    if (task->child_type[i] == keep_intact) {
+        VERBOSELOG("Child %d is elite.", i);
+        return;
+
+    // if there are any combined children to make, do it
+    } else if (task->child_type[i] == crossover_product) {
+
+        VERBOSELOG("Child %d is crossover.", i);
+
+        pred_genome_t target_genome = (pred_genome_t) pop->children[i]->genome;
+        _create_combined(pop, target_genome);
+        pop->children[i]->has_fitness = false;
+
+    // otherwise create random mutant
+    } else {
+
+        VERBOSELOG("Child %d is random.", i);
+        pred_randomize_genome(pop->children[i]);
+        pop->children[i]->has_fitness = false;
+    }
+
+    // evaluate right away, so the generation does not wait for all
+    // children to be created first
+    ga_evaluate_chr(pop, pop->children[i]);
+}
+
+
 /**
  * Create new generation
  * @param pop
@@ -503,6 +871,7 @@ void pred_offspring(ga_pop_t pop)
     memset(child_type, random_mutant, sizeof(enum _offspring_op) * pop->size);
 
     // find which individuals will be kept intact
+    TIMING_START(start);
     _find_elites(pop, elite_count, child_type);
 
     // find which individuals will be replaced from parents
@@ -516,37 +885,26 @@ void pred_offspring(ga_pop_t pop)
     }
 
     // create new population
-    #pragma omp parallel for
-    for (int i = 0; i < pop->size; i++) {
-        VERBOSELOG("Processing child %d.", i);
+    struct _offspring_task task = {
+        .pop = pop,
+        .child_type = child_type,
+    };
+    ga_parallel_for(pop->size, _offspring_task, &task);
 
-        // copy elites
+    // move elites without copying - parents are not needed anymore,
+    // so just exchange elite chromosome with its child slot
+    for (int i = 0; i < pop->size; i++) {
         if (child_type[i] == keep_intact) {
-            VERBOSELOG("Child %d is elite.", i);
-            ga_copy_chr(pop->children[i], pop->chromosomes[i], pred_copy_genome);
-
-        // if there are any combined children to make, do it
-        } else if (child_type[i] == crossover_product) {
-
-            VERBOSELOG("Child %d is crossover.", i);
-
-            pred_genome_t target_genome = (pred_genome_t) pop->children[i]->genome;
-            _create_combined(pop, target_genome);
-            pop->children[i]->has_fitness = false;
-
-        // otherwise create random mutant
-        } else {
-
-            VERBOSELOG("Child %d is random.", i);
-            pred_randomize_genome(pop->children[i]);
-            pop->children[i]->has_fitness = false;
+            ga_chr_t elite = pop->chromosomes[i];
+            pop->chromosomes[i] = pop->children[i];
+            pop->children[i] = elite;
         }
     }
 
     // switch new and old population
-    ga_chr_t *tmp = pop->chromosomes;
-    pop->chromosomes = pop->children;
-    pop->children = tmp;
+    ga_swap_generations(pop);
+
+    TIMING_STOP(timing_pred_offspring, start);
 }
 
 
@@ -581,3 +939,12 @@ int pred_get_max_length()
 {
     return _metadata->genotype_length;
 }
+
+
+/**
+ * Returns predictors evolution settings and current state
+ */
+pred_metadata_t *pred_get_metadata()
+{
+    return _metadata;
+}
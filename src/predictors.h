@@ -21,6 +21,8 @@
 #pragma once
 
 
+#include <stdint.h>
+
 #include "ga.h"
 #include "image.h"
 
@@ -28,11 +30,25 @@
 static const ga_problem_type_t PRED_PROBLEM_TYPE = minimize;
 
 
+/* number of pixels covered by one block of bitmap phenotype */
+#define PRED_BLOCK_SIZE 32
+
+/* number of pixels (one run) selected by single gene of tiled genotype */
+#define PRED_TILE_SIZE PRED_BLOCK_SIZE
+
+
 /* genome types ***************************************************************/
 
 typedef unsigned int pred_gene_t;
 typedef pred_gene_t* pred_gene_array_t;
 
+/* lane mask of single block, bit i means pixel (block * PRED_BLOCK_SIZE + i) */
+typedef uint32_t pred_block_mask_t;
+
+/* Required to solve circular dependency */
+struct pred_arena;
+typedef struct pred_arena* pred_arena_t;
+
 struct pred_genome {
     /* genotype */
     pred_gene_array_t _genes;
@@ -55,10 +71,66 @@ struct pred_genome {
     /* simd-friendly prepared image data */
     img_pixel_t *original_simd;
     img_pixel_t *pixels_simd[WINDOW_SIZE];
+
+    /*
+        bitmap phenotype (NULL if not used): lane masks of all image
+        blocks and sorted list of blocks with non-zero mask
+     */
+    pred_block_mask_t *block_masks;
+    unsigned int *active_blocks;
+    unsigned int active_blocks_count;
+
+    /* arena owning memory of all arrays above */
+    pred_arena_t _arena;
 };
 typedef struct pred_genome* pred_genome_t;
 
 
+/* arena types ****************************************************************/
+
+
+/**
+ * Predictors arena
+ *
+ * Holds genomes of a whole population (or a single standalone genome)
+ * in one aligned slab. Arrays of the same kind are stored next to each
+ * other (structure of arrays), each array starts on a cache line
+ * boundary, so it is safe to use aligned SIMD loads on them.
+ *
+ * Arrays are sized by maximal genotype length, so the arena survives
+ * genotype used length changes (baldwin) without reallocation.
+ */
+struct pred_arena {
+    /* how many genomes fits into the arena */
+    int capacity;
+
+    /* how many genomes were already handed out */
+    int allocated;
+
+    /* how many genomes were not released yet */
+    int references;
+
+    /* size of one genome's array of given kind, in bytes */
+    size_t genes_stride;
+    size_t used_values_stride;
+    size_t pixels_stride;
+    size_t simd_stride;
+    size_t block_masks_stride;
+    size_t active_blocks_stride;
+
+    /* genome headers */
+    struct pred_genome *genomes;
+
+    /* beginnings of array blocks */
+    unsigned char *genes;
+    unsigned char *used_values;
+    unsigned char *pixels;
+    unsigned char *simd;
+    unsigned char *block_masks;
+    unsigned char *active_blocks;
+};
+
+
 /* metadata types *************************************************************/
 
 
@@ -66,17 +138,36 @@ typedef enum {
     permuted,
     repeated,
     circular,
+
+    /* genes select runs of PRED_TILE_SIZE pixels, otherwise like repeated */
+    tiled,
+    tiled_circular,
 } pred_genome_type_t;
 
 
+typedef enum {
+    /* selected pixels are copied into per-predictor simd arrays */
+    gathered,
+
+    /* pixels are described by block bitmap, evaluated on image planes */
+    bitmap,
+} pred_phenotype_t;
+
+
 typedef struct {
     /* genome type */
     pred_genome_type_t genome_type;
 
+    /* phenotype representation used for simd evaluation */
+    pred_phenotype_t phenotype;
+
     /* maximal gene value (inclusive) */
     pred_gene_t max_gene_value;
 
-    /* genotype length */
+    /* number of image pixels */
+    unsigned int image_size;
+
+    /* genotype length (in genes, which are tiles for tiled genotypes) */
     unsigned int genotype_length;
 
     /* genotype used portion length */
@@ -111,6 +202,10 @@ ga_pop_t pred_init_pop(int pop_size);
 
 /**
  * Allocates memory for new predictor genome
+ *
+ * If there is an arena being filled (during `pred_init_pop`), genome
+ * is taken from it, otherwise standalone single-genome arena is created.
+ *
  * @return pointer to newly allocated genome
  */
 void* pred_alloc_genome();
@@ -130,6 +225,15 @@ void pred_free_genome(void *genome);
 void pred_calculate_phenotype(pred_genome_t genome);
 
 
+/**
+ * Returns whether both genomes select the same pixels
+ * @param  a
+ * @param  b
+ * @return
+ */
+bool pred_phenotype_equals(pred_genome_t a, pred_genome_t b);
+
+
 /**
  * Recalculates phenotype for repeated genotype in whole population
  */
@@ -152,6 +256,30 @@ int pred_randomize_genome(ga_chr_t chromosome);
 void pred_copy_genome(void *_dst, void *_src);
 
 
+/**
+ * Returns size of serialized genome in bytes
+ * @return
+ */
+size_t pred_serialized_size();
+
+
+/**
+ * Stores genotype into flat buffer, e.g. to send it to other process
+ * @param genome
+ * @param buffer At least `pred_serialized_size()` bytes
+ */
+void pred_serialize_genome(pred_genome_t genome, void *buffer);
+
+
+/**
+ * Loads genotype stored by `pred_serialize_genome` and calculates
+ * phenotype
+ * @param genome
+ * @param buffer
+ */
+void pred_deserialize_genome(pred_genome_t genome, const void *buffer);
+
+
 /**
  * Genome mutation function
  *
@@ -188,3 +316,9 @@ int pred_get_length();
  * Returns maximal genome length.
  */
 int pred_get_max_length();
+
+
+/**
+ * Returns predictors evolution settings and current state
+ */
+pred_metadata_t *pred_get_metadata();
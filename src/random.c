@@ -0,0 +1,95 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <pthread.h>
+
+#include "random.h"
+
+
+// generator state, used instead of the libc internal one, so it can be saved
+static char _state[RAND_STATE_SIZE];
+static struct random_data _data;
+
+// shared by all threads, state must not be copied in the middle of a step
+static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * Initializes random seed using given value.
+ * @return used random seed
+ */
+unsigned int rand_init_seed(unsigned int seed)
+{
+    pthread_mutex_lock(&_lock);
+    memset(&_data, 0, sizeof(_data));
+    initstate_r(seed, _state, RAND_STATE_SIZE, &_data);
+    pthread_mutex_unlock(&_lock);
+    return seed;
+}
+
+
+/**
+ * Returns next number from the generator, same as random()
+ * @return number between 0 and RAND_MAX
+ */
+long rand_next(void)
+{
+    int32_t result;
+    pthread_mutex_lock(&_lock);
+    if (_data.state == NULL) {
+        // not seeded yet, behave like random() without srandom()
+        initstate_r(1, _state, RAND_STATE_SIZE, &_data);
+    }
+    random_r(&_data, &result);
+    pthread_mutex_unlock(&_lock);
+    return result;
+}
+
+
+/**
+ * Copies current generator state, consistent even if other threads are
+ * drawing numbers
+ * @param buffer At least RAND_STATE_SIZE bytes
+ */
+void rand_save_state(void *buffer)
+{
+    // setstate_r() stores current position into the state array
+    pthread_mutex_lock(&_lock);
+    setstate_r(_state, &_data);
+    memcpy(buffer, _state, RAND_STATE_SIZE);
+    pthread_mutex_unlock(&_lock);
+}
+
+
+/**
+ * Restores generator state saved by `rand_save_state`
+ * @param buffer
+ */
+void rand_load_state(const void *buffer)
+{
+    pthread_mutex_lock(&_lock);
+    memcpy(_state, buffer, RAND_STATE_SIZE);
+    setstate_r(_state, &_data);
+    pthread_mutex_unlock(&_lock);
+}
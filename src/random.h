@@ -40,15 +40,41 @@ static inline unsigned int rand_seed_from_time()
 }
 
 
+/*
+    Size of generator state. 128 bytes is the glibc default, so sequences
+    are the same as with plain srand(). The state can be stored into
+    a checkpoint and restored later.
+ */
+#define RAND_STATE_SIZE 128
+
+
 /**
  * Initializes random seed using given value.
  * @return used random seed
  */
-static inline unsigned int rand_init_seed(unsigned int seed)
-{
-    srand(seed);
-    return seed;
-}
+unsigned int rand_init_seed(unsigned int seed);
+
+
+/**
+ * Returns next number from the generator, same as random()
+ * @return number between 0 and RAND_MAX
+ */
+long rand_next(void);
+
+
+/**
+ * Copies current generator state, generator is locked meanwhile, so the
+ * state is consistent even if other threads are drawing numbers
+ * @param buffer At least RAND_STATE_SIZE bytes
+ */
+void rand_save_state(void *buffer);
+
+
+/**
+ * Restores generator state saved by `rand_save_state`
+ * @param buffer
+ */
+void rand_load_state(const void *buffer);
 
 
 /**
@@ -70,7 +96,7 @@ static inline unsigned int rand_init()
  */
 static inline int rand_range(int low, int high)
 {
-    return rand() % (high - low + 1) + low;
+    return rand_next() % (high - low + 1) + low;
 }
 
 
@@ -82,7 +108,7 @@ static inline int rand_range(int low, int high)
  */
 static inline unsigned int rand_urange(unsigned int low, unsigned int high)
 {
-    return rand() % (high - low + 1) + low;
+    return rand_next() % (high - low + 1) + low;
 }
 
 
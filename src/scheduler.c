@@ -0,0 +1,156 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+#include "ga.h"
+#include "scheduler.h"
+
+
+static double _sched_elapsed(struct timespec *from, struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+
+/**
+ * Initializes scheduler and splits workers
+ * @param sched
+ * @param workers Total number of workers, zero for number of CPUs
+ * @param interval Rebalancing interval in CGP generations
+ * @param coevolution Whether predictors evolution runs at all
+ */
+void sched_init(sched_t *sched, int workers, int interval, bool coevolution)
+{
+    if (workers <= 0) {
+        #ifdef _OPENMP
+            workers = omp_get_num_procs();
+        #else
+            workers = 1;
+        #endif
+    }
+
+    sched->workers = workers;
+    sched->interval = coevolution? interval : 0;
+
+    if (!coevolution) {
+        atomic_init(&sched->cgp_workers, workers);
+        atomic_init(&sched->pred_workers, 0);
+
+    } else if (workers < 2) {
+        // cannot be split, both threads share single worker
+        atomic_init(&sched->cgp_workers, 1);
+        atomic_init(&sched->pred_workers, 1);
+
+    } else {
+        // CGP evaluation is the heavier one
+        int pred_workers = workers / 2;
+        atomic_init(&sched->cgp_workers, workers - pred_workers);
+        atomic_init(&sched->pred_workers, pred_workers);
+    }
+
+    atomic_init(&sched->pred_improvements, 0);
+    sched->last_generation = 0;
+    sched->last_pred_improvements = 0;
+    sched->cgp_generation_rate = 0;
+    sched->pred_improvement_rate = 0;
+    clock_gettime(CLOCK_MONOTONIC, &sched->last_time);
+}
+
+
+/**
+ * Applies CGP budget to parallel regions of calling thread
+ * @param sched
+ */
+void sched_apply_cgp(sched_t *sched)
+{
+    ga_set_workers(atomic_load(&sched->cgp_workers));
+}
+
+
+/**
+ * Applies predictors budget to parallel regions of calling thread
+ * @param sched
+ */
+void sched_apply_pred(sched_t *sched)
+{
+    ga_set_workers(atomic_load(&sched->pred_workers));
+}
+
+
+/**
+ * Measures throughput and moves one worker between sides if necessary
+ *
+ * @param sched
+ * @param generation Current CGP generation
+ * @return Whether budgets have changed
+ */
+bool sched_rebalance(sched_t *sched, int generation)
+{
+    if (sched->interval <= 0 || generation - sched->last_generation < sched->interval) {
+        return false;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = _sched_elapsed(&sched->last_time, &now);
+    if (elapsed <= 0) {
+        return false;
+    }
+
+    long improvements = atomic_load(&sched->pred_improvements);
+    int generations = generation - sched->last_generation;
+
+    sched->cgp_generation_rate = generations / elapsed;
+    sched->pred_improvement_rate = (improvements - sched->last_pred_improvements) / elapsed;
+
+    sched->last_generation = generation;
+    sched->last_pred_improvements = improvements;
+    sched->last_time = now;
+
+    if (sched->workers < 2) {
+        return false;
+    }
+
+    int cgp_workers = atomic_load(&sched->cgp_workers);
+    int pred_workers = atomic_load(&sched->pred_workers);
+
+    // improvements per CGP generation
+    double ratio = sched->pred_improvement_rate / sched->cgp_generation_rate;
+
+    if (ratio > SCHED_PRED_BUSY_RATIO && cgp_workers > 1) {
+        cgp_workers--;
+        pred_workers++;
+
+    } else if (ratio < SCHED_PRED_IDLE_RATIO && pred_workers > 1) {
+        cgp_workers++;
+        pred_workers--;
+
+    } else {
+        return false;
+    }
+
+    atomic_store(&sched->cgp_workers, cgp_workers);
+    atomic_store(&sched->pred_workers, pred_workers);
+    return true;
+}
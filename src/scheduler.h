@@ -0,0 +1,113 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+
+#include <time.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+
+/*
+    Predictor archive improvements per CGP generation. If predictors
+    improve more often, they are given one more worker, if they improve
+    less often, one of their workers is given back to CGP.
+ */
+static const double SCHED_PRED_BUSY_RATIO = 0.05;
+static const double SCHED_PRED_IDLE_RATIO = 0.01;
+
+
+/**
+ * Worker budgets of CGP and predictors evolution
+ *
+ * Budgets are only changed by CGP thread (in `sched_rebalance`), each side
+ * applies its own budget to its parallel regions.
+ */
+typedef struct {
+    /* total number of workers */
+    int workers;
+
+    /* rebalancing interval in CGP generations, zero to disable */
+    int interval;
+
+    /* current budgets */
+    atomic_int cgp_workers;
+    atomic_int pred_workers;
+
+    /* predictor archive improvements so far */
+    atomic_long pred_improvements;
+
+    /* state at the beginning of current measurement interval */
+    int last_generation;
+    long last_pred_improvements;
+    struct timespec last_time;
+
+    /* throughput measured in last interval */
+    double cgp_generation_rate;
+    double pred_improvement_rate;
+} sched_t;
+
+
+/**
+ * Initializes scheduler and splits workers
+ * @param sched
+ * @param workers Total number of workers, zero for number of CPUs
+ * @param interval Rebalancing interval in CGP generations
+ * @param coevolution Whether predictors evolution runs at all
+ */
+void sched_init(sched_t *sched, int workers, int interval, bool coevolution);
+
+
+/**
+ * Applies CGP budget to parallel regions of calling thread
+ * @param sched
+ */
+void sched_apply_cgp(sched_t *sched);
+
+
+/**
+ * Applies predictors budget to parallel regions of calling thread
+ * @param sched
+ */
+void sched_apply_pred(sched_t *sched);
+
+
+/**
+ * Notes predictor archive improvement
+ * @param sched
+ */
+static inline void sched_pred_improved(sched_t *sched)
+{
+    atomic_fetch_add(&sched->pred_improvements, 1);
+}
+
+
+/**
+ * Measures throughput and moves one worker between sides if necessary
+ *
+ * Must be called from CGP thread only.
+ *
+ * @param sched
+ * @param generation Current CGP generation
+ * @return Whether budgets have changed
+ */
+bool sched_rebalance(sched_t *sched, int generation);
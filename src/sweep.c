@@ -0,0 +1,325 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+// sched_setaffinity, CPU_* macros
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "sweep.h"
+#include "utils.h"
+
+
+typedef struct {
+    char **lines;
+    int count;
+} _sweep_jobs_t;
+
+
+/**
+ * Reads non-empty, non-comment lines of jobs file
+ * @return 0 on success
+ */
+static int _sweep_read_jobs(const char *jobs_file, _sweep_jobs_t *jobs)
+{
+    FILE *fp = fopen(jobs_file, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open sweep file %s: %s\n", jobs_file, strerror(errno));
+        return -1;
+    }
+
+    char line[SWEEP_LINE_LENGTH];
+    int capacity = 0;
+    jobs->lines = NULL;
+    jobs->count = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        char *start = line + strspn(line, " \t");
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        if (jobs->count == capacity) {
+            capacity = capacity? capacity * 2 : 16;
+            char **lines = realloc(jobs->lines, sizeof(char*) * capacity);
+            if (lines == NULL) break;
+            jobs->lines = lines;
+        }
+
+        jobs->lines[jobs->count] = strdup(start);
+        if (jobs->lines[jobs->count] == NULL) break;
+        jobs->count++;
+    }
+
+    bool failed = !feof(fp);
+    fclose(fp);
+
+    if (failed) {
+        fprintf(stderr, "Failed to read sweep file %s.\n", jobs_file);
+        return -1;
+    }
+    return 0;
+}
+
+
+static void _sweep_free_jobs(_sweep_jobs_t *jobs)
+{
+    for (int i = 0; i < jobs->count; i++) {
+        free(jobs->lines[i]);
+    }
+    free(jobs->lines);
+}
+
+
+/**
+ * Restricts calling process to CPUs of given slot
+ * @param  allowed CPUs available to whole sweep
+ * @param  slot
+ * @param  slots Number of slots (simultaneously running jobs)
+ * @return Number of CPUs of the slot
+ */
+static int _sweep_bind_slot(cpu_set_t *allowed, int slot, int slots)
+{
+    int cpus = CPU_COUNT(allowed);
+    int first, last;
+
+    if (slots <= cpus) {
+        // contiguous range, sizes differ by one at most
+        first = slot * cpus / slots;
+        last = (slot + 1) * cpus / slots;
+    } else {
+        first = slot % cpus;
+        last = first + 1;
+    }
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu = 0, index = 0; cpu < CPU_SETSIZE && index < last; cpu++) {
+        if (!CPU_ISSET(cpu, allowed)) continue;
+        if (index >= first) CPU_SET(cpu, &mask);
+        index++;
+    }
+
+    // binding is only a hint
+    sched_setaffinity(0, sizeof(mask), &mask);
+    return last - first;
+}
+
+
+/**
+ * Applies job options to configuration. Called in child process.
+ * @return 0 on success
+ */
+static int _sweep_configure_job(int job, char *line, config_t *cfg,
+    char *program, int cpus)
+{
+    char *argv[SWEEP_MAX_ARGS + 2] = { program };
+    int argc = 1;
+    char *saveptr;
+
+    for (char *arg = strtok_r(line, " \t", &saveptr); arg;
+        arg = strtok_r(NULL, " \t", &saveptr))
+    {
+        if (argc == SWEEP_MAX_ARGS + 1) {
+            fprintf(stderr, "Job %d: too many options.\n", job);
+            return -1;
+        }
+        argv[argc++] = arg;
+    }
+
+    config_t base = *cfg;
+
+    // restart option parsing
+    optind = 0;
+    if (config_load_args(argc, argv, cfg) != cfg_ok) {
+        fprintf(stderr, "Job %d: invalid options.\n", job);
+        return -1;
+    }
+
+    // training data are already prepared
+    if (strcmp(cfg->input_image, base.input_image) != 0
+        || strcmp(cfg->noisy_image, base.noisy_image) != 0)
+    {
+        fprintf(stderr, "Job %d: sweep jobs cannot change images.\n", job);
+        return -1;
+    }
+
+    if (strcmp(cfg->log_dir, base.log_dir) == 0) {
+        int length = snprintf(cfg->log_dir, sizeof(cfg->log_dir), "%s/job-%03d",
+            strlen(base.log_dir)? base.log_dir : "sweep", job);
+        if (length >= (int) sizeof(cfg->log_dir)) {
+            fprintf(stderr, "Job %d: log dir name is too long.\n", job);
+            return -1;
+        }
+    }
+
+    if (cfg->workers == 0) {
+        cfg->workers = cpus;
+    }
+
+    cfg->sweep_file[0] = '\0';
+    return 0;
+}
+
+
+/**
+ * Runs jobs listed in file, each in its own child process. At most
+ * `concurrency` jobs run at once, CPUs of this process are split evenly
+ * between them.
+ *
+ * In child process, job options are applied to `cfg` and the function
+ * returns, so the caller continues with normal run.
+ *
+ * @param  jobs_file One job per line, options applied on top of `cfg`
+ * @param  concurrency Number of simultaneously running jobs, zero
+ *                     for number of CPUs
+ * @param  cfg Configuration loaded from command line
+ * @param  program Program name used in option parsing messages
+ * @return Job index (>= 0) in child process. In parent process, after all
+ *         jobs finish, SWEEP_DONE if all of them succeeded or SWEEP_FAILED.
+ */
+int sweep_run(const char *jobs_file, int concurrency, config_t *cfg,
+    char *program)
+{
+    _sweep_jobs_t jobs;
+    if (_sweep_read_jobs(jobs_file, &jobs) != 0) {
+        return SWEEP_FAILED;
+    }
+
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        CPU_ZERO(&allowed);
+        CPU_SET(0, &allowed);
+    }
+
+    if (concurrency <= 0) {
+        concurrency = CPU_COUNT(&allowed);
+    }
+    if (concurrency > jobs.count) {
+        concurrency = jobs.count;
+    }
+
+    // jobs without their own log dir use subdirectories
+    const char *base_dir = strlen(cfg->log_dir)? cfg->log_dir : "sweep";
+    int create_dir_retval = create_dir(base_dir);
+    if (create_dir_retval != 0) {
+        fprintf(stderr, "Error initializing results directory: %s\n", strerror(create_dir_retval));
+        _sweep_free_jobs(&jobs);
+        return SWEEP_FAILED;
+    }
+
+    printf("Sweep: %d jobs, %d at once, %d CPUs\n", jobs.count, concurrency,
+        CPU_COUNT(&allowed));
+
+    pid_t slot_pids[concurrency];
+    int slot_jobs[concurrency];
+    for (int i = 0; i < concurrency; i++) {
+        slot_pids[i] = 0;
+    }
+
+    int next = 0;
+    int running = 0;
+    int failed = 0;
+
+    while (next < jobs.count || running > 0) {
+        if (next < jobs.count && running < concurrency) {
+            int slot = 0;
+            while (slot_pids[slot] != 0) slot++;
+
+            // do not duplicate buffered output in child
+            fflush(stdout);
+            fflush(stderr);
+
+            pid_t pid = fork();
+            if (pid == 0) {
+                int cpus = _sweep_bind_slot(&allowed, slot, concurrency);
+                int job = next;
+                int retval = _sweep_configure_job(job, jobs.lines[job], cfg, program, cpus);
+                _sweep_free_jobs(&jobs);
+                if (retval != 0) {
+                    _exit(1);
+                }
+
+                // results are in log dir
+                if (freopen("/dev/null", "w", stdout) == NULL) {
+                    _exit(1);
+                }
+                return job;
+            }
+
+            if (pid < 0) {
+                fprintf(stderr, "Job %d: failed to start: %s\n", next, strerror(errno));
+                failed++;
+            } else {
+                printf("Job %d started (pid %d): %s\n", next, (int) pid, jobs.lines[next]);
+                slot_pids[slot] = pid;
+                slot_jobs[slot] = next;
+                running++;
+            }
+            next++;
+            continue;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+
+            // results of remaining jobs cannot be collected
+            fprintf(stderr, "Sweep: failed to wait for %d jobs: %s\n", running, strerror(errno));
+            failed += running;
+            break;
+        }
+
+        for (int slot = 0; slot < concurrency; slot++) {
+            if (slot_pids[slot] != pid) continue;
+
+            bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            if (WIFEXITED(status)) {
+                printf("Job %d finished with exit code %d\n", slot_jobs[slot], WEXITSTATUS(status));
+            } else if (WIFSIGNALED(status)) {
+                printf("Job %d killed by signal %d (%s)\n", slot_jobs[slot],
+                    WTERMSIG(status), strsignal(WTERMSIG(status)));
+            } else {
+                printf("Job %d terminated\n", slot_jobs[slot]);
+            }
+            fflush(stdout);
+
+            if (!ok) failed++;
+            slot_pids[slot] = 0;
+            running--;
+        }
+    }
+
+    printf("Sweep: %d of %d jobs failed\n", failed, jobs.count);
+
+    _sweep_free_jobs(&jobs);
+    return failed? SWEEP_FAILED : SWEEP_DONE;
+}
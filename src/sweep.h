@@ -0,0 +1,63 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+
+#include "config.h"
+
+
+/*
+    Sweep runs many jobs on the same images. Everything loaded before
+    `sweep_run` is called (images and preprocessed training data) is
+    shared by jobs, which are forked from the calling process.
+ */
+
+
+// maximal length of single line of jobs file
+#define SWEEP_LINE_LENGTH 4096
+
+// maximal number of options of single job
+#define SWEEP_MAX_ARGS 128
+
+// `sweep_run` return values in parent process
+#define SWEEP_DONE -1
+#define SWEEP_FAILED -2
+
+
+/**
+ * Runs jobs listed in file, each in its own child process. At most
+ * `concurrency` jobs run at once, CPUs of this process are split evenly
+ * between them.
+ *
+ * In child process, job options are applied to `cfg` and the function
+ * returns, so the caller continues with normal run.
+ *
+ * @param  jobs_file One job per line, options applied on top of `cfg`
+ * @param  concurrency Number of simultaneously running jobs, zero
+ *                     for number of CPUs
+ * @param  cfg Configuration loaded from command line
+ * @param  program Program name used in option parsing messages
+ * @return Job index (>= 0) in child process. In parent process, after all
+ *         jobs finish, SWEEP_DONE if all of them succeeded or SWEEP_FAILED.
+ */
+int sweep_run(const char *jobs_file, int concurrency, config_t *cfg,
+    char *program);
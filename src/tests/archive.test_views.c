@@ -0,0 +1,86 @@
+/**
+ * Tests archive views - reader keeps its snapshot while writer publishes.
+ * Source files archive.c fitness_cache.c ga.c pool.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../archive.h"
+
+
+void* int_alloc()
+{
+    return malloc(sizeof(int));
+}
+
+
+void int_free(void *genome)
+{
+    free(genome);
+}
+
+
+void int_copy(void *dst, void *src)
+{
+    *(int*) dst = *(int*) src;
+}
+
+
+void print_view(const char *name, arc_view_t view)
+{
+    printf("%s: version %lu, stored %d:", name, view->version, view->stored);
+    for (int i = 0; i < view->stored; i++) {
+        printf(" %d", *(int*) arc_view_get(view, i)->genome);
+    }
+    printf("\n");
+}
+
+
+int main(int argc, char const *argv[])
+{
+    arc_func_vect_t methods = {
+        .alloc_genome = int_alloc,
+        .free_genome = int_free,
+        .copy_genome = int_copy,
+    };
+    archive_t arc = arc_create(2, 1, methods, maximize);
+
+    int value = 0;
+    struct ga_chr chr = {
+        .has_fitness = true,
+        .genome = &value,
+    };
+
+    for (value = 1; value <= 2; value++) {
+        chr.fitness = value;
+        arc_insert(arc, &chr);
+    }
+
+    arc_view_t held = arc_read_begin(arc);
+    print_view("Held", held);
+
+    for (value = 3; value <= 5; value++) {
+        chr.fitness = value;
+        arc_insert(arc, &chr);
+        print_view("Published", arc_current(arc));
+        print_view("Held", held);
+    }
+
+    arc_read_end(arc);
+
+    chr.fitness = value;
+    arc_insert(arc, &chr);
+    print_view("Published", arc_current(arc));
+
+    // fitness update keeps content version
+    arc_update_fitness(arc, 0, 10);
+    print_view("Updated", arc_current(arc));
+    printf("Updated fitness: %g\n", arc_get(arc, 0)->fitness);
+
+    printf("Best: %d\n", *(int*) arc->best_chromosome_ever->genome);
+    printf("Waits: %ld\n", arc->waits);
+
+    arc_destroy(arc);
+    return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * Tests C source dump - generated filter is compiled with scalar, SSE2
+ * and AVX2 kernels and must give the same image as `cgp_get_output`.
+ * Source files cgp/cgp_core.c cgp/cgp_program.c cgp/cgp_dump.c ga.c pool.c random.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../cgp/cgp.h"
+#include "../random.h"
+
+
+#define WIDTH 75
+#define HEIGHT 9
+
+
+static const char *driver =
+    "#include <stdio.h>\n"
+    "#include <stdint.h>\n"
+    "void coco_filter_image(const uint8_t *src, uint8_t *dst, int width, int height);\n"
+    "int main(int argc, char *argv[])\n"
+    "{\n"
+    "    static uint8_t src[75 * 9], dst[75 * 9];\n"
+    "    FILE *fp = fopen(argv[1], \"rb\");\n"
+    "    if (!fp || fread(src, 1, sizeof(src), fp) != sizeof(src)) return 1;\n"
+    "    fclose(fp);\n"
+    "    coco_filter_image(src, dst, 75, 9);\n"
+    "    fp = fopen(argv[2], \"wb\");\n"
+    "    if (!fp || fwrite(dst, 1, sizeof(dst), fp) != sizeof(dst)) return 1;\n"
+    "    fclose(fp);\n"
+    "    return 0;\n"
+    "}\n";
+
+
+static int clamp(int value, int max)
+{
+    if (value < 0) return 0;
+    if (value > max) return max;
+    return value;
+}
+
+
+/**
+ * Filters image using reference evaluation
+ */
+static void filter_reference(ga_chr_t chr, cgp_value_t *src, cgp_value_t *dst)
+{
+    cgp_value_t inputs[CGP_INPUTS];
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int sx = clamp(x + dx, WIDTH - 1);
+                    int sy = clamp(y + dy, HEIGHT - 1);
+                    inputs[3 * (dy + 1) + (dx + 1)] = src[sy * WIDTH + sx];
+                }
+            }
+            cgp_get_output(chr, inputs, &dst[y * WIDTH + x]);
+        }
+    }
+}
+
+
+/**
+ * Compiles generated source with given flags and filters image with it
+ * @return number of mismatching pixels, -1 on error
+ */
+static int filter_generated(const char *dir, const char *flags,
+    cgp_value_t *expected)
+{
+    char command[1024];
+    snprintf(command, sizeof(command),
+        "cc -std=c99 -O2 -Wall -Werror %s -o %s/filter %s/filter.c %s/driver.c"
+        " && %s/filter %s/input.raw %s/output.raw",
+        flags, dir, dir, dir, dir, dir, dir);
+    if (system(command) != 0) {
+        return -1;
+    }
+
+    cgp_value_t output[WIDTH * HEIGHT];
+    snprintf(command, sizeof(command), "%s/output.raw", dir);
+    FILE *fp = fopen(command, "rb");
+    if (!fp || fread(output, 1, sizeof(output), fp) != sizeof(output)) {
+        return -1;
+    }
+    fclose(fp);
+
+    int mismatches = 0;
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        mismatches += output[i] != expected[i];
+    }
+    return mismatches;
+}
+
+
+int main(int argc, char const *argv[])
+{
+    cgp_value_t image[WIDTH * HEIGHT];
+    cgp_value_t expected[WIDTH * HEIGHT];
+    char path[256];
+    FILE *fp;
+
+    rand_init_seed(42);
+    cgp_init(5, NULL);
+    cgp_set_functions(CGP_FUNC_SET_ALL);
+    ga_chr_t chr = ga_alloc_chr(cgp_alloc_genome);
+
+    char dir[] = "/tmp/cocotest_dump_c_XXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s/driver.c", dir);
+    fp = fopen(path, "wt");
+    fputs(driver, fp);
+    fclose(fp);
+
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        image[i] = rand_range(0, 255);
+    }
+    snprintf(path, sizeof(path), "%s/input.raw", dir);
+    fp = fopen(path, "wb");
+    fwrite(image, 1, sizeof(image), fp);
+    fclose(fp);
+
+    const char *flags[] = {
+        "-DCOCO_FILTER_NO_SIMD",
+        "-msse2",
+        "-mavx2",
+    };
+
+    // one circuit per function with all nodes set to it, then random ones
+    int mismatches[3] = {0};
+    int errors = 0;
+    for (int c = 0; c < CGP_FUNC_COUNT + 4; c++) {
+        cgp_randomize_genome(chr);
+        if (c < CGP_FUNC_COUNT) {
+            cgp_genome_t genome = (cgp_genome_t) chr->genome;
+            for (int i = 0; i < CGP_NODES; i++) {
+                genome->nodes[i].function = (cgp_func_t) c;
+            }
+            cgp_find_active_blocks(chr);
+        }
+        filter_reference(chr, image, expected);
+
+        snprintf(path, sizeof(path), "%s/filter.c", dir);
+        fp = fopen(path, "wt");
+        cgp_dump_chr(chr, fp, c_source);
+        fclose(fp);
+
+        for (int f = 0; f < 3; f++) {
+            if (f == 2 && !__builtin_cpu_supports("avx2")) {
+                continue;
+            }
+            int result = filter_generated(dir, flags[f], expected);
+            if (result < 0) {
+                errors++;
+            } else {
+                mismatches[f] += result;
+            }
+        }
+    }
+
+    printf("Errors: %d\n", errors);
+    printf("Mismatches scalar: %d\n", mismatches[0]);
+    printf("Mismatches SSE2: %d\n", mismatches[1]);
+    printf("Mismatches AVX2: %d\n", mismatches[2]);
+
+    snprintf(path, sizeof(path), "rm -rf %s", dir);
+    if (system(path) != 0) {
+        printf("Failed to remove temporary directory\n");
+    }
+
+    ga_destroy_chr(chr, cgp_free_genome);
+    cgp_deinit();
+    return 0;
+}
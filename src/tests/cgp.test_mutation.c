@@ -0,0 +1,85 @@
+/**
+ * Tests CGP mutation strategies - active and single mutations must always
+ * change some gene of active node or output, statistics must match.
+ * Source files cgp/cgp_core.c ga.c pool.c random.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../cgp/cgp.h"
+#include "../random.h"
+
+
+#define MUTATIONS 5000
+
+
+/**
+ * Returns whether child differs from parent in gene of node active
+ * in parent or in primary output
+ */
+static bool active_changed(cgp_genome_t parent, cgp_genome_t child)
+{
+    for (int i = 0; i < CGP_NODES; i++) {
+        if (cgp_node_is_active(parent, i)
+            && memcmp(&parent->nodes[i], &child->nodes[i], sizeof(cgp_node_t)) != 0) {
+            return true;
+        }
+    }
+    return memcmp(parent->outputs, child->outputs, sizeof(parent->outputs)) != 0;
+}
+
+
+static void test_strategy(cgp_mutation_t strategy, ga_chr_t parent, ga_chr_t child)
+{
+    cgp_mutation_stats_t before, after;
+    long neutral = 0;
+
+    cgp_set_mutation(strategy);
+    cgp_get_mutation_stats(&before);
+
+    for (int i = 0; i < MUTATIONS; i++) {
+        if (i % 100 == 0) {
+            cgp_randomize_genome(parent);
+        }
+        cgp_copy_genome(child->genome, parent->genome);
+        cgp_mutate_chr(child);
+        if (!active_changed(parent->genome, child->genome)) {
+            neutral++;
+        }
+    }
+
+    cgp_get_mutation_stats(&after);
+    long chromosomes = after.chromosomes - before.chromosomes;
+    long neutral_chromosomes = after.neutral_chromosomes - before.neutral_chromosomes;
+    long effective_genes = after.effective_genes - before.effective_genes;
+
+    printf("%s: chromosomes %ld, neutral %s, stats match: %s",
+        strategy == mutation_point? "point" : strategy == mutation_active? "active" : "single",
+        chromosomes,
+        neutral? "some" : "none",
+        neutral == neutral_chromosomes? "yes" : "no");
+    if (strategy == mutation_single) {
+        printf(", one effective gene: %s", effective_genes == chromosomes? "yes" : "no");
+    }
+    printf("\n");
+}
+
+
+int main(int argc, char const *argv[])
+{
+    rand_init_seed(42);
+    cgp_init(5, NULL);
+    ga_chr_t parent = ga_alloc_chr(cgp_alloc_genome);
+    ga_chr_t child = ga_alloc_chr(cgp_alloc_genome);
+
+    test_strategy(mutation_point, parent, child);
+    test_strategy(mutation_active, parent, child);
+    test_strategy(mutation_single, parent, child);
+
+    ga_destroy_chr(parent, cgp_free_genome);
+    ga_destroy_chr(child, cgp_free_genome);
+    cgp_deinit();
+    return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * Tests CGP evaluation program - simplified program must give the same
+ * outputs as direct evaluation of genome.
+ * Source files cgp/cgp_core.c cgp/cgp_program.c ga.c pool.c random.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../cgp/cgp.h"
+#include "../random.h"
+
+
+/**
+ * Builds genome where every node reads previous one (or primary inputs
+ * in first column), with given functions in first column
+ */
+static void set_chain(ga_chr_t chr, cgp_func_t first, cgp_func_t rest)
+{
+    cgp_genome_t genome = (cgp_genome_t) chr->genome;
+    for (int i = 0; i < CGP_NODES; i++) {
+        cgp_node_t *n = &(genome->nodes[i]);
+        int col = cgp_node_col(i);
+        if (col == 0) {
+            n->inputs[0] = i;
+            n->inputs[1] = i;
+            n->function = first;
+        } else {
+            n->inputs[0] = CGP_INPUTS + i - CGP_ROWS;
+            n->inputs[1] = CGP_INPUTS + i - CGP_ROWS;
+            n->function = rest;
+        }
+    }
+    genome->outputs[0] = CGP_INPUTS + CGP_NODES - 1;
+    cgp_find_active_blocks(chr);
+}
+
+
+int main(int argc, char const *argv[])
+{
+    cgp_program_t program;
+    cgp_value_t inputs[CGP_INPUTS];
+    cgp_value_t expected[CGP_OUTPUTS];
+    cgp_value_t outputs[CGP_OUTPUTS];
+
+    rand_init_seed(42);
+    cgp_init(5, NULL);
+    cgp_set_functions(CGP_FUNC_SET_ALL);
+    ga_chr_t chr = ga_alloc_chr(cgp_alloc_genome);
+
+    // identity chain collapses to primary input
+    set_chain(chr, identity, identity);
+    cgp_program_build(&program, chr);
+    printf("identity chain: %d instructions, output slot %d\n",
+        program.length, program.outputs[0]);
+
+    // double inversions cancel out
+    set_chain(chr, inversion, inversion);
+    cgp_program_build(&program, chr);
+    printf("inversion chain: %d instructions\n", program.length);
+
+    // constant is folded through the chain
+    set_chain(chr, c255, rshift1);
+    cgp_program_build(&program, chr);
+    printf("c255 >> 1 chain: %d instructions, constant %u\n",
+        program.length, program.constants[0]);
+
+    // x ^ x is zero, which is then folded through x & x
+    set_chain(chr, b_xor, b_and);
+    cgp_program_build(&program, chr);
+    printf("xor, and chain: %d instructions\n", program.length);
+
+    // averages are never folded
+    set_chain(chr, c255, avg);
+    cgp_program_build(&program, chr);
+    printf("c255, avg chain: %d instructions\n", program.length);
+
+    // whole chain depends on single input and becomes one table
+    set_chain(chr, inversion, add_sat);
+    cgp_program_build(&program, chr);
+    int length = program.length;
+    cgp_program_collapse_luts(&program, CGP_LUT_MIN_LENGTH_SCALAR);
+    printf("inversion, add_sat chain: %d instructions, with tables %d (%d tables)\n",
+        length, program.length, program.luts_count);
+
+    // short chains are kept
+    cgp_program_build(&program, chr);
+    cgp_program_collapse_luts(&program, CGP_NODES + 1);
+    printf("inversion, add_sat chain, long tables only: %d tables\n",
+        program.luts_count);
+
+    // averages are not tabulated
+    set_chain(chr, inversion, avg);
+    cgp_program_build(&program, chr);
+    cgp_program_collapse_luts(&program, CGP_LUT_MIN_LENGTH_SCALAR);
+    printf("inversion, avg chain: %d tables\n", program.luts_count);
+
+    // random circuits
+    cgp_program_t lut_program;
+    int mismatches = 0;
+    int lut_mismatches = 0;
+    long shorter = 0;
+    long luts = 0;
+    for (int c = 0; c < 2000; c++) {
+        cgp_randomize_genome(chr);
+        cgp_program_build(&program, chr);
+
+        cgp_genome_t genome = (cgp_genome_t) chr->genome;
+        int active = __builtin_popcountll(genome->active);
+        if (program.length > active) {
+            printf("Program longer than active part!\n");
+        }
+        shorter += active - program.length;
+
+        lut_program = program;
+        cgp_program_collapse_luts(&lut_program, CGP_LUT_MIN_LENGTH_SCALAR);
+        luts += lut_program.luts_count;
+
+        for (int t = 0; t < 100; t++) {
+            for (int i = 0; i < CGP_INPUTS; i++) {
+                inputs[i] = rand_range(0, 255);
+            }
+            cgp_get_output(chr, inputs, expected);
+            cgp_program_output(&program, inputs, outputs);
+            for (int i = 0; i < CGP_OUTPUTS; i++) {
+                mismatches += expected[i] != outputs[i];
+            }
+            cgp_program_output(&lut_program, inputs, outputs);
+            for (int i = 0; i < CGP_OUTPUTS; i++) {
+                lut_mismatches += expected[i] != outputs[i];
+            }
+        }
+    }
+
+    printf("Mismatches: %d\n", mismatches);
+    printf("Removed instructions: %s\n", shorter > 0? "yes" : "no");
+    printf("Mismatches with tables: %d\n", lut_mismatches);
+    printf("Tables used: %s\n", luts > 0? "yes" : "no");
+
+    ga_destroy_chr(chr, cgp_free_genome);
+    cgp_deinit();
+    return 0;
+}
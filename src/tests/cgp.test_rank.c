@@ -0,0 +1,91 @@
+/**
+ * Tests three-input rank functions - simplification of evaluation
+ * program, and chromosome file round trip with three-input nodes.
+ * Compile with -DCGP_FUNC_INPUTS=3
+ * Source files cgp/cgp_core.c cgp/cgp_program.c cgp/cgp_dump.c cgp/cgp_load.c ga.c pool.c random.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../cgp/cgp.h"
+#include "../cgp/cgp_program.h"
+#include "../cgp/cgp_dump.h"
+#include "../cgp/cgp_load.h"
+#include "../random.h"
+
+
+/**
+ * Sets first column nodes and connects output to the first node
+ */
+static void set_nodes(ga_chr_t chr, int count, cgp_func_t functions[],
+    int inputs[][CGP_FUNC_INPUTS])
+{
+    cgp_genome_t genome = (cgp_genome_t) chr->genome;
+    for (int i = 0; i < count; i++) {
+        genome->nodes[i].function = functions[i];
+        for (int k = 0; k < CGP_FUNC_INPUTS; k++) {
+            genome->nodes[i].inputs[k] = inputs[i][k];
+        }
+    }
+    genome->outputs[0] = CGP_INPUTS + count - 1;
+    cgp_find_active_blocks(chr);
+}
+
+
+static void print_program(const char *title, ga_chr_t chr)
+{
+    cgp_program_t program;
+    cgp_program_build(&program, chr);
+    printf("%s: %d instructions", title, program.length);
+    if (program.length > 0) {
+        printf(", last %s", cgp_func_names[program.instrs[program.length - 1].function]);
+    }
+    printf("\n");
+}
+
+
+int main(int argc, char const *argv[])
+{
+    rand_init_seed(42);
+    cgp_init(5, NULL);
+    cgp_set_functions(CGP_FUNC_SET_ALL);
+    ga_chr_t chr = ga_alloc_chr(cgp_alloc_genome);
+    cgp_randomize_genome(chr);
+
+    printf("Three-input nodes: %s\n", CGP_FUNC_INPUTS == 3? "yes" : "no");
+
+    set_nodes(chr, 1, (cgp_func_t[]) {median3}, (int[][3]) {{0, 1, 0}});
+    print_program("median3(a, b, a)", chr);
+
+    set_nodes(chr, 1, (cgp_func_t[]) {min3}, (int[][3]) {{0, 1, 0}});
+    print_program("min3(a, b, a)", chr);
+
+    set_nodes(chr, 2, (cgp_func_t[]) {c255, median3}, (int[][3]) {{0, 0, 0}, {0, CGP_INPUTS, 1}});
+    print_program("median3(a, 255, b)", chr);
+
+    set_nodes(chr, 2, (cgp_func_t[]) {c255, max3}, (int[][3]) {{0, 0, 0}, {0, 1, CGP_INPUTS}});
+    print_program("max3(a, b, 255)", chr);
+
+    set_nodes(chr, 3, (cgp_func_t[]) {min3, min3, b_xor},
+        (int[][3]) {{2, 0, 1}, {1, 2, 0}, {CGP_INPUTS, CGP_INPUTS + 1, 0}});
+    print_program("min3(c, a, b) xor min3(b, c, a)", chr);
+
+    // file round trip
+    cgp_randomize_genome(chr);
+    FILE *fp = tmpfile();
+    cgp_dump_chr_compat(chr, fp);
+    rewind(fp);
+
+    ga_chr_t loaded = ga_alloc_chr(cgp_alloc_genome);
+    int result = cgp_load_chr_compat(loaded, fp);
+    fclose(fp);
+    printf("Loaded: %d, same genome: %s\n", result,
+        memcmp(chr->genome, loaded->genome, sizeof(struct cgp_genome)) == 0? "yes" : "no");
+
+    ga_destroy_chr(loaded, cgp_free_genome);
+    ga_destroy_chr(chr, cgp_free_genome);
+    cgp_deinit();
+    return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * Tests population arena - genomes of fixed size are stored back to back
+ * and aligned, generations are swapped without copying.
+ * Source files ga.c pool.c
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "../ga.h"
+
+
+typedef struct {
+    int genes[20];
+} test_genome_t;
+
+
+static int counter = 0;
+
+
+int init_genome(ga_chr_t chr)
+{
+    test_genome_t *genome = (test_genome_t*) chr->genome;
+    for (int i = 0; i < 20; i++) {
+        genome->genes[i] = counter;
+    }
+    counter++;
+    return 0;
+}
+
+
+int main(int argc, char const *argv[])
+{
+    ga_func_vect_t methods = {
+        .init_genome = init_genome,
+        .genome_size = sizeof(test_genome_t),
+    };
+
+    ga_pop_t pop = ga_create_pop(4, maximize, methods);
+    if (!pop) {
+        printf("Failed to create population\n");
+        return 1;
+    }
+
+    bool aligned = true;
+    bool contiguous = true;
+    uintptr_t first = (uintptr_t) pop->chromosomes[0]->genome;
+    for (int i = 0; i < 2 * pop->size; i++) {
+        ga_chr_t chr = (i < pop->size)? pop->chromosomes[i] : pop->children[i - pop->size];
+        uintptr_t address = (uintptr_t) chr->genome;
+        aligned &= (address % 64) == 0;
+        contiguous &= address == first + i * 128;
+    }
+    printf("Genomes aligned: %s\n", aligned? "yes" : "no");
+    printf("Genomes back to back: %s\n", contiguous? "yes" : "no");
+
+    printf("Genes:");
+    for (int i = 0; i < pop->size; i++) {
+        printf(" %d", ((test_genome_t*) pop->chromosomes[i]->genome)->genes[19]);
+    }
+    printf("\n");
+
+    ga_chr_t child = pop->children[0];
+    ga_swap_generations(pop);
+    printf("Children became chromosomes: %s\n",
+        pop->chromosomes[0] == child? "yes" : "no");
+
+    ga_destroy_pop(pop);
+    return 0;
+}
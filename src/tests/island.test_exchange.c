@@ -0,0 +1,109 @@
+/**
+ * Tests island migration - each island receives from its predecessor,
+ * every migrant only once. Segment is kept until the last island leaves
+ * and segment left by crashed run is reset.
+ * Source files island.c
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "../island.h"
+
+
+void try_receive(const char *name, island_t island, island_channel_t channel)
+{
+    int payload[4] = {0};
+    ga_fitness_t fitness = 0;
+
+    if (island_receive(island, channel, payload, &fitness)) {
+        printf("%s: received %d %d %d %d, fitness %g\n", name,
+            payload[0], payload[1], payload[2], payload[3], fitness);
+    } else {
+        printf("%s: nothing new\n", name);
+    }
+}
+
+
+void check_removed(const char *group)
+{
+    char shm_name[256];
+    snprintf(shm_name, sizeof(shm_name), "/coco-islands-%s", group);
+
+    int fd = shm_open(shm_name, O_RDWR, 0600);
+    if (fd < 0) {
+        printf("segment removed\n");
+    } else {
+        printf("segment still exists\n");
+        close(fd);
+        shm_unlink(shm_name);
+    }
+}
+
+
+int main(int argc, char const *argv[])
+{
+    char group[64];
+    snprintf(group, sizeof(group), "test-%d", (int) getpid());
+
+    size_t sizes[ISLAND_CHANNELS] = {
+        [island_cgp] = sizeof(int) * 4,
+        [island_pred] = sizeof(int) * 2,
+    };
+
+    island_t first = island_create(group, 3, 0, sizes);
+    island_t second = island_create(group, 3, 1, sizes);
+    island_t third = island_create(group, 3, 2, sizes);
+
+    try_receive("second", second, island_cgp);
+
+    int cgp[4] = {1, 2, 3, 4};
+    island_publish(first, island_cgp, cgp, 10);
+    try_receive("second", second, island_cgp);
+    try_receive("second", second, island_cgp);
+    try_receive("third", third, island_cgp);
+    try_receive("first", first, island_cgp);
+
+    int pred[2] = {7, 8};
+    island_publish(third, island_pred, pred, 0.5);
+    try_receive("first", first, island_pred);
+    try_receive("first", first, island_cgp);
+
+    cgp[0] = 5;
+    island_publish(first, island_cgp, cgp, 20);
+    cgp[0] = 6;
+    island_publish(first, island_cgp, cgp, 30);
+    try_receive("second", second, island_cgp);
+
+    // restarted island joins running group
+    island_destroy(first);
+    first = island_create(group, 3, 0, sizes);
+    try_receive("first again", first, island_pred);
+
+    island_destroy(first);
+    island_destroy(second);
+    island_destroy(third);
+    check_removed(group);
+
+    // island of crashed run leaves segment with its migrant
+    snprintf(group, sizeof(group), "test-crashed-%d", (int) getpid());
+    pid_t child = fork();
+    if (child == 0) {
+        island_t crashed = island_create(group, 2, 0, sizes);
+        island_publish(crashed, island_cgp, cgp, 40);
+        _exit(0);
+    }
+    waitpid(child, NULL, 0);
+
+    first = island_create(group, 2, 0, sizes);
+    second = island_create(group, 2, 1, sizes);
+    try_receive("second of new run", second, island_cgp);
+
+    island_destroy(first);
+    island_destroy(second);
+    check_removed(group);
+    return 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * Tests worker pool - every task runs exactly once, in any width.
+ * Source files pool.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include "../pool.h"
+
+
+#define TASKS 1000
+
+
+static atomic_int runs[TASKS];
+
+
+void count_run(void *data, int index)
+{
+    atomic_fetch_add(&runs[index], 1);
+    atomic_fetch_add((atomic_int*) data, index);
+}
+
+
+void run_batch(const char *name, int count)
+{
+    atomic_int sum;
+    atomic_init(&sum, 0);
+    for (int i = 0; i < TASKS; i++) {
+        atomic_init(&runs[i], 0);
+    }
+
+    pool_parallel_for(count, count_run, &sum);
+
+    int wrong = 0;
+    for (int i = 0; i < TASKS; i++) {
+        if (atomic_load(&runs[i]) != (i < count? 1 : 0)) {
+            wrong++;
+        }
+    }
+
+    printf("%s: %d tasks, sum %d, wrong %d\n", name, count, atomic_load(&sum), wrong);
+}
+
+
+int main(int argc, char const *argv[])
+{
+    run_batch("no pool", 10);
+
+    if (pool_init(3) != 0) {
+        printf("pool_init failed\n");
+        return 1;
+    }
+
+    run_batch("all workers", 8);
+    run_batch("all workers", TASKS);
+
+    pool_set_width(1);
+    run_batch("one worker", TASKS);
+
+    pool_set_width(0);
+    run_batch("serial", 10);
+
+    // more tasks than queues can hold
+    pool_set_width(-1);
+    for (int i = 0; i < 20; i++) {
+        run_batch("repeated", TASKS);
+    }
+
+    pool_deinit();
+    return 0;
+}
@@ -0,0 +1,36 @@
+/**
+ * Tests that restored generator state produces the same sequence
+ * Source files random.c
+ */
+
+#include <stdio.h>
+
+#include "../random.h"
+
+
+int main(int argc, char const *argv[])
+{
+    char state[RAND_STATE_SIZE];
+
+    rand_init_seed(42);
+    rand_range(0, 1000);
+
+    rand_save_state(state);
+    int first[5];
+    for (int i = 0; i < 5; i++) {
+        first[i] = rand_range(0, 1000);
+    }
+
+    // reseeding changes sequence
+    rand_init_seed(7);
+    rand_range(0, 1000);
+
+    rand_load_state(state);
+    int same = 0;
+    for (int i = 0; i < 5; i++) {
+        if (rand_range(0, 1000) == first[i]) same++;
+    }
+    printf("same after restore: %d of 5\n", same);
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * Tests binary trace - records survive fixed and compressed round trip,
+ * appending continues the sequence, records after resumed generation
+ * are replaced.
+ * Source files logging/trace.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../logging/trace.h"
+
+
+static void write_records(const char *filename, bool compressed, bool append,
+    int first, int count)
+{
+    trace_t trace = trace_create(filename, compressed, append, first - 1);
+    if (!trace) {
+        printf("Failed to create trace\n");
+        exit(1);
+    }
+
+    for (int i = first; i < first + count; i++) {
+        trace_record_t record = {
+            .generation = i,
+            .flags = TRACE_VALID | ((i % 3 == 0) ? TRACE_REAL_MEASURED : 0),
+            .predicted_fitness = 20.0 + i * 0.25,
+            .real_fitness = 19.5 + (i / 3) * 0.75,
+            .active_predictor_fitness = 1.0 / (i + 1),
+            .pred_length = 64 + (i % 2) * 8,
+            .pred_used_length = 32 - i,
+            .cgp_evals = (int64_t) i * 4096,
+        };
+        trace_append(trace, &record);
+    }
+
+    trace_close(trace);
+}
+
+
+static void dump_records(const char *filename)
+{
+    trace_t trace = trace_open(filename);
+    if (!trace) {
+        printf("Failed to open trace\n");
+        exit(1);
+    }
+
+    trace_record_t record;
+    while (trace_read(trace, &record) > 0) {
+        printf("%d %u %g %g %g %d %d %lld\n",
+            record.generation, record.flags, record.predicted_fitness,
+            record.real_fitness, record.active_predictor_fitness,
+            record.pred_length, record.pred_used_length,
+            (long long) record.cgp_evals);
+    }
+
+    trace_close(trace);
+}
+
+
+int main(int argc, char const *argv[])
+{
+    const char *filename = "trace.test_roundtrip.bin";
+
+    for (int compressed = 0; compressed <= 1; compressed++) {
+        printf("Compressed: %d\n", compressed);
+        write_records(filename, compressed, false, 1, 4);
+        write_records(filename, compressed, true, 5, 3);
+        write_records(filename, compressed, true, 6, 2);
+        dump_records(filename);
+    }
+
+    remove(filename);
+    return 0;
+}
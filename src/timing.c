@@ -0,0 +1,86 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#include "timing.h"
+
+
+const char *timing_phase_names[TIMING_PHASES] = {
+    [timing_cgp_offspring] = "cgp_offspring",
+    [timing_cgp_eval] = "cgp_eval",
+    [timing_pred_offspring] = "pred_offspring",
+    [timing_pred_eval] = "pred_eval",
+    [timing_archive_insert] = "archive_insert",
+    [timing_baldwin_phenotype] = "baldwin_phenotype",
+    [timing_wait_async_parent] = "wait_async_parent",
+    [timing_wait_async_finish] = "wait_async_finish",
+};
+
+
+#ifdef TIMING
+
+
+static timing_slot_t _timing_slots[TIMING_MAX_THREADS];
+static atomic_int _timing_used_slots = 0;
+
+_Thread_local timing_slot_t *_timing_slot = NULL;
+
+
+/**
+ * Assigns counters to calling thread, last slot is shared by all threads
+ * which did not get their own
+ * @return
+ */
+timing_slot_t *_timing_register_thread()
+{
+    int index = atomic_fetch_add(&_timing_used_slots, 1);
+    if (index >= TIMING_MAX_THREADS) {
+        index = TIMING_MAX_THREADS - 1;
+    }
+    _timing_slot = &_timing_slots[index];
+    return _timing_slot;
+}
+
+
+/**
+ * Sums counters of all threads
+ * @param totals
+ */
+void timing_get_totals(timing_totals_t *totals)
+{
+    int used = atomic_load(&_timing_used_slots);
+    if (used > TIMING_MAX_THREADS) {
+        used = TIMING_MAX_THREADS;
+    }
+
+    for (int p = 0; p < TIMING_PHASES; p++) {
+        uint64_t nanoseconds = 0;
+        uint64_t calls = 0;
+        for (int i = 0; i < used; i++) {
+            nanoseconds += atomic_load_explicit(&_timing_slots[i].nanoseconds[p], memory_order_relaxed);
+            calls += atomic_load_explicit(&_timing_slots[i].calls[p], memory_order_relaxed);
+        }
+        totals->seconds[p] = nanoseconds / 1e9;
+        totals->calls[p] = calls;
+    }
+}
+
+
+#endif
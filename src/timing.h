@@ -0,0 +1,136 @@
+/*
+ * Colearning in Coevolutionary Algorithms
+ * Bc. Michal Wiglasz <xwigla00@stud.fit.vutbr.cz>
+ *
+ * Master Thesis
+ * 2014/2015
+ *
+ * Supervisor: Ing. Michaela Šikulová <isikulova@fit.vutbr.cz>
+ *
+ * Faculty of Information Technologies
+ * Brno University of Technology
+ * http://www.fit.vutbr.cz/
+ *
+ * Started on 28/07/2014.
+ *      _       _
+ *   __(.)=   =(.)__
+ *   \___)     (___/
+ */
+
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+
+/*
+    Hot-path timers, enabled by compiling with -DTIMING. Without it all
+    TIMING_* macros expand to nothing and nothing is measured.
+
+    Time is accumulated per thread, so phases executed by several threads
+    at once (e.g. population evaluation) may exceed wall clock time.
+    Phases may be nested (archive insertion includes CGP evaluation).
+ */
+
+
+typedef enum {
+    timing_cgp_offspring,
+    timing_cgp_eval,
+    timing_pred_offspring,
+    timing_pred_eval,
+    timing_archive_insert,
+    timing_baldwin_phenotype,
+    timing_wait_async_parent,
+    timing_wait_async_finish,
+
+    TIMING_PHASES,
+} timing_phase_t;
+
+
+/* phase names, used as CSV columns */
+extern const char *timing_phase_names[TIMING_PHASES];
+
+
+/* maximal number of threads with their own counters */
+#define TIMING_MAX_THREADS 256
+
+
+/*
+    Totals of all threads
+ */
+typedef struct {
+    double seconds[TIMING_PHASES];
+    long calls[TIMING_PHASES];
+} timing_totals_t;
+
+
+#ifdef TIMING
+
+    /*
+        Counters of single thread, on their own cache line
+     */
+    typedef struct {
+        atomic_uint_fast64_t nanoseconds[TIMING_PHASES];
+        atomic_uint_fast64_t calls[TIMING_PHASES];
+    } __attribute__ ((aligned (64))) timing_slot_t;
+
+
+    extern _Thread_local timing_slot_t *_timing_slot;
+
+
+    /**
+     * Assigns counters to calling thread
+     * @return
+     */
+    timing_slot_t *_timing_register_thread();
+
+
+    /**
+     * Returns current monotonic time in nanoseconds
+     */
+    static inline uint64_t timing_now()
+    {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+    }
+
+
+    /**
+     * Adds time elapsed since `start` to given phase
+     * @param phase
+     * @param start Value returned by `timing_now`
+     */
+    static inline void timing_add(timing_phase_t phase, uint64_t start)
+    {
+        uint64_t elapsed = timing_now() - start;
+        timing_slot_t *slot = _timing_slot;
+        if (slot == NULL) {
+            slot = _timing_register_thread();
+        }
+
+        // slot may be shared if there are too many threads
+        atomic_fetch_add_explicit(&slot->nanoseconds[phase], elapsed, memory_order_relaxed);
+        atomic_fetch_add_explicit(&slot->calls[phase], 1, memory_order_relaxed);
+    }
+
+
+    /**
+     * Sums counters of all threads
+     * @param totals
+     */
+    void timing_get_totals(timing_totals_t *totals);
+
+
+    #define TIMING_START(var) uint64_t var = timing_now()
+    #define TIMING_STOP(phase, var) timing_add((phase), (var))
+
+#else
+
+    #define TIMING_START(var)
+    #define TIMING_STOP(phase, var)
+
+#endif